@@ -32,6 +32,7 @@
 #include <formats/rwav.h>
 #endif
 #include <memalign.h>
+#include <retro_perf.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -80,6 +81,8 @@
 #define AUDIO_MIXER_MAX_VOICES      8
 #define AUDIO_MIXER_TEMP_BUFFER 8192
 
+RETRO_PERF_TIMER(perf_mixer_mix, "audio_mixer.mix");
+
 struct audio_mixer_sound
 {
    enum audio_mixer_type type;
@@ -1694,6 +1697,8 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
    float* sample              = NULL;
    audio_mixer_voice_t* voice = s_voices;
 
+   RETRO_PERF_BEGIN(perf_mixer_mix);
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
    {
       float volume;
@@ -1758,6 +1763,8 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
       else if (*sample > 1.0f)
          *sample = 1.0f;
    }
+
+   RETRO_PERF_END(perf_mixer_mix);
 }
 
 void audio_mixer_mix_s16(int16_t* buffer, size_t num_frames,
@@ -1766,6 +1773,8 @@ void audio_mixer_mix_s16(int16_t* buffer, size_t num_frames,
    unsigned i;
    audio_mixer_voice_t* voice = s_voices;
 
+   RETRO_PERF_BEGIN(perf_mixer_mix);
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
    {
       float   volume;
@@ -1825,6 +1834,8 @@ void audio_mixer_mix_s16(int16_t* buffer, size_t num_frames,
       AUDIO_MIXER_UNLOCK(voice);
    }
    /* No final clamp: audio_mixer_mix_*_s16 saturate as they accumulate. */
+
+   RETRO_PERF_END(perf_mixer_mix);
 }
 
 float audio_mixer_voice_get_volume(audio_mixer_voice_t *voice)
@@ -38,6 +38,7 @@
 #include <memalign.h>
 
 #include <audio/audio_resampler.h>
+#include <retro_perf.h>
 
 #ifdef __SSE__
 #include <xmmintrin.h>
@@ -87,6 +88,9 @@ typedef struct rarch_sinc_resampler
    uint32_t time;
    float subphase_mod;
    float kaiser_beta;
+#ifdef HAVE_RETRO_PERF
+   resampler_process_t process; /* kernel, timed by the process wrapper */
+#endif
 } rarch_sinc_resampler_t;
 
 /*
@@ -657,6 +661,19 @@ static void resampler_sinc_process_c(void *re_, struct resampler_data *data)
    data->output_frames = out_frames;
 }
 
+#ifdef HAVE_RETRO_PERF
+RETRO_PERF_TIMER(perf_sinc_process, "resampler.sinc");
+
+static void resampler_sinc_process_perf(void *re_,
+      struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   RETRO_PERF_BEGIN(perf_sinc_process);
+   resamp->process(re_, data);
+   RETRO_PERF_END(perf_sinc_process);
+}
+#endif
+
 static void resampler_sinc_free(void *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)data;
@@ -951,6 +968,11 @@ static void *resampler_sinc_new(const struct resampler_config *config,
 #endif
    }
 
+#ifdef HAVE_RETRO_PERF
+   re->process            = sinc_resampler.process;
+   sinc_resampler.process = resampler_sinc_process_perf;
+#endif
+
    return re;
 
 error:
@@ -52,6 +52,9 @@
 #include <math.h>
 
 #include <audio/sinc_resampler_int16.h>
+#include <retro_perf.h>
+
+RETRO_PERF_TIMER(perf_sinc_i16_process, "resampler.sinc_int16");
 
 /* On targets whose compiler can auto-vectorize an int16*int32->int64 MAC
  * (e.g. AArch64/NEON via smlal), splitting the Kaiser inner loop into a
@@ -402,10 +405,12 @@ static void sinc_i16_process_lanczos(rarch_sinc_resampler_int16_t *re,
 void sinc_resampler_int16_process(void *re_, struct resampler_data_int16 *data)
 {
    rarch_sinc_resampler_int16_t *re = (rarch_sinc_resampler_int16_t*)re_;
+   RETRO_PERF_BEGIN(perf_sinc_i16_process);
    if (re->window == SINC_I16_WINDOW_KAISER)
       sinc_i16_process_kaiser(re, data);
    else
       sinc_i16_process_lanczos(re, data);
+   RETRO_PERF_END(perf_sinc_i16_process);
 }
 
 /* ------------------------------------------------------------------------- */
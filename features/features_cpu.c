@@ -20,6 +20,11 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* sched_setaffinity, for reading CPUID on each CPU in turn */
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -1005,3 +1010,591 @@ end:
    }
 #endif
 }
+
+/* CPU topology */
+
+#ifndef CPU_TOPOLOGY_SYSFS_ROOT
+#define CPU_TOPOLOGY_SYSFS_ROOT "/sys/devices"
+#endif
+
+#define CPU_TOPOLOGY_BIT(i) ((uint64_t)1 << (i))
+
+#if defined(CPU_X86) && !defined(__MACH__)
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+/* x86_cpuid with a sub-leaf in ECX, for leaves 4, 7, 0xB and
+ * 0x8000001D */
+static void x86_cpuid_count(int func, int sub, int32_t flags[4])
+{
+#if defined(__GNUC__)
+   __asm__ volatile (
+         "mov %%" REG_b ", %%" REG_S "\n"
+         "cpuid\n"
+         "xchg %%" REG_b ", %%" REG_S "\n"
+         : "=a"(flags[0]), "=S"(flags[1]), "=c"(flags[2]), "=d"(flags[3])
+         : "a"(func), "c"(sub));
+#elif defined(_MSC_VER) && _MSC_VER >= 1500
+   __cpuidex((int*)flags, func, sub);
+#else
+   memset(flags, 0, 4 * sizeof(int32_t));
+#endif
+}
+#endif
+
+static void cpu_topology_add_cache(cpu_topology_t *topo, unsigned level,
+      unsigned type, uint32_t size, unsigned line_size, uint64_t shared)
+{
+   unsigned i;
+   cpu_cache_info_t *cache;
+
+   for (i = 0; i < topo->cache_count; i++)
+   {
+      cache = &topo->caches[i];
+      if (     cache->level       == level
+            && cache->type        == type
+            && cache->shared_cpus == shared)
+         return;
+   }
+   if (topo->cache_count >= CPU_TOPOLOGY_MAX_CACHES)
+      return;
+   cache              = &topo->caches[topo->cache_count++];
+   cache->shared_cpus = shared;
+   cache->size        = size;
+   cache->line_size   = (uint16_t)line_size;
+   cache->level       = (uint8_t)level;
+   cache->type        = (uint8_t)type;
+}
+
+#if defined(CPU_X86) && !defined(__MACH__)
+/* Deterministic cache parameters: leaf 4 on Intel, 0x8000001D on
+ * AMD.  Only the number of CPUs sharing each cache is reported, so
+ * instances are laid out over consecutively numbered CPUs. */
+static void cpu_topology_x86_caches(cpu_topology_t *topo)
+{
+   int      i;
+   int      leaf;
+   int32_t  flags[4];
+   uint64_t all = 0;
+
+   for (i = 0; i < (int)topo->cpu_count; i++)
+      if (topo->cpus[i].online)
+         all |= CPU_TOPOLOGY_BIT(i);
+
+   x86_cpuid(0, flags);
+   if (flags[1] == 0x68747541) /* "Auth"enticAMD */
+   {
+      x86_cpuid(0x80000000, flags);
+      if ((uint32_t)flags[0] < 0x8000001D)
+         return;
+      leaf = (int)0x8000001D;
+   }
+   else if (flags[0] >= 4)
+      leaf = 4;
+   else
+      return;
+
+   for (i = 0; i < 16; i++)
+   {
+      unsigned type, level, sharing, line, group, first;
+      uint32_t size;
+
+      x86_cpuid_count(leaf, i, flags);
+      if (!(type = flags[0] & 0x1f))
+         break;
+      level   = (flags[0] >> 5) & 0x7;
+      sharing = (((uint32_t)flags[0] >> 14) & 0xfff) + 1;
+      line    = (flags[1] & 0xfff) + 1;
+      size    = (((uint32_t)flags[1] >> 22) + 1)          /* ways */
+              * ((((uint32_t)flags[1] >> 12) & 0x3ff) + 1) /* partitions */
+              * line
+              * ((uint32_t)flags[2] + 1);                  /* sets */
+
+      /* The field is an upper bound rounded to the APIC ID layout */
+      for (group = 1; group < sharing; group <<= 1);
+      for (first = 0; first < topo->cpu_count; first += group)
+      {
+         unsigned j;
+         uint64_t mask = 0;
+         for (j = first; j < first + group && j < CPU_TOPOLOGY_MAX_CPUS; j++)
+            mask |= CPU_TOPOLOGY_BIT(j);
+         if (mask & all)
+            cpu_topology_add_cache(topo, level, type, size, line,
+                  mask & all);
+      }
+   }
+}
+
+/* Logical CPUs per core, from the SMT level of leaf 0xB */
+static unsigned cpu_topology_x86_smt_width(void)
+{
+   int32_t flags[4];
+   x86_cpuid(0, flags);
+   if (flags[0] < 0xB)
+      return 1;
+   x86_cpuid_count(0xB, 0, flags);
+   if (((flags[2] >> 8) & 0xff) != 1 || (flags[1] & 0xffff) == 0)
+      return 1;
+   return flags[1] & 0xffff;
+}
+
+/* Hybrid parts report the type of the core the instruction runs on
+ * (leaf 0x1A), so visit each CPU.  Returns false if the type of some
+ * CPU could not be read. */
+static bool cpu_topology_x86_core_types(cpu_topology_t *topo)
+{
+   unsigned i;
+   int32_t  flags[4];
+   bool     ret = true;
+#if defined(__linux__)
+   cpu_set_t old_set;
+#elif defined(_WIN32) && !defined(_XBOX)
+   DWORD_PTR old_mask = 0;
+#endif
+
+   x86_cpuid(0, flags);
+   if (flags[0] >= 7)
+   {
+      x86_cpuid_count(7, 0, flags);
+      if (!(flags[3] & (1 << 15)))
+         flags[0] = 0; /* not hybrid */
+      else
+         x86_cpuid(0, flags);
+   }
+   else
+      flags[0] = 0;
+
+   if (flags[0] < 0x1A)
+   {
+      /* All cores are alike */
+      for (i = 0; i < topo->cpu_count; i++)
+         topo->cpus[i].type = CPU_CORE_TYPE_PERFORMANCE;
+      return true;
+   }
+
+#if defined(__linux__)
+   if (sched_getaffinity(0, sizeof(old_set), &old_set) != 0)
+      return false;
+#endif
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      if (!topo->cpus[i].online)
+         continue;
+#if defined(__linux__)
+      {
+         cpu_set_t set;
+         CPU_ZERO(&set);
+         CPU_SET(i, &set);
+         if (sched_setaffinity(0, sizeof(set), &set) != 0)
+         {
+            ret = false;
+            continue;
+         }
+      }
+#elif defined(_WIN32) && !defined(_XBOX)
+      {
+         DWORD_PTR prev = SetThreadAffinityMask(GetCurrentThread(),
+               (DWORD_PTR)1 << i);
+         if (!prev)
+         {
+            ret = false;
+            continue;
+         }
+         if (!old_mask)
+            old_mask = prev;
+      }
+#else
+      ret = false;
+      break;
+#endif
+      x86_cpuid_count(0x1A, 0, flags);
+      switch (((uint32_t)flags[0] >> 24) & 0xff)
+      {
+         case 0x20: /* Atom */
+            topo->cpus[i].type = CPU_CORE_TYPE_EFFICIENCY;
+            break;
+         case 0x40: /* Core */
+            topo->cpus[i].type = CPU_CORE_TYPE_PERFORMANCE;
+            break;
+         default:
+            break;
+      }
+   }
+#if defined(__linux__)
+   sched_setaffinity(0, sizeof(old_set), &old_set);
+#elif defined(_WIN32) && !defined(_XBOX)
+   if (old_mask)
+      SetThreadAffinityMask(GetCurrentThread(), old_mask);
+#endif
+   return ret;
+}
+#endif
+
+#if defined(__linux__)
+static bool cpu_topology_read(const char *path, char *s, size_t len)
+{
+   int64_t _len = 0;
+   void   *buf  = NULL;
+
+   if (!filestream_read_file(path, &buf, &_len) || !buf)
+      return false;
+   strlcpy(s, (const char*)buf, len);
+   free(buf);
+   return true;
+}
+
+static bool cpu_topology_read_long(const char *path, long *val)
+{
+   char text[32];
+   if (!cpu_topology_read(path, text, sizeof(text)))
+      return false;
+   *val = strtol(text, NULL, 10);
+   return true;
+}
+
+/* sysfs CPU list: "0-3,8,10-11" */
+static uint64_t cpu_topology_parse_list(const char *s)
+{
+   uint64_t mask = 0;
+
+   while (*s)
+   {
+      char         *end;
+      unsigned long first, last;
+
+      if (*s < '0' || *s > '9')
+      {
+         s++;
+         continue;
+      }
+      first = strtoul(s, &end, 10);
+      last  = first;
+      if (*end == '-')
+         last = strtoul(end + 1, &end, 10);
+      for (; first <= last && first < CPU_TOPOLOGY_MAX_CPUS; first++)
+         mask |= CPU_TOPOLOGY_BIT(first);
+      s = end;
+   }
+   return mask;
+}
+
+static bool cpu_topology_read_list(const char *path, uint64_t *mask)
+{
+   char text[1024];
+   if (!cpu_topology_read(path, text, sizeof(text)))
+      return false;
+   *mask = cpu_topology_parse_list(text);
+   return true;
+}
+
+/* Cache sizes are written like "48K" or "32768K" */
+static uint32_t cpu_topology_parse_size(const char *s)
+{
+   char         *end;
+   unsigned long size = strtoul(s, &end, 10);
+   if (*end == 'K')
+      size <<= 10;
+   else if (*end == 'M')
+      size <<= 20;
+   return (uint32_t)size;
+}
+
+static void cpu_topology_sysfs_caches(cpu_topology_t *topo, unsigned cpu)
+{
+   unsigned i;
+   char     path[256];
+   char     text[64];
+
+   for (i = 0; i < 16; i++)
+   {
+      long     level;
+      long     line = 0;
+      unsigned type = CPU_CACHE_TYPE_UNIFIED;
+      uint32_t size = 0;
+      uint64_t shared;
+      int      n    = snprintf(path, sizeof(path),
+            CPU_TOPOLOGY_SYSFS_ROOT "/system/cpu/cpu%u/cache/index%u/",
+            cpu, i);
+
+      if (n < 0 || (size_t)n >= sizeof(path) - 32)
+         return;
+
+      strlcpy(path + n, "level", sizeof(path) - n);
+      if (!cpu_topology_read_long(path, &level))
+         return;
+      strlcpy(path + n, "type", sizeof(path) - n);
+      if (cpu_topology_read(path, text, sizeof(text)))
+      {
+         if (!strncmp(text, "Data", 4))
+            type = CPU_CACHE_TYPE_DATA;
+         else if (!strncmp(text, "Instruction", 11))
+            type = CPU_CACHE_TYPE_INSTRUCTION;
+      }
+      strlcpy(path + n, "size", sizeof(path) - n);
+      if (cpu_topology_read(path, text, sizeof(text)))
+         size = cpu_topology_parse_size(text);
+      strlcpy(path + n, "coherency_line_size", sizeof(path) - n);
+      cpu_topology_read_long(path, &line);
+      strlcpy(path + n, "shared_cpu_list", sizeof(path) - n);
+      if (!cpu_topology_read_list(path, &shared) || !shared)
+         shared = CPU_TOPOLOGY_BIT(cpu);
+
+      if (size)
+         cpu_topology_add_cache(topo, (unsigned)level, type, size,
+               line > 0 ? (unsigned)line : 0, shared);
+   }
+}
+
+static bool cpu_topology_read_sysfs(cpu_topology_t *topo)
+{
+   unsigned i, j;
+   char     path[256];
+   uint64_t present;
+   uint64_t online;
+   uint64_t core_mask = 0;
+   uint64_t atom_mask = 0;
+   long     package[CPU_TOPOLOGY_MAX_CPUS];
+   long     core_id[CPU_TOPOLOGY_MAX_CPUS];
+   long     capacity[CPU_TOPOLOGY_MAX_CPUS];
+   long     max_capacity = 0;
+   long     min_capacity = 0;
+
+   if (     !cpu_topology_read_list(CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/present", &present)
+         || !present)
+      return false;
+   if (!cpu_topology_read_list(CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/online", &online))
+      online = present;
+
+   for (i = 0; i < CPU_TOPOLOGY_MAX_CPUS; i++)
+   {
+      cpu_logical_info_t *cpu = &topo->cpus[i];
+
+      package[i]  = 0;
+      core_id[i]  = (long)i;
+      capacity[i] = 0;
+      if (!(present & CPU_TOPOLOGY_BIT(i)))
+         continue;
+      topo->cpu_count = i + 1;
+      cpu->online     = (online & CPU_TOPOLOGY_BIT(i)) != 0;
+
+      /* Offline CPUs have no topology directory */
+      snprintf(path, sizeof(path), CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/cpu%u/topology/physical_package_id", i);
+      if (!cpu_topology_read_long(path, &package[i]) || package[i] < 0)
+         package[i] = 0;
+      snprintf(path, sizeof(path), CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/cpu%u/topology/core_id", i);
+      if (!cpu_topology_read_long(path, &core_id[i]))
+         core_id[i] = (long)i;
+      snprintf(path, sizeof(path), CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/cpu%u/topology/thread_siblings_list", i);
+      if (!cpu_topology_read_list(path, &cpu->siblings))
+         cpu->siblings = 0;
+      /* ARM big.LITTLE: relative compute capacity, 1024 = biggest */
+      snprintf(path, sizeof(path), CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/cpu/cpu%u/cpu_capacity", i);
+      if (cpu->online && cpu_topology_read_long(path, &capacity[i]))
+      {
+         if (!max_capacity || capacity[i] > max_capacity)
+            max_capacity = capacity[i];
+         if (!min_capacity || capacity[i] < min_capacity)
+            min_capacity = capacity[i];
+      }
+   }
+
+   /* Number cores and packages densely */
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      cpu_logical_info_t *cpu = &topo->cpus[i];
+      if (!(present & CPU_TOPOLOGY_BIT(i)))
+         continue;
+      for (j = 0; j < i; j++)
+         if (     (present & CPU_TOPOLOGY_BIT(j))
+               && package[j] == package[i]
+               && core_id[j] == core_id[i])
+            break;
+      cpu->core = (j < i) ? topo->cpus[j].core : topo->core_count++;
+      for (j = 0; j < i; j++)
+         if ((present & CPU_TOPOLOGY_BIT(j)) && package[j] == package[i])
+            break;
+      cpu->package = (j < i) ? topo->cpus[j].package : topo->package_count++;
+   }
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      cpu_logical_info_t *cpu = &topo->cpus[i];
+      if (!(present & CPU_TOPOLOGY_BIT(i)) || cpu->siblings)
+         continue;
+      for (j = 0; j < topo->cpu_count; j++)
+         if ((present & CPU_TOPOLOGY_BIT(j)) && topo->cpus[j].core == cpu->core)
+            cpu->siblings |= CPU_TOPOLOGY_BIT(j);
+   }
+
+   /* NUMA nodes */
+   for (i = 0; i < CPU_TOPOLOGY_MAX_CPUS; i++)
+   {
+      uint64_t mask;
+      snprintf(path, sizeof(path), CPU_TOPOLOGY_SYSFS_ROOT
+            "/system/node/node%u/cpulist", i);
+      if (!cpu_topology_read_list(path, &mask) || !mask)
+         continue;
+      topo->numa_node_count++;
+      for (j = 0; j < topo->cpu_count; j++)
+         if (mask & CPU_TOPOLOGY_BIT(j))
+            topo->cpus[j].numa_node = i;
+   }
+   if (!topo->numa_node_count)
+      topo->numa_node_count = 1;
+
+   /* Core types: Intel hybrid PMUs, then ARM capacities, then CPUID */
+   if (     cpu_topology_read_list(CPU_TOPOLOGY_SYSFS_ROOT "/cpu_core/cpus",
+            &core_mask)
+         && cpu_topology_read_list(CPU_TOPOLOGY_SYSFS_ROOT "/cpu_atom/cpus",
+            &atom_mask))
+   {
+      for (i = 0; i < topo->cpu_count; i++)
+      {
+         if (core_mask & CPU_TOPOLOGY_BIT(i))
+            topo->cpus[i].type = CPU_CORE_TYPE_PERFORMANCE;
+         else if (atom_mask & CPU_TOPOLOGY_BIT(i))
+            topo->cpus[i].type = CPU_CORE_TYPE_EFFICIENCY;
+      }
+   }
+   else if (max_capacity)
+   {
+      for (i = 0; i < topo->cpu_count; i++)
+         if (capacity[i])
+            topo->cpus[i].type = (capacity[i] == max_capacity)
+               ? CPU_CORE_TYPE_PERFORMANCE
+               : CPU_CORE_TYPE_EFFICIENCY;
+   }
+#if defined(CPU_X86) && !defined(__MACH__)
+   else
+      cpu_topology_x86_core_types(topo);
+#endif
+
+   for (i = 0; i < topo->cpu_count; i++)
+      if (topo->cpus[i].online)
+         cpu_topology_sysfs_caches(topo, i);
+
+   return true;
+}
+#endif
+
+/* No OS topology: one package, SMT width from CPUID on x86 */
+static void cpu_topology_generic(cpu_topology_t *topo)
+{
+   unsigned i;
+   unsigned smt   = 1;
+   unsigned count = cpu_features_get_core_amount();
+
+   if (count > CPU_TOPOLOGY_MAX_CPUS)
+      count = CPU_TOPOLOGY_MAX_CPUS;
+   if (count < 1)
+      count = 1;
+#if defined(CPU_X86) && !defined(__MACH__)
+   smt = cpu_topology_x86_smt_width();
+   if (!smt || count % smt)
+      smt = 1;
+#endif
+
+   topo->cpu_count       = count;
+   topo->core_count      = count / smt;
+   topo->package_count   = 1;
+   topo->numa_node_count = 1;
+   for (i = 0; i < count; i++)
+   {
+      cpu_logical_info_t *cpu = &topo->cpus[i];
+      unsigned            j;
+      cpu->core     = i / smt;
+      cpu->online   = true;
+      cpu->siblings = 0;
+      for (j = cpu->core * smt; j < (cpu->core + 1) * smt; j++)
+         cpu->siblings |= CPU_TOPOLOGY_BIT(j);
+   }
+#if defined(CPU_X86) && !defined(__MACH__)
+   cpu_topology_x86_core_types(topo);
+#endif
+}
+
+bool cpu_features_get_topology(cpu_topology_t *topo)
+{
+   unsigned i;
+   uint64_t counted = 0;
+
+   if (!topo)
+      return false;
+   memset(topo, 0, sizeof(*topo));
+
+#if defined(__linux__)
+   if (!cpu_topology_read_sysfs(topo))
+#endif
+   {
+      memset(topo, 0, sizeof(*topo));
+      cpu_topology_generic(topo);
+   }
+#if defined(CPU_X86) && !defined(__MACH__)
+   if (!topo->cache_count)
+      cpu_topology_x86_caches(topo);
+#endif
+
+   /* Count cores that have an online CPU, by type */
+   topo->core_count = 0;
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      const cpu_logical_info_t *cpu = &topo->cpus[i];
+      if (!cpu->online || cpu->core >= CPU_TOPOLOGY_MAX_CPUS
+            || (counted & CPU_TOPOLOGY_BIT(cpu->core)))
+         continue;
+      counted |= CPU_TOPOLOGY_BIT(cpu->core);
+      topo->core_count++;
+      if (cpu->type == CPU_CORE_TYPE_PERFORMANCE)
+         topo->performance_core_count++;
+      else if (cpu->type == CPU_CORE_TYPE_EFFICIENCY)
+         topo->efficiency_core_count++;
+   }
+   return topo->cpu_count > 0;
+}
+
+uint64_t cpu_topology_get_mask(const cpu_topology_t *topo,
+      enum cpu_core_type type, bool one_per_core)
+{
+   unsigned i;
+   uint64_t mask = 0;
+
+   if (!topo)
+      return 0;
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      const cpu_logical_info_t *cpu = &topo->cpus[i];
+      if (!cpu->online)
+         continue;
+      if (type != CPU_CORE_TYPE_UNKNOWN && cpu->type != type)
+         continue;
+      /* Skip if a lower-numbered sibling represents this core */
+      if (one_per_core && (cpu->siblings & (CPU_TOPOLOGY_BIT(i) - 1)))
+         continue;
+      mask |= CPU_TOPOLOGY_BIT(i);
+   }
+   return mask;
+}
+
+uint32_t cpu_topology_get_cache_size(const cpu_topology_t *topo,
+      unsigned cpu, unsigned level)
+{
+   unsigned i;
+
+   if (!topo || cpu >= CPU_TOPOLOGY_MAX_CPUS)
+      return 0;
+   for (i = 0; i < topo->cache_count; i++)
+   {
+      const cpu_cache_info_t *cache = &topo->caches[i];
+      if (     cache->level == level
+            && cache->type  != CPU_CACHE_TYPE_INSTRUCTION
+            && (cache->shared_cpus & CPU_TOPOLOGY_BIT(cpu)))
+         return cache->size;
+   }
+   return 0;
+}
@@ -0,0 +1,530 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_perf.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <retro_perf.h>
+
+#ifdef HAVE_RETRO_PERF
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <formats/rjson.h>
+#include <formats/rjson_helpers.h>
+#include <retro_timers.h>
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREAD_STORAGE)
+#include <rthreads/rthreads.h>
+#define RETRO_PERF_RECLAIM
+#endif
+
+#if defined(_MSC_VER)
+#define RETRO_PERF_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define RETRO_PERF_THREAD_LOCAL __thread
+#else
+/* No thread-local storage: the first block is claimed once and shared
+ * by every thread, which is only correct on single-threaded targets */
+#define RETRO_PERF_THREAD_LOCAL
+#endif
+
+/* Calibrate over at least this long when exporting early */
+#define RETRO_PERF_CALIBRATE_USEC 10000
+
+struct retro_perf_slot
+{
+   uint64_t calls;
+   uint64_t total;   /* ticks, or the summed counter values */
+   uint64_t max;     /* ticks */
+   uint32_t histogram[RETRO_PERF_HISTOGRAM_BUCKETS];
+};
+
+struct retro_perf_scope
+{
+   retro_perf_site_t *counter;
+   retro_perf_tick_t     start;
+};
+
+typedef struct retro_perf_thread
+{
+   bool                    owned;    /* under perf_lock */
+   unsigned                depth;
+   struct retro_perf_scope stack[RETRO_PERF_MAX_DEPTH];
+   struct retro_perf_slot  slots[RETRO_PERF_MAX_COUNTERS];
+} retro_perf_thread_t;
+
+static retro_perf_thread_t   perf_threads[RETRO_PERF_MAX_THREADS];
+static retro_atomic_int_t    perf_thread_count;  /* blocks ever claimed */
+static retro_atomic_int_t    perf_thread_total;  /* threads that recorded */
+static retro_atomic_int_t    perf_dropped_threads;
+static RETRO_PERF_THREAD_LOCAL retro_perf_thread_t *perf_current;
+static RETRO_PERF_THREAD_LOCAL bool                 perf_current_dropped;
+
+/* Registry, written under perf_lock and published through
+ * perf_count and each counter's id */
+static retro_perf_site_t *perf_counters[RETRO_PERF_MAX_COUNTERS];
+static retro_atomic_int_t    perf_count;
+static retro_atomic_int_t    perf_lock;
+
+/* Totals of the threads that have exited, under perf_lock */
+static struct retro_perf_slot perf_retired[RETRO_PERF_MAX_COUNTERS];
+static unsigned               perf_retired_threads[RETRO_PERF_MAX_COUNTERS];
+
+#ifdef RETRO_PERF_RECLAIM
+/* Holds the calling thread's block; its destructor retires
+ * the block when the thread exits */
+static sthread_tls_t         perf_key;
+static bool                  perf_key_ready;
+#endif
+
+/* Clock calibration, taken under perf_lock when the first thread
+ * block is claimed and published through perf_clock_ready */
+static retro_perf_tick_t     perf_ticks_start;
+static retro_time_t          perf_usec_start;
+static retro_atomic_int_t    perf_clock_ready;
+
+static void retro_perf_lock(void)
+{
+   while (!retro_atomic_cas_int(&perf_lock, 0, 1))
+      retro_sleep(0);
+}
+
+static void retro_perf_unlock(void)
+{
+   retro_atomic_store_release_int(&perf_lock, 0);
+}
+
+#ifdef RETRO_PERF_RECLAIM
+/* Folds an exiting thread's block into perf_retired and
+ * frees it for the next thread */
+static void retro_perf_thread_retire(void *data)
+{
+   int                  i, b;
+   retro_perf_thread_t *t = (retro_perf_thread_t*)data;
+
+   if (!t)
+      return;
+   retro_perf_lock();
+   for (i = 0; i < RETRO_PERF_MAX_COUNTERS; i++)
+   {
+      const struct retro_perf_slot *slot = &t->slots[i];
+      struct retro_perf_slot       *into = &perf_retired[i];
+      if (!slot->calls)
+         continue;
+      perf_retired_threads[i]++;
+      into->calls += slot->calls;
+      into->total += slot->total;
+      if (slot->max > into->max)
+         into->max = slot->max;
+      for (b = 0; b < RETRO_PERF_HISTOGRAM_BUCKETS; b++)
+         into->histogram[b] += slot->histogram[b];
+   }
+   memset(t->slots, 0, sizeof(t->slots));
+   t->depth = 0;
+   t->owned = false;
+   retro_perf_unlock();
+}
+#endif
+
+static retro_perf_thread_t *retro_perf_thread(void)
+{
+   int                  i, count;
+   retro_perf_thread_t *t = NULL;
+
+   if (perf_current)
+      return perf_current;
+   if (perf_current_dropped)
+      return NULL;
+
+   retro_perf_lock();
+#ifdef RETRO_PERF_RECLAIM
+   if (!perf_key_ready)
+      perf_key_ready = sthread_tls_create_with_dtor(&perf_key,
+            retro_perf_thread_retire);
+#endif
+   count = retro_atomic_load_acquire_int(&perf_thread_count);
+   for (i = 0; i < count && !t; i++)
+      if (!perf_threads[i].owned)
+         t = &perf_threads[i];
+   if (!t && count < RETRO_PERF_MAX_THREADS)
+   {
+      t = &perf_threads[count];
+      retro_atomic_store_release_int(&perf_thread_count, count + 1);
+   }
+   if (t)
+   {
+      t->owned = true;
+      if (!retro_atomic_load_acquire_int(&perf_clock_ready))
+      {
+         perf_usec_start  = cpu_features_get_time_usec();
+         perf_ticks_start = cpu_features_get_perf_counter();
+         retro_atomic_store_release_int(&perf_clock_ready, 1);
+      }
+   }
+   retro_perf_unlock();
+
+   if (!t)
+   {
+      retro_atomic_inc_int(&perf_dropped_threads);
+      perf_current_dropped = true;
+      return NULL;
+   }
+#ifdef RETRO_PERF_RECLAIM
+   if (perf_key_ready)
+      sthread_tls_set(&perf_key, t);
+#endif
+   retro_atomic_inc_int(&perf_thread_total);
+   perf_current = t;
+   return t;
+}
+
+/* Registry index of @counter, registering it on first use; -1 if the
+ * registry is full */
+static int retro_perf_index(retro_perf_site_t *counter)
+{
+   int i, count;
+   int id = retro_atomic_load_acquire_int(&counter->id);
+
+   if (id)
+      return id - 1;
+
+   retro_perf_lock();
+   if (!(id = retro_atomic_load_acquire_int(&counter->id)))
+   {
+      count = retro_atomic_load_acquire_int(&perf_count);
+      for (i = 0; i < count; i++)
+         if (!strcmp(perf_counters[i]->name, counter->name))
+            break;
+      if (i == count)
+      {
+         if (count < RETRO_PERF_MAX_COUNTERS)
+         {
+            perf_counters[count] = counter;
+            retro_atomic_store_release_int(&perf_count, count + 1);
+         }
+         else
+            i = -1;
+      }
+      id = i + 1;
+      retro_atomic_store_release_int(&counter->id, id);
+   }
+   retro_perf_unlock();
+   return id - 1;
+}
+
+static unsigned retro_perf_bucket(uint64_t ticks)
+{
+   unsigned b = 0;
+#if defined(__GNUC__)
+   if (ticks > 1)
+      b = 63 - __builtin_clzll(ticks);
+#else
+   while (ticks > 1)
+   {
+      ticks >>= 1;
+      b++;
+   }
+#endif
+   return (b < RETRO_PERF_HISTOGRAM_BUCKETS)
+      ? b : RETRO_PERF_HISTOGRAM_BUCKETS - 1;
+}
+
+void retro_perf_begin(retro_perf_site_t *counter)
+{
+   retro_perf_thread_t *t = retro_perf_thread();
+
+   if (!t)
+      return;
+   if (t->depth < RETRO_PERF_MAX_DEPTH)
+   {
+      t->stack[t->depth].counter = counter;
+      t->stack[t->depth].start   = cpu_features_get_perf_counter();
+   }
+   t->depth++;
+}
+
+void retro_perf_end(retro_perf_site_t *counter)
+{
+   int                     idx;
+   uint64_t                ticks;
+   struct retro_perf_slot *slot;
+   retro_perf_tick_t       now = cpu_features_get_perf_counter();
+   retro_perf_thread_t    *t   = perf_current;
+
+   if (!t || !t->depth)
+      return;
+   /* Scopes beyond the stack were counted but not recorded */
+   if (--t->depth >= RETRO_PERF_MAX_DEPTH
+         || t->stack[t->depth].counter != counter)
+      return;
+   if ((idx = retro_perf_index(counter)) < 0)
+      return;
+
+   ticks = (now > t->stack[t->depth].start)
+      ? (uint64_t)(now - t->stack[t->depth].start) : 0;
+   slot  = &t->slots[idx];
+   slot->calls++;
+   slot->total += ticks;
+   if (ticks > slot->max)
+      slot->max = ticks;
+   slot->histogram[retro_perf_bucket(ticks)]++;
+}
+
+void retro_perf_add(retro_perf_site_t *counter, uint64_t value)
+{
+   int                     idx;
+   struct retro_perf_slot *slot;
+   retro_perf_thread_t    *t = retro_perf_thread();
+
+   if (!t || (idx = retro_perf_index(counter)) < 0)
+      return;
+   slot         = &t->slots[idx];
+   slot->calls++;
+   slot->total += value;
+}
+
+/* Ticks per microsecond of cpu_features_get_perf_counter() */
+static double retro_perf_ticks_per_usec(void)
+{
+   retro_perf_tick_t ticks;
+   retro_time_t      usec;
+
+   if (!retro_atomic_load_acquire_int(&perf_clock_ready))
+      return 0.0;
+   do
+   {
+      usec  = cpu_features_get_time_usec() - perf_usec_start;
+      ticks = cpu_features_get_perf_counter() - perf_ticks_start;
+   } while (usec < RETRO_PERF_CALIBRATE_USEC && ticks > 0);
+
+   return (usec > 0) ? (double)ticks / (double)usec : 0.0;
+}
+
+static uint64_t retro_perf_ticks_to_ns(uint64_t ticks, double ticks_per_usec)
+{
+   if (ticks_per_usec <= 0.0)
+      return 0;
+   return (uint64_t)((double)ticks * 1000.0 / ticks_per_usec);
+}
+
+/* Upper bound, in ticks, of the bucket holding the @num / @den
+ * quantile of @hist */
+static uint64_t retro_perf_quantile(const uint64_t *hist, uint64_t calls,
+      uint64_t max, unsigned num, unsigned den)
+{
+   unsigned b;
+   uint64_t seen = 0;
+   uint64_t rank = (calls * num + den - 1) / den;
+
+   if (!calls)
+      return 0;
+   if (!rank)
+      rank = 1;
+   for (b = 0; b < RETRO_PERF_HISTOGRAM_BUCKETS; b++)
+   {
+      seen += hist[b];
+      if (seen >= rank)
+      {
+         uint64_t upper = ((uint64_t)2 << b) - 1;
+         return (upper < max) ? upper : max;
+      }
+   }
+   return max;
+}
+
+static void retro_perf_collect(int idx, double ticks_per_usec,
+      retro_perf_stats_t *stats)
+{
+   int      i, b;
+   uint64_t total = 0;
+   uint64_t max   = 0;
+   uint64_t hist[RETRO_PERF_HISTOGRAM_BUCKETS];
+   int      threads = retro_atomic_load_acquire_int(&perf_thread_count);
+
+   if (threads > RETRO_PERF_MAX_THREADS)
+      threads = RETRO_PERF_MAX_THREADS;
+
+   memset(stats, 0, sizeof(*stats));
+   memset(hist, 0, sizeof(hist));
+   stats->name = perf_counters[idx]->name;
+   stats->type = perf_counters[idx]->type;
+
+   /* Locked so that a block being retired is counted once */
+   retro_perf_lock();
+   for (i = -1; i < threads; i++)
+   {
+      const struct retro_perf_slot *slot = (i < 0)
+         ? &perf_retired[idx] : &perf_threads[i].slots[idx];
+      if (!slot->calls)
+         continue;
+      stats->threads += (i < 0) ? perf_retired_threads[idx] : 1;
+      stats->calls   += slot->calls;
+      total          += slot->total;
+      if (slot->max > max)
+         max = slot->max;
+      for (b = 0; b < RETRO_PERF_HISTOGRAM_BUCKETS; b++)
+         hist[b] += slot->histogram[b];
+   }
+   retro_perf_unlock();
+
+   if (stats->type == RETRO_PERF_TYPE_COUNTER)
+   {
+      stats->value = total;
+      return;
+   }
+   stats->total_ns = retro_perf_ticks_to_ns(total, ticks_per_usec);
+   stats->max_ns   = retro_perf_ticks_to_ns(max, ticks_per_usec);
+   if (stats->calls)
+      stats->mean_ns = stats->total_ns / stats->calls;
+   stats->p50_ns   = retro_perf_ticks_to_ns(
+         retro_perf_quantile(hist, stats->calls, max, 50, 100),
+         ticks_per_usec);
+   stats->p99_ns   = retro_perf_ticks_to_ns(
+         retro_perf_quantile(hist, stats->calls, max, 99, 100),
+         ticks_per_usec);
+}
+
+bool retro_perf_get_stats(const char *name, retro_perf_stats_t *stats)
+{
+   int i;
+   int count = retro_atomic_load_acquire_int(&perf_count);
+
+   if (!name || !stats)
+      return false;
+   for (i = 0; i < count; i++)
+   {
+      if (strcmp(perf_counters[i]->name, name))
+         continue;
+      retro_perf_collect(i, retro_perf_ticks_per_usec(), stats);
+      return true;
+   }
+   return false;
+}
+
+static void retro_perf_json_key(rjsonwriter_t *writer, const char *key)
+{
+   rjsonwriter_add_string(writer, key);
+   rjsonwriter_add_colon(writer);
+   rjsonwriter_add_space(writer);
+}
+
+static void retro_perf_json_uint64(rjsonwriter_t *writer, const char *key,
+      uint64_t value)
+{
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_perf_json_key(writer, key);
+   rjsonwriter_add_uint64(writer, value);
+}
+
+bool retro_perf_write_json(struct rjsonwriter *writer)
+{
+   int    i;
+   double ticks_per_usec;
+   int    count   = retro_atomic_load_acquire_int(&perf_count);
+   int    threads = retro_atomic_load_acquire_int(&perf_thread_total);
+
+   if (!writer)
+      return false;
+
+   ticks_per_usec = retro_perf_ticks_per_usec();
+
+   rjsonwriter_add_start_object(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_tab(writer);
+   retro_perf_json_key(writer, "ticks_per_usec");
+   rjsonwriter_add_double(writer, ticks_per_usec);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_tab(writer);
+   retro_perf_json_key(writer, "threads");
+   rjsonwriter_add_int(writer, threads);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_tab(writer);
+   retro_perf_json_key(writer, "dropped_threads");
+   rjsonwriter_add_int(writer,
+         retro_atomic_load_acquire_int(&perf_dropped_threads));
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_tab(writer);
+   retro_perf_json_key(writer, "counters");
+   rjsonwriter_add_start_array(writer);
+
+   for (i = 0; i < count; i++)
+   {
+      retro_perf_stats_t stats;
+      retro_perf_collect(i, ticks_per_usec, &stats);
+
+      if (i)
+         rjsonwriter_add_comma(writer);
+      rjsonwriter_add_newline(writer);
+      rjsonwriter_add_tabs(writer, 2);
+      rjsonwriter_add_start_object(writer);
+      retro_perf_json_key(writer, "name");
+      rjsonwriter_add_string(writer, stats.name);
+      rjsonwriter_add_comma(writer);
+      rjsonwriter_add_space(writer);
+      retro_perf_json_key(writer, "type");
+      rjsonwriter_add_string(writer,
+            (stats.type == RETRO_PERF_TYPE_TIMER) ? "timer" : "counter");
+      retro_perf_json_uint64(writer, "threads", stats.threads);
+      retro_perf_json_uint64(writer, "calls", stats.calls);
+      if (stats.type == RETRO_PERF_TYPE_TIMER)
+      {
+         retro_perf_json_uint64(writer, "total_ns", stats.total_ns);
+         retro_perf_json_uint64(writer, "mean_ns",  stats.mean_ns);
+         retro_perf_json_uint64(writer, "p50_ns",   stats.p50_ns);
+         retro_perf_json_uint64(writer, "p99_ns",   stats.p99_ns);
+         retro_perf_json_uint64(writer, "max_ns",   stats.max_ns);
+      }
+      else
+         retro_perf_json_uint64(writer, "value", stats.value);
+      rjsonwriter_add_end_object(writer);
+   }
+
+   if (count)
+   {
+      rjsonwriter_add_newline(writer);
+      rjsonwriter_add_tab(writer);
+   }
+   rjsonwriter_add_end_array(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_end_object(writer);
+   rjsonwriter_add_newline(writer);
+   return true;
+}
+
+void retro_perf_reset(void)
+{
+   int i;
+   int threads = retro_atomic_load_acquire_int(&perf_thread_count);
+
+   if (threads > RETRO_PERF_MAX_THREADS)
+      threads = RETRO_PERF_MAX_THREADS;
+   retro_perf_lock();
+   for (i = 0; i < threads; i++)
+      memset(perf_threads[i].slots, 0, sizeof(perf_threads[i].slots));
+   memset(perf_retired, 0, sizeof(perf_retired));
+   memset(perf_retired_threads, 0, sizeof(perf_retired_threads));
+   retro_perf_unlock();
+}
+#endif
@@ -0,0 +1,413 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_trace.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <retro_trace.h>
+
+#ifdef HAVE_RETRO_TRACE
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <formats/rjson.h>
+#include <formats/rjson_helpers.h>
+#include <compat/strl.h>
+
+#if defined(HAVE_THREADS) && defined(HAVE_THREAD_STORAGE)
+#include <rthreads/rthreads.h>
+#define RETRO_TRACE_RECLAIM
+#endif
+
+#if defined(_MSC_VER)
+#define RETRO_TRACE_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define RETRO_TRACE_THREAD_LOCAL __thread
+#else
+/* No thread-local storage: the first ring is claimed once and shared
+ * by every thread, which is only correct on single-threaded targets */
+#define RETRO_TRACE_THREAD_LOCAL
+#endif
+
+#define RETRO_TRACE_RING_MASK ((size_t)RETRO_TRACE_RING_EVENTS - 1)
+
+/* Calibrate over at least this long when writing early */
+#define RETRO_TRACE_CALIBRATE_USEC 10000
+
+typedef struct retro_trace_record
+{
+   const char       *name;
+   retro_perf_tick_t ts;
+   int64_t           value;
+   unsigned          phase;
+} retro_trace_record_t;
+
+typedef struct retro_trace_ring
+{
+   retro_trace_record_t *events;
+   retro_atomic_size_t   head;       /* events written, release-stored */
+   retro_atomic_int_t    generation; /* trace_generation the events belong to */
+   retro_atomic_int_t    ready;      /* events allocated */
+   retro_atomic_int_t    owned;      /* a live thread records into it */
+   char                  name[32];
+} retro_trace_ring_t;
+
+retro_atomic_int_t retro_trace_active;
+
+static retro_trace_ring_t trace_rings[RETRO_TRACE_MAX_THREADS];
+static retro_atomic_int_t trace_ring_count;
+static retro_atomic_int_t trace_generation;
+static RETRO_TRACE_THREAD_LOCAL retro_trace_ring_t *trace_current;
+static RETRO_TRACE_THREAD_LOCAL bool                trace_current_dropped;
+/* Kept until the thread records its first event and claims a ring,
+ * so that naming a thread that is never traced costs no ring */
+static RETRO_TRACE_THREAD_LOCAL char                trace_current_name[32];
+
+/* Clock at retro_trace_start(), published by the generation bump */
+static retro_perf_tick_t  trace_ticks_start;
+static retro_time_t       trace_usec_start;
+
+#ifdef RETRO_TRACE_RECLAIM
+/* Holds the calling thread's ring; its destructor hands the
+ * ring back when the thread exits */
+static sthread_tls_t      trace_key;
+static bool               trace_key_ready;
+
+static void retro_trace_ring_release(void *data)
+{
+   retro_trace_ring_t *ring = (retro_trace_ring_t*)data;
+   if (ring)
+      retro_atomic_store_release_int(&ring->owned, 0);
+}
+
+/* Takes over the ring of a thread that has exited, dropping
+ * its events. With @stale_only, only a ring whose events
+ * predate the current retro_trace_start() qualifies. */
+static retro_trace_ring_t *retro_trace_ring_reuse(bool stale_only)
+{
+   int i;
+   int gen   = retro_atomic_load_acquire_int(&trace_generation);
+   int count = retro_atomic_load_acquire_int(&trace_ring_count);
+
+   if (count > RETRO_TRACE_MAX_THREADS)
+      count = RETRO_TRACE_MAX_THREADS;
+   for (i = 0; i < count; i++)
+   {
+      retro_trace_ring_t *ring = &trace_rings[i];
+      if (     !retro_atomic_load_acquire_int(&ring->ready)
+            || retro_atomic_load_acquire_int(&ring->owned)
+            || (stale_only && retro_atomic_load_acquire_int(
+                  &ring->generation) == gen)
+            || !retro_atomic_cas_int(&ring->owned, 0, 1))
+         continue;
+      /* No event of the new generation yet: the first one
+       * empties the ring, as after retro_trace_start() */
+      retro_atomic_store_release_int(&ring->generation, 0);
+      retro_atomic_store_release_size(&ring->head, 0);
+      strlcpy(ring->name, trace_current_name, sizeof(ring->name));
+      return ring;
+   }
+   return NULL;
+}
+#endif
+
+/* Sets up ring @idx, which nothing has used yet */
+static retro_trace_ring_t *retro_trace_ring_new(int idx)
+{
+   retro_trace_ring_t *ring = &trace_rings[idx];
+   ring->events = (retro_trace_record_t*)malloc(
+         RETRO_TRACE_RING_EVENTS * sizeof(*ring->events));
+   if (!ring->events)
+      return NULL;
+   strlcpy(ring->name, trace_current_name, sizeof(ring->name));
+   retro_atomic_store_release_int(&ring->owned, 1);
+   retro_atomic_store_release_int(&ring->ready, 1);
+   return ring;
+}
+
+static retro_trace_ring_t *retro_trace_ring(void)
+{
+   int                 idx;
+   retro_trace_ring_t *ring = NULL;
+
+   if (trace_current)
+      return trace_current;
+   if (trace_current_dropped)
+      return NULL;
+
+#ifdef RETRO_TRACE_RECLAIM
+   /* Prefer a ring with nothing worth keeping, then a new
+    * one; the events of exited threads are only dropped
+    * once every ring has been handed out */
+   if (trace_key_ready)
+      ring = retro_trace_ring_reuse(true);
+#endif
+   while (!ring)
+   {
+      idx = retro_atomic_load_acquire_int(&trace_ring_count);
+      if (idx >= RETRO_TRACE_MAX_THREADS)
+         break;
+      if (retro_atomic_cas_int(&trace_ring_count, idx, idx + 1))
+      {
+         if (!(ring = retro_trace_ring_new(idx)))
+            break;
+      }
+   }
+#ifdef RETRO_TRACE_RECLAIM
+   if (!ring && trace_key_ready)
+      ring = retro_trace_ring_reuse(false);
+   if (ring && trace_key_ready)
+      sthread_tls_set(&trace_key, ring);
+#endif
+
+   if (!ring)
+   {
+      trace_current_dropped = true;
+      return NULL;
+   }
+   trace_current = ring;
+   return ring;
+}
+
+void retro_trace_event(enum retro_trace_phase phase, const char *name,
+      int64_t value)
+{
+   size_t                head;
+   retro_trace_record_t *ev;
+   retro_perf_tick_t     now  = cpu_features_get_perf_counter();
+   int                   gen  = retro_atomic_load_acquire_int(
+         &trace_generation);
+   retro_trace_ring_t   *ring = retro_trace_ring();
+
+   if (!ring)
+      return;
+
+   /* First event since retro_trace_start(): drop the old ones */
+   if (retro_atomic_load_acquire_int(&ring->generation) != gen)
+   {
+      retro_atomic_store_release_size(&ring->head, 0);
+      retro_atomic_store_release_int(&ring->generation, gen);
+   }
+
+   head      = retro_atomic_load_acquire_size(&ring->head);
+   ev        = &ring->events[head & RETRO_TRACE_RING_MASK];
+   ev->name  = name;
+   ev->ts    = now;
+   ev->value = value;
+   ev->phase = phase;
+   retro_atomic_store_release_size(&ring->head, head + 1);
+}
+
+void retro_trace_set_thread_name(const char *name)
+{
+   if (!name)
+      return;
+   strlcpy(trace_current_name, name, sizeof(trace_current_name));
+   if (trace_current)
+      strlcpy(trace_current->name, name, sizeof(trace_current->name));
+}
+
+void retro_trace_start(void)
+{
+#ifdef RETRO_TRACE_RECLAIM
+   /* Nothing records before the first start, so no ring
+    * is claimed before the key exists */
+   if (!trace_key_ready)
+      trace_key_ready = sthread_tls_create_with_dtor(&trace_key,
+            retro_trace_ring_release);
+#endif
+   trace_usec_start  = cpu_features_get_time_usec();
+   trace_ticks_start = cpu_features_get_perf_counter();
+   retro_atomic_inc_int(&trace_generation);
+   retro_atomic_store_release_int(&retro_trace_active, 1);
+}
+
+void retro_trace_stop(void)
+{
+   retro_atomic_store_release_int(&retro_trace_active, 0);
+}
+
+/* Ticks per microsecond of cpu_features_get_perf_counter() */
+static double retro_trace_ticks_per_usec(void)
+{
+   retro_perf_tick_t ticks;
+   retro_time_t      usec;
+
+   do
+   {
+      usec  = cpu_features_get_time_usec() - trace_usec_start;
+      ticks = cpu_features_get_perf_counter() - trace_ticks_start;
+   } while (usec < RETRO_TRACE_CALIBRATE_USEC && ticks > 0);
+
+   return (usec > 0) ? (double)ticks / (double)usec : 0.0;
+}
+
+static void retro_trace_json_key(rjsonwriter_t *writer, const char *key)
+{
+   rjsonwriter_add_string(writer, key);
+   rjsonwriter_add_colon(writer);
+   rjsonwriter_add_space(writer);
+}
+
+static void retro_trace_json_begin(rjsonwriter_t *writer, bool *first,
+      const char *name, const char *phase, unsigned tid)
+{
+   if (!*first)
+      rjsonwriter_add_comma(writer);
+   *first = false;
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_tab(writer);
+   rjsonwriter_add_start_object(writer);
+   retro_trace_json_key(writer, "name");
+   rjsonwriter_add_string(writer, name);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_trace_json_key(writer, "ph");
+   rjsonwriter_add_string(writer, phase);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_trace_json_key(writer, "pid");
+   rjsonwriter_add_int(writer, 1);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_trace_json_key(writer, "tid");
+   rjsonwriter_add_unsigned(writer, tid);
+}
+
+static void retro_trace_json_event(rjsonwriter_t *writer, bool *first,
+      const retro_trace_record_t *ev, unsigned tid, double ticks_per_usec)
+{
+   static const char *phases[] = { "B", "E", "i", "C" };
+   double ts = 0.0;
+
+   /* Microseconds, rounded to the nanosecond displayTimeUnit */
+   if (ticks_per_usec > 0.0 && ev->ts > trace_ticks_start)
+      ts = (double)(int64_t)((double)(ev->ts - trace_ticks_start)
+            * 1000.0 / ticks_per_usec + 0.5) / 1000.0;
+
+   retro_trace_json_begin(writer, first, ev->name,
+         phases[ev->phase & 3], tid);
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_trace_json_key(writer, "ts");
+   rjsonwriter_add_double(writer, ts);
+
+   if (ev->phase == RETRO_TRACE_PHASE_INSTANT)
+   {
+      rjsonwriter_add_comma(writer);
+      rjsonwriter_add_space(writer);
+      retro_trace_json_key(writer, "s");
+      rjsonwriter_add_string(writer, "t");
+   }
+   else if (ev->phase == RETRO_TRACE_PHASE_COUNTER)
+   {
+      rjsonwriter_add_comma(writer);
+      rjsonwriter_add_space(writer);
+      retro_trace_json_key(writer, "args");
+      rjsonwriter_add_start_object(writer);
+      retro_trace_json_key(writer, "value");
+      rjsonwriter_add_int64(writer, ev->value);
+      rjsonwriter_add_end_object(writer);
+   }
+   rjsonwriter_add_end_object(writer);
+}
+
+bool retro_trace_write_json(struct rjsonwriter *writer)
+{
+   int                   i, count, gen;
+   double                ticks_per_usec;
+   bool                  first = true;
+   retro_trace_record_t *copy;
+
+   if (!writer)
+      return false;
+   if (!(copy = (retro_trace_record_t*)malloc(
+               RETRO_TRACE_RING_EVENTS * sizeof(*copy))))
+      return false;
+
+   gen            = retro_atomic_load_acquire_int(&trace_generation);
+   count          = retro_atomic_load_acquire_int(&trace_ring_count);
+   ticks_per_usec = gen ? retro_trace_ticks_per_usec() : 0.0;
+   if (count > RETRO_TRACE_MAX_THREADS)
+      count = RETRO_TRACE_MAX_THREADS;
+
+   rjsonwriter_add_start_object(writer);
+   retro_trace_json_key(writer, "displayTimeUnit");
+   rjsonwriter_add_string(writer, "ns");
+   rjsonwriter_add_comma(writer);
+   rjsonwriter_add_space(writer);
+   retro_trace_json_key(writer, "traceEvents");
+   rjsonwriter_add_start_array(writer);
+
+   for (i = 0; i < count; i++)
+   {
+      size_t              j, lo, first_copied, h1, h2;
+      retro_trace_ring_t *ring = &trace_rings[i];
+      unsigned            tid  = (unsigned)i + 1;
+
+      if (!retro_atomic_load_acquire_int(&ring->ready))
+         continue;
+
+      if (ring->name[0])
+      {
+         retro_trace_json_begin(writer, &first, "thread_name", "M", tid);
+         rjsonwriter_add_comma(writer);
+         rjsonwriter_add_space(writer);
+         retro_trace_json_key(writer, "args");
+         rjsonwriter_add_start_object(writer);
+         retro_trace_json_key(writer, "name");
+         rjsonwriter_add_string(writer, ring->name);
+         rjsonwriter_add_end_object(writer);
+         rjsonwriter_add_end_object(writer);
+      }
+
+      if (retro_atomic_load_acquire_int(&ring->generation) != gen)
+         continue;
+
+      h1 = retro_atomic_load_acquire_size(&ring->head);
+      lo = (h1 > RETRO_TRACE_RING_EVENTS) ? h1 - RETRO_TRACE_RING_EVENTS : 0;
+      for (j = lo; j < h1; j++)
+         copy[j - lo] = ring->events[j & RETRO_TRACE_RING_MASK];
+
+      /* The thread may have lapped the oldest copied events, or been
+       * restarted, while they were copied */
+      h2 = retro_atomic_load_acquire_size(&ring->head);
+      if (     h2 < h1
+            || retro_atomic_load_acquire_int(&ring->generation) != gen)
+         continue;
+      first_copied = lo;
+      if (h2 + 1 > lo + RETRO_TRACE_RING_EVENTS)
+         lo = h2 + 1 - RETRO_TRACE_RING_EVENTS;
+
+      for (j = lo; j < h1; j++)
+         retro_trace_json_event(writer, &first, &copy[j - first_copied],
+               tid, ticks_per_usec);
+   }
+
+   if (!first)
+      rjsonwriter_add_newline(writer);
+   rjsonwriter_add_end_array(writer);
+   rjsonwriter_add_end_object(writer);
+   rjsonwriter_add_newline(writer);
+
+   free(copy);
+   return true;
+}
+#endif
@@ -39,15 +39,120 @@
 
 #define MAX_INCLUDE_DEPTH 16
 
+/* Snapshot layout (native byte order, see config_file_new_cached):
+ *   header
+ *   sources[num_sources]      - [0] is the config itself
+ *   entries[num_entries]      - in list order
+ *   includes[num_includes]    - string offsets
+ *   references[num_refs]      - string offsets
+ *   strings[strings_len]      - NUL-terminated, last byte is NUL
+ * A snapshot written on a host of different endianness fails
+ * the magic check and is simply regenerated. */
+#define CONFIG_SNAPSHOT_MAGIC   0x53464352 /* 'RCFS' */
+#define CONFIG_SNAPSHOT_VERSION 1
+
+struct config_snapshot_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_sources;
+   uint32_t num_entries;
+   uint32_t num_includes;
+   uint32_t num_refs;
+   uint32_t strings_len;
+   uint32_t reserved;
+};
+
+struct config_snapshot_source
+{
+   int64_t  mtime;
+   int64_t  size;
+   uint32_t path;
+   uint32_t reserved;
+};
+
+struct config_snapshot_entry
+{
+   uint32_t key;
+   uint32_t value;
+   uint32_t readonly;
+};
+
 struct config_include_list
 {
    char *path;
    struct config_include_list *next;
 };
 
+/* A file pulled in through #include, stamped with its
+ * size and mtime as they were just before it was read
+ * (-1 for a file that could not be found) */
+struct config_source_list
+{
+   char *path;
+   int64_t mtime;
+   int64_t size;
+   struct config_source_list *next;
+};
+
+/* Storage for a config parsed in place: the raw file
+ * buffer that keys and values point into, followed by
+ * one block of entry nodes. Entries that are added or
+ * modified later on still live on the heap, so anything
+ * that frees entry data has to check ownership first
+ * (see config_file_arena_owns). */
+struct config_file_arena
+{
+   struct config_file_arena *next;
+   char *buf;
+   size_t buf_len;
+   size_t count;
+   size_t capacity;
+   struct config_entry_list nodes[1];
+};
+
 /* Forward declaration */
 static bool config_file_parse_line(config_file_t *conf,
-      struct config_entry_list *list, char *line, config_file_cb_t *cb);
+      struct config_entry_list *list, char *line, config_file_cb_t *cb,
+      bool in_place);
+
+static bool config_file_arena_owns(const config_file_t *conf,
+      const void *ptr)
+{
+   const char                       *p = (const char*)ptr;
+   const struct config_file_arena *arena;
+
+   for (arena = conf->arenas; arena; arena = arena->next)
+   {
+      if (p >= arena->buf && p < arena->buf + arena->buf_len)
+         return true;
+      if (     p >= (const char*)arena->nodes
+            && p <  (const char*)(arena->nodes + arena->capacity))
+         return true;
+   }
+
+   return false;
+}
+
+static struct config_file_arena *config_file_arena_new(
+      char *buf, size_t len, size_t capacity)
+{
+   struct config_file_arena *arena = NULL;
+
+   if (capacity < 1)
+      capacity = 1;
+
+   if (!(arena = (struct config_file_arena*)malloc(sizeof(*arena)
+         + (capacity - 1) * sizeof(struct config_entry_list))))
+      return NULL;
+
+   arena->next     = NULL;
+   arena->buf      = buf;
+   arena->buf_len  = len + 1;
+   arena->count    = 0;
+   arena->capacity = capacity;
+   return arena;
+}
 
 static int config_file_sort_compare_func(struct config_entry_list *a,
       struct config_entry_list *b)
@@ -205,7 +310,7 @@ static char *config_file_strip_comment(char *str)
    return NULL;
 }
 
-static char *config_file_extract_value(char *line)
+static char *config_file_extract_value(char *line, bool in_place)
 {
    while (*line == ' ' || *line == '\t' || *line == '\r' || *line == '\n')
       line++;
@@ -235,7 +340,7 @@ static char *config_file_extract_value(char *line)
 
          line[idx] = '\0';
          if ((value = line) && *value)
-            return strdup(value);
+            return in_place ? value : strdup(value);
       }
    }
    /* This is not a string literal - just read
@@ -251,11 +356,19 @@ static char *config_file_extract_value(char *line)
 
       line[idx] = '\0';
       if ((value = line) && *value)
-         return strdup(value);
+         return in_place ? value : strdup(value);
    }
 
    /* Note 2: Return an empty string.
-    * calloc gives us a NUL-terminated empty string in one call. */
+    * In place, 'line' sits on either the closing (")
+    * or the terminating NUL - both can serve as one.
+    * Otherwise calloc gives us a NUL-terminated empty
+    * string in one call. */
+   if (in_place)
+   {
+      *line = '\0';
+      return line;
+   }
    return (char*)calloc(1, 1);
 }
 
@@ -342,9 +455,43 @@ static void config_file_add_child_list(config_file_t *parent,
       child->entries_map  = NULL;
    }
 
+   /* Nested includes are sources of the parent too */
+   if (child->sources)
+   {
+      if (parent->sources)
+      {
+         struct config_source_list *head = parent->sources;
+         while (head->next)
+            head = head->next;
+         head->next      = child->sources;
+      }
+      else
+         parent->sources = child->sources;
+      child->sources     = NULL;
+   }
+
    child->entries = NULL;
 }
 
+static bool config_file_add_source(config_file_t *conf,
+      const char *path, int64_t mtime, int64_t size)
+{
+   struct config_source_list *node = (struct config_source_list*)
+      malloc(sizeof(*node));
+   if (!node)
+      return false;
+   if (!(node->path = strdup(path)))
+   {
+      free(node);
+      return false;
+   }
+   node->mtime   = mtime;
+   node->size    = size;
+   node->next    = conf->sources;
+   conf->sources = node;
+   return true;
+}
+
 static void config_file_get_realpath(char *s, size_t len,
       char *path, const char *config_path)
 {
@@ -469,11 +616,12 @@ static int config_file_load_internal(
       }
 
       list->readonly  = false;
+      list->dirty     = false;
       list->key       = NULL;
       list->value     = NULL;
       list->next      = NULL;
 
-      if (config_file_parse_line(conf, list, line, cb))
+      if (config_file_parse_line(conf, list, line, cb, false))
       {
          if (conf->entries)
             conf->tail->next = list;
@@ -510,7 +658,8 @@ static int config_file_load_internal(
 }
 
 static bool config_file_parse_line(config_file_t *conf,
-      struct config_entry_list *list, char *line, config_file_cb_t *cb)
+      struct config_entry_list *list, char *line, config_file_cb_t *cb,
+      bool in_place)
 {
    size_t idx            = 0;
    char *key             = NULL;
@@ -534,9 +683,10 @@ static bool config_file_parse_line(config_file_t *conf,
          config_file_t sub_conf;
          char real_path[PATH_MAX_LENGTH];
          char *include_line = comment + (sizeof("include ")-1);
+         real_path[0]       = '\0';
          if (*include_line == '\0')
             return false;
-         if (!(path = config_file_extract_value(include_line)))
+         if (!(path = config_file_extract_value(include_line, false)))
             return false;
          if (     *path == '\0'
                || conf->include_depth >= MAX_INCLUDE_DEPTH)
@@ -546,6 +696,17 @@ static bool config_file_parse_line(config_file_t *conf,
          }
          config_file_add_sub_conf(conf, path,
             real_path, sizeof(real_path), cb);
+         /* Record the include even if it cannot be
+          * loaded - its later appearance invalidates
+          * any snapshot of this config. Stamped before
+          * reading, so that an edit racing the parse
+          * leaves the snapshot stale rather than wrong */
+         if (*real_path)
+         {
+            int64_t size  = path_get_size(real_path);
+            int64_t mtime = (size < 0) ? -1 : path_get_mtime(real_path);
+            config_file_add_source(conf, real_path, mtime, size);
+         }
          config_file_initialize(&sub_conf);
          switch (config_file_load_internal(&sub_conf, real_path,
             conf->include_depth + 1, cb))
@@ -569,7 +730,7 @@ static bool config_file_parse_line(config_file_t *conf,
          char *reference_line = comment + (sizeof("reference ")-1);
          if (*reference_line == '\0')
             return false;
-         if (!(path = config_file_extract_value(reference_line)))
+         if (!(path = config_file_extract_value(reference_line, false)))
             return false;
          config_file_add_reference(conf, path);
          if (!path)
@@ -584,16 +745,29 @@ static bool config_file_parse_line(config_file_t *conf,
    /* Measure key length first (up to next non-graph char),
     * then copy once - avoids malloc+realloc growth pattern */
    {
-      const char *key_start = line;
+      char *key_start = line;
       while (isgraph((unsigned char)*line))
          line++;
       idx = (size_t)(line - key_start);
       if (idx == 0)
          return false;
-      if (!(key = (char*)malloc(idx + 1)))
-         return false;
-      memcpy(key, key_start, idx);
-      key[idx] = '\0';
+      if (in_place)
+      {
+         /* Terminate the key by overwriting the whitespace
+          * that follows it. Anything else (NUL, high-bit
+          * byte) cannot be followed by a valid '=' */
+         if (*line != ' ' && *line != '\t' && *line != '\r')
+            return false;
+         *line++ = '\0';
+         key     = key_start;
+      }
+      else
+      {
+         if (!(key = (char*)malloc(idx + 1)))
+            return false;
+         memcpy(key, key_start, idx);
+         key[idx] = '\0';
+      }
    }
    /* Add key and value entries to list */
    list->key     = key;
@@ -606,14 +780,16 @@ static bool config_file_parse_line(config_file_t *conf,
    {
       list->value = NULL;
       list->key   = NULL;
-      free(key);
+      if (!in_place)
+         free(key);
       return false;
    }
    line++;
-   if (!(list->value   = config_file_extract_value(line)))
+   if (!(list->value   = config_file_extract_value(line, in_place)))
    {
       list->key   = NULL;
-      free(key);
+      if (!in_place)
+         free(key);
       return false;
    }
    return true;
@@ -622,7 +798,8 @@ static bool config_file_parse_line(config_file_t *conf,
 static int config_file_from_string_internal(
       struct config_file *conf,
       char *from_string,
-      const char *path)
+      const char *path,
+      struct config_file_arena *arena)
 {
    char *line                     = from_string;
    if (path && *path)
@@ -638,15 +815,17 @@ static int config_file_from_string_internal(
       /* Parse current line */
       if (*line)
       {
-         list = (struct config_entry_list*)
-               malloc(sizeof(*list));
-         if (!list)
+         if (arena && arena->count < arena->capacity)
+            list = &arena->nodes[arena->count++];
+         else if (!(list = (struct config_entry_list*)
+               malloc(sizeof(*list))))
             return -1;
          list->readonly  = false;
+         list->dirty     = false;
          list->key       = NULL;
          list->value     = NULL;
          list->next      = NULL;
-         if (config_file_parse_line(conf, list, line, NULL))
+         if (config_file_parse_line(conf, list, line, NULL, arena != NULL))
          {
             if (conf->entries)
                conf->tail->next = list;
@@ -663,6 +842,9 @@ static int config_file_from_string_internal(
                   RHMAP_SET_FULL(conf->entries_map, hash, list->key, list);
             }
          }
+         /* Rejected lines hand their node straight back */
+         else if (arena && list == &arena->nodes[arena->count - 1])
+            arena->count--;
          else
             free(list);
       }
@@ -678,28 +860,59 @@ static int config_file_from_string_internal(
 bool config_file_deinitialize(config_file_t *conf)
 {
    struct config_include_list *inc_tmp = NULL;
+   struct config_source_list *src_tmp  = NULL;
    struct config_entry_list *tmp       = NULL;
+   struct config_file_arena *arena     = NULL;
 
    if (!conf)
       return false;
 
    tmp = conf->entries;
-   while (tmp)
+   if (!conf->arenas)
    {
-      struct config_entry_list *hold = NULL;
-      if (tmp->key)
-         free(tmp->key);
-      if (tmp->value)
-         free(tmp->value);
+      while (tmp)
+      {
+         struct config_entry_list *hold = NULL;
+         if (tmp->key)
+            free(tmp->key);
+         if (tmp->value)
+            free(tmp->value);
 
-      tmp->value = NULL;
-      tmp->key   = NULL;
+         tmp->value = NULL;
+         tmp->key   = NULL;
 
-      hold       = tmp;
-      tmp        = tmp->next;
+         hold       = tmp;
+         tmp        = tmp->next;
 
-      if (hold)
+         if (hold)
+            free(hold);
+      }
+   }
+   else
+   {
+      /* Only entries created or modified after loading
+       * own heap memory - the rest goes with the arena */
+      while (tmp)
+      {
+         struct config_entry_list *hold = tmp;
+         tmp                            = tmp->next;
+
+         if (hold->key   && !config_file_arena_owns(conf, hold->key))
+            free(hold->key);
+         if (hold->value && !config_file_arena_owns(conf, hold->value))
+            free(hold->value);
+         if (!config_file_arena_owns(conf, hold))
+            free(hold);
+      }
+
+      arena = conf->arenas;
+      while (arena)
+      {
+         struct config_file_arena *hold = arena;
+         arena                          = arena->next;
+         free(hold->buf);
          free(hold);
+      }
    }
 
    inc_tmp = (struct config_include_list*)conf->includes;
@@ -716,8 +929,19 @@ bool config_file_deinitialize(config_file_t *conf)
 
    path_linked_list_free(conf->references);
 
+   src_tmp = conf->sources;
+   while (src_tmp)
+   {
+      struct config_source_list *hold = src_tmp;
+      src_tmp = src_tmp->next;
+      free(hold->path);
+      free(hold);
+   }
+
    if (conf->path)
       free(conf->path);
+   if (conf->cache_path)
+      free(conf->cache_path);
 
    RHMAP_FREE(conf->entries_map);
 
@@ -735,7 +959,10 @@ bool config_file_deinitialize(config_file_t *conf)
    conf->last        = NULL;
    conf->includes    = NULL;
    conf->references  = NULL;
+   conf->arenas      = NULL;
+   conf->sources     = NULL;
    conf->path        = NULL;
+   conf->cache_path  = NULL;
    /* entries_map is cleared by RHMAP_FREE */
 
    return true;
@@ -783,11 +1010,30 @@ bool config_append_file(config_file_t *conf, const char *path)
 
    if (new_conf->tail)
    {
+      struct config_entry_list *list = new_conf->entries;
+
+      /* Appended entries are not backed by this config's
+       * file, so an incremental write has to emit them */
+      for (; list; list = list->next)
+         list->dirty = true;
+
       new_conf->tail->next = conf->entries;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
    }
 
+   /* The pilfered entries may point into the new
+    * config's arena - keep it alive along with them */
+   if (new_conf->arenas)
+   {
+      struct config_file_arena *arena = new_conf->arenas;
+      while (arena->next)
+         arena = arena->next;
+      arena->next       = conf->arenas;
+      conf->arenas      = new_conf->arenas;
+      new_conf->arenas  = NULL;
+   }
+
    config_file_free(new_conf);
    return true;
 }
@@ -807,13 +1053,68 @@ config_file_t *config_file_new_from_string(char *from_string,
    struct config_file *conf      = config_file_new_alloc();
    if (     conf
          && config_file_from_string_internal(
-            conf, from_string, path) != -1)
+            conf, from_string, path, NULL) != -1)
       return conf;
    if (conf)
       config_file_free(conf);
    return NULL;
 }
 
+/**
+ * config_file_new_from_buffer:
+ *
+ * Load a config file from a heap-allocated buffer,
+ * taking ownership of @buf.
+ **/
+config_file_t *config_file_new_from_buffer(char *buf, size_t len,
+      const char *path)
+{
+   struct config_file_arena *arena = NULL;
+   struct config_file *conf        = NULL;
+   /* One node per line is an upper bound on the number
+    * of entries the buffer can produce */
+   size_t lines                    = 1;
+   const char *s                   = buf;
+   const char *end                 = buf + len;
+
+   if (!buf)
+      return NULL;
+
+   while (s < end && (s = (const char*)memchr(s, '\n', end - s)))
+   {
+      lines++;
+      s++;
+   }
+
+   if (!(conf = config_file_new_alloc()))
+   {
+      free(buf);
+      return NULL;
+   }
+
+   /* If the arena cannot be had, fall back to
+    * regular copying parse and drop the buffer */
+   if (!(arena = config_file_arena_new(buf, len, lines)))
+   {
+      if (config_file_from_string_internal(conf, buf, path, NULL) == -1)
+      {
+         config_file_free(conf);
+         conf = NULL;
+      }
+      free(buf);
+      return conf;
+   }
+
+   conf->arenas = arena;
+   if (config_file_from_string_internal(conf, buf, path, arena) == -1)
+   {
+      config_file_free(conf);
+      return NULL;
+   }
+
+   return conf;
+}
+
 config_file_t *config_file_new_from_path_to_string(const char *path)
 {
    if (path_is_valid(path))
@@ -822,23 +1123,413 @@ config_file_t *config_file_new_from_path_to_string(const char *path)
       int64_t length                   = 0;
       if (filestream_read_file(path, (void**)&ret_buf, &length))
       {
-         config_file_t *conf           = NULL;
-         /* Note: 'ret_buf' is not used outside this
-          * function - we do not care that it will be
-          * modified by config_file_new_from_string() */
          if (length >= 0)
-            conf = config_file_new_from_string((char*)ret_buf, path);
+            return config_file_new_from_buffer((char*)ret_buf,
+                  (size_t)length, path);
 
          if ((void*)ret_buf)
             free((void*)ret_buf);
+      }
+   }
+
+   return NULL;
+}
+
+static void config_file_get_tmp_path(char *s, size_t len,
+      const char *path)
+{
+   size_t _len = strlcpy(s, path, len);
+   if (_len < len)
+      strlcpy(s + _len, ".tmp", len - _len);
+}
+
+/**
+ * config_file_commit_tmp:
+ *
+ * Moves a fully written @tmp_path over @path, so that
+ * readers only ever see the old or the new file.
+ **/
+static bool config_file_commit_tmp(const char *tmp_path, const char *path)
+{
+   if (filestream_rename(tmp_path, path) == 0)
+      return true;
+   /* Some platforms refuse to rename over an existing file */
+   if (     filestream_delete(path) == 0
+         && filestream_rename(tmp_path, path) == 0)
+      return true;
+   filestream_delete(tmp_path);
+   return false;
+}
+
+/**
+ * config_file_snapshot_write:
+ *
+ * Serializes @conf - entries in list order, includes,
+ * references, and the stamps of the config (@mtime and
+ * @size, taken by the caller before it read the file)
+ * and of all its sources - to @cache_path. Written to a
+ * temporary file first and renamed over the old snapshot
+ * so that a crash never leaves a torn snapshot behind.
+ **/
+static bool config_file_snapshot_write(config_file_t *conf,
+      const char *cache_path, int64_t mtime, int64_t size)
+{
+   struct config_snapshot_header hdr;
+   char tmp_path[PATH_MAX_LENGTH];
+   const struct config_entry_list   *entry = NULL;
+   const struct config_include_list *inc   = NULL;
+   const struct config_source_list  *src_n = NULL;
+   const struct path_linked_list    *node  = NULL;
+   uint8_t *data                           = NULL;
+   uint8_t *out                            = NULL;
+   char *strings                           = NULL;
+   uint32_t pos                            = 0;
+   size_t strings_len                      = 0;
+   size_t total                            = 0;
+   bool ret                                = false;
+
+   if (!conf->path || !cache_path || !*cache_path || size < 0)
+      return false;
+
+   memset(&hdr, 0, sizeof(hdr));
+   hdr.magic       = CONFIG_SNAPSHOT_MAGIC;
+   hdr.version     = CONFIG_SNAPSHOT_VERSION;
+
+   /* Measure */
+   hdr.num_sources = 1;
+   strings_len     = strlen(conf->path) + 1;
+   for (src_n = conf->sources; src_n; src_n = src_n->next)
+   {
+      hdr.num_sources++;
+      strings_len += strlen(src_n->path) + 1;
+   }
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      if (!entry->key || !entry->value)
+         continue;
+      hdr.num_entries++;
+      strings_len += strlen(entry->key) + strlen(entry->value) + 2;
+   }
+   for (inc = conf->includes; inc; inc = inc->next)
+   {
+      hdr.num_includes++;
+      strings_len += strlen(inc->path) + 1;
+   }
+   for (node = conf->references; node; node = node->next)
+   {
+      if (!node->path)
+         continue;
+      hdr.num_refs++;
+      strings_len += strlen(node->path) + 1;
+   }
+
+   if (strings_len > UINT32_MAX)
+      return false;
+   hdr.strings_len = (uint32_t)strings_len;
+
+   total = sizeof(hdr)
+      + hdr.num_sources * sizeof(struct config_snapshot_source)
+      + hdr.num_entries * sizeof(struct config_snapshot_entry)
+      + (hdr.num_includes + hdr.num_refs) * sizeof(uint32_t)
+      + strings_len;
+
+   if (!(data = (uint8_t*)malloc(total)))
+      return false;
+
+   strings = (char*)data + (total - strings_len);
+
+   /* Fill */
+   memcpy(data, &hdr, sizeof(hdr));
+   out = data + sizeof(hdr);
+
+#define CONFIG_SNAPSHOT_PUT_STRING(str, off) \
+   do { \
+      size_t _slen = strlen(str) + 1; \
+      memcpy(strings + pos, (str), _slen); \
+      (off) = pos; \
+      pos  += (uint32_t)_slen; \
+   } while (0)
+
+   {
+      struct config_snapshot_source src;
+      memset(&src, 0, sizeof(src));
+      src.size  = size;
+      src.mtime = mtime;
+      CONFIG_SNAPSHOT_PUT_STRING(conf->path, src.path);
+      memcpy(out, &src, sizeof(src));
+      out += sizeof(src);
+
+      for (src_n = conf->sources; src_n; src_n = src_n->next)
+      {
+         src.size  = src_n->size;
+         src.mtime = src_n->mtime;
+         CONFIG_SNAPSHOT_PUT_STRING(src_n->path, src.path);
+         memcpy(out, &src, sizeof(src));
+         out += sizeof(src);
+      }
+   }
+
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      struct config_snapshot_entry ent;
+      if (!entry->key || !entry->value)
+         continue;
+      CONFIG_SNAPSHOT_PUT_STRING(entry->key,   ent.key);
+      CONFIG_SNAPSHOT_PUT_STRING(entry->value, ent.value);
+      ent.readonly = entry->readonly ? 1 : 0;
+      memcpy(out, &ent, sizeof(ent));
+      out += sizeof(ent);
+   }
+
+   for (inc = conf->includes; inc; inc = inc->next)
+   {
+      uint32_t off;
+      CONFIG_SNAPSHOT_PUT_STRING(inc->path, off);
+      memcpy(out, &off, sizeof(off));
+      out += sizeof(off);
+   }
 
-         return conf;
+   for (node = conf->references; node; node = node->next)
+   {
+      uint32_t off;
+      if (!node->path)
+         continue;
+      CONFIG_SNAPSHOT_PUT_STRING(node->path, off);
+      memcpy(out, &off, sizeof(off));
+      out += sizeof(off);
+   }
+
+#undef CONFIG_SNAPSHOT_PUT_STRING
+
+   /* Write to the side and swap into place */
+   config_file_get_tmp_path(tmp_path, sizeof(tmp_path), cache_path);
+   if (filestream_write_file(tmp_path, data, (int64_t)total))
+      ret = config_file_commit_tmp(tmp_path, cache_path);
+
+   free(data);
+   return ret;
+}
+
+/**
+ * config_file_snapshot_load:
+ *
+ * Loads the snapshot at @cache_path if it was taken
+ * of @path and none of its sources changed since.
+ * Keys and values are used in place out of the
+ * snapshot buffer, which becomes the config's arena.
+ *
+ * @return NULL if the snapshot is missing, corrupt
+ * or stale.
+ **/
+static config_file_t *config_file_snapshot_load(const char *path,
+      const char *cache_path)
+{
+   struct config_snapshot_header hdr;
+   size_t i;
+   uint64_t total;
+   int64_t length                  = 0;
+   uint8_t *data                   = NULL;
+   const uint8_t *in               = NULL;
+   const uint8_t *sources          = NULL;
+   const char *strings             = NULL;
+   struct config_file_arena *arena = NULL;
+   config_file_t *conf             = NULL;
+
+   if (!path_is_valid(cache_path))
+      return NULL;
+   if (!filestream_read_file(cache_path, (void**)&data, &length))
+      return NULL;
+
+   if ((uint64_t)length < sizeof(hdr))
+      goto error;
+   memcpy(&hdr, data, sizeof(hdr));
+   if (     hdr.magic   != CONFIG_SNAPSHOT_MAGIC
+         || hdr.version != CONFIG_SNAPSHOT_VERSION
+         || hdr.num_sources < 1
+         || hdr.strings_len < 1)
+      goto error;
+
+   total = (uint64_t)sizeof(hdr)
+      + (uint64_t)hdr.num_sources * sizeof(struct config_snapshot_source)
+      + (uint64_t)hdr.num_entries * sizeof(struct config_snapshot_entry)
+      + ((uint64_t)hdr.num_includes + hdr.num_refs) * sizeof(uint32_t)
+      + hdr.strings_len;
+   if (total != (uint64_t)length)
+      goto error;
+
+   /* Every offset below is checked against strings_len;
+    * a terminating NUL at the very end guarantees every
+    * string in the blob is terminated */
+   strings = (const char*)data + (length - hdr.strings_len);
+   if (strings[hdr.strings_len - 1] != '\0')
+      goto error;
+
+#define CONFIG_SNAPSHOT_CHECK_OFFSET(off) \
+   if ((off) >= hdr.strings_len) \
+      goto error
+
+   /* Staleness check - cheapest rejection first */
+   in = sources = data + sizeof(hdr);
+   for (i = 0; i < hdr.num_sources; i++)
+   {
+      struct config_snapshot_source src;
+      int64_t size;
+      memcpy(&src, in, sizeof(src));
+      in += sizeof(src);
+      CONFIG_SNAPSHOT_CHECK_OFFSET(src.path);
+      /* Snapshot must have been taken of this very config */
+      if (i == 0 && strcmp(strings + src.path, path) != 0)
+         goto error;
+      if ((size = path_get_size(strings + src.path)) != src.size)
+         goto error;
+      if (i == 0 && size < 0)
+         goto error;
+      /* A file that exists but cannot report its mtime
+       * can never be validated */
+      if (size >= 0)
+      {
+         int64_t mtime = path_get_mtime(strings + src.path);
+         if (mtime < 0 || mtime != src.mtime)
+            goto error;
       }
    }
 
+   if (!(conf = config_file_new_alloc()))
+      goto error;
+   if (!(arena = config_file_arena_new((char*)data,
+         (size_t)length, hdr.num_entries)))
+      goto error;
+   conf->arenas = arena;
+   data         = NULL;
+   if (!(conf->path = strdup(path)))
+      goto error;
+   conf->flags |= CONF_FILE_FLG_FROM_SNAPSHOT;
+
+   /* Keep the include stamps, so that a snapshot
+    * rewritten from this config still tracks them */
+   for (i = 1; i < hdr.num_sources; i++)
+   {
+      struct config_snapshot_source src;
+      memcpy(&src, sources + i * sizeof(src), sizeof(src));
+      if (!config_file_add_source(conf, strings + src.path,
+            src.mtime, src.size))
+         goto error;
+   }
+
+   for (i = 0; i < hdr.num_entries; i++)
+   {
+      struct config_snapshot_entry ent;
+      struct config_entry_list *list = NULL;
+      uint32_t hash;
+      memcpy(&ent, in, sizeof(ent));
+      in += sizeof(ent);
+      CONFIG_SNAPSHOT_CHECK_OFFSET(ent.key);
+      CONFIG_SNAPSHOT_CHECK_OFFSET(ent.value);
+
+      list           = &arena->nodes[arena->count++];
+      list->key      = (char*)strings + ent.key;
+      list->value    = (char*)strings + ent.value;
+      list->readonly = ent.readonly != 0;
+      list->dirty    = false;
+      list->next     = NULL;
+
+      if (conf->entries)
+         conf->tail->next = list;
+      else
+         conf->entries    = list;
+      conf->tail          = list;
+
+      /* First one wins, as when parsing */
+      hash = rhmap_hash_string(list->key);
+      if (!RHMAP_HAS_FULL(conf->entries_map, hash, list->key))
+         RHMAP_SET_FULL(conf->entries_map, hash, list->key, list);
+   }
+
+   for (i = 0; i < hdr.num_includes; i++)
+   {
+      uint32_t off;
+      struct config_include_list *node = NULL;
+      memcpy(&off, in, sizeof(off));
+      in += sizeof(off);
+      CONFIG_SNAPSHOT_CHECK_OFFSET(off);
+      if (!(node = (struct config_include_list*)malloc(sizeof(*node))))
+         goto error;
+      if (!(node->path = strdup(strings + off)))
+      {
+         free(node);
+         goto error;
+      }
+      node->next = NULL;
+      if (conf->includes)
+      {
+         struct config_include_list *head = conf->includes;
+         while (head->next)
+            head = head->next;
+         head->next     = node;
+      }
+      else
+         conf->includes = node;
+   }
+
+   for (i = 0; i < hdr.num_refs; i++)
+   {
+      uint32_t off;
+      memcpy(&off, in, sizeof(off));
+      in += sizeof(off);
+      CONFIG_SNAPSHOT_CHECK_OFFSET(off);
+      if (!conf->references && !(conf->references = path_linked_list_new()))
+         goto error;
+      path_linked_list_add_path(conf->references, (char*)strings + off);
+   }
+
+#undef CONFIG_SNAPSHOT_CHECK_OFFSET
+
+   return conf;
+
+error:
+   if (data)
+      free(data);
+   if (conf)
+      config_file_free(conf);
    return NULL;
 }
 
+/**
+ * config_file_new_cached:
+ *
+ * Loads a config file through a binary snapshot,
+ * falling back to parsing when the snapshot is
+ * missing or stale.
+ *
+ * @return Returns NULL if file doesn't exist.
+ **/
+config_file_t *config_file_new_cached(const char *path,
+      const char *cache_path)
+{
+   config_file_t *conf = NULL;
+
+   if (!path || !*path)
+      return NULL;
+   if (!cache_path || !*cache_path)
+      return config_file_new_from_path_to_string(path);
+
+   if (!(conf = config_file_snapshot_load(path, cache_path)))
+   {
+      /* Stamp before reading; the includes are
+       * stamped as the parser reaches them */
+      int64_t size  = path_get_size(path);
+      int64_t mtime = (size < 0) ? -1 : path_get_mtime(path);
+      if (!(conf = config_file_new_from_path_to_string(path)))
+         return NULL;
+      if (mtime < 0 || !config_file_snapshot_write(conf,
+            cache_path, mtime, size))
+         filestream_delete(cache_path);
+   }
+
+   conf->cache_path = strdup(cache_path);
+   return conf;
+}
+
 /**
  * config_file_new_with_callback:
  *
@@ -912,6 +1603,9 @@ void config_file_initialize(struct config_file *conf)
    conf->last                     = NULL;
    conf->references               = NULL;
    conf->includes                 = NULL;
+   conf->arenas                   = NULL;
+   conf->sources                  = NULL;
+   conf->cache_path               = NULL;
    conf->include_depth            = 0;
    conf->flags                    = 0;
 }
@@ -1269,10 +1963,14 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
          {
             if (strcmp(entry->value, val) == 0)
                return;
-            free(entry->value);
+            if (!config_file_arena_owns(conf, entry->value))
+               free(entry->value);
          }
+         if (entry->readonly)
+            conf->flags |= CONF_FILE_FLG_INCLUDE_OVERRIDDEN;
          entry->value    = strdup(val);
          entry->readonly = false;
+         entry->dirty    = true;
          conf->flags    |= CONF_FILE_FLG_MODIFIED;
          return;
       }
@@ -1280,6 +1978,7 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    if (!(entry = (struct config_entry_list*)malloc(sizeof(*entry))))
       return;
    entry->readonly  = false;
+   entry->dirty     = true;
    entry->next      = NULL;
    entry->key       = strdup(key);
    entry->value     = strdup(val);
@@ -1318,10 +2017,13 @@ void config_unset(config_file_t *conf, const char *key)
 
    (void)RHMAP_DEL_STR(conf->entries_map, entry->key);
 
-   if (entry->key)
+   if (entry->readonly)
+      conf->flags |= CONF_FILE_FLG_INCLUDE_OVERRIDDEN;
+
+   if (entry->key && !config_file_arena_owns(conf, entry->key))
       free(entry->key);
 
-   if (entry->value)
+   if (entry->value && !config_file_arena_owns(conf, entry->value))
       free(entry->value);
 
    entry->key     = NULL;
@@ -1402,6 +2104,56 @@ size_t config_set_char(config_file_t *conf, const char *key, char val)
    return _len;
 }
 
+/**
+ * config_file_write_done:
+ *
+ * Bookkeeping after @conf was successfully written to @path:
+ * everything is clean again, and a snapshot of the config
+ * (see config_file_new_cached) is refreshed from the
+ * in-memory entries.
+ *
+ * The snapshot must match a reparse of the file exactly.
+ * The entries do, except once an entry that came from an
+ * #include was set or unset (a reparse brings the include's
+ * copy back) or when a value does not survive being written
+ * out in quotes. The snapshot is dropped then, and the next
+ * cached load parses the file and takes a new one.
+ *
+ * Only the config itself is restamped; the includes keep the
+ * stamps they had when they were read (or restored from the
+ * old snapshot), so one edited since still invalidates it.
+ **/
+static void config_file_write_done(config_file_t *conf, const char *path)
+{
+   struct config_entry_list *list = conf->entries;
+   bool exact                     =
+      !(conf->flags & CONF_FILE_FLG_INCLUDE_OVERRIDDEN);
+
+   for (; list; list = list->next)
+   {
+      list->dirty = false;
+      if (     list->key
+            && list->value
+            && strpbrk(list->value, "\"\n"))
+         exact    = false;
+   }
+
+   conf->flags &= ~CONF_FILE_FLG_MODIFIED;
+
+   if (     conf->cache_path
+         && conf->path
+         && strcmp(path, conf->path) == 0)
+   {
+      int64_t size  = path_get_size(path);
+      int64_t mtime = (size < 0) ? -1 : path_get_mtime(path);
+      if (     !exact
+            || mtime < 0
+            || !config_file_snapshot_write(conf,
+               conf->cache_path, mtime, size))
+         filestream_delete(conf->cache_path);
+   }
+}
+
 /**
  * config_file_write:
  *
@@ -1418,19 +2170,229 @@ bool config_file_write(config_file_t *conf, const char *path, bool sort)
       else
       {
          char buf[0x4000];
-         FILE *file = (FILE*)fopen_utf8(path, "wb");
-         if (!file)
+         char tmp_path[PATH_MAX_LENGTH];
+         FILE *file = NULL;
+         bool ok    = false;
+
+         config_file_get_tmp_path(tmp_path, sizeof(tmp_path), path);
+         if (!(file = (FILE*)fopen_utf8(tmp_path, "wb")))
             return false;
          setvbuf(file, buf, _IOFBF, sizeof(buf));
          config_file_dump(conf, file, sort);
-         if (file != stdout)
-            fclose(file);
-         conf->flags &= ~CONF_FILE_FLG_MODIFIED;
+         ok = !ferror(file);
+         if (fclose(file) != 0)
+            ok = false;
+         if (!ok)
+         {
+            filestream_delete(tmp_path);
+            return false;
+         }
+         if (!config_file_commit_tmp(tmp_path, path))
+            return false;
+         config_file_write_done(conf, path);
       }
    }
    return true;
 }
 
+/**
+ * config_file_patch_line:
+ *
+ * Finds the key of a line of a config file on disk, the
+ * way config_file_parse_line would see it. Lines that
+ * the parser would reject or treat as comments yield
+ * NULL and are to be copied verbatim.
+ *
+ * @return key (not NUL-terminated, ending at @key_end),
+ * or NULL if the line holds no entry.
+ **/
+static char *config_file_patch_line(char *line, char *end, char **key_end)
+{
+   char *key = NULL;
+   char *s   = line;
+
+   while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+      s++;
+   key = s;
+   while (s < end && isgraph((unsigned char)*s))
+      s++;
+   /* No key, or a comment cuts into it */
+   if (s == key || memchr(line, '#', s - line))
+      return NULL;
+   *key_end = s;
+   while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+      s++;
+   if (s >= end || *s != '=')
+      return NULL;
+   return key;
+}
+
+/**
+ * config_file_write_incremental:
+ *
+ * Write the current config by patching the file
+ * it was loaded from.
+ **/
+bool config_file_write_incremental(config_file_t *conf, const char *path)
+{
+   char buf[0x4000];
+   char tmp_path[PATH_MAX_LENGTH];
+   struct config_entry_list *list = NULL;
+   struct path_linked_list  *ref  = NULL;
+   /* Every key present in the file */
+   uint8_t *in_file               = NULL;
+   /* Keys already met while copying; only their
+    * first occurrence is live */
+   uint8_t *seen                  = NULL;
+   char *data                     = NULL;
+   char *cur                      = NULL;
+   char *end                      = NULL;
+   FILE *file                     = NULL;
+   int64_t length                 = 0;
+   size_t num_refs                = 0;
+   bool terminated                = true;
+   bool inserted                  = false;
+   bool ok                        = false;
+
+   if (!conf || !path || !*path)
+      return false;
+   if (!(conf->flags & CONF_FILE_FLG_MODIFIED))
+      return true;
+   if (     !conf->path
+         || strcmp(path, conf->path) != 0
+         || !path_is_valid(path)
+         || !filestream_read_file(path, (void**)&data, &length)
+         || length < 0)
+      goto full;
+
+   /* Pass 1: collect every key in the file, so that an entry
+    * whose line comes after an #include is not taken for new */
+   end = data + length;
+   for (cur = data; cur < end; )
+   {
+      char *eol     = (char*)memchr(cur, '\n', end - cur);
+      char *key_end = NULL;
+      char *key     = NULL;
+      if (!eol)
+         eol = end;
+      if ((eol - cur) >= 11 && !memcmp(cur, "#reference ", 11))
+         num_refs++;
+      else if ((key = config_file_patch_line(cur, eol, &key_end)))
+      {
+         char term  = *key_end;
+         *key_end   = '\0';
+         if (!RHMAP_HAS_STR(in_file, key))
+            RHMAP_SET_STR(in_file, key, 1);
+         *key_end   = term;
+      }
+      cur = eol + 1;
+   }
+
+   /* Every clean entry must still be backed by its line,
+    * and the set of references must be unchanged - else
+    * the file was edited behind our back, so regenerate */
+   for (list = conf->entries; list; list = list->next)
+      if (     list->key
+            && !list->readonly
+            && !list->dirty
+            && !RHMAP_HAS_STR(in_file, list->key))
+         goto full;
+   for (ref = conf->references; ref; ref = ref->next)
+      if (ref->path)
+         num_refs--;
+   if (num_refs != 0)
+      goto full;
+
+   /* Pass 2: copy the file, swapping out stale lines */
+   config_file_get_tmp_path(tmp_path, sizeof(tmp_path), path);
+   if (!(file = (FILE*)fopen_utf8(tmp_path, "wb")))
+      goto end;
+   setvbuf(file, buf, _IOFBF, sizeof(buf));
+
+   for (cur = data; ; )
+   {
+      char *eol     = NULL;
+      char *key_end = NULL;
+      char *key     = NULL;
+      size_t _len   = 0;
+
+      /* New entries go ahead of the includes,
+       * so that they take precedence over them */
+      if (!inserted && (cur >= end
+               || ((end - cur) >= 9 && !memcmp(cur, "#include ", 9))))
+      {
+         for (list = conf->entries; list; list = list->next)
+         {
+            if (     !list->key
+                  || !list->dirty
+                  ||  list->readonly
+                  ||  RHMAP_HAS_STR(in_file, list->key)
+                  ||  RHMAP_GET_STR(conf->entries_map, list->key) != list)
+               continue;
+            if (!terminated)
+               fputc('\n', file);
+            fprintf(file, "%s = \"%s\"\n", list->key, list->value);
+            terminated = true;
+         }
+         inserted = true;
+      }
+      if (cur >= end)
+         break;
+
+      if (!(eol = (char*)memchr(cur, '\n', end - cur)))
+         eol = end;
+      _len = (size_t)(eol - cur) + (eol < end ? 1 : 0);
+
+      if ((key = config_file_patch_line(cur, eol, &key_end)))
+      {
+         struct config_entry_list *entry = NULL;
+         char term                       = *key_end;
+         *key_end                        = '\0';
+         /* Shadowed duplicates are kept as they are */
+         if (!RHMAP_HAS_STR(seen, key))
+         {
+            RHMAP_SET_STR(seen, key, 1);
+            entry = RHMAP_GET_STR(conf->entries_map, key);
+            /* Unset since loading - drop the line */
+            if (!entry)
+            {
+               cur += _len;
+               continue;
+            }
+            if (entry->dirty && !entry->readonly)
+            {
+               fprintf(file, "%s = \"%s\"\n", entry->key, entry->value);
+               terminated = true;
+               cur       += _len;
+               continue;
+            }
+         }
+         *key_end = term;
+      }
+
+      fwrite(cur, 1, _len, file);
+      terminated = (cur[_len - 1] == '\n');
+      cur       += _len;
+   }
+
+   ok = !ferror(file);
+   if (fclose(file) != 0)
+      ok = false;
+   if (!ok)
+      filestream_delete(tmp_path);
+   else if ((ok = config_file_commit_tmp(tmp_path, path)))
+      config_file_write_done(conf, path);
+   goto end;
+
+full:
+   ok = config_file_write(conf, path, false);
+end:
+   RHMAP_FREE(in_file);
+   RHMAP_FREE(seen);
+   free(data);
+   return ok;
+}
+
 /**
  * config_file_dump:
  *
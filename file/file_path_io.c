@@ -47,6 +47,7 @@
 #include <file/file_path.h>
 #include <compat/strl.h>
 #include <compat/posix_string.h>
+#include <encodings/utf.h>
 #include <retro_miscellaneous.h>
 #define VFS_FRONTEND
 #include <vfs/vfs_implementation.h>
@@ -143,6 +144,57 @@ int64_t path_get_size(const char *path)
    return -1;
 }
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Queries the modification time of @path straight from
+ * the OS. The VFS interface has no notion of timestamps,
+ * so frontend-provided VFS callbacks are bypassed here.
+ *
+ * The value is only meant to be compared against other
+ * values returned by this function (change detection);
+ * it carries nanosecond precision where the platform
+ * provides it.
+ *
+ * @return modification timestamp, or -1 if the file does
+ * not exist or the platform cannot report it.
+ **/
+int64_t path_get_mtime(const char *path)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   struct __stat64 buf;
+   int ret;
+   wchar_t *path_wide = NULL;
+
+   if (!path || !*path)
+      return -1;
+   if (!(path_wide = utf8_to_utf16_string_alloc(path)))
+      return -1;
+   ret = _wstat64(path_wide, &buf);
+   free(path_wide);
+   if (ret != 0)
+      return -1;
+   return (int64_t)buf.st_mtime;
+#elif defined(ORBIS) || defined(__PSL1GHT__) || defined(__PS3__) || defined(_XBOX)
+   return -1;
+#else
+   struct stat buf;
+
+   if (!path || !*path)
+      return -1;
+   if (stat(path, &buf) != 0)
+      return -1;
+#if defined(__linux__) && defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+   return (int64_t)buf.st_mtim.tv_sec * 1000000000 + buf.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+   return (int64_t)buf.st_mtimespec.tv_sec * 1000000000 + buf.st_mtimespec.tv_nsec;
+#else
+   return (int64_t)buf.st_mtime;
+#endif
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -28,6 +28,7 @@
 #endif
 
 #include <file/nbio.h>
+#include <retro_trace.h>
 
 extern nbio_intf_t nbio_linux;
 extern nbio_intf_t nbio_mmap_unix;
@@ -85,7 +86,11 @@ void nbio_begin_write(void *data)
 
 bool nbio_iterate(void *data)
 {
-   return internal_nbio->iterate(data);
+   bool ret;
+   RETRO_TRACE_BEGIN("nbio.iterate");
+   ret = internal_nbio->iterate(data);
+   RETRO_TRACE_END("nbio.iterate");
+   return ret;
 }
 
 void nbio_resize(void *data, size_t len)
@@ -54,6 +54,11 @@
 #if defined(HAVE_RWEBM) && (defined(HAVE_ROPUS) || defined(HAVE_RVORBIS))
 #include <formats/rwebm.h>
 #endif
+#include <retro_perf.h>
+#include <retro_trace.h>
+
+RETRO_PERF_TIMER(perf_audio_decode, "audio.decode");
+RETRO_PERF_COUNTER(perf_audio_frames, "audio.decode.frames");
 
 /* One transfer context per codec. Each backend keeps only what it needs;
  * the enum 'type' handed to every entry point selects which arm runs, the
@@ -1573,7 +1578,7 @@ static int audio_transfer_aac_fill(struct audio_transfer_aac *ac, int fmt)
 }
 #endif
 
-int audio_transfer_read_s16(void *data, enum audio_type_enum type,
+static int audio_transfer_decode_s16(void *data, enum audio_type_enum type,
       int16_t *out, size_t frames, size_t *frames_out)
 {
    size_t produced = 0;
@@ -1713,7 +1718,25 @@ int audio_transfer_read_s16(void *data, enum audio_type_enum type,
    return (produced == 0) ? AUDIO_PROCESS_END : AUDIO_PROCESS_NEXT;
 }
 
-int audio_transfer_read_f32(void *data, enum audio_type_enum type,
+int audio_transfer_read_s16(void *data, enum audio_type_enum type,
+      int16_t *out, size_t frames, size_t *frames_out)
+{
+   int    ret;
+   size_t produced = 0;
+
+   RETRO_TRACE_BEGIN("audio.decode");
+   RETRO_PERF_BEGIN(perf_audio_decode);
+   ret = audio_transfer_decode_s16(data, type, out, frames, &produced);
+   RETRO_PERF_END(perf_audio_decode);
+   RETRO_TRACE_END("audio.decode");
+   RETRO_PERF_ADD(perf_audio_frames, produced);
+
+   if (frames_out && ret != AUDIO_PROCESS_ERROR)
+      *frames_out = produced;
+   return ret;
+}
+
+static int audio_transfer_decode_f32(void *data, enum audio_type_enum type,
       float *out, size_t frames, size_t *frames_out)
 {
    size_t produced = 0;
@@ -1856,6 +1879,24 @@ int audio_transfer_read_f32(void *data, enum audio_type_enum type,
    return (produced == 0) ? AUDIO_PROCESS_END : AUDIO_PROCESS_NEXT;
 }
 
+int audio_transfer_read_f32(void *data, enum audio_type_enum type,
+      float *out, size_t frames, size_t *frames_out)
+{
+   int    ret;
+   size_t produced = 0;
+
+   RETRO_TRACE_BEGIN("audio.decode");
+   RETRO_PERF_BEGIN(perf_audio_decode);
+   ret = audio_transfer_decode_f32(data, type, out, frames, &produced);
+   RETRO_PERF_END(perf_audio_decode);
+   RETRO_TRACE_END("audio.decode");
+   RETRO_PERF_ADD(perf_audio_frames, produced);
+
+   if (frames_out && ret != AUDIO_PROCESS_ERROR)
+      *frames_out = produced;
+   return ret;
+}
+
 size_t audio_transfer_buffer_tell(void *data, enum audio_type_enum type)
 {
    if (!data)
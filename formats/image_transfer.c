@@ -53,6 +53,11 @@
 #endif
 
 #include <formats/image.h>
+#include <retro_perf.h>
+#include <retro_trace.h>
+
+RETRO_PERF_TIMER(perf_image_process, "image.process");
+RETRO_PERF_TIMER(perf_image_iterate, "image.iterate");
 
 void image_transfer_free(void *data, enum image_type_enum type)
 {
@@ -321,6 +326,9 @@ int image_transfer_process(
 {
    int ret = 0;
 
+   RETRO_TRACE_BEGIN("image.process");
+   RETRO_PERF_BEGIN(perf_image_process);
+
    switch (type)
    {
       case IMAGE_TYPE_PNG:
@@ -392,6 +400,9 @@ int image_transfer_process(
          break;
    }
 
+   RETRO_PERF_END(perf_image_process);
+   RETRO_TRACE_END("image.process");
+
 #ifdef GEKKO
    /* Convert from linear ARGB to the Wii's tiled texture format.
     * Applied once when decoding finishes (IMAGE_PROCESS_END),
@@ -537,19 +548,26 @@ bool image_transfer_is_10bit(void *data, enum image_type_enum type)
 
 bool image_transfer_iterate(void *data, enum image_type_enum type)
 {
+   bool ret = true;
 
    switch (type)
    {
       case IMAGE_TYPE_PNG:
 #ifdef HAVE_RPNG
-         if (!rpng_iterate_image((rpng_t*)data))
-            return false;
+         RETRO_TRACE_BEGIN("image.iterate");
+         RETRO_PERF_BEGIN(perf_image_iterate);
+         ret = rpng_iterate_image((rpng_t*)data);
+         RETRO_PERF_END(perf_image_iterate);
+         RETRO_TRACE_END("image.iterate");
 #endif
          break;
       case IMAGE_TYPE_JPEG:
 #ifdef HAVE_RJPEG
-         if (!rjpeg_iterate_image((rjpeg_t*)data))
-            return false;
+         RETRO_TRACE_BEGIN("image.iterate");
+         RETRO_PERF_BEGIN(perf_image_iterate);
+         ret = rjpeg_iterate_image((rjpeg_t*)data);
+         RETRO_PERF_END(perf_image_iterate);
+         RETRO_TRACE_END("image.iterate");
 #endif
          break;
       case IMAGE_TYPE_TGA:
@@ -576,7 +594,7 @@ bool image_transfer_iterate(void *data, enum image_type_enum type)
          return false;
    }
 
-   return true;
+   return ret;
 }
 
 void image_transfer_set_avail(void *data, enum image_type_enum type,
@@ -871,33 +889,34 @@ void image_transfer_anim_stream_get_info(void *stream,
 const uint32_t *image_transfer_anim_stream_next(void *stream,
       enum image_type_enum type, int *duration_ms)
 {
+   const uint32_t *frame = NULL;
+
+   RETRO_TRACE_BEGIN("image.frame");
    switch (type)
    {
       case IMAGE_TYPE_WEBP:
 #ifdef HAVE_RWEBP
-         return rwebp_anim_stream_next((rwebp_anim_stream_t*)stream,
+         frame = rwebp_anim_stream_next((rwebp_anim_stream_t*)stream,
                duration_ms);
-#else
-         break;
 #endif
+         break;
       case IMAGE_TYPE_WEBM:
 #ifdef HAVE_RWEBM
-         return rwebm_video_stream_next((rwebm_video_stream_t*)stream,
+         frame = rwebm_video_stream_next((rwebm_video_stream_t*)stream,
                duration_ms);
-#else
-         break;
 #endif
+         break;
       case IMAGE_TYPE_MP4:
 #ifdef HAVE_RMP4
-         return rmp4_video_stream_next((rmp4_video_stream_t*)stream,
+         frame = rmp4_video_stream_next((rmp4_video_stream_t*)stream,
                duration_ms);
-#else
-         break;
 #endif
+         break;
       default:
          break;
    }
-   return NULL;
+   RETRO_TRACE_END("image.frame");
+   return frame;
 }
 
 void image_transfer_anim_stream_rewind(void *stream,
@@ -28,6 +28,7 @@
 #include <stdint.h> /* int64_t, SIZE_MAX */
 #include <stdlib.h> /* malloc, realloc, atof, atoi */
 #include <limits.h> /* INT_MAX */
+#include <float.h>  /* FLT_EVAL_METHOD */
 
 /* Ceiling for the parser's growing string buffer and the writer's
  * in-memory buffer.  Reached in practice only by pathologically large
@@ -39,11 +40,29 @@
  * stream in chunks. */
 #define _RJSON_MAX_SIZE ((size_t)256 * 1024 * 1024)
 
+/* Largest block rjson_open_buffer copies its input through.  The
+ * parser NUL-terminates strings inside its input buffer, so it cannot
+ * parse the caller's const buffer in place; a bounded block keeps the
+ * copy small while still giving the scanners long runs between
+ * refills. */
+#define _RJSON_BUFFER_BLOCK ((size_t)16 * 1024)
+
+#if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)))
+#include <emmintrin.h>
+#define _rJSON_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define _rJSON_NEON
+#endif
+
 #include <formats/rjson.h>
 #include <compat/posix_string.h>
+#include <compat/intrinsics.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 
+#include "rjson_pow5.h"
+
 struct _rjson_stack { enum rjson_type type; size_t count; };
 
 struct rjson
@@ -70,6 +89,8 @@ struct rjson
 
    char option_flags;
    char decimal_sep;
+   /* Tape mode: strings are validated but their escapes left in place */
+   bool keep_escapes, string_escaped;
    char error_text[80];
    char inline_string[512];
 
@@ -99,6 +120,123 @@ typedef unsigned int _rjson_char_t;
 #define _rJSON_LIKELY(x) (x)
 #endif
 
+/* Returns the first byte in [p, end) that ends a plain run of string
+ * characters, that is a '"', a '\\' or a control character, or end.
+ * Every byte skipped is OR'ed into utf8mask so the caller knows if
+ * the string needs UTF-8 validation.  The vector loops stop at the
+ * 16 byte chunk holding the special byte and leave it to the scalar
+ * loop, so no bit masking of partial chunks is needed. */
+static INLINE const unsigned char *_rjson_scan_string(
+      const unsigned char *p, const unsigned char *end,
+      unsigned char *utf8mask)
+{
+#if defined(_rJSON_SSE2)
+   const __m128i quote  = _mm_set1_epi8('"');
+   const __m128i bslash = _mm_set1_epi8('\\');
+   const __m128i ctrl   = _mm_set1_epi8(0x1F);
+   int high             = 0;
+   while (end - p >= 16)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i*)p);
+      __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+      if (_mm_movemask_epi8(m))
+         break;
+      high |= _mm_movemask_epi8(v);
+      p    += 16;
+   }
+   if (high)
+      *utf8mask |= 0x80;
+#elif defined(_rJSON_NEON)
+   const uint8x16_t quote  = vdupq_n_u8('"');
+   const uint8x16_t bslash = vdupq_n_u8('\\');
+   const uint8x16_t ctrl   = vdupq_n_u8(0x1F);
+   uint8x16_t high         = vdupq_n_u8(0);
+   uint64x2_t h;
+   while (end - p >= 16)
+   {
+      uint8x16_t v = vld1q_u8(p);
+      uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, quote),
+               vceqq_u8(v, bslash)), vcleq_u8(v, ctrl));
+      uint64x2_t w = vreinterpretq_u64_u8(m);
+      if (vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1))
+         break;
+      high = vorrq_u8(high, v);
+      p   += 16;
+   }
+   h = vreinterpretq_u64_u8(high);
+   if ((vgetq_lane_u64(h, 0) | vgetq_lane_u64(h, 1)) & 0x8080808080808080ULL)
+      *utf8mask |= 0x80;
+#endif
+   for (; p != end; p++)
+   {
+      unsigned char c = *p;
+      if (c == '"' || c == '\\' || c < 0x20)
+         break;
+      *utf8mask |= c;
+   }
+   return p;
+}
+
+/* Skips a run of spaces and tabs, as found in the indentation
+ * following every newline of pretty printed JSON */
+static INLINE const unsigned char *_rjson_skip_indent(
+      const unsigned char *p, const unsigned char *end)
+{
+#if defined(_rJSON_SSE2)
+   const __m128i space = _mm_set1_epi8(' ');
+   const __m128i tab   = _mm_set1_epi8('\t');
+   while (end - p >= 16)
+   {
+      __m128i v     = _mm_loadu_si128((const __m128i*)p);
+      unsigned bits = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+               _mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab))) ^ 0xFFFF;
+      if (bits)
+         return p + compat_ctz(bits);
+      p += 16;
+   }
+#elif defined(_rJSON_NEON)
+   const uint8x16_t space = vdupq_n_u8(' ');
+   const uint8x16_t tab   = vdupq_n_u8('\t');
+   while (end - p >= 16)
+   {
+      uint8x16_t v = vld1q_u8(p);
+      uint64x2_t w = vreinterpretq_u64_u8(vorrq_u8(
+               vceqq_u8(v, space), vceqq_u8(v, tab)));
+      if (~(vgetq_lane_u64(w, 0) & vgetq_lane_u64(w, 1)))
+         break;
+      p += 16;
+   }
+#endif
+   while (p != end && (*p == ' ' || *p == '\t'))
+      p++;
+   return p;
+}
+
+/* Skips ASCII bytes, used to get through the plain parts of a
+ * string that needs UTF-8 validation */
+static INLINE unsigned char *_rjson_skip_ascii(
+      unsigned char *p, unsigned char *end)
+{
+#if defined(_rJSON_SSE2)
+   while (end - p >= 16 &&
+         !_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)))
+      p += 16;
+#elif defined(_rJSON_NEON)
+   while (end - p >= 16)
+   {
+      uint64x2_t w = vreinterpretq_u64_u8(vld1q_u8(p));
+      if ((vgetq_lane_u64(w, 0) | vgetq_lane_u64(w, 1)) & 0x8080808080808080ULL)
+         break;
+      p += 16;
+   }
+#endif
+   while (p != end && *p <= 0x7F)
+      p++;
+   return p;
+}
+
 /* These 3 error functions return RJSON_ERROR for convenience */
 static enum rjson_type _rjson_error(rjson_t *json, const char *fmt, ...)
 {
@@ -241,7 +379,7 @@ static unsigned int _rjson_get_unicode_cp(rjson_t *json)
    }
 }
 
-static bool _rjson_read_unicode(rjson_t *json)
+static bool _rjson_read_unicode(rjson_t *json, bool push)
 {
    #define _rJSON_READ_UNICODE_REPLACE_OR_IGNORE \
       if (json->option_flags & (RJSON_OPTION_IGNORE_INVALID_ENCODING \
@@ -301,6 +439,9 @@ static bool _rjson_read_unicode(rjson_t *json)
       return false;
    }
 
+   if (!push)
+      return true;
+
    if (cp < 0x80UL)
       return _rjson_pushchar(json, cp);
 
@@ -331,7 +472,7 @@ static bool _rjson_read_unicode(rjson_t *json)
    return false;
 
 replace_or_ignore:
-   return ((json->option_flags & RJSON_OPTION_IGNORE_INVALID_ENCODING) ||
+   return (!push || (json->option_flags & RJSON_OPTION_IGNORE_INVALID_ENCODING) ||
          _rjson_pushchar(json, '?'));
    #undef _rJSON_READ_UNICODE_REPLACE_OR_IGNORE
 }
@@ -354,7 +495,7 @@ static bool _rjson_validate_utf8(rjson_t *json)
       first = *from;
       if (first <= 0x7F) /* ASCII */
       {
-         from++;
+         from = _rjson_skip_ascii(from + 1, to);
          continue;
       }
       p = from;
@@ -426,24 +567,25 @@ static enum rjson_type _rjson_read_string(rjson_t *json)
    const unsigned char *p    = json->input_p, *raw = p;
    const unsigned char *end  = json->input_end;
    unsigned char utf8mask    = 0;
+   bool keep                 = json->keep_escapes;
    json->string_pass_through = NULL;
    json->string_len          = 0;
+   json->string_escaped      = false;
 
    for (;;)
    {
       if (_rJSON_LIKELY(p != end))
       {
-         unsigned char c = *p;
-         if (_rJSON_LIKELY(c != '"' && c != '\\' && c >= 0x20))
-         {
-            /* handle most common case first, it's faster */
-            utf8mask |= c;
-            p++;
-         }
-         else if (c == '"')
+         unsigned char c;
+         /* handle most common case first, plain characters are
+          * skipped many at a time */
+         if ((p = _rjson_scan_string(p, end, &utf8mask)) == end)
+            continue;
+         c = *p;
+         if (c == '"')
          {
             json->input_p = p + 1;
-            if (json->string_len == 0 && p + 1 != end)
+            if (json->string_len == 0 && (p + 1 != end || keep))
             {
                /* raw string fully inside input buffer, pass through */
                json->string_len          = p - raw;
@@ -459,7 +601,7 @@ static enum rjson_type _rjson_read_string(rjson_t *json)
          else if (c == '\\')
          {
             _rjson_char_t esc;
-            if (raw != p)
+            if (raw != p && !keep)
             {
                /* Can't pass through string with escapes, use string buffer */
                if (!_rjson_pushchars(json, raw, p))
@@ -470,7 +612,7 @@ static enum rjson_type _rjson_read_string(rjson_t *json)
             switch (esc)
             {
                case 'u':
-                  if (!_rjson_read_unicode(json))
+                  if (!_rjson_read_unicode(json, !keep))
                      return RJSON_ERROR;
                   break;
 
@@ -497,7 +639,7 @@ static enum rjson_type _rjson_read_string(rjson_t *json)
                case '"':
                case '\\':
 escape_pushchar:
-                  if (!_rjson_pushchar(json, esc))
+                  if (!keep && !_rjson_pushchar(json, esc))
                      return RJSON_ERROR;
                   break;
 
@@ -507,6 +649,14 @@ escape_pushchar:
                default:
                   return _rjson_error_char(json, "invalid escaped %s", esc);
             }
+            if (keep)
+            {
+               /* Escape checked, keep passing the raw string through */
+               json->string_escaped = true;
+               p   = json->input_p;
+               end = json->input_end;
+               continue;
+            }
             raw = p = json->input_p;
             end     = json->input_end;
          }
@@ -784,6 +934,7 @@ enum rjson_type rjson_next(rjson_t *json)
             {
                json->source_line++;
                json->source_column_p = p;
+               p = _rjson_skip_indent(p, end);
                continue;
             }
             else if (tok == _rJSON_TOK_OPTIONAL_SKIP)
@@ -938,6 +1089,8 @@ void _rjson_setup(rjson_t *json, rjson_io_t io, void *user_data, int input_len)
    json->source_column_p     = json->input_p;
    json->option_flags        = 0;
    json->decimal_sep         = 0;
+   json->keep_escapes        = false;
+   json->string_escaped      = false;
 }
 
 rjson_t *rjson_open_user(rjson_io_t io, void *user_data, int io_block_size)
@@ -968,13 +1121,24 @@ static int _rjson_buffer_io(void* buf, int len, void *user)
 
 rjson_t *rjson_open_buffer(const void *buffer, size_t len)
 {
-   rjson_t *json   = (rjson_t *)malloc(sizeof(rjson_t) + sizeof(const char *)*2);
-   const char **ud = (const char **)(json + 1);
+   /* Small documents are copied in with a single read, larger ones
+    * in blocks of _RJSON_BUFFER_BLOCK.  Only strings that straddle a
+    * block boundary are copied again instead of passed through, and
+    * peak memory stays the caller's buffer plus one block. */
+   size_t io_size  = (len < sizeof(((rjson_t*)0)->input_buf)
+         ? sizeof(((rjson_t*)0)->input_buf)
+         : (len > _RJSON_BUFFER_BLOCK ? _RJSON_BUFFER_BLOCK : len));
+   size_t ud_ofs   = (sizeof(rjson_t) - sizeof(((rjson_t*)0)->input_buf)
+         + io_size + sizeof(const char *) - 1)
+         & ~(sizeof(const char *) - 1);
+   rjson_t *json   = (rjson_t *)malloc(ud_ofs + sizeof(const char *)*2);
+   const char **ud;
    if (!json)
       return NULL;
+   ud    = (const char **)((char*)json + ud_ofs);
    ud[0] = (const char *)buffer;
    ud[1] = ud[0] + len;
-   _rjson_setup(json, _rjson_buffer_io, (void*)ud, sizeof(json->input_buf));
+   _rjson_setup(json, _rjson_buffer_io, (void*)ud, (int)io_size);
    return json;
 }
 
@@ -993,7 +1157,7 @@ rjson_t *rjson_open_stream(struct intfstream_internal *stream)
    /* Allocate an input buffer based on the file size */
    int64_t size = intfstream_get_size(stream);
    int io_size  =
-         (size > 1024*1024 ? 4096 :
+         (size > 1024*1024 ? 65536 :
          (size >  256*1024 ? 2048 : 1024));
    return rjson_open_user(_rjson_stream_io, stream, io_size);
 }
@@ -1008,7 +1172,7 @@ rjson_t *rjson_open_rfile(RFILE *rfile)
    /* Allocate an input buffer based on the file size */
    int64_t size = filestream_get_size(rfile);
    int io_size =
-         (size > 1024*1024 ? 4096 :
+         (size > 1024*1024 ? 65536 :
          (size >  256*1024 ? 2048 : 1024));
    return rjson_open_user(_rjson_rfile_io, rfile, io_size);
 }
@@ -1033,24 +1197,508 @@ const char *rjson_get_string(rjson_t *json, size_t *len)
    return str;
 }
 
-double rjson_get_double(rjson_t *json)
+/* ------------------------------------------------------------------------- */
+/* Locale independent number conversion                                      */
+/* ------------------------------------------------------------------------- */
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 _rjson_uint128_t;
+#endif
+
+/* 64x64 to 128-bit multiplication, returns the low half */
+static INLINE uint64_t _rjson_mul128(uint64_t a, uint64_t b, uint64_t *hi)
 {
-   char* str = (json->string_pass_through ? json->string_pass_through : json->string);
-   str[json->string_len] = '\0';
-   if (json->decimal_sep != '.')
+#if defined(__SIZEOF_INT128__)
+   _rjson_uint128_t r = (_rjson_uint128_t)a * b;
+   *hi                = (uint64_t)(r >> 64);
+   return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+   return _umul128(a, b, hi);
+#else
+   uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+   uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+   uint64_t ll   = a_lo * b_lo, lh = a_lo * b_hi;
+   uint64_t hl   = a_hi * b_lo, hh = a_hi * b_hi;
+   uint64_t mid  = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+   *hi           = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+   return (mid << 32) | (uint32_t)ll;
+#endif
+}
+
+static INLINE int _rjson_clz64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+   return __builtin_clzll(x);
+#else
+   int n = 0;
+   if (!(x >> 32)) { n += 32; x <<= 32; }
+   if (!(x >> 48)) { n += 16; x <<= 16; }
+   if (!(x >> 56)) { n +=  8; x <<=  8; }
+   if (!(x >> 60)) { n +=  4; x <<=  4; }
+   if (!(x >> 62)) { n +=  2; x <<=  2; }
+   if (!(x >> 63)) { n +=  1; }
+   return n;
+#endif
+}
+
+/* Converts w * 10^q to the nearest double, following the Eisel-Lemire
+ * algorithm ("Number Parsing at a Gigabyte per Second", Lemire 2021).
+ * w must be non-zero.  Returns false in the rare cases where the 128-bit
+ * approximation of 5^q can't decide the rounding. */
+static bool _rjson_eisel_lemire(uint64_t w, int q, bool neg, double *out)
+{
+   uint64_t lo, hi, mantissa, bits;
+   int lz, upperbit, shift, power2;
+   const uint64_t *pow5;
+
+   if (q < _RJSON_POW5_MIN)
+      bits = 0;
+   else if (q > 308)
+      bits = 0x7FF0000000000000ULL;
+   else
+   {
+      lz   = _rjson_clz64(w);
+      w  <<= lz;
+      pow5 = &_rjson_pow5[(q - _RJSON_POW5_MIN) * 2];
+      lo   = _rjson_mul128(w, pow5[0], &hi);
+      /* Only the 9 bits below the rounding bit are uncertain, look at
+       * the lower half of 5^q when all of them are set */
+      if ((hi & 0x1FF) == 0x1FF)
+      {
+         uint64_t hi2;
+         _rjson_mul128(w, pow5[1], &hi2);
+         lo += hi2;
+         if (hi2 > lo)
+            hi++;
+         /* Truncating 5^q and the dropped low product each leave the
+          * true value less than one unit above lo.  If that can carry
+          * into hi, the result is undecided. */
+         if (lo >= 0xFFFFFFFFFFFFFFFEULL)
+            return false;
+      }
+
+      upperbit = (int)(hi >> 63);
+      shift    = upperbit + 64 - 52 - 3;
+      mantissa = hi >> shift;
+      power2   = (int)((((152170 + 65536) * (int64_t)q) >> 16) + 63)
+               + upperbit - lz + 1023;
+
+      if (power2 <= 0)
+      {
+         /* Subnormal, round-to-even ties can't happen this far from 1 */
+         if (-power2 + 1 >= 64)
+            mantissa = 0;
+         else
+         {
+            mantissa >>= -power2 + 1;
+            mantissa  += (mantissa & 1);
+            mantissa >>= 1;
+         }
+         power2      = (mantissa < (1ULL << 52)) ? 0 : 1;
+      }
+      else
+      {
+         /* Exactly halfway between two doubles, only possible while
+          * 5^q fits the table exactly; round to even */
+         if (lo == 0 && q >= 0 && q <= 23 && (mantissa & 3) == 1
+               && (mantissa << shift) == hi)
+            mantissa &= ~1ULL;
+         mantissa += (mantissa & 1);
+         mantissa >>= 1;
+         if (mantissa >= (2ULL << 52))
+         {
+            mantissa = (1ULL << 52);
+            power2++;
+         }
+         mantissa &= ~(1ULL << 52);
+         if (power2 >= 0x7FF)
+         {
+            power2   = 0x7FF;
+            mantissa = 0;
+         }
+      }
+      bits = mantissa | ((uint64_t)power2 << 52);
+   }
+
+   if (neg)
+      bits |= (1ULL << 63);
+   memcpy(out, &bits, sizeof(bits));
+   return true;
+}
+
+/* Parses the decimal number at the start of str, accepting the same
+ * syntax as strtod but always with '.' as the decimal separator.
+ * Returns false if str doesn't start with a decimal number (hex, inf
+ * and nan are left to strtod) or the exact result is undecided. */
+static bool _rjson_parse_double(const char *str, double *out)
+{
+   /* Exactly representable powers of ten */
+   static const double pow10[] =
+   {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+   };
+   const unsigned char *p = (const unsigned char*)str;
+   uint64_t w             = 0;
+   int64_t exp10          = 0;
+   int digits             = 0;
+   bool neg               = false;
+   bool any               = false;
+   bool truncated         = false;
+
+   while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+      p++;
+   if (*p == '-' || *p == '+')
+      neg = (*p++ == '-');
+   if (p[0] == '0' && (p[1] | 0x20) == 'x')
+      return false;
+
+   /* Keep the first 19 significant digits, which always fit */
+   for (; *p == '0'; p++)
+      any = true;
+   for (; *p >= '0' && *p <= '9'; p++)
+   {
+      any = true;
+      if (digits < 19)
+      {
+         w = w * 10 + (*p - '0');
+         digits++;
+      }
+      else
+      {
+         exp10++;
+         truncated |= (*p != '0');
+      }
+   }
+   if (*p == '.')
+   {
+      p++;
+      if (!digits)
+         for (; *p == '0'; p++, exp10--)
+            any = true;
+      for (; *p >= '0' && *p <= '9'; p++)
+      {
+         any = true;
+         if (digits < 19)
+         {
+            w = w * 10 + (*p - '0');
+            digits++;
+            exp10--;
+         }
+         else
+            truncated |= (*p != '0');
+      }
+   }
+   if (!any)
+      return false;
+   if ((*p | 0x20) == 'e')
+   {
+      const unsigned char *e = p + 1;
+      bool eneg              = false;
+      int64_t ev             = 0;
+      if (*e == '-' || *e == '+')
+         eneg = (*e++ == '-');
+      if (*e >= '0' && *e <= '9')
+      {
+         for (; *e >= '0' && *e <= '9'; e++)
+            if (ev < 100000)
+               ev = ev * 10 + (*e - '0');
+         exp10 += (eneg ? -ev : ev);
+      }
+   }
+
+   if (!w)
+   {
+      *out = (neg ? -0.0 : 0.0);
+      return true;
+   }
+   if (exp10 < -100000)
+      exp10 = -100000;
+   else if (exp10 > 100000)
+      exp10 = 100000;
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1
+   /* Both operands exact, so a single IEEE operation rounds correctly.
+    * Skipped where the FPU keeps extended precision (x87), which would
+    * round twice. */
+   if (!truncated && w <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22)
+   {
+      double d = (double)w;
+      d        = (exp10 < 0 ? d / pow10[-exp10] : d * pow10[exp10]);
+      *out     = (neg ? -d : d);
+      return true;
+   }
+#endif
+
+   if (!_rjson_eisel_lemire(w, (int)exp10, neg, out))
+      return false;
+   if (truncated)
+   {
+      /* The dropped digits put the value between w and w + 1 */
+      double up;
+      if (     !_rjson_eisel_lemire(w + 1, (int)exp10, neg, &up)
+            || up != *out)
+         return false;
+   }
+   return true;
+}
+
+/* Parses the integer at the start of str like atoll, but saturating */
+static int64_t _rjson_parse_int64(const char *str)
+{
+   const unsigned char *p = (const unsigned char*)str;
+   uint64_t v             = 0;
+   bool neg               = false;
+   while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+      p++;
+   if (*p == '-' || *p == '+')
+      neg = (*p++ == '-');
+   for (; *p >= '0' && *p <= '9'; p++)
+   {
+      if (v > (UINT64_MAX - 9) / 10)
+      {
+         v = UINT64_MAX;
+         break;
+      }
+      v = v * 10 + (*p - '0');
+   }
+   if (neg)
+      return (v > (uint64_t)INT64_MAX ? INT64_MIN : -(int64_t)v);
+   return (v > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)v);
+}
+
+/* Writes v as decimal digits ending right before end, two at a time,
+ * and returns a pointer to the first digit */
+static char *_rjson_write_u64(char *end, uint64_t v)
+{
+   static const char pairs[201] =
+      "00010203040506070809101112131415161718192021222324"
+      "25262728293031323334353637383940414243444546474849"
+      "50515253545556575859606162636465666768697071727374"
+      "75767778798081828384858687888990919293949596979899";
+   while (v >= 100)
+   {
+      const char *d = pairs + (v % 100) * 2;
+      v            /= 100;
+      *--end        = d[1];
+      *--end        = d[0];
+   }
+   if (v >= 10)
+   {
+      const char *d = pairs + v * 2;
+      *--end        = d[1];
+      *--end        = d[0];
+   }
+   else
+      *--end        = (char)('0' + v);
+   return end;
+}
+
+static uint64_t _rjson_schubfach_rop(uint64_t g1, uint64_t g0, uint64_t cp)
+{
+   uint64_t x1, y0, y1, z;
+   _rjson_mul128(g0, cp, &x1);
+   y0 = _rjson_mul128(g1, cp, &y1);
+   z  = (y0 >> 1) + x1;
+   return (y1 + (z >> 63))
+      | (((z & 0x7FFFFFFFFFFFFFFFULL) + 0x7FFFFFFFFFFFFFFFULL) >> 63);
+}
+
+/* Finds the shortest decimal f * 10^e that rounds back to c * 2^q,
+ * following Giulietti's Schubfach algorithm ("The Schubfach way to
+ * render doubles", 2020).  Unlike Java's Double.toString, which it was
+ * written for, the smallest subnormals aren't padded to two digits. */
+static void _rjson_schubfach(int q, uint64_t c, uint64_t *f, int *e)
+{
+   uint64_t cb  = c << 2;
+   uint64_t cbr = cb + 2;
+   uint64_t cbl, ghi, glo, g1, g0, vb, vbl, vbr, s, t;
+   int out      = (int)(c & 1);
+   int k, h;
+   int64_t cmp;
+   bool uin, win;
+   const uint64_t *pow5;
+
+   if (c != (1ULL << 52) || q == -1074)
+   {
+      cbl = cb - 2;
+      k   = (int)(((int64_t)q * 661971961083LL) >> 41);
+   }
+   else
+   {
+      /* The lower neighbour of a power of two is closer */
+      cbl = cb - 1;
+      k   = (int)(((int64_t)q * 661971961083LL - 274743187321LL) >> 41);
+   }
+   h    = q + (int)(((int64_t)-k * 913124641741LL) >> 38) + 2;
+
+   /* g = floor(10^-k / 2^r) + 1 scaled to 126 bits, split in two
+    * 63-bit halves; derived from the truncated 128-bit 5^-k */
+   pow5 = &_rjson_pow5[(-k - _RJSON_POW5_MIN) * 2];
+   ghi  = pow5[0] >> 2;
+   glo  = (pow5[1] >> 2) | (pow5[0] << 62);
+   if (++glo == 0)
+      ghi++;
+   g1   = (ghi << 1) | (glo >> 63);
+   g0   = glo & 0x7FFFFFFFFFFFFFFFULL;
+
+   vb   = _rjson_schubfach_rop(g1, g0, cb  << h);
+   vbl  = _rjson_schubfach_rop(g1, g0, cbl << h);
+   vbr  = _rjson_schubfach_rop(g1, g0, cbr << h);
+
+   s    = vb >> 2;
+   if (s >= 10)
+   {
+      /* Try one digit less first; Java stops at s >= 100 to keep two
+       * digits, which only subnormals reach */
+      uint64_t sp10 = (s / 10) * 10;
+      uint64_t tp10 = sp10 + 10;
+      bool upin     = (vbl + out <= (sp10 << 2));
+      bool wpin     = ((tp10 << 2) + out <= vbr);
+      if (upin != wpin)
+      {
+         *f = (upin ? sp10 : tp10);
+         *e = k;
+         return;
+      }
+   }
+
+   t    = s + 1;
+   uin  = (vbl + out <= (s << 2));
+   win  = ((t << 2) + out <= vbr);
+   *e   = k;
+   if (uin != win)
+   {
+      *f = (uin ? s : t);
+      return;
+   }
+   /* Both in range, pick the closest (even on a tie) */
+   cmp  = (int64_t)(vb - ((s + t) << 1));
+   *f   = ((cmp < 0 || (cmp == 0 && !(s & 1))) ? s : t);
+}
+
+/* Writes the shortest representation of value that reads back as the
+ * same double, formatted like JavaScript's Number.toString.
+ * buf must hold at least 32 bytes.  Returns the length. */
+static int _rjson_format_double(char *buf, double value)
+{
+   char digits[24];
+   char *d, *end = digits + sizeof(digits), *o = buf;
+   uint64_t bits, frac, f;
+   int biased, e, n, exp10, i;
+
+   memcpy(&bits, &value, sizeof(bits));
+   frac   = bits & ((1ULL << 52) - 1);
+   biased = (int)((bits >> 52) & 0x7FF);
+
+   /* JSON has no representation for infinities and NaN */
+   if (biased == 0x7FF)
+   {
+      memcpy(buf, "null", 4);
+      return 4;
+   }
+   if (bits >> 63)
+      *o++ = '-';
+
+   if (biased)
+   {
+      int mq     = 1075 - biased;
+      uint64_t c = (1ULL << 52) | frac;
+      e          = 0;
+      f          = c;
+      /* Integers below 2^53 are printed as they are */
+      if (mq > 0 && mq < 53 && ((c >> mq) << mq) == c)
+         f       = c >> mq;
+      else
+         _rjson_schubfach(-mq, c, &f, &e);
+   }
+   else if (frac)
+      _rjson_schubfach(-1074, frac, &f, &e);
+   else
+   {
+      *o++ = '0';
+      return (int)(o - buf);
+   }
+
+   while (f % 10 == 0)
+   {
+      f /= 10;
+      e++;
+   }
+   d     = _rjson_write_u64(end, f);
+   n     = (int)(end - d);
+   exp10 = e + n - 1;
+
+   if (exp10 >= 0 && exp10 < 21)
+   {
+      if (e >= 0)
+      {
+         memcpy(o, d, n);
+         o += n;
+         for (i = 0; i < e; i++)
+            *o++ = '0';
+      }
+      else
+      {
+         memcpy(o, d, exp10 + 1);
+         o   += exp10 + 1;
+         *o++ = '.';
+         memcpy(o, d + exp10 + 1, n - exp10 - 1);
+         o   += n - exp10 - 1;
+      }
+   }
+   else if (exp10 < 0 && exp10 >= -6)
+   {
+      *o++ = '0';
+      *o++ = '.';
+      for (i = -1; i > exp10; i--)
+         *o++ = '0';
+      memcpy(o, d, n);
+      o += n;
+   }
+   else
+   {
+      unsigned ue;
+      *o++ = d[0];
+      if (n > 1)
+      {
+         *o++ = '.';
+         memcpy(o, d + 1, n - 1);
+         o += n - 1;
+      }
+      *o++ = 'e';
+      *o++ = (exp10 < 0 ? '-' : '+');
+      ue   = (unsigned)(exp10 < 0 ? -exp10 : exp10);
+      if (ue >= 100)
+         *o++ = (char)('0' + ue / 100);
+      if (ue >= 10)
+         *o++ = (char)('0' + (ue / 10) % 10);
+      *o++ = (char)('0' + ue % 10);
+   }
+   return (int)(o - buf);
+}
+
+/* Converts a NUL-terminated number, decimal_sep caches the locale's */
+static double _rjson_str_to_double(char *str, char *decimal_sep)
+{
+   double res;
+   if (_rJSON_LIKELY(_rjson_parse_double(str, &res)))
+      return res;
+   /* Hex, inf and nan, or one of the rare numbers the fast path can't
+    * round exactly; strtod needs the locale's decimal separator */
+   if (*decimal_sep != '.')
    {
       /* handle locale that uses a non-standard decimal separator */
       char *p;
-      if (json->decimal_sep == 0)
+      if (*decimal_sep == 0)
       {
          char test[4];
          snprintf(test, sizeof(test), "%.1f", 0.0f);
-         json->decimal_sep = test[1];
+         *decimal_sep = test[1];
       }
-      if (json->decimal_sep != '.' && (p = (char*)memchr(str, '.', strlen(str) + 1)) != NULL)
+      if (*decimal_sep != '.' && (p = (char*)memchr(str, '.', strlen(str) + 1)) != NULL)
       {
-         double res;
-         *p  = json->decimal_sep;
+         *p  = *decimal_sep;
          res = atof(str);
          *p  = '.';
          return res;
@@ -1059,11 +1707,24 @@ double rjson_get_double(rjson_t *json)
    return atof(str);
 }
 
+double rjson_get_double(rjson_t *json)
+{
+   char* str = (json->string_pass_through ? json->string_pass_through : json->string);
+   str[json->string_len] = '\0';
+   return _rjson_str_to_double(str, &json->decimal_sep);
+}
+
 int rjson_get_int(rjson_t *json)
+{
+   int64_t res = rjson_get_int64(json);
+   return (int)(res < INT_MIN ? INT_MIN : (res > INT_MAX ? INT_MAX : res));
+}
+
+int64_t rjson_get_int64(rjson_t *json)
 {
    char* str = (json->string_pass_through ? json->string_pass_through : json->string);
    str[json->string_len] = '\0';
-   return atoi(str);
+   return _rjson_parse_int64(str);
 }
 
 const char *rjson_get_error(rjson_t *json)
@@ -1138,12 +1799,20 @@ enum rjson_type rjson_get_context_type(rjson_t *json)
    return json->stack_top->type;
 }
 
-void rjson_free(rjson_t *json)
+/* Frees the buffers a parser may have grown, but not the parser itself */
+static void _rjson_release(rjson_t *json)
 {
    if (json->stack != json->inline_stack)
       free(json->stack);
    if (json->string != json->inline_string)
       free(json->string);
+   json->stack  = json->inline_stack;
+   json->string = json->inline_string;
+}
+
+void rjson_free(rjson_t *json)
+{
+   _rjson_release(json);
    free(json);
 }
 
@@ -1249,6 +1918,7 @@ bool rjson_parse_quick(const char *string, size_t len, void* context, char optio
 {
    const char *user_data[2];
    rjson_t json;
+   bool ret     = false;
    user_data[0] = string;
    user_data[1] = string + len;
    _rjson_setup(&json, _rjson_buffer_io, (void*)user_data, sizeof(json.input_buf));
@@ -1258,15 +1928,385 @@ bool rjson_parse_quick(const char *string, size_t len, void* context, char optio
          start_object_handler, end_object_handler,
          start_array_handler, end_array_handler,
          boolean_handler, null_handler) == RJSON_DONE)
-      return true;
-   if (error_handler)
+      ret = true;
+   else if (error_handler)
       error_handler(context,
             (int)rjson_get_source_line(&json),
             (int)rjson_get_source_column(&json),
             rjson_get_error(&json));
+   /* The parser lives on the stack, but strings longer than the
+    * inline buffer still got a heap allocation */
+   _rjson_release(&json);
+   return ret;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Tape                                                                      */
+/* ------------------------------------------------------------------------- */
+
+/* Node flags */
+#define _RJSON_TAPE_ESCAPED 1 /* string still has its escape sequences */
+
+/* Every value is one node, containers are closed with an extra end node.
+ * A container's skip is the distance past its end node, so stepping
+ * to the next sibling is a single addition.  While a container is
+ * still open during parsing, skip holds the index of its parent. */
+struct _rjson_tape_node
+{
+   uint32_t offset; /* of string/number text in the document copy */
+   uint32_t len;    /* of string/number text, child nodes for containers */
+   uint32_t skip;
+   unsigned char type, flags;
+};
+
+struct rjson_tape
+{
+   struct _rjson_tape_node *nodes;
+   size_t count, cap;
+   /* Parser kept between parses, its input buffer holds the document */
+   rjson_t *json;
+   size_t json_cap;
+   char error[128];
+};
+
+rjson_tape_t *rjson_tape_new(void)
+{
+   return (rjson_tape_t*)calloc(1, sizeof(rjson_tape_t));
+}
+
+void rjson_tape_free(rjson_tape_t *tape)
+{
+   if (!tape)
+      return;
+   if (tape->json)
+   {
+      _rjson_release(tape->json);
+      free(tape->json);
+   }
+   free(tape->nodes);
+   free(tape);
+}
+
+static struct _rjson_tape_node *_rjson_tape_push(rjson_tape_t *tape,
+      unsigned char type, size_t parent)
+{
+   struct _rjson_tape_node *node;
+   if (tape->count == tape->cap)
+   {
+      size_t new_cap = (tape->cap ? tape->cap * 2 : 64);
+      struct _rjson_tape_node *nodes = (struct _rjson_tape_node*)
+            realloc(tape->nodes, new_cap * sizeof(*nodes));
+      if (!nodes)
+         return NULL;
+      tape->nodes = nodes;
+      tape->cap   = new_cap;
+   }
+   if (parent != RJSON_TAPE_NONE)
+      tape->nodes[parent].len++;
+   node         = &tape->nodes[tape->count++];
+   node->offset = 0;
+   node->len    = 0;
+   node->skip   = 1;
+   node->type   = type;
+   node->flags  = 0;
+   return node;
+}
+
+bool rjson_tape_parse(rjson_tape_t *tape, const char *string, size_t len,
+      char option_flags)
+{
+   const char *user_data[2];
+   struct _rjson_tape_node *node;
+   rjson_t *json;
+   size_t open      = RJSON_TAPE_NONE;
+   size_t json_cap  = (len + 1 < sizeof(((rjson_t*)0)->input_buf)
+         ? sizeof(((rjson_t*)0)->input_buf) : len + 1);
+
+   tape->count      = 0;
+   tape->error[0]   = '\0';
+   if (len >= _RJSON_MAX_SIZE)
+   {
+      snprintf(tape->error, sizeof(tape->error), "document too large");
+      return false;
+   }
+
+   /* The parser's input buffer is sized to take the whole document,
+    * with a spare byte to terminate a number right at its end */
+   if (tape->json)
+      _rjson_release(tape->json);
+   if (json_cap > tape->json_cap)
+   {
+      json = (rjson_t*)realloc(tape->json,
+            sizeof(rjson_t) - sizeof(json->input_buf) + json_cap);
+      if (!json)
+      {
+         snprintf(tape->error, sizeof(tape->error), "out of memory");
+         return false;
+      }
+      tape->json     = json;
+      tape->json_cap = json_cap;
+   }
+   json         = tape->json;
+   user_data[0] = string;
+   user_data[1] = string + len;
+   _rjson_setup(json, _rjson_buffer_io, (void*)user_data, (int)tape->json_cap);
+   json->option_flags = option_flags;
+   json->keep_escapes = true;
+
+   for (;;)
+   {
+      enum rjson_type type = rjson_next(json);
+      switch (type)
+      {
+         case RJSON_DONE:
+            json->keep_escapes = false;
+            json->user_data    = NULL;
+            return true;
+         case RJSON_ERROR:
+            snprintf(tape->error, sizeof(tape->error),
+                  "%s at line %u, column %u", json->error_text,
+                  (unsigned)rjson_get_source_line(json),
+                  (unsigned)rjson_get_source_column(json));
+            tape->count = 0;
+            return false;
+         case RJSON_OBJECT_END:
+         case RJSON_ARRAY_END:
+            if (!(node = _rjson_tape_push(tape, (unsigned char)type,
+                  RJSON_TAPE_NONE)))
+               goto oom;
+            node       = &tape->nodes[open];
+            open       = (node->skip == (uint32_t)-1 ? RJSON_TAPE_NONE : node->skip);
+            node->skip = (uint32_t)(tape->count - (node - tape->nodes));
+            break;
+         default:
+            if (!(node = _rjson_tape_push(tape, (unsigned char)type, open)))
+               goto oom;
+            if (type == RJSON_OBJECT || type == RJSON_ARRAY)
+            {
+               node->skip = (uint32_t)open;
+               open       = tape->count - 1;
+            }
+            else if (type == RJSON_STRING)
+            {
+               node->offset = (uint32_t)
+                     ((unsigned char*)json->string_pass_through - json->input_buf);
+               node->len    = (uint32_t)json->string_len;
+               if (json->string_escaped)
+                  node->flags = _RJSON_TAPE_ESCAPED;
+               else
+                  json->string_pass_through[json->string_len] = '\0';
+            }
+            else if (type == RJSON_NUMBER)
+            {
+               /* Numbers are copied out by the parser, but they are
+                * still intact in the document and end right where
+                * parsing stopped (or at the end of the document) */
+               size_t end   = (json->input_p == json->input_buf
+                     ? len : (size_t)(json->input_p - json->input_buf));
+               node->offset = (uint32_t)(end - json->string_len);
+               node->len    = (uint32_t)json->string_len;
+            }
+            break;
+      }
+   }
+
+oom:
+   snprintf(tape->error, sizeof(tape->error), "out of memory");
+   tape->count = 0;
    return false;
 }
 
+const char *rjson_tape_get_error(rjson_tape_t *tape)
+{
+   return tape->error;
+}
+
+enum rjson_type rjson_tape_get_type(rjson_tape_t *tape, size_t node)
+{
+   if (node >= tape->count)
+      return RJSON_ERROR;
+   return (enum rjson_type)tape->nodes[node].type;
+}
+
+size_t rjson_tape_get_count(rjson_tape_t *tape, size_t node)
+{
+   if (node >= tape->count)
+      return 0;
+   switch (tape->nodes[node].type)
+   {
+      case RJSON_ARRAY:
+         return tape->nodes[node].len;
+      case RJSON_OBJECT:
+         return tape->nodes[node].len / 2;
+   }
+   return 0;
+}
+
+size_t rjson_tape_first(rjson_tape_t *tape, size_t node)
+{
+   if (     node >= tape->count
+         || (tape->nodes[node].type != RJSON_OBJECT
+         &&  tape->nodes[node].type != RJSON_ARRAY)
+         || !tape->nodes[node].len)
+      return RJSON_TAPE_NONE;
+   return node + 1;
+}
+
+size_t rjson_tape_next(rjson_tape_t *tape, size_t node)
+{
+   if (node >= tape->count)
+      return RJSON_TAPE_NONE;
+   node += tape->nodes[node].skip;
+   if (     node >= tape->count
+         || tape->nodes[node].type == RJSON_OBJECT_END
+         || tape->nodes[node].type == RJSON_ARRAY_END)
+      return RJSON_TAPE_NONE;
+   return node;
+}
+
+const char *rjson_tape_get_string(rjson_tape_t *tape, size_t node,
+      size_t *length)
+{
+   struct _rjson_tape_node *n;
+   rjson_t *json = tape->json;
+   char *str;
+
+   if (length)
+      *length = 0;
+   if (node >= tape->count)
+      return NULL;
+   n = &tape->nodes[node];
+   if (n->type != RJSON_STRING && n->type != RJSON_NUMBER)
+      return NULL;
+   str = (char*)json->input_buf + n->offset;
+
+   if (n->flags & _RJSON_TAPE_ESCAPED)
+   {
+      /* Unescape on first access by running the string reader again
+       * over the raw text and its closing quote.  The result is never
+       * longer than the escaped text, so it is written back in place. */
+      json->input_p   = (const unsigned char*)str;
+      json->input_end = (const unsigned char*)str + n->len + 1;
+      if (_rjson_read_string(json) != RJSON_STRING)
+      {
+         /* Only running out of memory can fail here, allow a retry */
+         json->stack_top->type = RJSON_DONE;
+         return NULL;
+      }
+      memcpy(str, json->string, json->string_len);
+      n->len    = (uint32_t)json->string_len;
+      n->flags &= ~_RJSON_TAPE_ESCAPED;
+      json->string_len = 0;
+   }
+   /* Numbers are only terminated now as the byte after them was
+    * still needed by the parser */
+   str[n->len] = '\0';
+   if (length)
+      *length = n->len;
+   return str;
+}
+
+double rjson_tape_get_double(rjson_tape_t *tape, size_t node)
+{
+   char *str = (char*)rjson_tape_get_string(tape, node, NULL);
+   return (str ? _rjson_str_to_double(str, &tape->json->decimal_sep) : 0.0);
+}
+
+int64_t rjson_tape_get_int64(rjson_tape_t *tape, size_t node)
+{
+   const char *str = rjson_tape_get_string(tape, node, NULL);
+   return (str ? _rjson_parse_int64(str) : 0);
+}
+
+size_t rjson_tape_get_index(rjson_tape_t *tape, size_t array, size_t index)
+{
+   size_t node;
+   if (     array >= tape->count
+         || tape->nodes[array].type != RJSON_ARRAY
+         || index >= tape->nodes[array].len)
+      return RJSON_TAPE_NONE;
+   for (node = array + 1; index--;)
+      node += tape->nodes[node].skip;
+   return node;
+}
+
+/* Compares a member name with a key, which may be JSON Pointer escaped */
+static bool _rjson_tape_key_equal(rjson_tape_t *tape, size_t node,
+      const char *key, size_t len, bool pointer)
+{
+   size_t name_len;
+   const char *name;
+   if (     !(tape->nodes[node].flags & _RJSON_TAPE_ESCAPED)
+         && !pointer && tape->nodes[node].len != len)
+      return false;
+   if (!(name = rjson_tape_get_string(tape, node, &name_len)))
+      return false;
+   if (!pointer)
+      return (name_len == len && !memcmp(name, key, len));
+   for (; len; len--, name_len--)
+   {
+      char c = *key++;
+      if (c == '~' && len > 1 && (*key == '0' || *key == '1'))
+      {
+         c = (*key++ == '0' ? '~' : '/');
+         len--;
+      }
+      if (!name_len || *name++ != c)
+         return false;
+   }
+   return !name_len;
+}
+
+static size_t _rjson_tape_member(rjson_tape_t *tape, size_t object,
+      const char *key, size_t len, bool pointer)
+{
+   size_t node;
+   if (object >= tape->count || tape->nodes[object].type != RJSON_OBJECT)
+      return RJSON_TAPE_NONE;
+   /* Members are name and value node pairs, names are always 1 node */
+   for (node = object + 1; tape->nodes[node].type == RJSON_STRING;)
+   {
+      if (_rjson_tape_key_equal(tape, node, key, len, pointer))
+         return node + 1;
+      node += 1 + tape->nodes[node + 1].skip;
+   }
+   return RJSON_TAPE_NONE;
+}
+
+size_t rjson_tape_get_member(rjson_tape_t *tape, size_t object,
+      const char *key)
+{
+   return _rjson_tape_member(tape, object, key, strlen(key), false);
+}
+
+size_t rjson_tape_find(rjson_tape_t *tape, size_t node, const char *path)
+{
+   while (*path == '/' && node < tape->count)
+   {
+      const char *token = ++path;
+      while (*path && *path != '/')
+         path++;
+      if (tape->nodes[node].type == RJSON_ARRAY)
+      {
+         /* Array indices are plain decimals without leading zeros */
+         const char *p;
+         size_t index = 0;
+         if (path == token || (*token == '0' && path - token > 1))
+            return RJSON_TAPE_NONE;
+         for (p = token; p != path; p++)
+         {
+            if (*p < '0' || *p > '9' || index > (RJSON_TAPE_NONE - 9) / 10)
+               return RJSON_TAPE_NONE;
+            index = index * 10 + (size_t)(*p - '0');
+         }
+         node = rjson_tape_get_index(tape, node, index);
+      }
+      else
+         node = _rjson_tape_member(tape, node, token, path - token, true);
+   }
+   return (*path || node >= tape->count ? RJSON_TAPE_NONE : node);
+}
+
 struct rjsonwriter
 {
    char* buf;
@@ -1276,7 +2316,7 @@ struct rjsonwriter
    void *user_data;
 
    const char* error_text;
-   char option_flags, decimal_sep;
+   char option_flags;
    bool buf_is_output, final_flush;
 
    char inline_buf[1024];
@@ -1293,7 +2333,7 @@ rjsonwriter_t *rjsonwriter_open_user(rjsonwriter_io_t io, void *user_data)
    writer->buf_cap       = sizeof(writer->inline_buf);
 
    writer->error_text    = NULL;
-   writer->option_flags  = writer->decimal_sep = 0;
+   writer->option_flags  = 0;
    writer->buf_is_output = writer->final_flush = false;
 
    writer->io            = io;
@@ -1599,23 +2639,25 @@ void rjsonwriter_add_string_len(rjsonwriter_t *writer, const char *value, int le
 
 void rjsonwriter_add_double(rjsonwriter_t *writer, double value)
 {
-   int old_buf_num = writer->buf_num;
-   rjsonwriter_rawf(writer, "%G", value);
-   if (writer->decimal_sep != '.')
-   {
-      /* handle locale that uses a non-standard decimal separator */
-      char *p, *str;
-      if (writer->decimal_sep == 0)
-      {
-         char test[4];
-         snprintf(test, sizeof(test), "%.1f", 0.0f);
-         if ((writer->decimal_sep = test[1]) == '.')
-            return;
-      }
-      str = writer->buf + (old_buf_num > writer->buf_num ? 0 : old_buf_num);
-      if ((p = strchr(str, writer->decimal_sep)) != NULL)
-         *p = '.';
-   }
+   char buf[32];
+   rjsonwriter_raw(writer, buf, _rjson_format_double(buf, value));
+}
+
+void rjsonwriter_add_int64(rjsonwriter_t *writer, int64_t value)
+{
+   char buf[24];
+   char *p = _rjson_write_u64(buf + sizeof(buf),
+         (value < 0 ? 0 - (uint64_t)value : (uint64_t)value));
+   if (value < 0)
+      *--p = '-';
+   rjsonwriter_raw(writer, p, (int)(buf + sizeof(buf) - p));
+}
+
+void rjsonwriter_add_uint64(rjsonwriter_t *writer, uint64_t value)
+{
+   char buf[24];
+   char *p = _rjson_write_u64(buf + sizeof(buf), value);
+   rjsonwriter_raw(writer, p, (int)(buf + sizeof(buf) - p));
 }
 
 void rjsonwriter_add_spaces(rjsonwriter_t *writer, int count)
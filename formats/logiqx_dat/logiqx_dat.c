@@ -20,17 +20,138 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <file/file_path.h>
 #include <string/stdstring.h>
+#include <streams/file_stream.h>
+#include <streams/interface_stream.h>
 #include <formats/rxml.h>
 
 #include <formats/logiqx_dat.h>
 
+/* A DAT file is streamed once at load time into flat
+ * game and ROM tables; the DOM is never built. Lookup
+ * indexes are sorted arrays over those tables, built
+ * the first time a search needs them.
+ *
+ * Index cache layout (native byte order, see
+ * logiqx_dat_init_cached()):
+ *   header
+ *   roms[num_roms]
+ *   games[num_games]
+ *   strings[strings_len]     - NUL-terminated, offset 0 is ""
+ */
+#define LOGIQX_DAT_CACHE_MAGIC   0x58444c52 /* 'RLDX' */
+#define LOGIQX_DAT_CACHE_VERSION 1
+
+enum logiqx_dat_game_flags
+{
+   LOGIQX_DAT_GAME_BIOS     = (1 << 0),
+   LOGIQX_DAT_GAME_RUNNABLE = (1 << 1)
+};
+
+enum logiqx_dat_rom_flags
+{
+   LOGIQX_DAT_ROM_CRC  = (1 << 0),
+   LOGIQX_DAT_ROM_SIZE = (1 << 1),
+   LOGIQX_DAT_ROM_MD5  = (1 << 2),
+   LOGIQX_DAT_ROM_SHA1 = (1 << 3)
+};
+
+enum logiqx_dat_flags
+{
+   LOGIQX_DAT_FLAG_NAME_INDEX = (1 << 0),
+   LOGIQX_DAT_FLAG_ROM_INDEX  = (1 << 1)
+};
+
+/* Strings are offsets into the string pool, already
+ * sanitised and truncated to logiqx_dat_game_info_t sizes */
+struct logiqx_dat_game
+{
+   uint32_t name;
+   uint32_t description;
+   uint32_t year;
+   uint32_t manufacturer;
+   uint32_t flags;
+};
+
+struct logiqx_dat_rom
+{
+   uint64_t size;
+   uint32_t crc;
+   uint32_t game;
+   uint8_t  md5[16];
+   uint8_t  sha1[20];
+   uint32_t flags;
+};
+
+struct logiqx_dat_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_games;
+   uint32_t num_roms;
+   uint32_t strings_len;
+   uint32_t path;
+   uint32_t game_size;
+   uint32_t rom_size;
+   int64_t  mtime;
+   int64_t  size;
+};
+
+/* Index entries; ties are broken by game index so that
+ * the first match is the first game in file order */
+struct logiqx_dat_name_key
+{
+   const char *name;
+   uint32_t game;
+};
+
+struct logiqx_dat_crc_key
+{
+   uint64_t size;
+   uint32_t crc;
+   uint32_t game;
+};
+
+struct logiqx_dat_md5_key
+{
+   uint8_t  md5[16];
+   uint32_t game;
+};
+
+struct logiqx_dat_sha1_key
+{
+   uint8_t  sha1[20];
+   uint32_t game;
+};
+
 /* Holds all internal DAT file data */
 struct logiqx_dat
 {
-   rxml_document_t *data;
-   rxml_node_t *current_node;
+   struct logiqx_dat_rom  *roms;
+   struct logiqx_dat_game *games;
+   char *strings;
+   uint8_t *cache;    /* tables live in here when loaded from a cache */
+   struct logiqx_dat_name_key *name_index;
+   struct logiqx_dat_crc_key  *crc_index;
+   struct logiqx_dat_md5_key  *md5_index;
+   struct logiqx_dat_sha1_key *sha1_index;
+   size_t num_games;
+   size_t num_roms;
+   size_t strings_len;
+   size_t games_cap;
+   size_t roms_cap;
+   size_t strings_cap;
+   size_t name_count;
+   size_t crc_count;
+   size_t md5_count;
+   size_t sha1_count;
+   size_t current;
+   uint8_t flags;
 };
 
 /* List of HTML formatting codes that must
@@ -88,96 +209,12 @@ bool logiqx_dat_path_is_valid(const char *path, uint64_t *file_size)
    return true;
 }
 
-/* File initialisation/de-initialisation */
-
-/* Loads specified Logiqx XML DAT file from disk.
- * Returned logiqx_dat_t object must be free'd using
- * logiqx_dat_free().
- * Returns NULL if file is invalid or a read error
- * occurs. */
-logiqx_dat_t *logiqx_dat_init(const char *path)
-{
-   logiqx_dat_t *dat_file = NULL;
-   rxml_node_t *root_node = NULL;
-
-   /* Check file path */
-   if (!logiqx_dat_path_is_valid(path, NULL))
-      goto error;
-
-   /* Create logiqx_dat_t object */
-   dat_file = (logiqx_dat_t*)calloc(1, sizeof(*dat_file));
-
-   if (!dat_file)
-      goto error;
-
-   /* Read file from disk */
-   dat_file->data = rxml_load_document(path);
-
-   if (!dat_file->data)
-      goto error;
 
-   /* Ensure root node has the correct name */
-   root_node = rxml_root_node(dat_file->data);
+/* Table building */
 
-   if (!root_node)
-      goto error;
-
-   if (!root_node->name || !*root_node->name)
-      goto error;
-
-   /* > Logiqx XML uses:           'datafile'
-    * > MAME List XML uses:        'mame'
-    * > MAME 'Software List' uses: 'softwarelist' */
-   if (   !string_is_equal(root_node->name, "datafile")
-       && !string_is_equal(root_node->name, "mame")
-       && !string_is_equal(root_node->name, "softwarelist"))
-      goto error;
-
-   /* Get pointer to initial child node */
-   dat_file->current_node = root_node->children;
-
-   if (!dat_file->current_node)
-      goto error;
-
-   /* All is well - return logiqx_dat_t object */
-   return dat_file;
-
-error:
-   logiqx_dat_free(dat_file);
-   return NULL;
-}
-
-/* Frees specified DAT file */
-void logiqx_dat_free(logiqx_dat_t *dat_file)
+/* Returns true if specified element name is a 'game' entry */
+static bool logiqx_dat_is_game_name(const char *node_name)
 {
-   if (!dat_file)
-      return;
-
-   dat_file->current_node = NULL;
-
-   if (dat_file->data)
-   {
-      rxml_free_document(dat_file->data);
-      dat_file->data = NULL;
-   }
-
-   free(dat_file);
-   dat_file = NULL;
-}
-
-/* Game information access */
-
-/* Returns true if specified node is a 'game' entry */
-static bool logiqx_dat_is_game_node(rxml_node_t *node)
-{
-   const char *node_name = NULL;
-
-   if (!node)
-      return false;
-
-   /* Check node name */
-   node_name = node->name;
-
    if (!node_name || !*node_name)
       return false;
 
@@ -189,23 +226,6 @@ static bool logiqx_dat_is_game_node(rxml_node_t *node)
           || string_is_equal(node_name, "software");
 }
 
-/* Returns true if specified node is a game
- * node containing information for a game with
- * the specified name */
-static bool logiqx_dat_game_node_matches_name(
-      rxml_node_t *node, const char *game_name)
-{
-   const char *node_game_name = NULL;
-   if (  !logiqx_dat_is_game_node(node)
-       || (!game_name || !*game_name))
-      return false;
-   /* Get 'name' attribute of XML node */
-   node_game_name = rxml_node_attrib(node, "name");
-   if (!node_game_name || !*node_game_name)
-      return false;
-   return string_is_equal(node_game_name, game_name);
-}
-
 /* The XML element data strings returned from
  * DAT files are very 'messy'. This function
  * removes all cruft, replaces formatting strings
@@ -263,25 +283,165 @@ static void logiqx_dat_sanitise_element_data(
       strlcpy(str, sanitised_data, len);
 }
 
-/* Extracts game information from specified node.
- * Returns false if node is invalid */
-static bool logiqx_dat_parse_game_node(
-      rxml_node_t *node, logiqx_dat_game_info_t *game_info)
+/* Parses exactly 'len' bytes worth of hex digits */
+static bool logiqx_dat_parse_hex(const char *s, uint8_t *out, size_t len)
 {
-   const char *game_name   = NULL;
-   const char *is_bios     = NULL;
-   const char *is_runnable = NULL;
-   rxml_node_t *info_node  = NULL;
-   bool description_found  = false;
-   bool year_found         = false;
-   bool manufacturer_found = false;
+   size_t i;
 
-   if (!logiqx_dat_is_game_node(node))
+   if (!s || strlen(s) != len * 2)
       return false;
 
-   if (!game_info)
+   for (i = 0; i < len * 2; i++)
+   {
+      char c    = s[i];
+      uint8_t v;
+      if (c >= '0' && c <= '9')
+         v = (uint8_t)(c - '0');
+      else if (c >= 'a' && c <= 'f')
+         v = (uint8_t)(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+         v = (uint8_t)(c - 'A' + 10);
+      else
+         return false;
+      if (i & 1)
+         out[i >> 1] |= v;
+      else
+         out[i >> 1]  = (uint8_t)(v << 4);
+   }
+
+   return true;
+}
+
+/* Appends 's' to the string pool; empty strings
+ * share offset 0 */
+static bool logiqx_dat_add_string(logiqx_dat_t *dat_file,
+      const char *s, uint32_t *offset)
+{
+   size_t _len = strlen(s) + 1;
+
+   if (_len == 1)
+   {
+      *offset = 0;
+      return true;
+   }
+
+   if (dat_file->strings_len + _len > dat_file->strings_cap)
+   {
+      size_t cap = dat_file->strings_cap * 2;
+      char *tmp  = NULL;
+      while (cap < dat_file->strings_len + _len)
+         cap *= 2;
+      if (cap > UINT32_MAX)
+         return false;
+      if (!(tmp = (char*)realloc(dat_file->strings, cap)))
+         return false;
+      dat_file->strings     = tmp;
+      dat_file->strings_cap = cap;
+   }
+
+   *offset = (uint32_t)dat_file->strings_len;
+   memcpy(dat_file->strings + dat_file->strings_len, s, _len);
+   dat_file->strings_len += _len;
+   return true;
+}
+
+static bool logiqx_dat_add_game(logiqx_dat_t *dat_file,
+      const logiqx_dat_game_info_t *game_info)
+{
+   struct logiqx_dat_game *game = NULL;
+
+   if (dat_file->num_games == dat_file->games_cap)
+   {
+      size_t cap = dat_file->games_cap ? dat_file->games_cap * 2 : 256;
+      struct logiqx_dat_game *tmp = (struct logiqx_dat_game*)realloc(
+            dat_file->games, cap * sizeof(*tmp));
+      if (!tmp)
+         return false;
+      dat_file->games     = tmp;
+      dat_file->games_cap = cap;
+   }
+
+   game        = &dat_file->games[dat_file->num_games];
+   game->flags = 0;
+   if (game_info->is_bios)
+      game->flags |= LOGIQX_DAT_GAME_BIOS;
+   if (game_info->is_runnable)
+      game->flags |= LOGIQX_DAT_GAME_RUNNABLE;
+
+   if (     !logiqx_dat_add_string(dat_file, game_info->name, &game->name)
+         || !logiqx_dat_add_string(dat_file, game_info->description,
+               &game->description)
+         || !logiqx_dat_add_string(dat_file, game_info->year, &game->year)
+         || !logiqx_dat_add_string(dat_file, game_info->manufacturer,
+               &game->manufacturer))
       return false;
 
+   dat_file->num_games++;
+   return true;
+}
+
+/* Records the hashes of the <rom> element the reader
+ * is positioned on. ROMs without any usable hash
+ * (e.g. 'nodump' entries) are skipped */
+static bool logiqx_dat_add_rom(logiqx_dat_t *dat_file,
+      rxml_reader_t *reader)
+{
+   uint8_t crc[4];
+   struct logiqx_dat_rom rom;
+   const char *size = rxml_reader_attrib(reader, "size");
+
+   memset(&rom, 0, sizeof(rom));
+   rom.game = (uint32_t)dat_file->num_games;
+
+   if (logiqx_dat_parse_hex(rxml_reader_attrib(reader, "crc"),
+            crc, sizeof(crc)))
+   {
+      rom.crc    = ((uint32_t)crc[0] << 24) | ((uint32_t)crc[1] << 16)
+                 | ((uint32_t)crc[2] <<  8) |  (uint32_t)crc[3];
+      rom.flags |= LOGIQX_DAT_ROM_CRC;
+   }
+   if (logiqx_dat_parse_hex(rxml_reader_attrib(reader, "md5"),
+            rom.md5, sizeof(rom.md5)))
+      rom.flags |= LOGIQX_DAT_ROM_MD5;
+   if (logiqx_dat_parse_hex(rxml_reader_attrib(reader, "sha1"),
+            rom.sha1, sizeof(rom.sha1)))
+      rom.flags |= LOGIQX_DAT_ROM_SHA1;
+   if (size && *size >= '0' && *size <= '9')
+   {
+      char *end = NULL;
+      rom.size  = (uint64_t)strtoull(size, &end, 10);
+      if (end && !*end)
+         rom.flags |= LOGIQX_DAT_ROM_SIZE;
+   }
+
+   if (!(rom.flags & (LOGIQX_DAT_ROM_CRC
+               | LOGIQX_DAT_ROM_MD5 | LOGIQX_DAT_ROM_SHA1)))
+      return true;
+
+   if (dat_file->num_roms == dat_file->roms_cap)
+   {
+      size_t cap = dat_file->roms_cap ? dat_file->roms_cap * 2 : 256;
+      struct logiqx_dat_rom *tmp = (struct logiqx_dat_rom*)realloc(
+            dat_file->roms, cap * sizeof(*tmp));
+      if (!tmp)
+         return false;
+      dat_file->roms     = tmp;
+      dat_file->roms_cap = cap;
+   }
+
+   dat_file->roms[dat_file->num_roms++] = rom;
+   return true;
+}
+
+/* Extracts game information from the game element
+ * the reader is positioned on */
+static void logiqx_dat_begin_game(rxml_reader_t *reader,
+      logiqx_dat_game_info_t *game_info)
+{
+   const char *game_name   = rxml_reader_attrib(reader, "name");
+   const char *is_bios     = rxml_reader_attrib(reader, "isbios");
+   const char *is_runnable = rxml_reader_attrib(reader, "runnable");
+
    /* Initialise logiqx_dat_game_info_t object */
    game_info->name[0]         = '\0';
    game_info->description[0]  = '\0';
@@ -290,15 +450,9 @@ static bool logiqx_dat_parse_game_node(
    game_info->is_bios         = false;
    game_info->is_runnable     = true;
 
-   /* Get game name */
-   game_name = rxml_node_attrib(node, "name");
-
    if (game_name && *game_name)
       strlcpy(game_info->name, game_name, sizeof(game_info->name));
 
-   /* Get 'is bios' status */
-   is_bios = rxml_node_attrib(node, "isbios");
-
    if (is_bios && *is_bios)
       game_info->is_bios = string_is_equal(is_bios, "yes");
 
@@ -307,79 +461,441 @@ static bool logiqx_dat_parse_game_node(
     *   XML files, but there is no harm in checking for
     *   it generally. For normal Logiqx XML files,
     *   'is runnable' is just the inverse of 'is bios' */
-   is_runnable = rxml_node_attrib(node, "runnable");
-
    if (is_runnable && *is_runnable)
       game_info->is_runnable = string_is_equal(is_runnable, "yes");
    else
       game_info->is_runnable = !game_info->is_bios;
+}
 
-   /* Loop over all game info nodes */
-   for (info_node = node->children; info_node; info_node = info_node->next)
+/* Streams the DAT file at 'path' into the game and
+ * ROM tables. Only the text of the info element
+ * currently being read is ever held in memory */
+static bool logiqx_dat_load(logiqx_dat_t *dat_file, const char *path)
+{
+   char text[PATH_MAX_LENGTH];
+   logiqx_dat_game_info_t game_info;
+   char *field             = NULL;
+   size_t field_len        = 0;
+   size_t text_len         = 0;
+   unsigned found          = 0;
+   bool in_game            = false;
+   bool leaf               = false;
+   bool has_children       = false;
+   bool ret                = false;
+   rxml_reader_t *reader   = NULL;
+   intfstream_t *stream    = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!stream)
+      return false;
+   if (!(reader = rxml_reader_new(stream)))
+      goto end;
+
+   /* Offset 0 is the shared empty string */
+   if (!(dat_file->strings = (char*)malloc(4096)))
+      goto end;
+   dat_file->strings[0]  = '\0';
+   dat_file->strings_len = 1;
+   dat_file->strings_cap = 4096;
+
+   for (;;)
    {
-      const char *info_node_name = info_node->name;
-      const char *info_node_data = info_node->data;
+      const char *name;
+      unsigned depth;
+      enum rxml_reader_event ev = rxml_reader_next(reader);
+
+      if (ev == RXML_READER_DONE)
+         break;
+      if (ev == RXML_READER_ERROR)
+         goto end;
 
-      if (!info_node_name || !*info_node_name)
-         continue;
+      depth = rxml_reader_depth(reader);
 
-      /* Check description */
-      if (string_is_equal(info_node_name, "description"))
-      {
-         logiqx_dat_sanitise_element_data(
-            info_node_data, game_info->description,
-            sizeof(game_info->description));
-         description_found = true;
-      }
-      /* Check year */
-      else if (string_is_equal(info_node_name, "year"))
+      switch (ev)
       {
-         logiqx_dat_sanitise_element_data(
-            info_node_data, game_info->year,
-            sizeof(game_info->year));
-         year_found = true;
-      }
-      /* Check manufacturer */
-      else if (string_is_equal(info_node_name, "manufacturer"))
-      {
-         logiqx_dat_sanitise_element_data(
-            info_node_data, game_info->manufacturer,
-            sizeof(game_info->manufacturer));
-         manufacturer_found = true;
+         case RXML_READER_START:
+            name = rxml_reader_name(reader, NULL);
+            if (depth == 1)
+            {
+               /* > Logiqx XML uses:           'datafile'
+                * > MAME List XML uses:        'mame'
+                * > MAME 'Software List' uses: 'softwarelist' */
+               if (     !string_is_equal(name, "datafile")
+                     && !string_is_equal(name, "mame")
+                     && !string_is_equal(name, "softwarelist"))
+                  goto end;
+            }
+            else if (depth == 2)
+            {
+               has_children = true;
+               if ((in_game = logiqx_dat_is_game_name(name)))
+               {
+                  logiqx_dat_begin_game(reader, &game_info);
+                  found = 0;
+               }
+            }
+            else if (in_game)
+            {
+               if (depth == 3)
+               {
+                  field    = NULL;
+                  text_len = 0;
+                  leaf     = true;
+                  /* Once all entries have been found,
+                   * later duplicates are ignored */
+                  if (found == 7)
+                     field = NULL;
+                  else if (string_is_equal(name, "description"))
+                  {
+                     field     = game_info.description;
+                     field_len = sizeof(game_info.description);
+                     found    |= 1;
+                  }
+                  else if (string_is_equal(name, "year"))
+                  {
+                     field     = game_info.year;
+                     field_len = sizeof(game_info.year);
+                     found    |= 2;
+                  }
+                  else if (string_is_equal(name, "manufacturer"))
+                  {
+                     field     = game_info.manufacturer;
+                     field_len = sizeof(game_info.manufacturer);
+                     found    |= 4;
+                  }
+               }
+               else if (depth == 4)
+                  leaf = false; /* element data is only kept on leaves */
+
+               if (     string_is_equal(name, "rom")
+                     && !logiqx_dat_add_rom(dat_file, reader))
+                  goto end;
+            }
+            break;
+         case RXML_READER_TEXT:
+            if (in_game && field && depth == 3)
+            {
+               size_t _len;
+               const char *data = rxml_reader_text(reader, &_len);
+               if (_len > sizeof(text) - 1 - text_len)
+                  _len = sizeof(text) - 1 - text_len;
+               memcpy(text + text_len, data, _len);
+               text_len += _len;
+            }
+            break;
+         case RXML_READER_END:
+            if (!in_game)
+               break;
+            if (depth == 2)
+            {
+               if (!logiqx_dat_add_game(dat_file, &game_info))
+                  goto end;
+               in_game = false;
+            }
+            else if (depth == 3 && field)
+            {
+               if (leaf)
+               {
+                  text[text_len] = '\0';
+                  logiqx_dat_sanitise_element_data(text, field, field_len);
+               }
+               field = NULL;
+            }
+            break;
+         default:
+            break;
       }
+   }
 
-      /* If all required entries have been found,
-       * can end loop */
-      if (description_found && year_found && manufacturer_found)
-         break;
+   ret = has_children;
+
+end:
+   rxml_reader_free(reader);
+   intfstream_close(stream);
+   free(stream);
+   return ret;
+}
+
+/* Index cache */
+
+static void logiqx_dat_get_tmp_path(char *s, size_t len,
+      const char *path)
+{
+   size_t _len = strlcpy(s, path, len);
+   if (_len < len)
+      strlcpy(s + _len, ".tmp", len - _len);
+}
+
+/**
+ * logiqx_dat_cache_write:
+ *
+ * Serializes the tables of @dat_file, together with
+ * the path, size and mtime of the DAT they were built
+ * from, to @cache_path. Written to a temporary file
+ * first and renamed over the old cache.
+ **/
+static bool logiqx_dat_cache_write(logiqx_dat_t *dat_file,
+      const char *path, const char *cache_path)
+{
+   struct logiqx_dat_cache_header hdr;
+   char tmp_path[PATH_MAX_LENGTH];
+   uint8_t *data  = NULL;
+   uint8_t *out   = NULL;
+   size_t path_len = strlen(path) + 1;
+   size_t total;
+   bool ret       = false;
+
+   if (dat_file->strings_len + path_len > UINT32_MAX)
+      return false;
+
+   memset(&hdr, 0, sizeof(hdr));
+   hdr.magic       = LOGIQX_DAT_CACHE_MAGIC;
+   hdr.version     = LOGIQX_DAT_CACHE_VERSION;
+   hdr.num_games   = (uint32_t)dat_file->num_games;
+   hdr.num_roms    = (uint32_t)dat_file->num_roms;
+   hdr.strings_len = (uint32_t)(dat_file->strings_len + path_len);
+   hdr.path        = (uint32_t)dat_file->strings_len;
+   hdr.game_size   = sizeof(struct logiqx_dat_game);
+   hdr.rom_size    = sizeof(struct logiqx_dat_rom);
+   hdr.size        = path_get_size(path);
+   hdr.mtime       = path_get_mtime(path);
+
+   /* A DAT whose mtime can't be read could never be
+    * validated again */
+   if (hdr.size <= 0 || hdr.mtime < 0)
+      return false;
+
+   total = sizeof(hdr)
+      + dat_file->num_roms  * sizeof(struct logiqx_dat_rom)
+      + dat_file->num_games * sizeof(struct logiqx_dat_game)
+      + hdr.strings_len;
+
+   if (!(data = (uint8_t*)malloc(total)))
+      return false;
+
+   out = data;
+   memcpy(out, &hdr, sizeof(hdr));
+   out += sizeof(hdr);
+   if (dat_file->num_roms)
+      memcpy(out, dat_file->roms,
+            dat_file->num_roms * sizeof(struct logiqx_dat_rom));
+   out += dat_file->num_roms * sizeof(struct logiqx_dat_rom);
+   if (dat_file->num_games)
+      memcpy(out, dat_file->games,
+            dat_file->num_games * sizeof(struct logiqx_dat_game));
+   out += dat_file->num_games * sizeof(struct logiqx_dat_game);
+   memcpy(out, dat_file->strings, dat_file->strings_len);
+   out += dat_file->strings_len;
+   memcpy(out, path, path_len);
+
+   logiqx_dat_get_tmp_path(tmp_path, sizeof(tmp_path), cache_path);
+   if (filestream_write_file(tmp_path, data, (int64_t)total))
+   {
+      if (filestream_rename(tmp_path, cache_path) == 0)
+         ret = true;
+      /* Some platforms refuse to rename over an existing file */
+      else if (     filestream_delete(cache_path) == 0
+                 && filestream_rename(tmp_path, cache_path) == 0)
+         ret = true;
+      else
+         filestream_delete(tmp_path);
    }
 
-   return true;
+   free(data);
+   return ret;
 }
 
-/* Sets/resets internal node pointer to the first
- * entry in the DAT file */
-void logiqx_dat_set_first(logiqx_dat_t *dat_file)
+/**
+ * logiqx_dat_cache_load:
+ *
+ * Loads the index cache at @cache_path if it was
+ * built from @path and the DAT hasn't changed since.
+ * The tables are used in place out of the cache
+ * buffer.
+ *
+ * @return NULL if the cache is missing, corrupt
+ * or stale.
+ **/
+static logiqx_dat_t *logiqx_dat_cache_load(const char *path,
+      const char *cache_path)
 {
-   rxml_node_t *root_node = NULL;
+   struct logiqx_dat_cache_header hdr;
+   size_t i;
+   uint64_t total;
+   int64_t length         = 0;
+   uint8_t *data          = NULL;
+   logiqx_dat_t *dat_file = NULL;
 
-   if (!dat_file)
-      return;
+   if (!path_is_valid(cache_path))
+      return NULL;
+   if (!filestream_read_file(cache_path, (void**)&data, &length))
+      return NULL;
 
-   if (!dat_file->data)
-      return;
+   if ((uint64_t)length < sizeof(hdr))
+      goto error;
+   memcpy(&hdr, data, sizeof(hdr));
+   if (     hdr.magic       != LOGIQX_DAT_CACHE_MAGIC
+         || hdr.version     != LOGIQX_DAT_CACHE_VERSION
+         || hdr.game_size   != sizeof(struct logiqx_dat_game)
+         || hdr.rom_size    != sizeof(struct logiqx_dat_rom)
+         || hdr.strings_len <= hdr.path)
+      goto error;
 
-   /* Get root node */
-   root_node = rxml_root_node(dat_file->data);
+   total = (uint64_t)sizeof(hdr)
+      + (uint64_t)hdr.num_roms  * sizeof(struct logiqx_dat_rom)
+      + (uint64_t)hdr.num_games * sizeof(struct logiqx_dat_game)
+      + hdr.strings_len;
+   if (total != (uint64_t)length)
+      goto error;
+
+   if (!(dat_file = (logiqx_dat_t*)calloc(1, sizeof(*dat_file))))
+      goto error;
+   dat_file->cache       = data;
+   dat_file->roms        = (struct logiqx_dat_rom*)(data + sizeof(hdr));
+   dat_file->games       = (struct logiqx_dat_game*)(dat_file->roms
+         + hdr.num_roms);
+   dat_file->strings     = (char*)(dat_file->games + hdr.num_games);
+   dat_file->strings_len = hdr.path;
+   dat_file->num_roms    = hdr.num_roms;
+   dat_file->num_games   = hdr.num_games;
+   data                  = NULL;
+
+   /* The terminating NUL at the very end guarantees
+    * every string in the blob is terminated */
+   if (     dat_file->strings[hdr.strings_len - 1] != '\0'
+         || dat_file->strings[0] != '\0')
+      goto error;
+
+   /* Staleness check */
+   if (     !string_is_equal(dat_file->strings + hdr.path, path)
+         || path_get_size(path)  != hdr.size
+         || path_get_mtime(path) != hdr.mtime)
+      goto error;
 
-   if (!root_node)
+   for (i = 0; i < dat_file->num_games; i++)
    {
-      dat_file->current_node = NULL;
+      const struct logiqx_dat_game *game = &dat_file->games[i];
+      if (     game->name         >= hdr.path
+            || game->description  >= hdr.path
+            || game->year         >= hdr.path
+            || game->manufacturer >= hdr.path)
+         goto error;
+   }
+   for (i = 0; i < dat_file->num_roms; i++)
+      if (dat_file->roms[i].game >= hdr.num_games)
+         goto error;
+
+   return dat_file;
+
+error:
+   free(data);
+   logiqx_dat_free(dat_file);
+   return NULL;
+}
+
+/* File initialisation/de-initialisation */
+
+/* Loads specified Logiqx XML DAT file from disk.
+ * Returned logiqx_dat_t object must be free'd using
+ * logiqx_dat_free().
+ * Returns NULL if file is invalid or a read error
+ * occurs. */
+logiqx_dat_t *logiqx_dat_init(const char *path)
+{
+   logiqx_dat_t *dat_file = NULL;
+
+   /* Check file path */
+   if (!logiqx_dat_path_is_valid(path, NULL))
+      return NULL;
+
+   /* Create logiqx_dat_t object */
+   if (!(dat_file = (logiqx_dat_t*)calloc(1, sizeof(*dat_file))))
+      return NULL;
+
+   /* Read file from disk */
+   if (!logiqx_dat_load(dat_file, path))
+   {
+      logiqx_dat_free(dat_file);
+      return NULL;
+   }
+
+   return dat_file;
+}
+
+/* Same as logiqx_dat_init(), but first tries the index
+ * cache at 'cache_path'. The cache is used only if it
+ * was built from 'path' and the DAT file's size and
+ * modification time are unchanged; otherwise the DAT
+ * file is parsed and the cache is (re)written.
+ * Failing to write the cache is not an error. */
+logiqx_dat_t *logiqx_dat_init_cached(const char *path,
+      const char *cache_path)
+{
+   logiqx_dat_t *dat_file = NULL;
+
+   if (!cache_path || !*cache_path)
+      return logiqx_dat_init(path);
+
+   if (!logiqx_dat_path_is_valid(path, NULL))
+      return NULL;
+
+   if ((dat_file = logiqx_dat_cache_load(path, cache_path)))
+      return dat_file;
+
+   if ((dat_file = logiqx_dat_init(path)))
+      logiqx_dat_cache_write(dat_file, path, cache_path);
+
+   return dat_file;
+}
+
+/* Frees specified DAT file */
+void logiqx_dat_free(logiqx_dat_t *dat_file)
+{
+   if (!dat_file)
       return;
+
+   if (dat_file->cache)
+      free(dat_file->cache);
+   else
+   {
+      free(dat_file->roms);
+      free(dat_file->games);
+      free(dat_file->strings);
    }
 
-   /* Get pointer to initial child node */
-   dat_file->current_node = root_node->children;
+   free(dat_file->name_index);
+   free(dat_file->crc_index);
+   free(dat_file->md5_index);
+   free(dat_file->sha1_index);
+   free(dat_file);
+}
+
+/* Game information access */
+
+static void logiqx_dat_get_game_info(const logiqx_dat_t *dat_file,
+      size_t idx, logiqx_dat_game_info_t *game_info)
+{
+   const struct logiqx_dat_game *game = &dat_file->games[idx];
+   const char *strings                = dat_file->strings;
+
+   strlcpy(game_info->name, strings + game->name,
+         sizeof(game_info->name));
+   strlcpy(game_info->description, strings + game->description,
+         sizeof(game_info->description));
+   strlcpy(game_info->year, strings + game->year,
+         sizeof(game_info->year));
+   strlcpy(game_info->manufacturer, strings + game->manufacturer,
+         sizeof(game_info->manufacturer));
+   game_info->is_bios     = (game->flags & LOGIQX_DAT_GAME_BIOS) != 0;
+   game_info->is_runnable = (game->flags & LOGIQX_DAT_GAME_RUNNABLE) != 0;
+}
+
+/* Sets/resets internal node pointer to the first
+ * entry in the DAT file */
+void logiqx_dat_set_first(logiqx_dat_t *dat_file)
+{
+   if (dat_file)
+      dat_file->current = 0;
 }
 
 /* Fetches game information for the current entry
@@ -393,24 +909,181 @@ bool logiqx_dat_get_next(
    if (!dat_file || !game_info)
       return false;
 
-   if (!dat_file->data)
+   if (dat_file->current >= dat_file->num_games)
       return false;
 
-   while (dat_file->current_node)
+   logiqx_dat_get_game_info(dat_file, dat_file->current++, game_info);
+   return true;
+}
+
+/* Index lookup */
+
+static int logiqx_dat_name_key_cmp(const void *a, const void *b)
+{
+   return strcmp(((const struct logiqx_dat_name_key*)a)->name,
+                 ((const struct logiqx_dat_name_key*)b)->name);
+}
+
+static int logiqx_dat_crc_key_cmp(const void *a, const void *b)
+{
+   const struct logiqx_dat_crc_key *x = (const struct logiqx_dat_crc_key*)a;
+   const struct logiqx_dat_crc_key *y = (const struct logiqx_dat_crc_key*)b;
+   if (x->crc != y->crc)
+      return x->crc < y->crc ? -1 : 1;
+   if (x->size != y->size)
+      return x->size < y->size ? -1 : 1;
+   return 0;
+}
+
+static int logiqx_dat_md5_key_cmp(const void *a, const void *b)
+{
+   return memcmp(((const struct logiqx_dat_md5_key*)a)->md5,
+                 ((const struct logiqx_dat_md5_key*)b)->md5, 16);
+}
+
+static int logiqx_dat_sha1_key_cmp(const void *a, const void *b)
+{
+   return memcmp(((const struct logiqx_dat_sha1_key*)a)->sha1,
+                 ((const struct logiqx_dat_sha1_key*)b)->sha1, 20);
+}
+
+/* qsort() is not stable, so sort comparators fall back
+ * to file order */
+#define LOGIQX_DAT_SORT_CMP(type) \
+static int type##_sort(const void *a, const void *b) \
+{ \
+   int ret = type##_cmp(a, b); \
+   if (ret) \
+      return ret; \
+   return (int)(((const struct type*)a)->game \
+              > ((const struct type*)b)->game) \
+        - (int)(((const struct type*)a)->game \
+              < ((const struct type*)b)->game); \
+}
+
+LOGIQX_DAT_SORT_CMP(logiqx_dat_name_key)
+LOGIQX_DAT_SORT_CMP(logiqx_dat_crc_key)
+LOGIQX_DAT_SORT_CMP(logiqx_dat_md5_key)
+LOGIQX_DAT_SORT_CMP(logiqx_dat_sha1_key)
+
+/* Returns the first entry of a sorted index equal
+ * to 'key', or NULL */
+static const void *logiqx_dat_index_find(const void *base,
+      size_t count, size_t size, const void *key,
+      int (*cmp)(const void*, const void*))
+{
+   const uint8_t *p = (const uint8_t*)base;
+   size_t lo        = 0;
+   size_t hi        = count;
+
+   while (lo < hi)
    {
-      rxml_node_t *current_node = dat_file->current_node;
+      size_t mid = lo + ((hi - lo) >> 1);
+      if (cmp(p + mid * size, key) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-      /* Whatever happens, internal node pointer must
-       * be 'incremented' */
-      dat_file->current_node = dat_file->current_node->next;
+   if (lo < count && cmp(p + lo * size, key) == 0)
+      return p + lo * size;
+   return NULL;
+}
+
+static bool logiqx_dat_build_name_index(logiqx_dat_t *dat_file)
+{
+   size_t i;
+
+   if (dat_file->flags & LOGIQX_DAT_FLAG_NAME_INDEX)
+      return true;
 
-      /* If this is a game node, extract info
-       * and return */
-      if (logiqx_dat_is_game_node(current_node))
-         return logiqx_dat_parse_game_node(current_node, game_info);
+   if (dat_file->num_games)
+   {
+      if (!(dat_file->name_index = (struct logiqx_dat_name_key*)malloc(
+            dat_file->num_games * sizeof(*dat_file->name_index))))
+         return false;
+
+      for (i = 0; i < dat_file->num_games; i++)
+      {
+         uint32_t name = dat_file->games[i].name;
+         if (!name)
+            continue;
+         dat_file->name_index[dat_file->name_count].name =
+               dat_file->strings + name;
+         dat_file->name_index[dat_file->name_count].game = (uint32_t)i;
+         dat_file->name_count++;
+      }
+
+      qsort(dat_file->name_index, dat_file->name_count,
+            sizeof(*dat_file->name_index), logiqx_dat_name_key_sort);
    }
 
-   return false;
+   dat_file->flags |= LOGIQX_DAT_FLAG_NAME_INDEX;
+   return true;
+}
+
+static bool logiqx_dat_build_rom_index(logiqx_dat_t *dat_file)
+{
+   size_t i;
+
+   if (dat_file->flags & LOGIQX_DAT_FLAG_ROM_INDEX)
+      return true;
+
+   if (dat_file->num_roms)
+   {
+      size_t n = dat_file->num_roms;
+      if (     !(dat_file->crc_index  = (struct logiqx_dat_crc_key*)
+                  malloc(n * sizeof(*dat_file->crc_index)))
+            || !(dat_file->md5_index  = (struct logiqx_dat_md5_key*)
+                  malloc(n * sizeof(*dat_file->md5_index)))
+            || !(dat_file->sha1_index = (struct logiqx_dat_sha1_key*)
+                  malloc(n * sizeof(*dat_file->sha1_index))))
+      {
+         free(dat_file->crc_index);
+         free(dat_file->md5_index);
+         dat_file->crc_index = NULL;
+         dat_file->md5_index = NULL;
+         return false;
+      }
+
+      for (i = 0; i < n; i++)
+      {
+         const struct logiqx_dat_rom *rom = &dat_file->roms[i];
+         if ((rom->flags & (LOGIQX_DAT_ROM_CRC | LOGIQX_DAT_ROM_SIZE))
+               == (LOGIQX_DAT_ROM_CRC | LOGIQX_DAT_ROM_SIZE))
+         {
+            struct logiqx_dat_crc_key *key =
+                  &dat_file->crc_index[dat_file->crc_count++];
+            key->size = rom->size;
+            key->crc  = rom->crc;
+            key->game = rom->game;
+         }
+         if (rom->flags & LOGIQX_DAT_ROM_MD5)
+         {
+            struct logiqx_dat_md5_key *key =
+                  &dat_file->md5_index[dat_file->md5_count++];
+            memcpy(key->md5, rom->md5, sizeof(key->md5));
+            key->game = rom->game;
+         }
+         if (rom->flags & LOGIQX_DAT_ROM_SHA1)
+         {
+            struct logiqx_dat_sha1_key *key =
+                  &dat_file->sha1_index[dat_file->sha1_count++];
+            memcpy(key->sha1, rom->sha1, sizeof(key->sha1));
+            key->game = rom->game;
+         }
+      }
+
+      qsort(dat_file->crc_index, dat_file->crc_count,
+            sizeof(*dat_file->crc_index), logiqx_dat_crc_key_sort);
+      qsort(dat_file->md5_index, dat_file->md5_count,
+            sizeof(*dat_file->md5_index), logiqx_dat_md5_key_sort);
+      qsort(dat_file->sha1_index, dat_file->sha1_count,
+            sizeof(*dat_file->sha1_index), logiqx_dat_sha1_key_sort);
+   }
+
+   dat_file->flags |= LOGIQX_DAT_FLAG_ROM_INDEX;
+   return true;
 }
 
 /* Fetches information for the specified game.
@@ -420,28 +1093,102 @@ bool logiqx_dat_search(
       logiqx_dat_t *dat_file, const char *game_name,
       logiqx_dat_game_info_t *game_info)
 {
-   rxml_node_t *root_node = NULL;
-   rxml_node_t *game_node = NULL;
+   struct logiqx_dat_name_key key;
+   const struct logiqx_dat_name_key *match = NULL;
 
    if (!dat_file || !game_info || (!game_name || !*game_name))
       return false;
 
-   if (!dat_file->data)
+   if (!logiqx_dat_build_name_index(dat_file))
+      return false;
+
+   key.name = game_name;
+   key.game = 0;
+   if (!(match = (const struct logiqx_dat_name_key*)logiqx_dat_index_find(
+         dat_file->name_index, dat_file->name_count, sizeof(key),
+         &key, logiqx_dat_name_key_cmp)))
+      return false;
+
+   logiqx_dat_get_game_info(dat_file, match->game, game_info);
+   return true;
+}
+
+/* Fetches information for the game containing a ROM
+ * with the specified CRC32 and size.
+ * Returns false if no such ROM exists, or arguments
+ * are invalid. */
+bool logiqx_dat_search_crc(
+      logiqx_dat_t *dat_file, uint32_t crc, uint64_t size,
+      logiqx_dat_game_info_t *game_info)
+{
+   struct logiqx_dat_crc_key key;
+   const struct logiqx_dat_crc_key *match = NULL;
+
+   if (!dat_file || !game_info)
+      return false;
+
+   if (!logiqx_dat_build_rom_index(dat_file))
       return false;
 
-   /* Get root node */
-   root_node = rxml_root_node(dat_file->data);
+   key.size = size;
+   key.crc  = crc;
+   key.game = 0;
+   if (!(match = (const struct logiqx_dat_crc_key*)logiqx_dat_index_find(
+         dat_file->crc_index, dat_file->crc_count, sizeof(key),
+         &key, logiqx_dat_crc_key_cmp)))
+      return false;
 
-   if (!root_node)
+   logiqx_dat_get_game_info(dat_file, match->game, game_info);
+   return true;
+}
+
+/* Fetches information for the game containing a ROM
+ * with the specified MD5 (32 hex digits) or SHA-1
+ * (40 hex digits) hash.
+ * Returns false if no such ROM exists, or arguments
+ * are invalid. */
+bool logiqx_dat_search_hash(
+      logiqx_dat_t *dat_file, const char *hash,
+      logiqx_dat_game_info_t *game_info)
+{
+   uint32_t game;
+   size_t _len;
+
+   if (!dat_file || !game_info || (!hash || !*hash))
       return false;
 
-   /* Loop over all child nodes of the DAT file */
-   for (game_node = root_node->children; game_node; game_node = game_node->next)
+   if (!logiqx_dat_build_rom_index(dat_file))
+      return false;
+
+   _len = strlen(hash);
+
+   if (_len == 32)
    {
-      /* If this is the requested game, fetch info and return */
-      if (logiqx_dat_game_node_matches_name(game_node, game_name))
-         return logiqx_dat_parse_game_node(game_node, game_info);
+      struct logiqx_dat_md5_key key;
+      const struct logiqx_dat_md5_key *match = NULL;
+      if (!logiqx_dat_parse_hex(hash, key.md5, sizeof(key.md5)))
+         return false;
+      if (!(match = (const struct logiqx_dat_md5_key*)logiqx_dat_index_find(
+            dat_file->md5_index, dat_file->md5_count, sizeof(key),
+            &key, logiqx_dat_md5_key_cmp)))
+         return false;
+      game = match->game;
    }
+   else if (_len == 40)
+   {
+      struct logiqx_dat_sha1_key key;
+      const struct logiqx_dat_sha1_key *match = NULL;
+      if (!logiqx_dat_parse_hex(hash, key.sha1, sizeof(key.sha1)))
+         return false;
+      if (!(match = (const struct logiqx_dat_sha1_key*)logiqx_dat_index_find(
+            dat_file->sha1_index, dat_file->sha1_count, sizeof(key),
+            &key, logiqx_dat_sha1_key_cmp)))
+         return false;
+      game = match->game;
+   }
+   else
+      return false;
 
-   return false;
+   logiqx_dat_get_game_info(dat_file, game, game_info);
+   return true;
 }
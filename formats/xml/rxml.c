@@ -26,6 +26,7 @@
 
 #include <retro_inline.h>
 #include <streams/file_stream.h>
+#include <streams/interface_stream.h>
 
 #include <formats/rxml.h>
 
@@ -61,9 +62,23 @@
  *     U+DFFF..U+E7FD (while accepting U+D800..U+DFFE).
  */
 
+/* Nodes, attributes and strings of a document are carved out of a
+ * list of chunks, so loading needs a handful of mallocs instead of
+ * several per element and freeing never walks the tree.  Chunks
+ * double in size up to RXML_ARENA_MAX; larger requests get a chunk
+ * of their own. */
+struct rxml_arena_chunk
+{
+   struct rxml_arena_chunk *next;
+};
+
 struct rxml_document
 {
    struct rxml_node *root_node;
+   struct rxml_arena_chunk *chunks;
+   char *arena_p;               /* free space in the newest chunk */
+   char *arena_end;
+   size_t arena_next;           /* size of the next chunk */
 };
 
 /* Keep rarely taken scanners (declarations, comments, PIs, references,
@@ -86,6 +101,9 @@ struct rxml_document
 
 #define RXML_NAME_BUDGET 4094 /* open-name byte budget (was yxml's 4096-byte stack) */
 
+#define RXML_ARENA_MIN 8192
+#define RXML_ARENA_MAX (1024 * 1024)
+
 /* Byte classes.  bit0: name char, bit1: name start char, bit2: whitespace,
  * bit3: stops a content run, bit4: stops an attribute-value run. */
 #define RXML_CN  1
@@ -183,10 +201,66 @@ static int rxml_acc_span(struct rxml_parser *ps, const unsigned char *s, size_t
    return 1;
 }
 
-/* strdup() of a counted span */
-static char *rxml_span_dup(const unsigned char *s, size_t len)
+/* Arena ------------------------------------------------------------- */
+
+/* The chunk header is padded so the data after it is pointer aligned */
+#define RXML_ARENA_ALIGN(n) \
+   (((n) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+#define RXML_ARENA_HEADER RXML_ARENA_ALIGN(sizeof(struct rxml_arena_chunk))
+
+RXML_COLD static void *rxml_arena_grow(rxml_document_t *doc, size_t size)
+{
+   struct rxml_arena_chunk *chunk;
+   size_t cap = doc->arena_next;
+   if (size > cap / 4)
+   {
+      /* Oversized: own chunk, linked behind the current one so the
+       * remaining space of that one stays in use. */
+      if (!(chunk = (struct rxml_arena_chunk*)malloc(RXML_ARENA_HEADER + size)))
+         return NULL;
+      if (doc->chunks)
+      {
+         chunk->next       = doc->chunks->next;
+         doc->chunks->next = chunk;
+      }
+      else
+      {
+         chunk->next       = NULL;
+         doc->chunks       = chunk;
+         doc->arena_p      = doc->arena_end = (char*)chunk + RXML_ARENA_HEADER + size;
+      }
+      return (char*)chunk + RXML_ARENA_HEADER;
+   }
+   if (!(chunk = (struct rxml_arena_chunk*)malloc(RXML_ARENA_HEADER + cap)))
+      return NULL;
+   chunk->next    = doc->chunks;
+   doc->chunks    = chunk;
+   doc->arena_p   = (char*)chunk + RXML_ARENA_HEADER + size;
+   doc->arena_end = (char*)chunk + RXML_ARENA_HEADER + cap;
+   if (cap < RXML_ARENA_MAX)
+      doc->arena_next = cap * 2;
+   return (char*)chunk + RXML_ARENA_HEADER;
+}
+
+/* Pointer aligned allocation, for nodes */
+static INLINE void *rxml_arena_alloc(rxml_document_t *doc, size_t size)
 {
-   char *r = (char*)malloc(len + 1);
+   char *p = (char*)RXML_ARENA_ALIGN((uintptr_t)doc->arena_p);
+   size    = RXML_ARENA_ALIGN(size);
+   if (p > doc->arena_end || (size_t)(doc->arena_end - p) < size)
+      return rxml_arena_grow(doc, size);
+   doc->arena_p = p + size;
+   return p;
+}
+
+/* strdup() of a counted span, unaligned */
+static char *rxml_span_dup(rxml_document_t *doc, const unsigned char *s, size_t len)
+{
+   char *r = doc->arena_p;
+   if ((size_t)(doc->arena_end - r) <= len)
+      r = (char*)rxml_arena_grow(doc, len + 1);
+   else
+      doc->arena_p = r + len + 1;
    if (r)
    {
       memcpy(r, s, len);
@@ -217,10 +291,12 @@ static size_t rxml_scan_name(struct rxml_parser *ps, const unsigned char **pp, i
 /* Character / entity references ------------------------------------- */
 
 /* Decode the reference whose body (between '&' and ';') is the
- * ref_len-byte string at ref, and append its UTF-8 form to the
- * accumulator.  Returns 0 on invalid reference or OOM.  The validity
+ * ref_len-byte string at ref, and store its UTF-8 form at out, which
+ * may overlap the reference itself.  Returns the number of bytes
+ * stored (1 to 4), or 0 on an invalid reference.  The validity
  * predicate replicates the old parser exactly. */
-RXML_COLD static int rxml_ref_emit(struct rxml_parser *ps, const unsigned char *ref, size_t ref_len)
+RXML_COLD static size_t rxml_ref_decode(const unsigned char *ref, size_t ref_len,
+      unsigned char *out)
 {
    unsigned ch = 0;
    if (ref_len == 0 || ref_len > 7)
@@ -293,27 +369,40 @@ RXML_COLD static int rxml_ref_emit(struct rxml_parser *ps, const unsigned char *
       return 0;
 
    if (ch <= 0x7F)
-      return rxml_acc_ch(ps, (unsigned char)ch);
-   if (!rxml_acc_reserve(ps, 4))
-      return 0;
-   if (ch <= 0x7FF)
    {
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0xC0 |  (ch >> 6));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 |  (ch & 0x3F));
+      out[0] = (unsigned char)ch;
+      return 1;
    }
-   else if (ch <= 0xFFFF)
+   if (ch <= 0x7FF)
    {
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0xE0 |  (ch >> 12));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 | ((ch >> 6) & 0x3F));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 |  (ch & 0x3F));
+      out[0] = (unsigned char)(0xC0 |  (ch >> 6));
+      out[1] = (unsigned char)(0x80 |  (ch & 0x3F));
+      return 2;
    }
-   else
+   if (ch <= 0xFFFF)
    {
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0xF0 |  (ch >> 18));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 | ((ch >> 12) & 0x3F));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 | ((ch >> 6) & 0x3F));
-      ps->acc[ps->acc_len++] = (char)(unsigned char)(0x80 |  (ch & 0x3F));
+      out[0] = (unsigned char)(0xE0 |  (ch >> 12));
+      out[1] = (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+      out[2] = (unsigned char)(0x80 |  (ch & 0x3F));
+      return 3;
    }
+   out[0] = (unsigned char)(0xF0 |  (ch >> 18));
+   out[1] = (unsigned char)(0x80 | ((ch >> 12) & 0x3F));
+   out[2] = (unsigned char)(0x80 | ((ch >> 6) & 0x3F));
+   out[3] = (unsigned char)(0x80 |  (ch & 0x3F));
+   return 4;
+}
+
+/* Append the decoded reference to the accumulator.  Returns 0 on
+ * invalid reference or OOM. */
+RXML_COLD static int rxml_ref_emit(struct rxml_parser *ps, const unsigned char *ref, size_t ref_len)
+{
+   size_t n;
+   if (!rxml_acc_reserve(ps, 4))
+      return 0;
+   if (!(n = rxml_ref_decode(ref, ref_len, (unsigned char*)ps->acc + ps->acc_len)))
+      return 0;
+   ps->acc_len += n;
    return 1;
 }
 
@@ -350,8 +439,8 @@ RXML_COLD static int rxml_scan_ref(struct rxml_parser *ps)
 /* Tree building ----------------------------------------------------- */
 
 /* Element start: link a node exactly as the old event loop did.  The
- * node and its name live in one allocation (the name directly after
- * the struct); rxml_free_node() frees the node only. */
+ * node and its name share one arena allocation (the name directly
+ * after the struct). */
 static int rxml_on_elemstart(struct rxml_parser *ps,
       const unsigned char *name, size_t name_len)
 {
@@ -366,7 +455,7 @@ static int rxml_on_elemstart(struct rxml_parser *ps,
       ps->frames     = nf;
       ps->frames_cap = ncap;
    }
-   n = (rxml_node_t*)malloc(sizeof(*n) + name_len + 1);
+   n = (rxml_node_t*)rxml_arena_alloc(ps->doc, sizeof(*n) + name_len + 1);
    if (!n)
       return 0;
    n->name     = (char*)(n + 1);
@@ -406,9 +495,8 @@ static int rxml_on_elemend(struct rxml_parser *ps)
    {
       if (ps->level == ps->stack_i)
       {
-         if (ps->node->data)
-            free(ps->node->data);
-         ps->node->data = rxml_span_dup((const unsigned char*)ps->acc, ps->acc_len);
+         ps->node->data = rxml_span_dup(ps->doc,
+               (const unsigned char*)ps->acc, ps->acc_len);
          if (!ps->node->data)
             return 0;
       }
@@ -423,7 +511,7 @@ static int rxml_on_attrstart(struct rxml_parser *ps,
       const unsigned char *name, size_t name_len)
 {
    struct rxml_attrib_node *a = (struct rxml_attrib_node*)
-      malloc(sizeof(*a) + name_len + 1);
+      rxml_arena_alloc(ps->doc, sizeof(*a) + name_len + 1);
    if (!a)
       return 0;
    a->attrib   = (char*)(a + 1);
@@ -446,7 +534,8 @@ static int rxml_on_attrend(struct rxml_parser *ps)
    {
       if (ps->val_direct_len)
       {
-         ps->attr->value = rxml_span_dup(ps->val_direct, ps->val_direct_len);
+         ps->attr->value = rxml_span_dup(ps->doc,
+               ps->val_direct, ps->val_direct_len);
          if (!ps->attr->value)
             return 0;
       }
@@ -455,7 +544,8 @@ static int rxml_on_attrend(struct rxml_parser *ps)
    }
    if (ps->acc_len)
    {
-      ps->attr->value = rxml_span_dup((const unsigned char*)ps->acc, ps->acc_len);
+      ps->attr->value = rxml_span_dup(ps->doc,
+            (const unsigned char*)ps->acc, ps->acc_len);
       if (!ps->attr->value)
          return 0;
       ps->acc_len = 0;
@@ -1237,40 +1327,6 @@ struct rxml_node *rxml_root_node(rxml_document_t *doc)
    return NULL;
 }
 
-RXML_COLD static void rxml_free_node(struct rxml_node *node)
-{
-   struct rxml_node *head = NULL;
-   struct rxml_attrib_node *attrib_node_head = NULL;
-
-   if (!node)
-      return;
-
-   for (head = node->children; head; )
-   {
-      struct rxml_node *next_node = (struct rxml_node*)head->next;
-      rxml_free_node(head);
-      head = next_node;
-   }
-
-   for (attrib_node_head = node->attrib; attrib_node_head; )
-   {
-      struct rxml_attrib_node *next_attrib =
-            (struct rxml_attrib_node*)attrib_node_head->next;
-
-      /* ->attrib lives inside the same allocation */
-      if (attrib_node_head->value)
-         free(attrib_node_head->value);
-      free(attrib_node_head);
-
-      attrib_node_head = next_attrib;
-   }
-
-   /* ->name lives inside the same allocation */
-   if (node->data)
-      free(node->data);
-   free(node);
-}
-
 rxml_document_t *rxml_load_document_string(const char *str)
 {
    struct rxml_parser ps;
@@ -1282,13 +1338,13 @@ rxml_document_t *rxml_load_document_string(const char *str)
    ps.acc        = (char*)malloc(ps.acc_cap);
    ps.frames_cap = 32;
    ps.frames     = (struct rxml_frame*)malloc(ps.frames_cap * sizeof(*ps.frames));
-   ps.doc        = (rxml_document_t*)malloc(sizeof(*ps.doc));
+   ps.doc        = (rxml_document_t*)calloc(1, sizeof(*ps.doc));
 
    if (!ps.acc || !ps.frames || !ps.doc)
       r = 0;
    else
    {
-      ps.doc->root_node = NULL;
+      ps.doc->arena_next = RXML_ARENA_MIN;
       r = rxml_parse_document(&ps);
    }
 
@@ -1351,10 +1407,16 @@ error:
 
 void rxml_free_document(rxml_document_t *doc)
 {
+   struct rxml_arena_chunk *chunk;
    if (!doc)
       return;
 
-   rxml_free_node(doc->root_node);
+   for (chunk = doc->chunks; chunk; )
+   {
+      struct rxml_arena_chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+   }
 
    free(doc);
 }
@@ -1371,6 +1433,599 @@ const char *rxml_node_attrib(struct rxml_node *node, const char *attrib)
    return NULL;
 }
 
+/* Streaming reader -------------------------------------------------- */
+
+/* The reader pulls the document through a buffer and hands out every
+ * element start, element end and text run as NUL-terminated slices of
+ * that buffer, so memory use depends on the largest single construct
+ * rather than on the document size.  A construct (a whole tag, a text
+ * run, a comment...) is only decoded once all of it is in the buffer;
+ * when it runs off the end, the buffer is compacted (or doubled, up
+ * to RXML_READER_MAX) and the construct is scanned again from its
+ * start.  References and line ends are decoded in place, which never
+ * makes a run longer.  Prolog, comments, PIs and DOCTYPE go through
+ * the same scanners as the tree builder. */
+
+#define RXML_READER_BLOCK 65536
+#define RXML_READER_MAX   (16 * 1024 * 1024)
+#define RXML_READER_AGAIN (-2) /* construct consumed without an event */
+
+enum rxml_reader_state
+{
+   RXML_READER_STATE_PROLOG = 0,
+   RXML_READER_STATE_CONTENT,
+   RXML_READER_STATE_EPILOG,
+   RXML_READER_STATE_DONE,
+   RXML_READER_STATE_ERROR
+};
+
+struct rxml_reader_attrib
+{
+   const char *name;
+   const char *value;
+   size_t name_len;
+   size_t value_len;
+};
+
+struct rxml_reader
+{
+   struct rxml_parser ps;       /* cursor and name budget for the scanners */
+   intfstream_t *stream;
+   unsigned char *buf;          /* cap + 1 bytes, data is NUL-terminated */
+   unsigned char *end;
+   size_t cap;
+   unsigned char *restore;      /* '<' overwritten to terminate a text run */
+   struct rxml_reader_attrib *attribs;
+   unsigned attrib_count;
+   unsigned attrib_cap;
+   const char *name;
+   const char *text;
+   size_t name_len;
+   size_t text_len;
+   unsigned depth;
+   enum rxml_reader_state state;
+   int eof;
+   int pop;                     /* pop the open element on the next call */
+   int self_closed;             /* report the end of an empty element next */
+   char names[RXML_NAME_BUDGET + 2]; /* open element names, NUL-separated */
+};
+
+/* Keep [tok, end) and read more data after it, doubling the buffer if
+ * tok already sits at its start with no room left.  The cursor is set
+ * to the new location of tok. */
+RXML_COLD static int rxml_reader_fill(struct rxml_reader *r,
+      const unsigned char *tok)
+{
+   size_t keep = (size_t)(r->end - tok);
+   int64_t n;
+   if (keep == r->cap)
+   {
+      unsigned char *nb;
+      if (r->cap >= RXML_READER_MAX)
+         return 0;
+      if (!(nb = (unsigned char*)realloc(r->buf, r->cap * 2 + 1)))
+         return 0;
+      r->buf  = nb;
+      r->cap *= 2;
+   }
+   else if (keep && tok != r->buf)
+      memmove(r->buf, tok, keep);
+   n = intfstream_read(r->stream, r->buf + keep, (uint64_t)(r->cap - keep));
+   if (n < 0)
+      return 0;
+   if (n == 0)
+      r->eof = 1;
+   r->end  = r->buf + keep + (size_t)n;
+   *r->end = '\0';
+   r->ps.p = r->buf;
+   return 1;
+}
+
+/* Name of the innermost open element */
+static const char *rxml_reader_top(struct rxml_reader *r, size_t *len)
+{
+   size_t e = r->ps.names_len - 1, b = e;
+   while (b && r->names[b - 1])
+      b--;
+   *len = e - b;
+   return r->names + b;
+}
+
+/* Decode the reference at q ('&') in place, storing it at *w.  Returns
+ * the byte after ';' or NULL if the reference is invalid. */
+static unsigned char *rxml_reader_ref(unsigned char *q, unsigned char **w)
+{
+   unsigned char *s = q + 1;
+   unsigned char *e = s;
+   size_t n;
+   while (*e != ';')
+   {
+      unsigned char c = *e;
+      if (!((unsigned)((c | 32) - 'a') < 26 ||
+            (unsigned)(c - '0') < 10 || c == '#'))
+         return NULL;
+      if ((size_t)(e - s) >= 7)
+         return NULL;
+      e++;
+   }
+   if (!(n = rxml_ref_decode(s, (size_t)(e - s), *w)))
+      return NULL;
+   *w += n;
+   return e + 1;
+}
+
+/* Character data up to the next '<' */
+static int rxml_reader_chardata(struct rxml_reader *r, unsigned char *p)
+{
+   unsigned char *lt = (unsigned char*)memchr(p, '<', (size_t)(r->end - p));
+   unsigned char *q  = p;
+   unsigned char *w  = p;
+   if (!lt)
+   {
+      r->ps.p = r->end;
+      return -1;
+   }
+   for (;;)
+   {
+      const unsigned char *run = q;
+      unsigned char c;
+      while (!(rxml_cls[*q] & RXML_CCS))
+         q++;
+      if (w != run)
+         memmove(w, run, (size_t)(q - run));
+      w += q - run;
+      c  = *q;
+      if (c == '<')
+         break;
+      if (c == '&')
+      {
+         if (!(q = rxml_reader_ref(q, &w)))
+            return 0;
+      }
+      else if (c == 0x0d)
+      {
+         *w++ = 0x0a;
+         if (*++q == 0x0a)
+            q++;
+      }
+      else
+         return 0;                       /* NUL inside the document */
+   }
+   if (w == lt)
+      r->restore = lt;
+   *w          = '\0';
+   r->text     = (const char*)p;
+   r->text_len = (size_t)(w - p);
+   r->ps.p     = lt;
+   return RXML_READER_TEXT;
+}
+
+/* "<![CDATA[...]]>", only line ends are translated */
+RXML_COLD static int rxml_reader_cdata(struct rxml_reader *r, unsigned char *p)
+{
+   unsigned char *q, *w, *e;
+   int ret;
+   r->ps.p = p + 3;
+   if ((ret = rxml_match(&r->ps, "CDATA[")) != 1)
+      return ret;
+   q = w = (unsigned char*)r->ps.p;
+   for (e = q;; e++)
+   {
+      if (!(e = (unsigned char*)memchr(e, ']', (size_t)(r->end - e))))
+      {
+         r->ps.p = r->end;
+         return -1;
+      }
+      if (e[1] == ']' && e[2] == '>')
+         break;
+   }
+   r->text = (const char*)q;
+   while (q != e)
+   {
+      unsigned char c = *q++;
+      if (c == 0x0d)
+      {
+         c = 0x0a;
+         if (q != e && *q == 0x0a)
+            q++;
+      }
+      else if (!c)
+         return 0;
+      *w++ = c;
+   }
+   *w          = '\0';
+   r->text_len = (size_t)(w - (unsigned char*)r->text);
+   r->ps.p     = e + 3;
+   return r->text_len ? RXML_READER_TEXT : RXML_READER_AGAIN;
+}
+
+/* Attribute value after the opening quote, decoded in place.  Returns
+ * the closing quote or NULL on error, *w is the end of the value. */
+static unsigned char *rxml_reader_attrvalue(unsigned char *q,
+      unsigned char quote, unsigned char **w)
+{
+   for (;;)
+   {
+      const unsigned char *run = q;
+      unsigned char c;
+      while (!(rxml_cls[*q] & RXML_CAS))
+         q++;
+      if (*w != run)
+         memmove(*w, run, (size_t)(q - run));
+      *w += q - run;
+      c   = *q;
+      if (c == quote)
+         return q;
+      switch (c)
+      {
+         case '&':
+            if (!(q = rxml_reader_ref(q, w)))
+               return NULL;
+            break;
+         case 0x0d:
+            *(*w)++ = 0x20;
+            if (*++q == 0x0a)
+               q++;
+            break;
+         case 0x09:
+         case 0x0a:
+            *(*w)++ = 0x20;
+            q++;
+            break;
+         case '\'':
+         case '"':
+            *(*w)++ = c;
+            q++;
+            break;
+         default:                        /* '<' or NUL */
+            return NULL;
+      }
+   }
+}
+
+static int rxml_reader_start_tag(struct rxml_reader *r, unsigned char *p)
+{
+   unsigned char *q = p + 1;
+   unsigned char *name;
+   size_t len;
+   int fail;
+   unsigned char c;
+
+   /* The whole tag has to be in the buffer.  Quoted values may hold '>'. */
+   for (; *q != '>'; q++)
+   {
+      if (*q == '"' || *q == '\'')
+      {
+         unsigned char *e = (unsigned char*)
+               memchr(q + 1, *q, (size_t)(r->end - q - 1));
+         if (!e)
+         {
+            r->ps.p = r->end;
+            return -1;
+         }
+         q = e;
+      }
+      else if (!*q)
+      {
+         r->ps.p = q;
+         return -1;
+      }
+   }
+
+   name    = p + 1;
+   r->ps.p = name;
+   len     = rxml_scan_name(&r->ps, &r->ps.p, &fail);
+   if (fail)
+      return 0;
+   q = (unsigned char*)r->ps.p;
+   c = *q;
+   if (!(rxml_is_sp(c) || c == 0x0d) && c != '/' && c != '>')
+      return 0;
+   *q = '\0';
+
+   memcpy(r->names + r->ps.names_len, name, len);
+   r->names[r->ps.names_len + len] = '\0';
+   r->ps.names_len += len + 1;
+   r->depth++;
+
+   for (;;)
+   {
+      struct rxml_reader_attrib *a;
+      unsigned char *aname, *value, *w;
+      size_t alen;
+      int sp = 0;
+      while (rxml_is_sp(c) || c == 0x0d)
+      {
+         sp = 1;
+         c  = *++q;
+      }
+      if (c == '>')
+      {
+         q++;
+         break;
+      }
+      if (c == '/')
+      {
+         if (q[1] != '>')
+            return 0;
+         q += 2;
+         r->self_closed = 1;
+         break;
+      }
+      if (!sp || !rxml_is_namestart(c))
+         return 0;
+
+      aname   = q;
+      r->ps.p = q;
+      alen    = rxml_scan_name(&r->ps, &r->ps.p, &fail);
+      if (fail)
+         return 0;
+      q  = (unsigned char*)r->ps.p;
+      c  = *q;
+      *q = '\0';
+      while (rxml_is_sp(c) || c == 0x0d)
+         c = *++q;
+      if (c != '=')
+         return 0;
+      do
+      {
+         c = *++q;
+      } while (rxml_is_sp(c) || c == 0x0d);
+      if (c != '\'' && c != '"')
+         return 0;
+      value = w = ++q;
+      if (!(q = rxml_reader_attrvalue(q, c, &w)))
+         return 0;
+      *w = '\0';
+
+      if (r->attrib_count == r->attrib_cap)
+      {
+         unsigned ncap = r->attrib_cap ? r->attrib_cap * 2 : 16;
+         struct rxml_reader_attrib *na = (struct rxml_reader_attrib*)
+               realloc(r->attribs, ncap * sizeof(*na));
+         if (!na)
+            return 0;
+         r->attribs    = na;
+         r->attrib_cap = ncap;
+      }
+      a            = &r->attribs[r->attrib_count++];
+      a->name      = (const char*)aname;
+      a->name_len  = alen;
+      a->value     = (const char*)value;
+      a->value_len = (size_t)(w - value);
+
+      /* After the closing quote: '/', '>' or whitespace. */
+      c = *++q;
+      if (!(rxml_is_sp(c) || c == 0x0d) && c != '/' && c != '>')
+         return 0;
+   }
+
+   r->ps.p     = q;
+   r->name     = (const char*)name;
+   r->name_len = len;
+   return RXML_READER_START;
+}
+
+static int rxml_reader_end_tag(struct rxml_reader *r, unsigned char *p)
+{
+   unsigned char *gt = (unsigned char*)memchr(p, '>', (size_t)(r->end - p));
+   unsigned char *q  = p + 2;
+   const char *open;
+   size_t len;
+   if (!gt)
+   {
+      r->ps.p = r->end;
+      return -1;
+   }
+   open = rxml_reader_top(r, &len);
+   if ((size_t)(gt - q) < len || memcmp(q, open, len))
+      return 0;
+   for (q += len; rxml_is_sp(*q) || *q == 0x0d; q++) { }
+   if (q != gt)
+      return 0;
+   r->ps.p     = gt + 1;
+   r->name     = open;
+   r->name_len = len;
+   r->pop      = 1;
+   return RXML_READER_END;
+}
+
+static int rxml_reader_content(struct rxml_reader *r)
+{
+   unsigned char *p = (unsigned char*)r->ps.p;
+   unsigned char c;
+   int ret;
+   if (*p != '<')
+      return rxml_reader_chardata(r, p);
+   c = p[1];
+   if (c == '/' && r->depth)
+      return rxml_reader_end_tag(r, p);
+   if (rxml_is_namestart(c))
+      return rxml_reader_start_tag(r, p);
+   if (c == '!')
+   {
+      if (p[2] == '-')
+      {
+         r->ps.p = p + 3;
+         return ((ret = rxml_scan_comment(&r->ps)) == 1 ? RXML_READER_AGAIN : ret);
+      }
+      if (p[2] == '[')
+         return rxml_reader_cdata(r, p);
+      return p[2] ? 0 : -1;
+   }
+   if (c == '?')
+   {
+      r->ps.p = p + 2;
+      return ((ret = rxml_scan_pi(&r->ps)) == 1 ? RXML_READER_AGAIN : ret);
+   }
+   return c ? 0 : -1;
+}
+
+static int rxml_reader_prolog(struct rxml_reader *r)
+{
+   int ret;
+   /* Optional UTF-8 byte order mark, only at the very first byte. */
+   if (*r->ps.p == 0xEF)
+   {
+      r->ps.p++;
+      if ((ret = rxml_match(&r->ps, "\xbb\xbf")) != 1)
+         return ret;
+   }
+   if ((ret = rxml_scan_misc(&r->ps, 2)) != 1)
+      return ret;
+   r->ps.p--;                            /* back onto the root's '<' */
+   r->state = RXML_READER_STATE_CONTENT;
+   return RXML_READER_AGAIN;
+}
+
+rxml_reader_t *rxml_reader_new(intfstream_t *stream)
+{
+   rxml_reader_t *r = (rxml_reader_t*)calloc(1, sizeof(*r));
+   if (!r)
+      return NULL;
+   r->cap = RXML_READER_BLOCK;
+   if (!(r->buf = (unsigned char*)malloc(r->cap + 1)))
+   {
+      free(r);
+      return NULL;
+   }
+   r->stream = stream;
+   r->end    = r->buf;
+   *r->end   = '\0';
+   r->ps.p   = r->buf;
+   return r;
+}
+
+void rxml_reader_free(rxml_reader_t *reader)
+{
+   if (!reader)
+      return;
+   free(reader->attribs);
+   free(reader->buf);
+   free(reader);
+}
+
+enum rxml_reader_event rxml_reader_next(rxml_reader_t *r)
+{
+   if (r->restore)
+   {
+      *r->restore = '<';
+      r->restore  = NULL;
+   }
+   r->attrib_count = 0;
+   if (r->pop)
+   {
+      r->ps.names_len -= r->name_len + 1;
+      r->pop           = 0;
+      if (!--r->depth)
+         r->state      = RXML_READER_STATE_EPILOG;
+   }
+   if (r->self_closed)
+   {
+      r->self_closed = 0;
+      r->pop         = 1;
+      return RXML_READER_END;             /* name is still the start's */
+   }
+
+   for (;;)
+   {
+      const unsigned char *tok = r->ps.p;
+      int ret;
+      switch (r->state)
+      {
+         case RXML_READER_STATE_PROLOG:
+            ret = rxml_reader_prolog(r);
+            break;
+         case RXML_READER_STATE_CONTENT:
+            ret = rxml_reader_content(r);
+            break;
+         case RXML_READER_STATE_EPILOG:
+            ret = rxml_scan_misc(&r->ps, 0);
+            break;
+         case RXML_READER_STATE_DONE:
+            return RXML_READER_DONE;
+         default:
+            return RXML_READER_ERROR;
+      }
+      if (ret > 0)
+         return (enum rxml_reader_event)ret;
+      if (ret == RXML_READER_AGAIN)
+         continue;
+      /* Out of data in the middle of a construct, unless a NUL byte
+       * inside the document stopped the scanner early. */
+      if (ret == -1 && !memchr(tok, 0, (size_t)(r->end - tok)))
+      {
+         if (!r->eof)
+         {
+            if (rxml_reader_fill(r, tok))
+               continue;
+         }
+         else if (r->state == RXML_READER_STATE_EPILOG)
+         {
+            r->state = RXML_READER_STATE_DONE;
+            return RXML_READER_DONE;
+         }
+      }
+      r->state = RXML_READER_STATE_ERROR;
+      return RXML_READER_ERROR;
+   }
+}
+
+const char *rxml_reader_name(rxml_reader_t *reader, size_t *len)
+{
+   if (len)
+      *len = reader->name_len;
+   return reader->name;
+}
+
+const char *rxml_reader_text(rxml_reader_t *reader, size_t *len)
+{
+   if (len)
+      *len = reader->text_len;
+   return reader->text;
+}
+
+unsigned rxml_reader_depth(rxml_reader_t *reader)
+{
+   return reader->depth;
+}
+
+unsigned rxml_reader_attrib_count(rxml_reader_t *reader)
+{
+   return reader->attrib_count;
+}
+
+const char *rxml_reader_attrib_name(rxml_reader_t *reader,
+      unsigned idx, size_t *len)
+{
+   if (idx >= reader->attrib_count)
+      return NULL;
+   if (len)
+      *len = reader->attribs[idx].name_len;
+   return reader->attribs[idx].name;
+}
+
+const char *rxml_reader_attrib_value(rxml_reader_t *reader,
+      unsigned idx, size_t *len)
+{
+   if (idx >= reader->attrib_count)
+      return NULL;
+   if (len)
+      *len = reader->attribs[idx].value_len;
+   return reader->attribs[idx].value;
+}
+
+const char *rxml_reader_attrib(rxml_reader_t *reader, const char *attrib)
+{
+   unsigned i;
+   for (i = 0; i < reader->attrib_count; i++)
+   {
+      if (strcmp(attrib, reader->attribs[i].name) == 0)
+         return reader->attribs[i].value;
+   }
+   return NULL;
+}
+
 /* Keep the single-translation-unit (griffin) namespace clean. */
 #undef RXML_CN
 #undef RXML_CNS
@@ -1378,6 +2033,13 @@ const char *rxml_node_attrib(struct rxml_node *node, const char *attrib)
 #undef RXML_CCS
 #undef RXML_CAS
 #undef RXML_NAME_BUDGET
+#undef RXML_ARENA_MIN
+#undef RXML_ARENA_MAX
+#undef RXML_ARENA_ALIGN
+#undef RXML_ARENA_HEADER
+#undef RXML_READER_BLOCK
+#undef RXML_READER_MAX
+#undef RXML_READER_AGAIN
 #undef RXML_COLD
 #undef RXML_NOINLINE
 #undef rxml_is_name
@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 
+#include <boolean.h>
 #include <libretro.h>
 
 RETRO_BEGIN_DECLS
@@ -102,6 +103,121 @@ unsigned cpu_features_get_core_amount(void);
  */
 void cpu_features_get_model_name(char *name, int len);
 
+/** Logical CPUs beyond this index are not reported by the topology API. */
+#define CPU_TOPOLOGY_MAX_CPUS   64
+/** Maximum number of distinct cache instances reported. */
+#define CPU_TOPOLOGY_MAX_CACHES 64
+
+/** Kind of physical core a logical CPU belongs to. */
+enum cpu_core_type
+{
+   /** The platform gives no way to tell. */
+   CPU_CORE_TYPE_UNKNOWN = 0,
+   /** A big core, or any core on a system where all cores are alike. */
+   CPU_CORE_TYPE_PERFORMANCE,
+   /** A little core (Intel E-core, ARM LITTLE). */
+   CPU_CORE_TYPE_EFFICIENCY
+};
+
+/** Values match the CPUID leaf 4 cache type field. */
+enum cpu_cache_type
+{
+   CPU_CACHE_TYPE_DATA = 1,
+   CPU_CACHE_TYPE_INSTRUCTION,
+   CPU_CACHE_TYPE_UNIFIED
+};
+
+/** One cache instance, e.g. the L2 of one core or a shared L3. */
+typedef struct cpu_cache_info
+{
+   /** Logical CPUs that share this instance. */
+   uint64_t shared_cpus;
+   /** Size in bytes. */
+   uint32_t size;
+   /** Line size in bytes, or 0 if unknown. */
+   uint16_t line_size;
+   uint8_t  level;
+   /** enum cpu_cache_type */
+   uint8_t  type;
+} cpu_cache_info_t;
+
+/** One logical CPU (hardware thread). */
+typedef struct cpu_logical_info
+{
+   /** Logical CPUs on the same physical core, this one included. */
+   uint64_t siblings;
+   /** Physical core, numbered densely from 0 to \c core_count - 1. */
+   unsigned core;
+   /** Physical package (socket), numbered densely from 0. */
+   unsigned package;
+   /** NUMA node as numbered by the OS; 0 without NUMA information. */
+   unsigned numa_node;
+   enum cpu_core_type type;
+   /** \c false for CPUs that are present but offline. */
+   bool online;
+} cpu_logical_info_t;
+
+/**
+ * Processor layout as seen by the OS.
+ *
+ * \c cpus[i] describes logical CPU \c i (the numbering used by affinity
+ * masks, see \c sthread_attr_t) for \c i below \c cpu_count.
+ */
+typedef struct cpu_topology
+{
+   cpu_logical_info_t cpus[CPU_TOPOLOGY_MAX_CPUS];
+   cpu_cache_info_t   caches[CPU_TOPOLOGY_MAX_CACHES];
+   unsigned cpu_count;
+   unsigned cache_count;
+   /** Physical cores with at least one online CPU. */
+   unsigned core_count;
+   unsigned performance_core_count;
+   unsigned efficiency_core_count;
+   unsigned package_count;
+   unsigned numa_node_count;
+} cpu_topology_t;
+
+/**
+ * Discovers the CPU topology: which logical CPUs share a core,
+ * the type of each core, the cache hierarchy and NUMA nodes.
+ *
+ * Linux reads /sys/devices/system/cpu, /sys/devices/system/node and,
+ * on Intel hybrid parts, /sys/devices/cpu_core and cpu_atom.
+ * Elsewhere on x86 it falls back to CPUID leaves 4 / 0x8000001D
+ * (caches), 0xB (SMT width) and 0x1A (core type, read on each CPU in
+ * turn), and assumes that SMT siblings are numbered consecutively.
+ * Other platforms get one core per logical CPU and no cache data.
+ *
+ * Reads many small files on Linux; call once and keep the result.
+ *
+ * @param[out] topo Filled in on success. Must not be \c NULL.
+ * @return \c true if at least the logical CPUs could be enumerated.
+ */
+bool cpu_features_get_topology(cpu_topology_t *topo);
+
+/**
+ * Selects online logical CPUs from \c topo, e.g. to build an
+ * affinity mask for worker threads.
+ *
+ * @param topo Topology from \c cpu_features_get_topology.
+ * @param type Only CPUs of this type;
+ * \c CPU_CORE_TYPE_UNKNOWN selects every type.
+ * @param one_per_core If \c true, only the lowest-numbered SMT
+ * sibling of each core is included.
+ * @return Mask with bit \c i set for each selected CPU.
+ */
+uint64_t cpu_topology_get_mask(const cpu_topology_t *topo,
+      enum cpu_core_type type, bool one_per_core);
+
+/**
+ * Size of the data or unified cache at \c level that \c cpu uses.
+ * Handy for chunk-size heuristics (e.g. keep a working set in L2).
+ *
+ * @return Size in bytes, or 0 if unknown.
+ */
+uint32_t cpu_topology_get_cache_size(const cpu_topology_t *topo,
+      unsigned cpu, unsigned level);
+
 RETRO_END_DECLS
 
 #endif
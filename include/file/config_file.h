@@ -54,7 +54,13 @@ RETRO_BEGIN_DECLS
 enum config_file_flags
 {
    CONF_FILE_FLG_MODIFIED                 = (1 << 0),
-   CONF_FILE_FLG_GUARANTEED_NO_DUPLICATES = (1 << 1)
+   CONF_FILE_FLG_GUARANTEED_NO_DUPLICATES = (1 << 1),
+   /* An entry that came from an #include was set or unset;
+    * the entries no longer match a reparse of the file */
+   CONF_FILE_FLG_INCLUDE_OVERRIDDEN       = (1 << 2),
+   /* Entries were restored from the snapshot at cache_path
+    * instead of being parsed (see config_file_new_cached) */
+   CONF_FILE_FLG_FROM_SNAPSHOT            = (1 << 3)
 };
 
 struct config_file
@@ -66,6 +72,16 @@ struct config_file
    struct config_entry_list *last;
    struct config_include_list *includes;
    struct path_linked_list *references;
+   /* Backing storage for entries parsed in place
+    * (see config_file_new_from_buffer) */
+   struct config_file_arena *arenas;
+   /* Resolved paths of every file pulled in
+    * through #include, recursively, with the
+    * size and mtime each had when it was read */
+   struct config_source_list *sources;
+   /* Snapshot kept in sync by config_file_write
+    * (see config_file_new_cached) */
+   char *cache_path;
    unsigned include_depth;
    uint8_t flags;
 };
@@ -132,8 +148,51 @@ config_file_t *config_file_new_with_callback(
 config_file_t *config_file_new_from_string(char *from_string,
       const char *path);
 
+/**
+ * config_file_new_from_buffer:
+ *
+ * Load a config file from a heap-allocated buffer,
+ * taking ownership of @buf. @buf must be NUL-terminated
+ * at @buf[@len].
+ *
+ * Keys and values are sliced in place out of @buf and
+ * all entry nodes are carved from a single block, so a
+ * config loaded this way costs two allocations instead
+ * of three per line. @buf is released together with
+ * the config file (also on failure).
+ **/
+config_file_t *config_file_new_from_buffer(char *buf, size_t len,
+      const char *path);
+
+/**
+ * config_file_new_from_path_to_string:
+ *
+ * Reads the file at @path into memory in one go and
+ * parses it in place (see config_file_new_from_buffer).
+ *
+ * @return Returns NULL if file doesn't exist.
+ **/
 config_file_t *config_file_new_from_path_to_string(const char *path);
 
+/**
+ * config_file_new_cached:
+ *
+ * Loads a config file through a binary snapshot stored at
+ * @cache_path. The snapshot holds the already-parsed entries
+ * together with the modification time and size of @path and
+ * of every file it includes. If none of those changed, the
+ * snapshot is loaded in one read without tokenizing anything;
+ * otherwise @path is parsed as usual and the snapshot is
+ * (re)written.
+ *
+ * The snapshot is refreshed by every subsequent successful
+ * config_file_write() of the returned config to @path.
+ *
+ * @return Returns NULL if file doesn't exist.
+ **/
+config_file_t *config_file_new_cached(const char *path,
+      const char *cache_path);
+
 /**
  * config_file_free:
  *
@@ -164,6 +223,9 @@ struct config_entry_list
    /* If we got this from an #include,
     * do not allow overwrite. */
    bool readonly;
+   /* Set or changed since the config was
+    * last loaded or written. */
+   bool dirty;
 };
 
 struct config_file_entry
@@ -315,6 +377,24 @@ void config_unset(config_file_t *conf, const char *key);
  **/
 bool config_file_write(config_file_t *conf, const char *path, bool val);
 
+/**
+ * config_file_write_incremental:
+ *
+ * Write the current config to @path, which must be the
+ * file it was loaded from, by patching the existing file:
+ * only lines of entries that were set, changed or unset
+ * since loading are rewritten, new entries are inserted
+ * ahead of the first #include, and comments, ordering and
+ * everything else are preserved byte for byte.
+ *
+ * Falls back to config_file_write() (unsorted) when the
+ * file on disk no longer matches what was loaded.
+ *
+ * Like config_file_write(), the file is replaced
+ * atomically through a temporary file.
+ **/
+bool config_file_write_incremental(config_file_t *conf, const char *path);
+
 /**
  * config_file_dump:
  *
@@ -680,6 +680,14 @@ bool path_is_valid(const char *path);
 
 int64_t path_get_size(const char *path);
 
+/**
+ * path_get_mtime:
+ *
+ * @return opaque modification timestamp of @path, only
+ * meaningful for change detection, or -1 if unavailable.
+ **/
+int64_t path_get_mtime(const char *path);
+
 bool is_path_accessible_using_standard_io(const char *path);
 
 RETRO_END_DECLS
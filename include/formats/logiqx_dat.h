@@ -78,6 +78,16 @@ bool logiqx_dat_path_is_valid(const char *path, uint64_t *file_size);
  * occurs. */
 logiqx_dat_t *logiqx_dat_init(const char *path);
 
+/* Same as logiqx_dat_init(), but first tries the index
+ * cache at 'cache_path'. The cache is used only if it
+ * was built from 'path' and the DAT file's size and
+ * modification time are unchanged, in which case the
+ * XML is not parsed at all; otherwise the DAT file is
+ * loaded and the cache is (re)written.
+ * Failing to write the cache is not an error. */
+logiqx_dat_t *logiqx_dat_init_cached(const char *path,
+      const char *cache_path);
+
 /* Frees specified DAT file */
 void logiqx_dat_free(logiqx_dat_t *dat_file);
 
@@ -96,12 +106,31 @@ bool logiqx_dat_get_next(
       logiqx_dat_t *dat_file, logiqx_dat_game_info_t *game_info);
 
 /* Fetches information for the specified game.
+ * Lookups go through an index built on the first
+ * search, so repeated searches are cheap.
  * Returns false if game does not exist, or arguments
  * are invalid. */
 bool logiqx_dat_search(
       logiqx_dat_t *dat_file, const char *game_name,
       logiqx_dat_game_info_t *game_info);
 
+/* Fetches information for the game containing a ROM
+ * with the specified CRC32 and size.
+ * Returns false if no such ROM exists, or arguments
+ * are invalid. */
+bool logiqx_dat_search_crc(
+      logiqx_dat_t *dat_file, uint32_t crc, uint64_t size,
+      logiqx_dat_game_info_t *game_info);
+
+/* Fetches information for the game containing a ROM
+ * with the specified MD5 (32 hex digits) or SHA-1
+ * (40 hex digits) hash.
+ * Returns false if no such ROM exists, or arguments
+ * are invalid. */
+bool logiqx_dat_search_hash(
+      logiqx_dat_t *dat_file, const char *hash,
+      logiqx_dat_game_info_t *game_info);
+
 RETRO_END_DECLS
 
 #endif
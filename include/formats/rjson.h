@@ -26,6 +26,7 @@
 #include <retro_common_api.h>
 #include <boolean.h> /* bool */
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* int64_t, uint64_t */
 
 RETRO_BEGIN_DECLS
 
@@ -93,9 +94,12 @@ enum rjson_type rjson_next(rjson_t *json);
  * The returned pointer is only valid until the parsing continues. */
 const char *rjson_get_string(rjson_t *json, size_t *length);
 
-/* Returns the current number (or string) converted to double or int */
-double rjson_get_double(rjson_t *json);
-int    rjson_get_int(rjson_t *json);
+/* Returns the current number (or string) converted to double or int.
+ * The conversion doesn't depend on the locale and doubles are correctly
+ * rounded.  Integers out of range saturate. */
+double  rjson_get_double(rjson_t *json);
+int     rjson_get_int(rjson_t *json);
+int64_t rjson_get_int64(rjson_t *json);
 
 /* Returns a string describing the error once rjson_next/rjson_parse
  * has returned an unrecoverable RJSON_ERROR (otherwise returns ""). */
@@ -170,6 +174,62 @@ bool rjson_parse_quick(const char *string, size_t len, void* context, char optio
 
 /* ------------------------------------------------------------------------- */
 
+/* A tape holds a whole parsed document as one flat array of nodes, so it
+ * can be walked in any order and queried repeatedly without building a
+ * tree of allocations.  Nodes are addressed by index and the root value
+ * is node 0.  Containers know the size of their subtree, so stepping to
+ * the next sibling is O(1).  Strings are unescaped on first access only.
+ * A tape can be reparsed with a new document and reuses its memory. */
+typedef struct rjson_tape rjson_tape_t;
+
+/* Returned instead of a node index when a lookup fails */
+#define RJSON_TAPE_NONE ((size_t)-1)
+
+rjson_tape_t *rjson_tape_new(void);
+void rjson_tape_free(rjson_tape_t *tape);
+
+/* Parse a JSON document in memory, the passed rjson_option flags are
+ * applied.  The document is copied and doesn't need to stay around.
+ * On failure, rjson_tape_get_error returns a description with the
+ * source line and column, and the tape is left empty. */
+bool rjson_tape_parse(rjson_tape_t *tape, const char *string, size_t len,
+      char option_flags);
+const char *rjson_tape_get_error(rjson_tape_t *tape);
+
+/* Returns the type of a node, or RJSON_ERROR for an invalid index */
+enum rjson_type rjson_tape_get_type(rjson_tape_t *tape, size_t node);
+
+/* Returns the number of elements of an array or members of an object */
+size_t rjson_tape_get_count(rjson_tape_t *tape, size_t node);
+
+/* Iterate the children of an array or an object.  Like with rjson_next,
+ * an object's children alternate between member name and value.
+ * Both return RJSON_TAPE_NONE when there are no more children. */
+size_t rjson_tape_first(rjson_tape_t *tape, size_t node);
+size_t rjson_tape_next(rjson_tape_t *tape, size_t node);
+
+/* Look up the value of an object member, or an array element */
+size_t rjson_tape_get_member(rjson_tape_t *tape, size_t object,
+      const char *key);
+size_t rjson_tape_get_index(rjson_tape_t *tape, size_t array, size_t index);
+
+/* Look up a value with a JSON Pointer (RFC 6901) relative to node, like
+ * rjson_tape_find(tape, 0, "/items/3/path").  Member names containing
+ * '~' or '/' are written as "~0" and "~1". */
+size_t rjson_tape_find(rjson_tape_t *tape, size_t node, const char *path);
+
+/* Get a string or number node, null-terminated unescaped UTF-8 encoded.
+ * Returns NULL for other node types.  The returned pointer stays valid
+ * until the tape is reparsed or freed. */
+const char *rjson_tape_get_string(rjson_tape_t *tape, size_t node,
+      size_t *length);
+
+/* Same conversions as rjson_get_double and rjson_get_int64 */
+double  rjson_tape_get_double(rjson_tape_t *tape, size_t node);
+int64_t rjson_tape_get_int64(rjson_tape_t *tape, size_t node);
+
+/* ------------------------------------------------------------------------- */
+
 /* Options that can be passed to rjsonwriter_set_options */
 enum rjsonwriter_option
 {
@@ -231,7 +291,12 @@ void rjsonwriter_rawf(rjsonwriter_t *writer, const char *fmt, ...);
 void rjsonwriter_add_string(rjsonwriter_t *writer, const char *value);
 void rjsonwriter_add_string_len(rjsonwriter_t *writer, const char *value, int len);
 
+/* Add a number.  Doubles are written in the shortest form that reads back
+ * as the same value, independent of the locale.  Infinities and NaN, which
+ * JSON can't represent, are written as null. */
 void rjsonwriter_add_double(rjsonwriter_t *writer, double value);
+void rjsonwriter_add_int64(rjsonwriter_t *writer, int64_t value);
+void rjsonwriter_add_uint64(rjsonwriter_t *writer, uint64_t value);
 
 void rjsonwriter_add_spaces(rjsonwriter_t *writer, int count);
 
@@ -61,11 +61,11 @@ static INLINE void rjsonwriter_add_tab(rjsonwriter_t *writer)
       { rjsonwriter_raw(writer, "\t", 1); }
 
 static INLINE void rjsonwriter_add_unsigned(rjsonwriter_t *writer, unsigned value)
-      { rjsonwriter_rawf(writer, "%u", value); }
+      { rjsonwriter_add_uint64(writer, value); }
 
 /* Add a signed or unsigned integer or a double number */
 static INLINE void rjsonwriter_add_int(rjsonwriter_t *writer, int value)
-      { rjsonwriter_rawf(writer, "%d", value); }
+      { rjsonwriter_add_int64(writer, value); }
 
 static INLINE void rjsonwriter_add_bool(rjsonwriter_t *writer, bool value)
       { rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5)); }
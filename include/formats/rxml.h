@@ -24,6 +24,8 @@
 
 #include <retro_common_api.h>
 
+#include <stddef.h>
+
 RETRO_BEGIN_DECLS
 
 /* Total NIH. Very trivial "XML" implementation for use in RetroArch.
@@ -64,6 +66,52 @@ struct rxml_node *rxml_root_node(rxml_document_t *doc);
 
 const char *rxml_node_attrib(struct rxml_node *node, const char *attrib);
 
+/* Streaming reader.  Pulls a document from a stream one event at a
+ * time instead of building a tree, so memory use is bounded by the
+ * largest single tag or text run rather than the document size.
+ *
+ * Names, attribute values and text are returned as NUL-terminated,
+ * decoded slices of the reader's buffer and stay valid only until
+ * the next call to rxml_reader_next.  Text may be reported in more
+ * than one RXML_READER_TEXT event (for example around comments and
+ * CDATA sections) and includes whitespace between elements.
+ * An empty element "<a/>" is reported as a start and an end event.
+ * Unlike rxml_load_document, truncated documents are an error. */
+
+enum rxml_reader_event
+{
+   RXML_READER_ERROR = 0,
+   RXML_READER_DONE,
+   RXML_READER_START,   /* element start, name and attributes available */
+   RXML_READER_END,     /* element end, name available */
+   RXML_READER_TEXT     /* character data */
+};
+
+typedef struct rxml_reader rxml_reader_t;
+struct intfstream_internal;
+
+/* The stream isn't closed by rxml_reader_free */
+rxml_reader_t *rxml_reader_new(struct intfstream_internal *stream);
+void rxml_reader_free(rxml_reader_t *reader);
+
+enum rxml_reader_event rxml_reader_next(rxml_reader_t *reader);
+
+/* Element name on RXML_READER_START and RXML_READER_END */
+const char *rxml_reader_name(rxml_reader_t *reader, size_t *len);
+/* Character data on RXML_READER_TEXT */
+const char *rxml_reader_text(rxml_reader_t *reader, size_t *len);
+/* Number of open elements, including the one just started or ended */
+unsigned rxml_reader_depth(rxml_reader_t *reader);
+
+/* Attributes of the element on RXML_READER_START */
+unsigned rxml_reader_attrib_count(rxml_reader_t *reader);
+const char *rxml_reader_attrib_name(rxml_reader_t *reader,
+      unsigned idx, size_t *len);
+const char *rxml_reader_attrib_value(rxml_reader_t *reader,
+      unsigned idx, size_t *len);
+/* Same as rxml_node_attrib, but empty values are "" instead of NULL */
+const char *rxml_reader_attrib(rxml_reader_t *reader, const char *attrib);
+
 RETRO_END_DECLS
 
 #endif
@@ -53,6 +53,18 @@ cothread_t co_active(void);
  *
  * Create a co_thread.
  *
+ * On the amd64, x86, aarch64, armeabi, sjlj and ucontext ports the
+ * stack is mapped with a guard page below it, so an overflow faults
+ * instead of corrupting memory, and is taken from the calling
+ * thread's pool of recycled stacks when one of the right size class
+ * is free.  The stack may be rounded up to its size class.
+ *
+ * SAFETY: callable from any thread; each thread has its own pool, so
+ * no lock is needed and a cothread may be deleted on another thread
+ * than the one that created it.  The pool is only on by default
+ * where it is emptied on thread exit: GCC-style thread-local storage
+ * on a POSIX host built with HAVE_THREADS.
+ *
  * Returns: cothread if successful, otherwise NULL.
  */
 cothread_t co_create(unsigned int, void (*)(void));
@@ -61,10 +73,36 @@ cothread_t co_create(unsigned int, void (*)(void));
  * co_delete:
  * @cothread           : cothread object
  *
- * Frees a co_thread.
+ * Frees a co_thread.  Its stack goes to the calling thread's pool,
+ * or back to the system when that pool is full.
  */
 void co_delete(cothread_t cothread);
 
+/**
+ * co_stack_high_water:
+ * @cothread           : cothread object
+ *
+ * Measures how deep @cothread's stack has been used so far, for
+ * sizing the stack passed to co_create().  Costs a scan of the unused
+ * part of the stack, so call it when tuning rather than per switch.
+ *
+ * Returns: bytes of stack used at the deepest point, or 0 when not
+ * known (the thread's own context, or a port without pooled stacks).
+ */
+unsigned int co_stack_high_water(cothread_t cothread);
+
+/**
+ * co_stack_pool_trim:
+ *
+ * Returns the stacks that co_delete() pooled on the calling thread to
+ * the system.  Only touches the calling thread's pool; the pools of
+ * other threads are left alone.  Runs by itself when a thread exits
+ * where the pool is on by default; call it to give memory back after
+ * a burst of cothreads, or before a thread exits when the pool was
+ * enabled through LIBCO_STACK_POOL_DEPTH on any other target.
+ */
+void co_stack_pool_trim(void);
+
 /**
  * co_switch:
  * @cothread           : cothread object to switch to
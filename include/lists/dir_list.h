@@ -40,7 +40,10 @@ RETRO_BEGIN_DECLS
  * @include_compressed : Only include files which match ext. Do not try to match compressed files, etc.
  * @recursive          : list directory contents recursively
  *
- * Create a directory listing, appending to an existing list
+ * Create a directory listing, appending to an existing list.
+ * Passing a pooled list (see string_list_new_pooled) stores
+ * all paths in a few contiguous blocks instead of one heap
+ * allocation per file.
  *
  * @return Returns true on success, otherwise false.
  **/
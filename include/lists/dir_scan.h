@@ -0,0 +1,81 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dir_scan.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_DIR_SCAN_H
+#define __LIBRETRO_SDK_DIR_SCAN_H
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+enum dir_scan_flags
+{
+   DIR_SCAN_FLAG_INCLUDE_DIRS       = (1 << 0),
+   DIR_SCAN_FLAG_INCLUDE_HIDDEN     = (1 << 1),
+   DIR_SCAN_FLAG_INCLUDE_COMPRESSED = (1 << 2),
+   DIR_SCAN_FLAG_RECURSIVE          = (1 << 3)
+};
+
+/**
+ * dir_scan_cb_t:
+ * @path     : full path of the entry.
+ * @type     : RARCH_PLAIN_FILE, RARCH_COMPRESSED_ARCHIVE,
+ *             RARCH_DIRECTORY or RARCH_FILETYPE_UNSET
+ *             (see file/file_path.h).
+ * @userdata : opaque pointer passed to dir_scan.
+ *
+ * @path is only valid for the duration of the call.
+ *
+ * @return false to stop the scan.
+ **/
+typedef bool (*dir_scan_cb_t)(const char *path, unsigned type,
+      void *userdata);
+
+/**
+ * dir_scan:
+ * @dir         : directory path.
+ * @ext         : '|' separated list of extensions to include, or NULL.
+ * @flags       : bitmask of enum dir_scan_flags.
+ * @num_threads : number of worker threads used to walk subdirectories.
+ *                0 or 1 scans on the calling thread.
+ * @cb          : called once for every entry that passes the filters.
+ * @userdata    : passed through to @cb.
+ *
+ * Walks a directory the same way dir_list_append does, but streams
+ * every entry to @cb instead of collecting a list. Entries are
+ * classified from the directory entry type where the platform
+ * provides it, and rejected by extension before any path is built.
+ *
+ * With HAVE_THREADS and @num_threads > 1, each subdirectory is
+ * handed to a thread pool as it is found. The order of entries is
+ * then unspecified, but @cb is never invoked concurrently.
+ *
+ * @return true if the whole tree was walked, false if @dir could
+ * not be opened, an allocation failed or @cb stopped the scan.
+ **/
+bool dir_scan(const char *dir, const char *ext, unsigned flags,
+      unsigned num_threads, dir_scan_cb_t cb, void *userdata);
+
+RETRO_END_DECLS
+
+#endif
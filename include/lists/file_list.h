@@ -52,6 +52,18 @@ typedef struct file_list
    size_t size;
 } file_list_t;
 
+/* Flat copy of the strings file_list_search() looks at
+ * (alt, else path, else label), case-folded and packed
+ * back to back, so that repeated searches stream through
+ * label bytes only instead of hopping between entries.
+ * A snapshot: rebuild it after the list changes. */
+typedef struct file_list_index
+{
+   char   *labels;  /* NUL-separated, lower case */
+   size_t *offsets; /* per entry; (size_t)-1 if it has no string */
+   size_t  size;
+} file_list_index_t;
+
 void *file_list_get_userdata_at_offset(const file_list_t *list,
       size_t index);
 
@@ -118,13 +130,43 @@ void file_list_set_alt_at_offset(file_list_t *list, size_t index,
 void file_list_set_label_at_offset(file_list_t *list, size_t index,
       const char *label);
 
+/**
+ * @brief sorts the list case-insensitively on alt (or path)
+ *
+ * Collation keys are computed once per entry, then merge sorted.
+ * The sort is stable.
+ */
 void file_list_sort_on_alt(file_list_t *list);
 
+/**
+ * @brief sorts the list on type with a stable radix sort
+ */
 void file_list_sort_on_type(file_list_t *list);
 
 bool file_list_search(const file_list_t *list, const char *needle,
       size_t *index);
 
+/**
+ * @brief builds a search index over the current contents of @list
+ *
+ * @param index Index to fill; release with file_list_index_free()
+ * @param list The list to index
+ * @return whether or not the operation succeeded
+ */
+bool file_list_index_build(file_list_index_t *index,
+      const file_list_t *list);
+
+/**
+ * @brief same as file_list_search(), run against an index
+ *
+ * Returns the first entry whose string starts with @needle, else the
+ * first one containing it, case-insensitively.
+ */
+bool file_list_index_search(const file_list_index_t *index,
+      const char *needle, size_t *idx);
+
+void file_list_index_free(file_list_index_t *index);
+
 RETRO_END_DECLS
 
 #endif
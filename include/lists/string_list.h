@@ -50,6 +50,9 @@ struct string_list
    struct string_list_elem *elems;
    size_t size;
    size_t cap;
+   /* Backing storage for element strings, if any
+    * (see string_list_new_pooled) */
+   struct string_list_pool *pool;
 };
 
 /**
@@ -95,6 +98,19 @@ bool string_list_deinitialize(struct string_list *list);
 
 bool string_list_initialize(struct string_list *list);
 
+/**
+ * string_list_initialize_pooled:
+ * @list             : pointer to string list
+ * @intern           : share storage between equal elements?
+ *
+ * Like string_list_initialize(), but element strings are
+ * carved out of a few large blocks owned by the list instead
+ * of being allocated one by one (see string_list_new_pooled).
+ *
+ * @return true if successful, otherwise false.
+ **/
+bool string_list_initialize_pooled(struct string_list *list, bool intern);
+
 /**
  * string_list_new:
  *
@@ -104,6 +120,27 @@ bool string_list_initialize(struct string_list *list);
  **/
 struct string_list *string_list_new(void);
 
+/**
+ * string_list_new_pooled:
+ * @intern           : share storage between equal elements?
+ *
+ * Creates a new string list whose element strings live in
+ * contiguous blocks owned by the list. Appending no longer
+ * costs an allocation per element, and freeing the list
+ * costs one free per block rather than per element.
+ *
+ * With @intern set, appending a string equal to one already
+ * in the list reuses its storage - worthwhile for lists with
+ * many repeats (e.g. file extensions).
+ *
+ * NOTE: The .data of elements in a pooled list must not be
+ * freed or reallocated by the caller, and must be treated as
+ * read-only if @intern is set.
+ *
+ * @return New string list if successful, otherwise NULL.
+ **/
+struct string_list *string_list_new_pooled(bool intern);
+
 /**
  * string_list_append:
  * @list             : pointer to string list
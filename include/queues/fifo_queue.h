@@ -29,13 +29,28 @@
 
 #include <retro_common_api.h>
 #include <retro_inline.h>
+#include <retro_atomic.h>
 #include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
+/* Cache-line padding size for the SPSC cursors; see
+ * RETRO_SPSC_CACHE_LINE for the reasoning behind 64. */
+#ifndef FIFO_CACHE_LINE
+#define FIFO_CACHE_LINE 64
+#endif
+
+#define FIFO_PAD_BYTES \
+   ((FIFO_CACHE_LINE > sizeof(retro_atomic_size_t)) \
+      ? (FIFO_CACHE_LINE - sizeof(retro_atomic_size_t)) \
+      : 1)
+
 /**
  * Returns the available data in \c buffer for reading.
  *
+ * Only valid for queues created without \c FIFO_FLAG_SPSC;
+ * use \c fifo_read_avail for those.
+ *
  * @param buffer <tt>fifo_buffer_t *</tt>. The FIFO queue to check.
  * @return The number of bytes available for reading from \c buffer.
  */
@@ -44,6 +59,9 @@ RETRO_BEGIN_DECLS
 /**
  * Returns the available space in \c buffer for writing.
  *
+ * Only valid for queues created without \c FIFO_FLAG_SPSC;
+ * use \c fifo_write_avail for those.
+ *
  * @param buffer <tt>fifo_buffer_t *</tt>. The FIFO queue to check.
  * @return The number of bytes that \c buffer can accept.
  */
@@ -65,6 +83,16 @@ RETRO_BEGIN_DECLS
  */
 #define FIFO_WRITE_AVAIL_NONPTR(buffer) (((buffer).size - 1) - (((buffer).end + (((buffer).end < (buffer).first) ? (buffer).size : 0)) - (buffer).first))
 
+enum fifo_buffer_flags
+{
+   /**
+    * The queue is lock-free for exactly one producer thread and one
+    * consumer thread.  Set by \c fifo_new_spsc and
+    * \c fifo_initialize_spsc.
+    */
+   FIFO_FLAG_SPSC = (1 << 0)
+};
+
 /** @copydoc fifo_buffer_t */
 struct fifo_buffer
 {
@@ -72,16 +100,47 @@ struct fifo_buffer
    size_t size;
    size_t first;
    size_t end;
+   uint8_t flags;
+   /* FIFO_FLAG_SPSC only: free-running cursors, published the same
+    * way as retro_spsc_t's, each on its own cache line */
+   uint8_t _pad0[FIFO_CACHE_LINE];
+   retro_atomic_size_t head;
+   uint8_t _pad1[FIFO_PAD_BYTES];
+   retro_atomic_size_t tail;
+   uint8_t _pad2[FIFO_PAD_BYTES];
 };
 
 /**
  * A bounded FIFO byte queue implemented as a ring buffer.
  *
- * Useful for communication between threads,
- * although the caller is responsible for synchronization.
+ * Useful for communication between threads.
+ * By default the caller is responsible for synchronization,
+ * typically by holding an \c slock_t around every call.
+ *
+ * A queue created with \c fifo_new_spsc or \c fifo_initialize_spsc
+ * (\c FIFO_FLAG_SPSC) needs no lock as long as only one thread writes
+ * and only one thread reads, as between a threaded audio driver and
+ * the thread feeding it.  It uses the cursor protocol of
+ * \c retro_spsc_t: the producer release-stores the write cursor after
+ * copying data in, the consumer release-stores the read cursor after
+ * copying data out, and each acquire-loads the other's cursor.
+ * Its size is rounded up to a power of 2 and all of it is usable.
+ * The \c FIFO_READ_AVAIL and \c FIFO_WRITE_AVAIL macros do not apply
+ * to such a queue; call \c fifo_read_avail and \c fifo_write_avail.
  */
 typedef struct fifo_buffer fifo_buffer_t;
 
+/**
+ * A region of the ring, for zero-copy access.
+ * \c len[1] is non-zero only when the region wraps past the end
+ * of the buffer, in which case \c ptr[1] is the start of the buffer.
+ */
+typedef struct fifo_spans
+{
+   uint8_t *ptr[2];
+   size_t   len[2];
+} fifo_spans_t;
+
 /**
  * Creates a new FIFO queue with \c size bytes of memory.
  * Must be freed with \c fifo_free.
@@ -107,6 +166,33 @@ fifo_buffer_t *fifo_new(size_t len);
  */
 bool fifo_initialize(fifo_buffer_t *buf, size_t len);
 
+/**
+ * Creates a new lock-free single-producer, single-consumer
+ * FIFO queue of at least \c len bytes.
+ * Must be freed with \c fifo_free.
+ *
+ * @param len The size of the FIFO queue, in bytes.
+ * Rounded up to the next power of 2.
+ * @return The new queue if successful, \c NULL otherwise.
+ * @see fifo_buffer_t
+ */
+fifo_buffer_t *fifo_new_spsc(size_t len);
+
+/**
+ * Initializes an existing FIFO queue as a lock-free
+ * single-producer, single-consumer queue of at least \c len bytes.
+ * Must be freed with \c fifo_deinitialize.
+ *
+ * @param buf Pointer to the FIFO queue to initialize.
+ * @param len The size of the FIFO queue, in bytes.
+ * Rounded up to the next power of 2.
+ * @return \c true if \c buf was initialized,
+ * \c false if \c buf is \c NULL, \c len is 0 or too large,
+ * or there was an error.
+ * @see fifo_buffer_t
+ */
+bool fifo_initialize_spsc(fifo_buffer_t *buf, size_t len);
+
 /**
  * Resets the bounds of \c buffer,
  * effectively clearing it.
@@ -121,11 +207,39 @@ static INLINE void fifo_clear(fifo_buffer_t *buffer)
 {
    buffer->first = 0;
    buffer->end   = 0;
+   /* Callable only while neither side of an SPSC queue is active */
+   retro_atomic_size_init(&buffer->head, 0);
+   retro_atomic_size_init(&buffer->tail, 0);
 }
 
+/**
+ * Returns the available data in \c buffer for reading.
+ *
+ * Works for every queue.  On an SPSC queue,
+ * call it only from the consumer thread.
+ *
+ * @param buffer The FIFO queue to check.
+ * @return The number of bytes available for reading from \c buffer.
+ */
+size_t fifo_read_avail(const fifo_buffer_t *buffer);
+
+/**
+ * Returns the available space in \c buffer for writing.
+ *
+ * Works for every queue.  On an SPSC queue,
+ * call it only from the producer thread.
+ *
+ * @param buffer The FIFO queue to check.
+ * @return The number of bytes that \c buffer can accept.
+ */
+size_t fifo_write_avail(const fifo_buffer_t *buffer);
+
 /**
  * Writes \c size bytes to the given queue.
  *
+ * The caller checks that there is room first.
+ * Bytes that don't fit are dropped.
+ *
  * @param buffer The FIFO queue to write to.
  * @param in_buf The buffer to read bytes from.
  * @param size The length of \c in_buf, in bytes.
@@ -142,6 +256,54 @@ void fifo_write(fifo_buffer_t *buffer, const void *in_buf, size_t len);
  */
 void fifo_read(fifo_buffer_t *buffer, void *in_buf, size_t len);
 
+/**
+ * Exposes up to \c want bytes of free space in \c buffer
+ * for the producer to fill in place.
+ *
+ * Nothing becomes readable until \c fifo_write_commit.
+ * Reserving again without committing returns the same region.
+ *
+ * @param buffer The FIFO queue to write to.
+ * @param want The number of bytes the producer would like to write.
+ * @param spans Receives the writable region.
+ * @return The number of bytes reserved, at most \c want;
+ * equal to <tt>spans->len[0] + spans->len[1]</tt>.
+ */
+size_t fifo_write_reserve(fifo_buffer_t *buffer, size_t want,
+      fifo_spans_t *spans);
+
+/**
+ * Makes \c len bytes from the start of the last reservation readable.
+ *
+ * @param buffer The FIFO queue to write to.
+ * @param len The number of bytes filled in;
+ * must not exceed the amount reserved.
+ */
+void fifo_write_commit(fifo_buffer_t *buffer, size_t len);
+
+/**
+ * Exposes up to \c want bytes of queued data in \c buffer in place.
+ *
+ * The data stays queued, and valid, until \c fifo_read_release.
+ *
+ * @param buffer The FIFO queue to read from.
+ * @param want The number of bytes the consumer would like to see.
+ * @param spans Receives the readable region.
+ * @return The number of bytes exposed, at most \c want.
+ */
+size_t fifo_read_peek(fifo_buffer_t *buffer, size_t want,
+      fifo_spans_t *spans);
+
+/**
+ * Frees \c len bytes from the start of the queued data
+ * for the producer to reuse.
+ *
+ * @param buffer The FIFO queue to read from.
+ * @param len The number of bytes consumed;
+ * must not exceed the amount available.
+ */
+void fifo_read_release(fifo_buffer_t *buffer, size_t len);
+
 /**
  * Releases \c buffer and its contents.
  *
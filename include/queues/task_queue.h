@@ -53,6 +53,37 @@ enum task_style
    TASK_STYLE_NEGATIVE
 };
 
+/**
+ * Upper bound on worker threads in threaded mode.
+ * Emscripten and 3DS keep the single worker they always had.
+ */
+#ifndef TASK_QUEUE_MAX_WORKERS
+#if defined(EMSCRIPTEN) || defined(_3DS)
+#define TASK_QUEUE_MAX_WORKERS 1
+#else
+#define TASK_QUEUE_MAX_WORKERS 8
+#endif
+#endif
+
+/**
+ * Scheduling class of a task in threaded mode.
+ * Ignored when the task queue is not threaded.
+ */
+enum task_priority
+{
+   /**
+    * Work the user is waiting on (thumbnails, menu actions).
+    * Runs before any background task and always has a worker available.
+    */
+   TASK_PRIORITY_INTERACTIVE = 0,
+
+   /**
+    * Long-running bulk work (decompression, scans, downloads).
+    * Never occupies every worker, so it cannot hold up interactive tasks.
+    */
+   TASK_PRIORITY_BACKGROUND
+};
+
 typedef struct retro_task retro_task_t;
 
 /** @copydoc retro_task::callback */
@@ -63,6 +94,13 @@ typedef void (*retro_task_callback_t)(retro_task_t *task,
 /** @copydoc retro_task::handler */
 typedef void (*retro_task_handler_t)(retro_task_t *task);
 
+/**
+ * Body of a coroutine task, run once from start to finish
+ * on the task's own stack.
+ * @see task_init_coroutine
+ */
+typedef void (*retro_task_body_t)(retro_task_t *task);
+
 /** @copydoc task_finder_data::func */
 typedef bool (*retro_task_finder_t)(retro_task_t *task,
       void *userdata);
@@ -262,6 +300,19 @@ struct retro_task
     */
    retro_task_t *next;
 
+   /**
+    * @private Pointer to the next task waiting for a worker thread.
+    * Do not touch this; it is managed by the task system.
+    */
+   retro_task_t *ready_next;
+
+   /**
+    * @private State of a coroutine task, or \c NULL.
+    * Do not touch this; it is managed by the task system.
+    * @see task_init_coroutine
+    */
+   void *coroutine;
+
    /**
     * Indicates the current progress of the task.
     *
@@ -287,6 +338,13 @@ struct retro_task
    enum task_type type;
    enum task_style style;
 
+   /**
+    * Which class of worker time this task competes for in threaded mode.
+    * Set by the caller before the task is pushed;
+    * defaults to \c TASK_PRIORITY_INTERACTIVE.
+    */
+   enum task_priority priority;
+
    uint8_t flags;
 };
 
@@ -703,10 +761,18 @@ void task_queue_deinit(void);
  * Must be called before any other task_queue_* function,
  * and must only be called from the main thread.
  *
- * @param threaded \c true if tasks should run on a separate thread,
+ * @param threaded \c true if tasks should run on worker threads,
  * \c false if they should remain on the calling thread.
- * All tasks run in sequence on a single thread.
- * If you want to scale a task to multiple threads,
+ * In threaded mode there is one worker per CPU core,
+ * at least two, capped at \c TASK_QUEUE_MAX_WORKERS,
+ * so different tasks may run at the same time;
+ * a single task's \c handler is never called concurrently with itself.
+ * Interactive tasks are picked before background ones
+ * (see \c task_priority).
+ * Workers are named "task_queue" and run as
+ * \c STHREAD_SCHED_BACKGROUND, so they yield the CPU to the
+ * audio, video and emulation threads.
+ * If you want to scale a single task to multiple threads,
  * you must do so within the task itself.
  * @param msg_push The task system will call this function to output messages.
  * If \c NULL, no messages will be output.
@@ -729,6 +795,54 @@ void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push);
  */
 retro_task_t *task_init(void);
 
+/**
+ * Default stack size in bytes for \c task_init_coroutine.
+ */
+#ifndef TASK_COROUTINE_STACK_SIZE
+#define TASK_COROUTINE_STACK_SIZE (64 * 1024)
+#endif
+
+/**
+ * Allocates a task whose work is written as straight-line code.
+ *
+ * Instead of a \c handler that the queue calls again and again,
+ * \c body runs once on its own libco cothread and calls \c task_yield
+ * at natural points, such as after each chunk of I/O.
+ * Each yield returns to the queue, which runs other tasks
+ * and later resumes \c body where it left off.
+ * The task is finished when \c body returns,
+ * or when it sets \c RETRO_TASK_FLG_FINISHED and yields.
+ *
+ * Coroutine tasks take turns on a single lock, because libco keeps
+ * one active context per process unless it is built with \c LIBCO_MP;
+ * ordinary tasks still run in parallel with them.
+ * A body must therefore never block waiting on another coroutine task.
+ *
+ * Requires \c HAVE_LIBCO. Without it, \c body runs to completion
+ * in a single handler call and \c task_yield does nothing.
+ *
+ * Set the other fields (callback, title, priority...) as for
+ * \c task_init, but do not replace \c handler.
+ *
+ * @param body Function to run. Must not be \c NULL.
+ * @param stack_size Stack size in bytes,
+ * or 0 for \c TASK_COROUTINE_STACK_SIZE.
+ * @returns Pointer to a newly allocated task,
+ * or \c NULL if allocation fails.
+ */
+retro_task_t *task_init_coroutine(retro_task_body_t body,
+      unsigned stack_size);
+
+/**
+ * Suspends the calling coroutine task's \c body
+ * until the queue runs the task again.
+ *
+ * Does nothing when not called from a coroutine task's body.
+ *
+ * @see task_init_coroutine
+ */
+void task_yield(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -31,17 +31,22 @@
  * This header consolidates the ad-hoc atomic shims previously duplicated
  * in audio/drivers/{coreaudio,coreaudio3,xaudio,opensl}.c, audio/common/
  * mmdevice_common.c and gfx/gfx_thumbnail.c.  The surface is intentionally
- * narrow: load, store, fetch_add, fetch_sub, fetch_or, fetch_and, plus
- * inc/dec convenience wrappers.  Everything is on plain machine words
- * (int and size_t); no compare-exchange, no double-word ops, no
- * thread-fences.  Add only when a real caller needs it.
+ * narrow: load, store, fetch_add, fetch_sub, fetch_or, fetch_and, a
+ * strong compare-exchange, plus inc/dec convenience wrappers and a
+ * futex-style wait/notify on int (implemented in rthreads).
+ * Everything is on plain machine words (int and size_t); no double-word
+ * ops, no thread-fences.  Add only when a real caller needs it.
+ *
+ * compare-exchange was added for retro_mpmc.h, whose producers and
+ * consumers claim slots by swinging a shared cursor; that cannot be
+ * expressed with fetch_add alone without giving up the non-blocking
+ * "queue full / queue empty" answer.
  *
  * fetch_or / fetch_and are int-width only, deliberately.  They exist for
  * flag words, which are 32-bit everywhere in the tree, and the Apple
  * OSAtomic backend has no 64-bit bitwise primitive -- a _size variant
- * could not be implemented there without a compare-exchange loop, which
- * this header does not provide.  Rather than ship a size variant that is
- * unavailable on one backend, the operation is simply not offered.
+ * could only be built there as a retro_atomic_cas_size loop.  No caller
+ * needs one, so the operation is simply not offered.
  *
  * Memory ordering is fixed per-operation rather than parameterised, to
  * keep the call sites readable and to avoid having to invent ordering
@@ -53,6 +58,9 @@
  *   retro_atomic_fetch_sub      - acq_rel RMW
  *   retro_atomic_fetch_or       - acq_rel RMW, int only, returns old value
  *   retro_atomic_fetch_and      - acq_rel RMW, int only, returns old value
+ *   retro_atomic_cas_int,
+ *   retro_atomic_cas_size       - acq_rel RMW, returns nonzero if *p
+ *                                 held @expected and now holds @desired
  *   retro_atomic_inc / dec      - acq_rel RMW, return void
  *
  * Backend selection (in order):
@@ -343,13 +351,15 @@
 #endif
 #endif
 
-/* The header contains only macros and integer typedefs; there are no
- * function declarations and therefore no need for RETRO_BEGIN_DECLS
- * around the file.  The C++11 backend below #includes <atomic>, whose
- * templates cannot be declared with C linkage; if a caller wraps its
- * #include of this header in extern "C" { ... } (e.g. ui_qt.cpp under
- * !CXX_BUILD), libstdc++ <atomic> emits dozens of "template with C
- * linkage" errors.  RETRO_BEGIN_DECLS_CXX below escapes that. */
+/* The backends below define only macros, typedefs and static INLINE
+ * helpers, which have internal linkage and need no RETRO_BEGIN_DECLS.
+ * The one set of extern functions, wait/notify at the end of the file,
+ * is wrapped on its own.  The file as a whole is not: the C++11 backend
+ * #includes <atomic>, whose templates cannot be declared with C
+ * linkage; if a caller wraps its #include of this header in
+ * extern "C" { ... } (e.g. ui_qt.cpp under !CXX_BUILD), libstdc++
+ * <atomic> emits dozens of "template with C linkage" errors.
+ * RETRO_BEGIN_DECLS_CXX below escapes that. */
 
 /* ---- C11 <stdatomic.h> ------------------------------------------------- */
 #if defined(RETRO_ATOMIC_BACKEND_C11)
@@ -386,6 +396,28 @@ typedef atomic_size_t retro_atomic_size_t;
 #define retro_atomic_fetch_sub_size(p, v) \
    atomic_fetch_sub_explicit((p), (v), memory_order_acq_rel)
 
+/* compare_exchange writes the observed value back through @expected,
+ * which must be an lvalue; the helpers keep the macro form usable
+ * with rvalue arguments. */
+static INLINE int retro_atomic_cas_int_c11(retro_atomic_int_t *p,
+      int expected, int desired)
+{
+   return atomic_compare_exchange_strong_explicit(p, &expected, desired,
+         memory_order_acq_rel, memory_order_acquire);
+}
+
+static INLINE int retro_atomic_cas_size_c11(retro_atomic_size_t *p,
+      size_t expected, size_t desired)
+{
+   return atomic_compare_exchange_strong_explicit(p, &expected, desired,
+         memory_order_acq_rel, memory_order_acquire);
+}
+
+#define retro_atomic_cas_int(p, e, d) \
+   retro_atomic_cas_int_c11((p), (e), (d))
+#define retro_atomic_cas_size(p, e, d) \
+   retro_atomic_cas_size_c11((p), (e), (d))
+
 /* ---- C++11 <atomic> --------------------------------------------------- */
 #elif defined(RETRO_ATOMIC_BACKEND_CXX11)
 
@@ -443,6 +475,25 @@ typedef std::atomic<std::size_t> retro_atomic_size_t;
 #define retro_atomic_fetch_sub_size(p, v) \
    std::atomic_fetch_sub_explicit((p), (std::size_t)(v), std::memory_order_acq_rel)
 
+static INLINE int retro_atomic_cas_int_cxx11(retro_atomic_int_t *p,
+      int expected, int desired)
+{
+   return std::atomic_compare_exchange_strong_explicit(p, &expected,
+         desired, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+static INLINE int retro_atomic_cas_size_cxx11(retro_atomic_size_t *p,
+      std::size_t expected, std::size_t desired)
+{
+   return std::atomic_compare_exchange_strong_explicit(p, &expected,
+         desired, std::memory_order_acq_rel, std::memory_order_acquire);
+}
+
+#define retro_atomic_cas_int(p, e, d) \
+   retro_atomic_cas_int_cxx11((p), (int)(e), (int)(d))
+#define retro_atomic_cas_size(p, e, d) \
+   retro_atomic_cas_size_cxx11((p), (std::size_t)(e), (std::size_t)(d))
+
 /* ---- GCC __atomic_* (4.7+) / Clang ------------------------------------ */
 #elif defined(RETRO_ATOMIC_BACKEND_GCC_NEW)
 
@@ -477,6 +528,25 @@ typedef size_t retro_atomic_size_t;
 #define retro_atomic_fetch_sub_size(p, v) \
    __atomic_fetch_sub((p), (v), __ATOMIC_ACQ_REL)
 
+static INLINE int retro_atomic_cas_int_gcc(retro_atomic_int_t *p,
+      int expected, int desired)
+{
+   return __atomic_compare_exchange_n(p, &expected, desired, 0,
+         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static INLINE int retro_atomic_cas_size_gcc(retro_atomic_size_t *p,
+      size_t expected, size_t desired)
+{
+   return __atomic_compare_exchange_n(p, &expected, desired, 0,
+         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#define retro_atomic_cas_int(p, e, d) \
+   retro_atomic_cas_int_gcc((p), (e), (d))
+#define retro_atomic_cas_size(p, e, d) \
+   retro_atomic_cas_size_gcc((p), (e), (d))
+
 /* ---- MSVC Interlocked* (Win32 API, works back to VS2003 / Xbox 360) ---- */
 #elif defined(RETRO_ATOMIC_BACKEND_MSVC)
 
@@ -638,6 +708,40 @@ static INLINE LONG retro_atomic_fetch_and_int_cas(LONG volatile *p, LONG v)
    (size_t)InterlockedExchangeAdd((LONG volatile*)(p), -(LONG)(v)) )
 #endif
 
+/* compare-exchange is bracketed on both sides on ARM: the plain form
+ * has no barrier there, and a failed exchange must still acquire. */
+static INLINE int retro_atomic_cas_int_msvc(LONG volatile *p,
+      LONG expected, LONG desired)
+{
+   LONG prev;
+   RETRO_ATOMIC_MSVC_ARM_FENCE();
+   prev = InterlockedCompareExchange(p, desired, expected);
+   RETRO_ATOMIC_MSVC_ARM_FENCE();
+   return prev == expected;
+}
+
+static INLINE int retro_atomic_cas_size_msvc(LONG_PTR volatile *p,
+      LONG_PTR expected, LONG_PTR desired)
+{
+   LONG_PTR prev;
+   RETRO_ATOMIC_MSVC_ARM_FENCE();
+#if defined(_WIN64)
+   prev = (LONG_PTR)InterlockedCompareExchange64(
+         (LONGLONG volatile*)p, (LONGLONG)desired, (LONGLONG)expected);
+#else
+   prev = (LONG_PTR)InterlockedCompareExchange(
+         (LONG volatile*)p, (LONG)desired, (LONG)expected);
+#endif
+   RETRO_ATOMIC_MSVC_ARM_FENCE();
+   return prev == expected;
+}
+
+#define retro_atomic_cas_int(p, e, d) \
+   retro_atomic_cas_int_msvc((LONG volatile*)(p), (LONG)(e), (LONG)(d))
+#define retro_atomic_cas_size(p, e, d) \
+   retro_atomic_cas_size_msvc((LONG_PTR volatile*)(p), \
+         (LONG_PTR)(e), (LONG_PTR)(d))
+
 /* ---- Apple OSAtomic (deprecated but available pre-10.7) --------------- */
 #elif defined(RETRO_ATOMIC_BACKEND_APPLE)
 
@@ -688,6 +792,18 @@ typedef volatile intptr_t retro_atomic_size_t;
    ((size_t)(OSAtomicAdd32Barrier(-(int32_t)(v), (volatile int32_t*)(p)) + (int32_t)(v)))
 #endif
 
+#define retro_atomic_cas_int(p, e, d) \
+   ((int)OSAtomicCompareAndSwap32Barrier((int32_t)(e), (int32_t)(d), (p)))
+#if defined(__LP64__)
+#define retro_atomic_cas_size(p, e, d) \
+   ((int)OSAtomicCompareAndSwap64Barrier((int64_t)(e), (int64_t)(d), \
+         (volatile int64_t*)(p)))
+#else
+#define retro_atomic_cas_size(p, e, d) \
+   ((int)OSAtomicCompareAndSwap32Barrier((int32_t)(e), (int32_t)(d), \
+         (volatile int32_t*)(p)))
+#endif
+
 /* ---- GCC __sync_* (legacy, 4.1-4.6) ----------------------------------- */
 #elif defined(RETRO_ATOMIC_BACKEND_SYNC)
 
@@ -725,6 +841,11 @@ typedef volatile size_t retro_atomic_size_t;
 #define retro_atomic_fetch_sub_size(p, v) \
    __sync_fetch_and_sub((p), (v))
 
+#define retro_atomic_cas_int(p, e, d) \
+   ((int)__sync_bool_compare_and_swap((p), (e), (d)))
+#define retro_atomic_cas_size(p, e, d) \
+   ((int)__sync_bool_compare_and_swap((p), (size_t)(e), (size_t)(d)))
+
 /* ---- Volatile fallback ------------------------------------------------- */
 #else /* RETRO_ATOMIC_BACKEND_VOLATILE */
 
@@ -767,6 +888,27 @@ static INLINE int retro_atomic_fetch_and_int_fb(retro_atomic_int_t *p, int v)
 #define retro_atomic_fetch_add_size(p, v)        ((*(p) += (v)) - (v))
 #define retro_atomic_fetch_sub_size(p, v)        ((*(p) -= (v)) + (v))
 
+#define retro_atomic_cas_int(p, e, d)  retro_atomic_cas_int_fb((p), (e), (d))
+#define retro_atomic_cas_size(p, e, d) retro_atomic_cas_size_fb((p), (e), (d))
+
+static INLINE int retro_atomic_cas_int_fb(retro_atomic_int_t *p,
+      int expected, int desired)
+{
+   if (*p != expected)
+      return 0;
+   *p = desired;
+   return 1;
+}
+
+static INLINE int retro_atomic_cas_size_fb(retro_atomic_size_t *p,
+      size_t expected, size_t desired)
+{
+   if (*p != expected)
+      return 0;
+   *p = desired;
+   return 1;
+}
+
 #endif /* backend selection */
 
 /* ---- Convenience wrappers (backend-agnostic) -------------------------- */
@@ -776,4 +918,40 @@ static INLINE int retro_atomic_fetch_and_int_fb(retro_atomic_int_t *p, int v)
 #define retro_atomic_inc_size(p)   ((void)retro_atomic_fetch_add_size((p), 1))
 #define retro_atomic_dec_size(p)   ((void)retro_atomic_fetch_sub_size((p), 1))
 
+/* ---- Wait / notify ------------------------------------------------------
+ *
+ * Block until an int changes, without a mutex or condition variable
+ * (the C++20 atomic::wait / notify shape).  These need the OS, so they
+ * are implemented in rthreads/rthreads.c and only available when that
+ * file is built (HAVE_THREADS).  Linux uses futex(2) directly; other
+ * targets park on a small hashed table of slock_t / scond_t pairs.
+ *
+ * retro_atomic_wait_int:
+ *   If *p still equals @expected, sleep until a notify on @p or until
+ *   @timeout_us microseconds pass (negative waits forever).  Returns 0
+ *   on timeout, nonzero otherwise.  Wakeups can be spurious: always
+ *   re-check the value in a loop.
+ *
+ * retro_atomic_notify_one_int / retro_atomic_notify_all_int:
+ *   Wake one / all threads waiting on @p.  Store the new value first.
+ *   notify_one may wake more than one thread on the fallback.
+ *
+ *   while (retro_atomic_load_acquire_int(&ready) == 0)
+ *      retro_atomic_wait_int(&ready, 0, -1);
+ *   ...
+ *   retro_atomic_store_release_int(&ready, 1);
+ *   retro_atomic_notify_all_int(&ready);
+ */
+#include <stdint.h>
+
+/* Implemented in C, so C linkage even from C++ callers */
+RETRO_BEGIN_DECLS
+
+int  retro_atomic_wait_int(retro_atomic_int_t *p, int expected,
+      int64_t timeout_us);
+void retro_atomic_notify_one_int(retro_atomic_int_t *p);
+void retro_atomic_notify_all_int(retro_atomic_int_t *p);
+
+RETRO_END_DECLS
+
 #endif /* __LIBRETRO_SDK_ATOMIC_H */
@@ -0,0 +1,214 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_mpmc.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_MPMC_H
+#define __LIBRETRO_SDK_MPMC_H
+
+/*
+ * retro_mpmc.h - portable bounded multi-producer / multi-consumer queue
+ *
+ * Lock-free queue of fixed-size elements, safe for any number of
+ * producer and consumer threads.  This is Dmitry Vyukov's bounded
+ * MPMC design: every slot carries a sequence number that tells a
+ * thread whether the slot is ready to be written (seq == pos) or
+ * read (seq == pos + 1) for the lap it is on.  A thread claims a
+ * position by compare-exchanging the shared cursor, copies the
+ * element, then hands the slot over by release-storing the slot's
+ * sequence number.
+ *
+ * Constraints:
+ *   - Capacity is a number of elements and must be a power of 2.
+ *     Init rounds up; the minimum is 2.
+ *   - Every element is exactly elem_size bytes, copied in and out
+ *     with memcpy.  To queue larger or variable-sized objects, queue
+ *     pointers to them.
+ *   - push and pop never block and never spin waiting for another
+ *     thread: they return false when the queue is full or empty.
+ *     A producer that loses a race for a slot simply retries on the
+ *     next position.
+ *   - Not linearizable for a thread that stalls between claiming a
+ *     slot and publishing it: a consumer reaching that slot reports
+ *     "empty" even if later slots are already filled.  Consumers
+ *     that must drain a queue should keep polling until they know
+ *     all producers have finished.
+ *
+ * Memory model:
+ *   - Producer acquire-loads a slot's sequence, claims the slot with
+ *     an acq_rel compare-exchange on head, writes the element
+ *     (non-atomic stores), then release-stores seq = pos + 1.
+ *   - Consumer acquire-loads the same sequence (seeing the element
+ *     writes), claims with a compare-exchange on tail, reads the
+ *     element, then release-stores seq = pos + capacity so that the
+ *     producer on the next lap can reuse the slot.
+ *   - Requires a real backend (RETRO_ATOMIC_LOCK_FREE).  On the
+ *     volatile fallback the compare-exchange is not atomic and the
+ *     queue is only usable from a single thread.
+ *
+ * Cache behaviour:
+ *   - head (producers) and tail (consumers) each own a cache line,
+ *     padded to RETRO_MPMC_CACHE_LINE, so producers hammering head do
+ *     not invalidate the consumers' cursor and vice versa.  Slots are
+ *     not padded: neighbouring slots are normally touched by
+ *     different threads only briefly, and padding every slot would
+ *     multiply the footprint of small elements.
+ *
+ * Lifetime:
+ *   - Same as retro_spsc: the caller owns the retro_mpmc_t struct,
+ *     init/free/clear are not thread-safe and must run while no other
+ *     thread uses the queue.
+ *
+ * Example:
+ *
+ *   retro_mpmc_t q;
+ *   retro_mpmc_init(&q, 1024, sizeof(struct job*));
+ *
+ *   // Any producer thread:
+ *   struct job *job = ...;
+ *   while (!retro_mpmc_push(&q, &job))
+ *      retro_sleep(0);
+ *
+ *   // Any consumer thread:
+ *   struct job *job;
+ *   if (retro_mpmc_pop(&q, &job))
+ *      run(job);
+ *
+ *   retro_mpmc_free(&q);
+ *
+ * Comparison with the other queues:
+ *   - retro_spsc is cheaper (no RMW on the hot path) when there is
+ *     exactly one producer and one consumer; prefer it then.
+ *   - slock_t + scond_t queues (tpool, task_queue) can block a
+ *     consumer until work arrives.  retro_mpmc has no wait primitive;
+ *     pair it with a semaphore or condition variable when consumers
+ *     need to sleep.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+#include <retro_atomic.h>
+
+RETRO_BEGIN_DECLS
+
+/* Cache-line padding size; see RETRO_SPSC_CACHE_LINE for the
+ * reasoning behind 64. */
+#ifndef RETRO_MPMC_CACHE_LINE
+#define RETRO_MPMC_CACHE_LINE 64
+#endif
+
+#define RETRO_MPMC_PAD0_BYTES \
+   ((RETRO_MPMC_CACHE_LINE > (sizeof(uint8_t*) + 3 * sizeof(size_t))) \
+      ? (RETRO_MPMC_CACHE_LINE - (sizeof(uint8_t*) + 3 * sizeof(size_t))) \
+      : 1)
+#define RETRO_MPMC_PAD1_BYTES \
+   ((RETRO_MPMC_CACHE_LINE > sizeof(retro_atomic_size_t)) \
+      ? (RETRO_MPMC_CACHE_LINE - sizeof(retro_atomic_size_t)) \
+      : 1)
+
+typedef struct retro_mpmc
+{
+   uint8_t            *slots;
+   size_t              capacity;   /* elements, power of 2 */
+   size_t              elem_size;  /* bytes per element */
+   size_t              stride;     /* bytes per slot, sequence included */
+   uint8_t             _pad0[RETRO_MPMC_PAD0_BYTES];
+   retro_atomic_size_t head;       /* next position producers claim */
+   uint8_t             _pad1[RETRO_MPMC_PAD1_BYTES];
+   retro_atomic_size_t tail;       /* next position consumers claim */
+   /* Keep whatever follows the struct off the tail's line */
+   uint8_t             _pad2[RETRO_MPMC_PAD1_BYTES];
+} retro_mpmc_t;
+
+/**
+ * retro_mpmc_init:
+ * @q             : The queue.
+ * @min_capacity  : Requested capacity in elements.  Rounded up to the
+ *                  next power of 2, minimum 2.
+ * @elem_size     : Size of one element in bytes.  Must be > 0.
+ *
+ * Allocates the slots and sets up their sequence numbers.  The queue
+ * starts empty.
+ *
+ * Returns: true on success, false on allocation failure or invalid
+ * arguments.
+ */
+bool retro_mpmc_init(retro_mpmc_t *q, size_t min_capacity,
+      size_t elem_size);
+
+/**
+ * retro_mpmc_free:
+ * @q : The queue.
+ *
+ * Releases the slots.  Caller must ensure no thread is still using
+ * @q.  Safe to call on a queue that retro_mpmc_init failed on.
+ */
+void retro_mpmc_free(retro_mpmc_t *q);
+
+/**
+ * retro_mpmc_clear:
+ * @q : The queue.
+ *
+ * Discards all queued elements.  Callable only while no producer or
+ * consumer is active, like retro_spsc_clear.
+ */
+void retro_mpmc_clear(retro_mpmc_t *q);
+
+/**
+ * retro_mpmc_push:
+ * @q    : The queue.
+ * @elem : Pointer to elem_size bytes to enqueue.
+ *
+ * Returns: true if the element was queued, false if the queue was
+ * full.
+ *
+ * SAFETY: callable from any number of threads concurrently.
+ */
+bool retro_mpmc_push(retro_mpmc_t *q, const void *elem);
+
+/**
+ * retro_mpmc_pop:
+ * @q    : The queue.
+ * @elem : Destination for elem_size bytes.
+ *
+ * Returns: true if an element was dequeued into @elem, false if the
+ * queue was empty.
+ *
+ * SAFETY: callable from any number of threads concurrently.
+ */
+bool retro_mpmc_pop(retro_mpmc_t *q, void *elem);
+
+/**
+ * retro_mpmc_count:
+ * @q : The queue.
+ *
+ * Returns: number of elements queued, in [0, capacity].  Only a
+ * snapshot when other threads are pushing or popping; use it for
+ * statistics and heuristics, not for deciding whether a push or pop
+ * will succeed.
+ */
+size_t retro_mpmc_count(const retro_mpmc_t *q);
+
+RETRO_END_DECLS
+
+#endif /* __LIBRETRO_SDK_MPMC_H */
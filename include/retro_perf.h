@@ -0,0 +1,213 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_perf.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_PERF_H
+#define __LIBRETRO_SDK_PERF_H
+
+/*
+ * retro_perf.h - named hot-path timers and counters
+ *
+ * A registry of named timers and counters that instrumented code
+ * updates without locks and that can be dumped as JSON:
+ *
+ *   RETRO_PERF_TIMER(perf_decode, "rpng.decode");
+ *   RETRO_PERF_COUNTER(perf_bytes, "rpng.bytes");
+ *
+ *   void decode(...)
+ *   {
+ *      RETRO_PERF_BEGIN(perf_decode);
+ *      ...
+ *      RETRO_PERF_ADD(perf_bytes, len);
+ *      RETRO_PERF_END(perf_decode);
+ *   }
+ *
+ * Everything is compiled out unless HAVE_RETRO_PERF is defined: the
+ * macros expand to nothing, the query functions to stubs, and
+ * retro_perf.c to an empty translation unit.
+ *
+ * Timers:
+ *   - BEGIN/END pairs nest; each thread keeps a small stack of open
+ *     scopes, so an END always closes the innermost BEGIN.  An END
+ *     that does not match the innermost scope is dropped.  A scope
+ *     must begin and end on the same thread and must not be left open
+ *     across a coroutine switch such as task_yield().
+ *   - Durations are read from cpu_features_get_perf_counter() and
+ *     filed into a log2 histogram of ticks.  Ticks are converted to
+ *     nanoseconds on export, against cpu_features_get_time_usec().
+ *   - Statistics report calls, total, mean, p50, p99 and max.  p50
+ *     and p99 are the upper bound of the histogram bucket they fall
+ *     in, so they are accurate to within a factor of 2.
+ *
+ * Counters:
+ *   - RETRO_PERF_ADD sums a value (bytes, frames, tasks...) and
+ *     counts the calls.
+ *
+ * Threads:
+ *   - Each thread accumulates into its own block, found through a
+ *     thread-local pointer, with plain stores: there is no shared
+ *     cache line and no atomic on the hot path.  Blocks are merged on
+ *     export.  A thread's block is claimed on its first timer or
+ *     counter.  Up to RETRO_PERF_MAX_THREADS threads record at once;
+ *     a thread that finds every block taken is ignored.
+ *   - With HAVE_THREAD_STORAGE on pthreads, a thread's block is
+ *     folded into a shared total when the thread exits and handed to
+ *     the next thread, so results of finished workers still show
+ *     up.  Elsewhere a block stays with its thread for good.
+ *   - Export reads other threads' blocks while they may be updating
+ *     them, so figures taken while instrumented code runs can be a
+ *     few updates stale.  They are exact once those threads are idle.
+ *   - Each counter is registered on first use, under a spinlock that
+ *     is only taken once per call site.  Sites that use the same name
+ *     share an entry.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+#include <retro_inline.h>
+
+#ifdef HAVE_RETRO_PERF
+#include <retro_atomic.h>
+#endif
+
+RETRO_BEGIN_DECLS
+
+struct rjsonwriter;
+
+enum retro_perf_type
+{
+   RETRO_PERF_TYPE_TIMER = 0,
+   RETRO_PERF_TYPE_COUNTER
+};
+
+typedef struct retro_perf_stats
+{
+   const char          *name;
+   enum retro_perf_type type;
+   uint64_t             calls;   /* completed scopes, or RETRO_PERF_ADD calls */
+   uint64_t             value;   /* counters: sum of the added values */
+   uint64_t             total_ns;
+   uint64_t             mean_ns;
+   uint64_t             p50_ns;
+   uint64_t             p99_ns;
+   uint64_t             max_ns;
+   unsigned             threads; /* threads that recorded at least once */
+} retro_perf_stats_t;
+
+#ifdef HAVE_RETRO_PERF
+
+/* Registry sizes; override on the command line if needed */
+#ifndef RETRO_PERF_MAX_COUNTERS
+#define RETRO_PERF_MAX_COUNTERS 64
+#endif
+#ifndef RETRO_PERF_MAX_THREADS
+#define RETRO_PERF_MAX_THREADS 32
+#endif
+#ifndef RETRO_PERF_MAX_DEPTH
+#define RETRO_PERF_MAX_DEPTH 16
+#endif
+
+/* Durations of 2^i to 2^(i+1)-1 ticks land in bucket i */
+#define RETRO_PERF_HISTOGRAM_BUCKETS 40
+
+/* One per call site, declared with RETRO_PERF_TIMER/COUNTER */
+typedef struct retro_perf_site
+{
+   const char          *name;
+   enum retro_perf_type type;
+   retro_atomic_int_t   id;   /* registry index + 1, 0 until first use */
+} retro_perf_site_t;
+
+#define RETRO_PERF_TIMER(var, name) \
+   static retro_perf_site_t var = \
+      { name, RETRO_PERF_TYPE_TIMER, RETRO_ATOMIC_INT_INITIALIZER(0) }
+#define RETRO_PERF_COUNTER(var, name) \
+   static retro_perf_site_t var = \
+      { name, RETRO_PERF_TYPE_COUNTER, RETRO_ATOMIC_INT_INITIALIZER(0) }
+
+#define RETRO_PERF_BEGIN(var)  retro_perf_begin(&(var))
+#define RETRO_PERF_END(var)    retro_perf_end(&(var))
+#define RETRO_PERF_ADD(var, n) retro_perf_add(&(var), (uint64_t)(n))
+
+void retro_perf_begin(retro_perf_site_t *counter);
+void retro_perf_end(retro_perf_site_t *counter);
+void retro_perf_add(retro_perf_site_t *counter, uint64_t value);
+
+/**
+ * retro_perf_get_stats:
+ * @name  : Name a timer or counter was declared with.
+ * @stats : Filled with the totals over all threads.
+ *
+ * Returns: true if @name has been used at least once.
+ */
+bool retro_perf_get_stats(const char *name, retro_perf_stats_t *stats);
+
+/**
+ * retro_perf_write_json:
+ * @writer : Writer to append to.
+ *
+ * Writes one JSON object holding the clock calibration and an array
+ * with the statistics of every registered timer and counter, in
+ * registration order.
+ *
+ * Returns: false if @writer is NULL.
+ */
+bool retro_perf_write_json(struct rjsonwriter *writer);
+
+/**
+ * retro_perf_reset:
+ *
+ * Zeroes the statistics of every thread.  Registrations are kept.
+ * Call only while no instrumented code runs, or figures recorded
+ * concurrently may survive the reset.
+ */
+void retro_perf_reset(void);
+
+#else
+
+#define RETRO_PERF_TIMER(var, name)   typedef int var##_retro_perf_unused
+#define RETRO_PERF_COUNTER(var, name) typedef int var##_retro_perf_unused
+#define RETRO_PERF_BEGIN(var)         ((void)0)
+#define RETRO_PERF_END(var)           ((void)0)
+#define RETRO_PERF_ADD(var, n)        ((void)0)
+
+static INLINE bool retro_perf_get_stats(const char *name,
+      retro_perf_stats_t *stats)
+{
+   (void)name;
+   (void)stats;
+   return false;
+}
+static INLINE bool retro_perf_write_json(struct rjsonwriter *writer)
+{
+   (void)writer;
+   return false;
+}
+static INLINE void retro_perf_reset(void) { }
+
+#endif
+
+RETRO_END_DECLS
+
+#endif /* __LIBRETRO_SDK_PERF_H */
@@ -93,6 +93,20 @@
  *     and (b) the lock contention in fifo_queue measurably matters.
  *   - For most code paths, fifo_queue is the better default.  This
  *     primitive is for hot paths where lock-free is a measured win.
+ *
+ * Zero-copy access:
+ *   - retro_spsc_write_reserve / retro_spsc_write_commit let the
+ *     producer decode straight into the ring, and retro_spsc_read_peek
+ *     / retro_spsc_read_release let the consumer use data in place.
+ *     A region that crosses the end of the buffer comes back as two
+ *     spans; the second one always starts at the beginning of the
+ *     buffer.
+ *
+ * Framed records:
+ *   - retro_spsc_record_* carries whole messages, each prefixed with
+ *     a native-endian uint32_t length.  A record is published all or
+ *     nothing, so the consumer never sees half a message.  Don't mix
+ *     record and raw byte calls on the same queue.
  */
 
 #include <stddef.h>
@@ -265,6 +279,166 @@ size_t retro_spsc_read(retro_spsc_t *q, void *data, size_t bytes);
  */
 size_t retro_spsc_peek(const retro_spsc_t *q, void *data, size_t bytes);
 
+/* A region of the ring.  len[1] is non-zero only when the region
+ * wraps past the end of the buffer, in which case ptr[1] is the start
+ * of the buffer. */
+typedef struct retro_spsc_spans
+{
+   uint8_t *ptr[2];
+   size_t   len[2];
+} retro_spsc_spans_t;
+
+/**
+ * retro_spsc_write_reserve:
+ * @q     : The queue.
+ * @want  : Number of bytes the producer would like to write.
+ * @spans : Receives the writable region.
+ *
+ * Exposes up to @want bytes of free space for the producer to fill in
+ * place.  Nothing becomes visible to the consumer until
+ * retro_spsc_write_commit.  Reserving again without committing
+ * returns the same region.
+ *
+ * Returns: bytes reserved, in [0, @want]; spans->len[0] + len[1]
+ * equals the return value.
+ *
+ * SAFETY: callable only from the producer thread.
+ */
+size_t retro_spsc_write_reserve(retro_spsc_t *q, size_t want,
+      retro_spsc_spans_t *spans);
+
+/**
+ * retro_spsc_write_commit:
+ * @q     : The queue.
+ * @bytes : Number of reserved bytes that were filled, from the start
+ *          of the reservation.  Must not exceed the amount reserved.
+ *
+ * Publishes @bytes of the reserved region to the consumer.
+ *
+ * SAFETY: callable only from the producer thread.
+ */
+void retro_spsc_write_commit(retro_spsc_t *q, size_t bytes);
+
+/**
+ * retro_spsc_read_peek:
+ * @q     : The queue.
+ * @want  : Number of bytes the consumer would like to see.
+ * @spans : Receives the readable region.
+ *
+ * Exposes up to @want bytes of queued data in place.  The data stays
+ * queued, and valid, until retro_spsc_read_release.
+ *
+ * Returns: bytes exposed, in [0, @want].
+ *
+ * SAFETY: callable only from the consumer thread.
+ */
+size_t retro_spsc_read_peek(retro_spsc_t *q, size_t want,
+      retro_spsc_spans_t *spans);
+
+/**
+ * retro_spsc_read_release:
+ * @q     : The queue.
+ * @bytes : Number of bytes consumed, from the start of the queued
+ *          data.  Must not exceed the amount available.
+ *
+ * Hands @bytes back to the producer.
+ *
+ * SAFETY: callable only from the consumer thread.
+ */
+void retro_spsc_read_release(retro_spsc_t *q, size_t bytes);
+
+/* Size of the length prefix in front of every record */
+#define RETRO_SPSC_RECORD_HEADER sizeof(uint32_t)
+
+/**
+ * retro_spsc_record_write:
+ * @q    : The queue.
+ * @data : Record payload.
+ * @len  : Payload size in bytes; may be 0.
+ *
+ * Queues one record.  Nothing is written unless the header and the
+ * whole payload fit.
+ *
+ * Returns: true if the record was queued, false if there is not
+ * enough room right now or the record can never fit (@len larger
+ * than capacity - RETRO_SPSC_RECORD_HEADER).
+ *
+ * SAFETY: callable only from the producer thread.
+ */
+bool retro_spsc_record_write(retro_spsc_t *q, const void *data, size_t len);
+
+/**
+ * retro_spsc_record_reserve:
+ * @q     : The queue.
+ * @len   : Largest payload the producer may write.
+ * @spans : Receives the payload region.
+ *
+ * Zero-copy form of retro_spsc_record_write.  Reserves room for the
+ * header and @len payload bytes.
+ *
+ * Returns: true if the room was available.
+ *
+ * SAFETY: callable only from the producer thread.
+ */
+bool retro_spsc_record_reserve(retro_spsc_t *q, size_t len,
+      retro_spsc_spans_t *spans);
+
+/**
+ * retro_spsc_record_commit:
+ * @q   : The queue.
+ * @len : Actual payload size, at most the @len passed to
+ *        retro_spsc_record_reserve.  Larger values are clamped to
+ *        it, so a record never carries bytes the producer was not
+ *        given.
+ *
+ * Writes the header and publishes the record.
+ *
+ * SAFETY: callable only from the producer thread.
+ */
+void retro_spsc_record_commit(retro_spsc_t *q, size_t len);
+
+/**
+ * retro_spsc_record_read:
+ * @q    : The queue.
+ * @data : Destination for the payload.
+ * @cap  : Size of @data.
+ * @len  : Receives the payload size of the next record.
+ *
+ * Dequeues the next record into @data.  If @cap is too small, the
+ * record stays queued and @len tells the caller how much room it
+ * needs.
+ *
+ * Returns: true if a record was dequeued.
+ *
+ * SAFETY: callable only from the consumer thread.
+ */
+bool retro_spsc_record_read(retro_spsc_t *q, void *data, size_t cap,
+      size_t *len);
+
+/**
+ * retro_spsc_record_peek:
+ * @q     : The queue.
+ * @spans : Receives the payload of the next record.
+ *
+ * Zero-copy form of retro_spsc_record_read.  The payload stays valid
+ * until retro_spsc_record_release.
+ *
+ * Returns: true if a complete record is queued.
+ *
+ * SAFETY: callable only from the consumer thread.
+ */
+bool retro_spsc_record_peek(retro_spsc_t *q, retro_spsc_spans_t *spans);
+
+/**
+ * retro_spsc_record_release:
+ * @q : The queue.
+ *
+ * Drops the record returned by the last retro_spsc_record_peek.
+ *
+ * SAFETY: callable only from the consumer thread.
+ */
+void retro_spsc_record_release(retro_spsc_t *q);
+
 RETRO_END_DECLS
 
 #endif /* __LIBRETRO_SDK_SPSC_H */
@@ -0,0 +1,190 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_trace.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_TRACE_H
+#define __LIBRETRO_SDK_TRACE_H
+
+/*
+ * retro_trace.h - Chrome trace-event recorder
+ *
+ * Records begin/end, instant and counter events from any thread into
+ * per-thread ring buffers and writes them out in the Chrome trace
+ * event format, which chrome://tracing and ui.perfetto.dev load:
+ *
+ *   retro_trace_start();
+ *   ...
+ *   RETRO_TRACE_BEGIN("decode");
+ *   RETRO_TRACE_COUNTER("queue_depth", depth);
+ *   RETRO_TRACE_END("decode");
+ *   ...
+ *   // On a frame hitch, dump what every thread was doing
+ *   w = rjsonwriter_open_rfile(file);
+ *   retro_trace_write_json(w);
+ *
+ * Everything is compiled out unless HAVE_RETRO_TRACE is defined.
+ * When compiled in, a site costs one load until retro_trace_start()
+ * is called.
+ *
+ * Events:
+ *   - Names are stored by pointer and must outlive the trace: use
+ *     string literals.
+ *   - BEGIN/END pairs nest per thread.  Timestamps come from
+ *     cpu_features_get_perf_counter(), converted to microseconds on
+ *     output against cpu_features_get_time_usec().
+ *
+ * Rings:
+ *   - A thread gets a ring of RETRO_TRACE_RING_EVENTS events on its
+ *     first event.  When the ring is full the oldest events are
+ *     overwritten, so the output always holds the most recent history
+ *     of every thread.  Up to RETRO_TRACE_MAX_THREADS threads record
+ *     at once.
+ *   - A ring outlives its thread, so the events of a thread that has
+ *     exited still show up in the output, until a new thread takes
+ *     the ring over and drops them.  Handing rings back needs
+ *     HAVE_THREAD_STORAGE and a thread-exit destructor (pthreads);
+ *     elsewhere a ring stays with its thread for good.
+ *   - Only the owning thread writes its ring, with plain stores
+ *     followed by a release store of the write count, so
+ *     retro_trace_write_json() can read rings while their threads
+ *     record.  Events a thread overwrites during that read are
+ *     dropped; the others are complete.  The slot the thread may be
+ *     writing next is always skipped, so a full ring yields
+ *     RETRO_TRACE_RING_EVENTS - 1 events.  An END whose BEGIN was
+ *     overwritten is ignored by the viewers.
+ *   - retro_trace_start() begins a new generation; each thread empties
+ *     its own ring on its first event of the new generation.
+ */
+
+#include <stdint.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+#include <retro_inline.h>
+
+#ifdef HAVE_RETRO_TRACE
+#include <retro_atomic.h>
+#endif
+
+RETRO_BEGIN_DECLS
+
+struct rjsonwriter;
+
+#ifdef HAVE_RETRO_TRACE
+
+#ifndef RETRO_TRACE_RING_EVENTS
+#define RETRO_TRACE_RING_EVENTS 4096 /* power of 2 */
+#endif
+#ifndef RETRO_TRACE_MAX_THREADS
+#define RETRO_TRACE_MAX_THREADS 64
+#endif
+
+enum retro_trace_phase
+{
+   RETRO_TRACE_PHASE_BEGIN = 0,
+   RETRO_TRACE_PHASE_END,
+   RETRO_TRACE_PHASE_INSTANT,
+   RETRO_TRACE_PHASE_COUNTER
+};
+
+/* Non-zero while recording; tested inline by the macros */
+extern retro_atomic_int_t retro_trace_active;
+
+#define RETRO_TRACE_EVENT(phase, name, value) \
+   do { \
+      if (retro_atomic_load_acquire_int(&retro_trace_active)) \
+         retro_trace_event((phase), (name), (int64_t)(value)); \
+   } while (0)
+
+#define RETRO_TRACE_BEGIN(name) \
+   RETRO_TRACE_EVENT(RETRO_TRACE_PHASE_BEGIN, name, 0)
+#define RETRO_TRACE_END(name) \
+   RETRO_TRACE_EVENT(RETRO_TRACE_PHASE_END, name, 0)
+#define RETRO_TRACE_INSTANT(name) \
+   RETRO_TRACE_EVENT(RETRO_TRACE_PHASE_INSTANT, name, 0)
+#define RETRO_TRACE_COUNTER(name, value) \
+   RETRO_TRACE_EVENT(RETRO_TRACE_PHASE_COUNTER, name, value)
+#define RETRO_TRACE_THREAD_NAME(name) retro_trace_set_thread_name(name)
+
+void retro_trace_event(enum retro_trace_phase phase, const char *name,
+      int64_t value);
+
+/**
+ * retro_trace_set_thread_name:
+ * @name : Name shown for the calling thread, truncated to 31 bytes.
+ *
+ * Can be called before retro_trace_start(); the name is kept in
+ * thread-local storage and given to the thread's ring when it records
+ * its first event.  A thread that is named but never records takes
+ * none of the RETRO_TRACE_MAX_THREADS rings.
+ */
+void retro_trace_set_thread_name(const char *name);
+
+/**
+ * retro_trace_start:
+ *
+ * Discards recorded events and starts recording.  Not thread-safe
+ * against another retro_trace_start() or retro_trace_stop(); event
+ * sites may run concurrently.
+ */
+void retro_trace_start(void);
+
+/**
+ * retro_trace_stop:
+ *
+ * Stops recording.  Recorded events are kept for
+ * retro_trace_write_json().
+ */
+void retro_trace_stop(void);
+
+/**
+ * retro_trace_write_json:
+ * @writer : Writer to append to.
+ *
+ * Writes the recorded events of every thread as one trace-event JSON
+ * object.  Can be called while recording.
+ *
+ * Returns: false if @writer is NULL or a buffer could not be
+ * allocated.
+ */
+bool retro_trace_write_json(struct rjsonwriter *writer);
+
+#else
+
+#define RETRO_TRACE_BEGIN(name)          ((void)0)
+#define RETRO_TRACE_END(name)            ((void)0)
+#define RETRO_TRACE_INSTANT(name)        ((void)0)
+#define RETRO_TRACE_COUNTER(name, value) ((void)0)
+#define RETRO_TRACE_THREAD_NAME(name)    ((void)0)
+
+static INLINE void retro_trace_start(void) { }
+static INLINE void retro_trace_stop(void) { }
+static INLINE bool retro_trace_write_json(struct rjsonwriter *writer)
+{
+   (void)writer;
+   return false;
+}
+
+#endif
+
+RETRO_END_DECLS
+
+#endif /* __LIBRETRO_SDK_TRACE_H */
@@ -26,6 +26,7 @@
 #include <retro_common_api.h>
 
 #include <boolean.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
@@ -35,7 +36,15 @@ RETRO_BEGIN_DECLS
 /** Platform-agnostic handle to a thread. */
 typedef struct sthread sthread_t;
 
-/** Platform-agnostic handle to a mutex. */
+/**
+ * Platform-agnostic handle to a mutex.
+ *
+ * On Linux, slock_t and scond_t are implemented on futex(2), and a
+ * contended slock_lock spins briefly before sleeping. Elsewhere, or
+ * when built with RTHREADS_NO_FUTEX, they wrap the native primitives.
+ * Do not lock an slock_t the calling thread already holds; only the
+ * Win32 backend tolerates that.
+ */
 typedef struct slock slock_t;
 
 /** Platform-agnostic handle to a condition variable. */
@@ -80,6 +89,89 @@ sthread_t *sthread_create(void (*thread_func)(void*), void *userdata);
  */
 sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userdata, int thread_priority);
 
+/** Nice value used for \c STHREAD_SCHED_BACKGROUND when no priority is given. */
+#ifndef STHREAD_BACKGROUND_NICE
+#define STHREAD_BACKGROUND_NICE 10
+#endif
+
+/** Scheduling class requested through \c sthread_attr_t. */
+enum sthread_sched_class
+{
+   /** Normal time-sharing. \c priority is a nice value. */
+   STHREAD_SCHED_DEFAULT = 0,
+   /** Throughput work that should yield to interactive threads
+    * (decoders, scanners, task workers). Linux: nice
+    * \c STHREAD_BACKGROUND_NICE unless \c priority is set;
+    * Apple: QOS_CLASS_UTILITY; Win32: below normal. */
+   STHREAD_SCHED_BACKGROUND,
+   /** Latency-critical work such as audio. Linux: SCHED_FIFO with
+    * \c priority 1-99 (0 picks the minimum), which needs
+    * CAP_SYS_NICE or an RLIMIT_RTPRIO grant; Apple:
+    * QOS_CLASS_USER_INTERACTIVE; Win32: time critical. */
+   STHREAD_SCHED_REALTIME
+};
+
+/**
+ * Optional properties for a new thread.
+ *
+ * Always start from \c sthread_attr_init so fields added later keep
+ * their defaults.
+ */
+typedef struct sthread_attr
+{
+   /** Name shown by debuggers and profilers, or \c NULL.
+    * Copied at creation; Linux keeps the first 15 characters. */
+   const char *name;
+   /** Bit \c n allows logical CPU \c n; 0 leaves the thread unpinned.
+    * Only the first 64 CPUs can be addressed. */
+   uint64_t affinity;
+   /** Stack size in bytes, or 0 for the platform default. */
+   size_t stack_size;
+   enum sthread_sched_class sched_class;
+   /** Meaning depends on \c sched_class; 0 is always the default. */
+   int priority;
+} sthread_attr_t;
+
+/**
+ * Sets every field of \c attr to its default: unnamed, unpinned,
+ * default stack size and \c STHREAD_SCHED_DEFAULT.
+ *
+ * @param attr The attributes to initialize.
+ */
+void sthread_attr_init(sthread_attr_t *attr);
+
+/**
+ * Creates a new thread with the given attributes and starts running it.
+ *
+ * The stack size is applied at creation. The name, affinity and
+ * scheduling class are applied by the new thread itself before
+ * \c thread_func runs, as by \c sthread_set_current_attr. Settings the
+ * platform does not support, or that the process lacks the privilege
+ * for (such as SCHED_FIFO), are skipped and the thread still runs.
+ *
+ * @param thread_func Function to run in the new thread.
+ * @param userdata Passed directly to \c thread_func.
+ * @param attr Attributes for the new thread, or \c NULL for defaults.
+ * @return Pointer to the new thread,
+ * or \c NULL if the thread could not be created.
+ * @see sthread_attr_init
+ */
+sthread_t *sthread_create_with_attr(void (*thread_func)(void*),
+      void *userdata, const sthread_attr_t *attr);
+
+/**
+ * Applies the name, affinity and scheduling class in \c attr to the
+ * calling thread. \c stack_size is ignored.
+ *
+ * Use this for threads that rthreads did not create, such as the main
+ * thread or a thread owned by an audio API.
+ *
+ * @param attr The attributes to apply. \c NULL is a no-op.
+ * @return \c true if every requested setting took effect,
+ * \c false if any was unsupported or refused.
+ */
+bool sthread_set_current_attr(const sthread_attr_t *attr);
+
 /**
  * Detaches the given thread.
  *
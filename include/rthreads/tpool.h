@@ -30,13 +30,27 @@
 
 #include <retro_common_api.h>
 
+#include <stddef.h>
 #include <boolean.h>
 
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
+#include <rthreads/rthreads.h>
 
 RETRO_BEGIN_DECLS
 
+/* Scheduling:
+ *
+ * Where lock-free atomics are available (RETRO_ATOMIC_LOCK_FREE) the
+ * pool is a work-stealing scheduler.  Each worker owns a deque; work
+ * added from inside a job runs on the same worker, newest first,
+ * unless an idle worker steals it.  Work added from other threads
+ * goes through a shared lock-free queue.  Otherwise, or when built
+ * with TPOOL_NO_WORK_STEALING, all work goes through a single locked
+ * FIFO queue.
+ *
+ * In either mode no ordering between work items is guaranteed. */
+
 struct tpool;
 typedef struct tpool tpool_t;
 
@@ -59,15 +73,33 @@ typedef void (*thread_func_t)(void *arg);
  */
 tpool_t *tpool_create(size_t num);
 
+/**
+ * tpool_create_with_attr:
+ * @num           : Number of threads the pool should have.
+ *                  If 0 defaults to 2.
+ * @attr          : Attributes for every worker thread, or NULL for
+ *                  defaults.  Copied; need not outlive the call.
+ *
+ * Like tpool_create, but the workers are created with
+ * sthread_create_with_attr.  Use it to name the workers, keep them
+ * off a core (affinity) or run them as STHREAD_SCHED_BACKGROUND so
+ * they yield to audio and emulation threads.  tpool_create names
+ * its workers "tpool" and leaves everything else at the default.
+ *
+ * Returns: pool.
+ */
+tpool_t *tpool_create_with_attr(size_t num, const sthread_attr_t *attr);
+
 /**
  * tpool_destroy:
  * @tp            : Thread pool.
  *
  * Destroy a thread pool
  * The pool can be destroyed while there is outstanding work to process. All
- * outstanding unprocessed work will be discarded. There may be a delay before
- * this function returns because it will block for work that is processing to
- * complete.
+ * outstanding unprocessed work will be discarded (helpers queued by
+ * tpool_parallel_for just release their share of its state). There may be
+ * a delay before this function returns because it will block for work that
+ * is processing to complete.
  **/
 void tpool_destroy(tpool_t *tp);
 
@@ -77,7 +109,8 @@ void tpool_destroy(tpool_t *tp);
  * @func       : Function the pool should call.
  * @arg        : Argument to pass to func.
  *
- * Add work to a thread pool.
+ * Add work to a thread pool.  Safe to call from any thread, including
+ * from inside a job running on the same pool.
  *
  * Returns: true if work was added, otherwise false.
  **/
@@ -91,6 +124,144 @@ bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg);
  */
 void tpool_wait(tpool_t *tp);
 
+/* Task groups, dependencies and parallel loops
+ *
+ * A group collects tasks so that a caller can wait for just its own
+ * work instead of everything in the pool.  Tasks can be chained with
+ * dependency edges, so a multi-stage pipeline such as
+ * decode -> convert -> scale runs each stage as soon as its inputs
+ * are ready, without a barrier between stages:
+ *
+ *   tpool_group_t *g   = tpool_group_new(tp);
+ *   tpool_task_t  *dec = tpool_task_new(g, decode, frame);
+ *   tpool_task_t  *cvt = tpool_task_new(g, convert, frame);
+ *   tpool_task_t  *scl = tpool_task_new(g, scale, frame);
+ *   tpool_task_depend(cvt, dec);
+ *   tpool_task_depend(scl, cvt);
+ *   tpool_task_submit(dec);
+ *   tpool_task_submit(cvt);
+ *   tpool_task_submit(scl);
+ *   tpool_group_wait(g);
+ *   tpool_group_free(g);
+ */
+
+struct tpool_group;
+typedef struct tpool_group tpool_group_t;
+
+struct tpool_task;
+typedef struct tpool_task tpool_task_t;
+
+/**
+ * (*tpool_range_func_t):
+ * @begin         : First index of the chunk.
+ * @end           : One past the last index of the chunk.
+ * @arg           : Argument.
+ *
+ * Callback that tpool_parallel_for calls once per chunk.
+ **/
+typedef void (*tpool_range_func_t)(size_t begin, size_t end, void *arg);
+
+/**
+ * tpool_group_new:
+ * @tp            : Thread pool the group's tasks run on.
+ *
+ * Create an empty task group.
+ *
+ * Returns: group, or NULL on failure.
+ **/
+tpool_group_t *tpool_group_new(tpool_t *tp);
+
+/**
+ * tpool_group_free:
+ * @group         : Task group.
+ *
+ * Wait for the group's submitted tasks and free it.  Must be freed
+ * before the pool it belongs to is destroyed.
+ **/
+void tpool_group_free(tpool_group_t *group);
+
+/**
+ * tpool_group_add_work:
+ * @group         : Task group.
+ * @func          : Function the pool should call.
+ * @arg           : Argument to pass to func.
+ *
+ * Add independent work to a group.  Same as creating a task with no
+ * dependencies and submitting it.
+ *
+ * Returns: true if work was added, otherwise false.
+ **/
+bool tpool_group_add_work(tpool_group_t *group,
+      thread_func_t func, void *arg);
+
+/**
+ * tpool_group_wait:
+ * @group         : Task group.
+ *
+ * Wait until every task submitted to the group, including tasks that
+ * were waiting on dependencies, has finished.  Other work in the pool
+ * is not waited for.  Must not be called from a job that the group's
+ * own tasks could be queued behind.
+ **/
+void tpool_group_wait(tpool_group_t *group);
+
+/**
+ * tpool_task_new:
+ * @group         : Task group the task is counted in.
+ * @func          : Function the pool should call.
+ * @arg           : Argument to pass to func.
+ *
+ * Create a task that does not run until it has been submitted with
+ * tpool_task_submit and all of its dependencies have finished.  The
+ * pool frees the task after it runs; every task must be submitted
+ * exactly once.
+ *
+ * Returns: task, or NULL on failure.
+ **/
+tpool_task_t *tpool_task_new(tpool_group_t *group,
+      thread_func_t func, void *arg);
+
+/**
+ * tpool_task_depend:
+ * @task          : Task that has to wait.
+ * @before        : Task that has to finish first.
+ *
+ * Make @task run only after @before has finished.  Both tasks may
+ * belong to different groups of the same pool.  Edges must be added
+ * before @before is submitted, and must not form a cycle.
+ *
+ * Returns: true if the edge was added, otherwise false.
+ **/
+bool tpool_task_depend(tpool_task_t *task, tpool_task_t *before);
+
+/**
+ * tpool_task_submit:
+ * @task          : Task.
+ *
+ * Hand a task to the pool.  It is queued as soon as all of its
+ * dependencies have finished, which may be immediately.
+ **/
+void tpool_task_submit(tpool_task_t *task);
+
+/**
+ * tpool_parallel_for:
+ * @tp            : Thread pool.
+ * @begin         : First index.
+ * @end           : One past the last index.
+ * @grain         : Indices per chunk.  0 picks a few chunks per thread.
+ * @fn            : Function called for each chunk.
+ * @arg           : Argument to pass to fn.
+ *
+ * Split [begin, end) into chunks of @grain indices and run @fn on
+ * each, on the pool's threads and on the calling thread.  Returns when
+ * every chunk has finished.  The calling thread takes part in the
+ * work, so this is safe to call from inside a job on the same pool.
+ *
+ * Returns: true on success, false on invalid arguments.
+ **/
+bool tpool_parallel_for(tpool_t *tp, size_t begin, size_t end,
+      size_t grain, tpool_range_func_t fn, void *arg);
+
 RETRO_END_DECLS
 
 #endif
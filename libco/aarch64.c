@@ -11,9 +11,8 @@
 #include <string.h>
 #include <stdint.h>
 
-#ifndef __APPLE__
-#include <malloc.h>
-#endif
+#define LIBCO_STACK_ALIGN 1024
+#include "stack.c"
 
 #ifdef __cplusplus
 extern "C" {
@@ -68,15 +67,9 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
 {
 	uint64_t *ptr     = NULL;
    cothread_t handle = 0;
-   size              = (size + 1023) & ~1023;
-#if HAVE_POSIX_MEMALIGN >= 1
-   if (posix_memalign(&handle, 1024, size + 512) < 0)
-      return 0;
-#else
-   handle            = memalign(1024, size + 512);
-#endif
+   size              = ((size + 1023) & ~1023) + 512;
 
-   if (!handle)
+   if (!(handle = (cothread_t)co_stack_alloc(&size, 512)))
       return handle;
 
    ptr     = (uint64_t*)handle;
@@ -100,7 +93,7 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
    ptr[16] = 0; /* x26 */
    ptr[17] = 0; /* x27 */
    ptr[18] = 0; /* x28 */
-   ptr[20] = (uintptr_t)ptr + size + 512 - 16; /* x30, stack pointer */
+   ptr[20] = (uintptr_t)ptr + size - 16; /* x30, stack pointer */
    ptr[19] = ptr[20]; /* x29, frame pointer */
    ptr[21] = (uintptr_t)entrypoint; /* PC (link register x31 gets saved here). */
    return handle;
@@ -115,7 +108,14 @@ cothread_t co_active(void)
 
 void co_delete(cothread_t handle)
 {
-   free(handle);
+   co_stack_free(handle);
+}
+
+unsigned int co_stack_high_water(cothread_t handle)
+{
+   if (!handle || handle == (cothread_t)co_active_buffer)
+      return 0;
+   return (unsigned int)co_stack_used(handle);
 }
 
 void co_switch(cothread_t handle)
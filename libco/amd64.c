@@ -9,6 +9,10 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#ifndef __GENODE__
+#include "stack.c"
+#endif
+
 #if defined(__GNUC__) && !defined(_WIN32) && !defined(__cplusplus)
 #define CO_USE_INLINE_ASM
 #endif
@@ -159,7 +163,7 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
       *(long long*)handle = (long long)p;                /* stack pointer */
    }
 #else
-   if ((handle = (cothread_t)malloc(size)))
+   if ((handle = (cothread_t)co_stack_alloc(&size, 512)))
    {
       long long *p = (long long*)((char*)handle + size); /* seek to top of stack */
       *--p = (long long)crash;                           /* crash if entrypoint returns */
@@ -176,10 +180,19 @@ void co_delete(cothread_t handle)
 #ifdef __GENODE__
    genode_free_secondary_stack(handle);
 #else
-   free(handle);
+   co_stack_free(handle);
 #endif
 }
 
+#ifdef LIBCO_STACK_POOL
+unsigned int co_stack_high_water(cothread_t handle)
+{
+   if (!handle || handle == (cothread_t)co_active_buffer)
+      return 0;
+   return (unsigned int)co_stack_used(handle);
+}
+#endif
+
 #ifndef CO_USE_INLINE_ASM
 void co_switch(cothread_t handle)
 {
@@ -11,9 +11,8 @@
 #include <string.h>
 #include <stdint.h>
 
-#ifndef __APPLE__
-#include <malloc.h>
-#endif
+#define LIBCO_STACK_ALIGN 1024
+#include "stack.c"
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,15 +59,9 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
 {
    uint32_t *ptr     = NULL;
    cothread_t handle = 0;
-   size              = (size + 1023) & ~1023;
-#if defined(__APPLE__) || HAVE_POSIX_MEMALIGN >= 1
-   if (posix_memalign(&handle, 1024, size + 256) < 0)
-      return 0;
-#else
-   handle = memalign(1024, size + 256);
-#endif
+   size              = ((size + 1023) & ~1023) + 256;
 
-   if (!handle)
+   if (!(handle = (cothread_t)co_stack_alloc(&size, 256)))
       return handle;
 
    ptr    = (uint32_t*)handle;
@@ -82,7 +75,7 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
    ptr[6] = 0; /* r10 */
    ptr[7] = 0; /* r11 */
    /* Align stack to 64-bit */
-   ptr[8] = (uintptr_t)ptr + size + 256 - 8; /* r13, stack pointer */
+   ptr[8] = (uintptr_t)ptr + size - 8; /* r13, stack pointer */
    ptr[9] = (uintptr_t)entrypoint; /* r15, PC (link register r14 gets saved here). */
    return handle;
 }
@@ -96,7 +89,14 @@ cothread_t co_active(void)
 
 void co_delete(cothread_t handle)
 {
-   free(handle);
+   co_stack_free(handle);
+}
+
+unsigned int co_stack_high_water(cothread_t handle)
+{
+   if (!handle || handle == (cothread_t)co_active_buffer)
+      return 0;
+   return (unsigned int)co_stack_used(handle);
 }
 
 void co_switch(cothread_t handle)
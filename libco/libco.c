@@ -43,3 +43,14 @@ void genode_free_secondary_stack(void *stack);
 #else
   #error "libco: unsupported processor, compiler or operating system"
 #endif
+
+#ifndef LIBCO_STACK_POOL
+/* Port allocates its own stacks; nothing is pooled or measured */
+unsigned int co_stack_high_water(cothread_t cothread)
+{
+   (void)cothread;
+   return 0;
+}
+
+void co_stack_pool_trim(void) { }
+#endif
@@ -17,6 +17,8 @@
 #include <signal.h>
 #include <setjmp.h>
 
+#include "stack.c"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -58,8 +60,8 @@ cothread_t co_create(unsigned int size, void (*coentry)(void))
       thread->coentry = thread->stack = 0;
 
       stack.ss_flags  = 0;
+      thread->stack   = stack.ss_sp = co_stack_alloc(&size, 0);
       stack.ss_size   = size;
-      thread->stack   = stack.ss_sp = malloc(size);
 
       if (stack.ss_sp && !sigaltstack(&stack, &old_stack))
       {
@@ -94,11 +96,18 @@ void co_delete(cothread_t cothread)
    if (cothread)
    {
       if (((cothread_struct*)cothread)->stack)
-         free(((cothread_struct*)cothread)->stack);
+         co_stack_free(((cothread_struct*)cothread)->stack);
       free(cothread);
    }
 }
 
+unsigned int co_stack_high_water(cothread_t cothread)
+{
+   if (!cothread || !((cothread_struct*)cothread)->stack)
+      return 0;
+   return (unsigned int)co_stack_used(((cothread_struct*)cothread)->stack);
+}
+
 void co_switch(cothread_t cothread)
 {
    if (!sigsetjmp(co_running->context, 0))
@@ -0,0 +1,469 @@
+/*
+  libco
+  stack allocator shared by the ports
+  license: public domain
+*/
+
+/*
+ * Included by the ports that keep a cothread's stack in a block of
+ * their own.  Each stack is mapped with an inaccessible guard page
+ * below it, so running off the bottom faults instead of silently
+ * corrupting the neighbouring allocation.  co_delete() hands stacks
+ * back to a small per-thread pool, sorted into power-of-2 size
+ * classes, from which co_create() takes them again without a system
+ * call.
+ *
+ * The pool needs real thread-local storage, independent of LIBCO_MP:
+ * libco.h's thread_local is empty without it, and a shared free list
+ * without a lock would hand one stack to two threads.  Where the
+ * compiler has no TLS keyword the pool is disabled and every stack
+ * goes straight back to the system, which is always thread-safe.
+ * A stack freed on another thread than the one that created it simply
+ * joins the freeing thread's pool.
+ *
+ * A thread's pool is emptied when the thread exits through a
+ * pthread key destructor, which needs HAVE_THREADS (for the pthread
+ * link) and GCC-style TLS.  Elsewhere nothing would empty it, so the
+ * pool is off unless LIBCO_STACK_POOL_DEPTH is set explicitly, and a
+ * thread that pools stacks must call co_stack_pool_trim() before it
+ * exits.
+ *
+ * Layout of one allocation, low to high addresses:
+ *
+ *   [guard page][header, padded to LIBCO_STACK_ALIGN][stack ... top]
+ *
+ * A port gets a pointer to the first byte of the stack; the first
+ * `reserved` bytes of it hold the port's register save area.
+ *
+ * Fresh stacks are zero-filled by the system and co_delete() zeroes
+ * what the cothread dirtied before pooling the stack, so the lowest
+ * non-zero byte above the save area marks the deepest point the
+ * stack has reached.  That gives co_stack_high_water() for free; a
+ * frame that only ever wrote zeroes at its deepest point is missed,
+ * so the figure can be a few bytes low.
+ *
+ * Tunables, set before including:
+ *   LIBCO_STACK_ALIGN      : alignment of the stack pointer handed to
+ *                            the port (power of 2, at most a page).
+ *   LIBCO_STACK_POOL_DEPTH : stacks kept per size class per thread;
+ *                            0 unmaps every stack on co_delete().
+ *                            Defaults to 8 where the pool is emptied
+ *                            on thread exit, 0 elsewhere.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define CO_STACK_VIRTUALALLOC
+#elif defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) \
+   || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#include <unistd.h>
+#include <sys/mman.h>
+#if defined(MAP_ANONYMOUS) || defined(MAP_ANON)
+#define CO_STACK_MMAP
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+#endif
+
+/* AddressSanitizer poisons the frames a cothread leaves on its stack
+ * when it is deleted without returning.  The stack scan reads that
+ * memory and the pool reuses it, so both have to look past the
+ * poisoning. */
+#if defined(__SANITIZE_ADDRESS__)
+#define CO_STACK_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CO_STACK_ASAN
+#endif
+#endif
+
+#ifdef CO_STACK_ASAN
+#include <sanitizer/asan_interface.h>
+#define CO_STACK_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define CO_STACK_NO_ASAN
+#endif
+
+#ifndef LIBCO_STACK_ALIGN
+#define LIBCO_STACK_ALIGN 16
+#endif
+
+#if defined(_MSC_VER)
+#define CO_STACK_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define CO_STACK_THREAD_LOCAL __thread
+#if defined(HAVE_THREADS) && defined(CO_STACK_MMAP)
+#include <pthread.h>
+#define CO_STACK_THREAD_EXIT
+#endif
+#else
+#define CO_STACK_THREAD_LOCAL
+#undef LIBCO_STACK_POOL_DEPTH
+#define LIBCO_STACK_POOL_DEPTH 0
+#endif
+
+#ifndef LIBCO_STACK_POOL_DEPTH
+#ifdef CO_STACK_THREAD_EXIT
+#define LIBCO_STACK_POOL_DEPTH 8
+#else
+#define LIBCO_STACK_POOL_DEPTH 0
+#endif
+#endif
+
+/* Tells libco.c that the port implements the stack API */
+#define LIBCO_STACK_POOL
+
+/* Size classes are whole allocations, guard page included:
+ * 16 KiB, 32 KiB, ... 16 MiB.  Larger stacks are never pooled. */
+#define CO_STACK_MIN_SHIFT 14
+#define CO_STACK_CLASSES   11
+#define CO_STACK_MAGIC     0x636f7374u
+
+/* Stacks above this size are released with madvise() rather than
+ * scanned and cleared when they go back to the pool */
+#define CO_STACK_SCAN_MAX  (256 * 1024)
+
+typedef struct co_stack_header
+{
+   struct co_stack_header *next; /* pool link while pooled */
+   void    *base;                /* start of the allocation */
+   size_t   map_size;            /* bytes allocated from the system */
+   size_t   size;                /* usable stack bytes */
+   size_t   reserved;            /* port's save area at the stack bottom */
+   unsigned cls;                 /* size class, CO_STACK_CLASSES if none */
+   unsigned magic;
+} co_stack_header_t;
+
+#define CO_STACK_PAD \
+   ((sizeof(co_stack_header_t) + LIBCO_STACK_ALIGN - 1) \
+    & ~(size_t)(LIBCO_STACK_ALIGN - 1))
+
+static CO_STACK_THREAD_LOCAL co_stack_header_t
+   *co_stack_pool[CO_STACK_CLASSES];
+static CO_STACK_THREAD_LOCAL unsigned co_stack_pool_count[CO_STACK_CLASSES];
+
+#ifdef CO_STACK_THREAD_EXIT
+/* Set on a thread once it pools a stack; the key's destructor then
+ * empties that thread's pool as it exits */
+static pthread_key_t  co_stack_exit_key;
+static pthread_once_t co_stack_exit_once = PTHREAD_ONCE_INIT;
+static int            co_stack_exit_ready;
+static CO_STACK_THREAD_LOCAL int co_stack_exit_armed;
+
+static void co_stack_thread_exit(void *data)
+{
+   (void)data;
+   co_stack_pool_trim();
+}
+
+static void co_stack_exit_init(void)
+{
+   co_stack_exit_ready = pthread_key_create(&co_stack_exit_key,
+         co_stack_thread_exit) == 0;
+}
+
+/* A module that is unloaded must not leave its destructor behind for
+ * threads that outlive it; their pools are leaked instead */
+__attribute__((destructor))
+static void co_stack_exit_fini(void)
+{
+   if (co_stack_exit_ready)
+      pthread_key_delete(co_stack_exit_key);
+   co_stack_exit_ready = 0;
+}
+
+static void co_stack_exit_arm(void)
+{
+   if (co_stack_exit_armed)
+      return;
+   pthread_once(&co_stack_exit_once, co_stack_exit_init);
+   if (co_stack_exit_ready)
+      pthread_setspecific(co_stack_exit_key, &co_stack_exit_armed);
+   co_stack_exit_armed = 1;
+}
+#endif
+
+static size_t co_stack_page_size(void)
+{
+   /* Cached per thread so that no two threads race on the cache */
+   static CO_STACK_THREAD_LOCAL size_t page_size = 0;
+   if (!page_size)
+   {
+#if defined(CO_STACK_VIRTUALALLOC)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      page_size = info.dwPageSize;
+#elif defined(CO_STACK_MMAP)
+      long ret  = sysconf(_SC_PAGESIZE);
+      page_size = (ret > 0) ? (size_t)ret : 4096;
+#else
+      page_size = LIBCO_STACK_ALIGN;
+#endif
+   }
+   return page_size;
+}
+
+/* Bytes below the header that are mapped inaccessible */
+static size_t co_stack_guard_size(void)
+{
+#if defined(CO_STACK_VIRTUALALLOC) || defined(CO_STACK_MMAP)
+   return co_stack_page_size();
+#else
+   return 0;
+#endif
+}
+
+/* Returns zero-filled memory of map_size bytes whose first
+ * co_stack_guard_size() bytes fault on access. */
+static void *co_stack_map(size_t map_size)
+{
+#if defined(CO_STACK_VIRTUALALLOC)
+   DWORD old_protect;
+   void *base = VirtualAlloc(NULL, map_size,
+         MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+   if (base && !VirtualProtect(base, co_stack_guard_size(),
+            PAGE_NOACCESS, &old_protect))
+   {
+      VirtualFree(base, 0, MEM_RELEASE);
+      base = NULL;
+   }
+   return base;
+#elif defined(CO_STACK_MMAP)
+   void *base = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (base == MAP_FAILED)
+      return NULL;
+   if (mprotect(base, co_stack_guard_size(), PROT_NONE) != 0)
+   {
+      munmap(base, map_size);
+      return NULL;
+   }
+   return base;
+#else
+   /* No guard page; over-allocate so the header can be aligned */
+   return calloc(1, map_size + LIBCO_STACK_ALIGN);
+#endif
+}
+
+static void co_stack_unmap(void *base, size_t map_size)
+{
+#if defined(CO_STACK_VIRTUALALLOC)
+   VirtualFree(base, 0, MEM_RELEASE);
+#elif defined(CO_STACK_MMAP)
+   munmap(base, map_size);
+#else
+   free(base);
+#endif
+}
+
+/* Where the scan for used stack starts: the first word above the
+ * port's save area */
+static size_t co_stack_scan_start(const co_stack_header_t *header)
+{
+   return (header->reserved + sizeof(uintptr_t) - 1)
+      & ~(sizeof(uintptr_t) - 1);
+}
+
+/* Offset from the stack bottom of the lowest word above the save
+ * area that is not zero, or header->size if there is none. */
+CO_STACK_NO_ASAN
+static size_t co_stack_first_used(const co_stack_header_t *header)
+{
+   const char      *stack = (const char*)header + CO_STACK_PAD;
+   const uintptr_t *p     = (const uintptr_t*)(stack
+         + co_stack_scan_start(header));
+   const uintptr_t *end   = (const uintptr_t*)(stack + header->size);
+#if defined(CO_STACK_MMAP) && defined(__linux__)
+   /* Pages the cothread never touched are not resident.  Skip them
+    * rather than read them, which would also map them in. */
+   size_t page_size = co_stack_page_size();
+
+   while (p < end)
+   {
+      unsigned char resident[64];
+      size_t i;
+      size_t pages;
+      uintptr_t page = (uintptr_t)p & ~(uintptr_t)(page_size - 1);
+
+      pages = ((uintptr_t)end - page + page_size - 1) / page_size;
+      if (pages > sizeof(resident))
+         pages = sizeof(resident);
+      if (mincore((void*)page, pages * page_size, resident) != 0)
+         break;
+
+      for (i = 0; i < pages && p < end; i++)
+      {
+         const uintptr_t *page_end = (const uintptr_t*)
+            (page + (i + 1) * page_size);
+         if (page_end > end)
+            page_end = end;
+         if (resident[i] & 1)
+         {
+            for (; p < page_end; p++)
+               if (*p)
+                  return (size_t)((const char*)p - stack);
+         }
+         p = page_end;
+      }
+   }
+#endif
+   for (; p < end; p++)
+      if (*p)
+         return (size_t)((const char*)p - stack);
+   return header->size;
+}
+
+/* Bytes of the stack in use, counted down from the top */
+static size_t co_stack_used(const void *stack)
+{
+   const co_stack_header_t *header = (const co_stack_header_t*)
+      ((const char*)stack - CO_STACK_PAD);
+   if (header->magic != CO_STACK_MAGIC)
+      return 0;
+   return header->size - co_stack_first_used(header);
+}
+
+/**
+ * co_stack_alloc:
+ * @size     : in, stack bytes wanted; out, stack bytes granted,
+ *             at least as many and, when changed, a multiple of
+ *             LIBCO_STACK_ALIGN.
+ * @reserved : bytes at the bottom of the stack the port uses for its
+ *             own state; not counted by co_stack_high_water().
+ *
+ * Returns: bottom of a zero-filled stack aligned to LIBCO_STACK_ALIGN,
+ * or NULL.
+ */
+static void *co_stack_alloc(unsigned int *size, size_t reserved)
+{
+   co_stack_header_t *header = NULL;
+   size_t guard              = co_stack_guard_size();
+   size_t need               = guard + CO_STACK_PAD + *size;
+   unsigned cls              = 0;
+
+   while (cls < CO_STACK_CLASSES
+         && ((size_t)1 << (cls + CO_STACK_MIN_SHIFT)) < need)
+      cls++;
+
+   if (cls < CO_STACK_CLASSES && co_stack_pool[cls])
+   {
+      header                   = co_stack_pool[cls];
+      co_stack_pool[cls]       = header->next;
+      co_stack_pool_count[cls]--;
+   }
+   else
+   {
+      size_t map_size;
+      size_t grain = co_stack_page_size();
+      void *base;
+
+      if (cls < CO_STACK_CLASSES)
+         map_size = (size_t)1 << (cls + CO_STACK_MIN_SHIFT);
+      else
+         map_size = (need + grain - 1) & ~(grain - 1);
+
+      if (!(base = co_stack_map(map_size)))
+         return NULL;
+
+      header           = (co_stack_header_t*)
+         (((uintptr_t)base + guard + LIBCO_STACK_ALIGN - 1)
+          & ~(uintptr_t)(LIBCO_STACK_ALIGN - 1));
+      header->base     = base;
+      header->map_size = map_size;
+      header->size     = map_size - guard - CO_STACK_PAD;
+      header->cls      = cls;
+      header->magic    = CO_STACK_MAGIC;
+   }
+
+   header->next     = NULL;
+   header->reserved = reserved;
+   if (header->size <= UINT_MAX)
+      *size         = (unsigned int)header->size;
+   return (char*)header + CO_STACK_PAD;
+}
+
+/**
+ * co_stack_free:
+ * @stack : pointer returned by co_stack_alloc().
+ *
+ * Zeroes what the cothread wrote and pools the stack, or returns it to
+ * the system if its class is full.
+ */
+static void co_stack_free(void *stack)
+{
+   co_stack_header_t *header;
+   size_t first;
+
+   if (!stack)
+      return;
+
+   header = (co_stack_header_t*)((char*)stack - CO_STACK_PAD);
+   /* Overwritten by a stack overflow that stopped short of the guard
+    * page; the allocation can no longer be found, so leak it. */
+   assert(header->magic == CO_STACK_MAGIC);
+   if (header->magic != CO_STACK_MAGIC)
+      return;
+
+#ifdef CO_STACK_ASAN
+   ASAN_UNPOISON_MEMORY_REGION(stack, header->size);
+#endif
+
+   if (     header->cls >= CO_STACK_CLASSES
+         || co_stack_pool_count[header->cls] >= LIBCO_STACK_POOL_DEPTH)
+   {
+      co_stack_unmap(header->base, header->map_size);
+      return;
+   }
+
+#if defined(CO_STACK_MMAP) && defined(__linux__) && defined(MADV_DONTNEED)
+   /* Finding the used part of a big stack costs more than dropping
+    * the whole of it, which Linux refills with zeroes on demand */
+   if (header->size > CO_STACK_SCAN_MAX)
+   {
+      size_t    page_size = co_stack_page_size();
+      uintptr_t lo        = ((uintptr_t)stack + page_size - 1)
+         & ~(uintptr_t)(page_size - 1);
+      uintptr_t hi        = (uintptr_t)stack + header->size;
+      if (madvise((void*)lo, hi - lo, MADV_DONTNEED) == 0)
+      {
+         memset(stack, 0, lo - (uintptr_t)stack);
+         first = header->size;
+      }
+      else
+         first = co_stack_first_used(header);
+   }
+   else
+#endif
+      first = co_stack_first_used(header);
+   memset(stack, 0, co_stack_scan_start(header));
+   memset((char*)stack + first, 0, header->size - first);
+
+#ifdef CO_STACK_THREAD_EXIT
+   co_stack_exit_arm();
+#endif
+   header->next                     = co_stack_pool[header->cls];
+   co_stack_pool[header->cls]       = header;
+   co_stack_pool_count[header->cls]++;
+}
+
+void co_stack_pool_trim(void)
+{
+   unsigned cls;
+   for (cls = 0; cls < CO_STACK_CLASSES; cls++)
+   {
+      while (co_stack_pool[cls])
+      {
+         co_stack_header_t *header = co_stack_pool[cls];
+         co_stack_pool[cls]        = header->next;
+         co_stack_unmap(header->base, header->map_size);
+      }
+      co_stack_pool_count[cls] = 0;
+   }
+}
@@ -21,6 +21,8 @@
 #include <stdlib.h>
 #include <ucontext.h>
 
+#include "stack.c"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,7 +45,7 @@ cothread_t co_create(unsigned int heapsize, void (*coentry)(void))
 
    if ((thread = (ucontext_t*)malloc(sizeof(ucontext_t))))
    {
-      if ((!getcontext(thread) && !(thread->uc_stack.ss_sp = 0)) && (thread->uc_stack.ss_sp = malloc(heapsize)))
+      if ((!getcontext(thread) && !(thread->uc_stack.ss_sp = 0)) && (thread->uc_stack.ss_sp = co_stack_alloc(&heapsize, 0)))
       {
          thread->uc_link = co_running;
          thread->uc_stack.ss_size = heapsize;
@@ -64,10 +66,17 @@ void co_delete(cothread_t cothread)
       return;
 
    if (((ucontext_t*)cothread)->uc_stack.ss_sp)
-      free(((ucontext_t*)cothread)->uc_stack.ss_sp);
+      co_stack_free(((ucontext_t*)cothread)->uc_stack.ss_sp);
    free(cothread);
 }
 
+unsigned int co_stack_high_water(cothread_t cothread)
+{
+   if (!cothread || !((ucontext_t*)cothread)->uc_stack.ss_sp)
+      return 0;
+   return (unsigned int)co_stack_used(((ucontext_t*)cothread)->uc_stack.ss_sp);
+}
+
 void co_switch(cothread_t cothread)
 {
    ucontext_t *old_thread = co_running;
@@ -9,6 +9,8 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "stack.c"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -90,7 +92,7 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
    size += 256; /* allocate additional space for storage */
    size &= ~15; /* align stack to 16-byte boundary */
 
-   if ((handle = (cothread_t)malloc(size)))
+   if ((handle = (cothread_t)co_stack_alloc(&size, 256)))
    {
       long *p        = (long*)((char*)handle + size); /* seek to top of stack */
       *--p           = (long)crash;                   /* crash if entrypoint returns */
@@ -103,7 +105,14 @@ cothread_t co_create(unsigned int size, void (*entrypoint)(void))
 
 void co_delete(cothread_t handle)
 {
-   free(handle);
+   co_stack_free(handle);
+}
+
+unsigned int co_stack_high_water(cothread_t handle)
+{
+   if (!handle || handle == (cothread_t)co_active_buffer)
+      return 0;
+   return (unsigned int)co_stack_used(handle);
 }
 
 void co_switch(cothread_t handle)
@@ -325,7 +325,8 @@ bool dir_list_append(struct string_list *list,
 
    if (ext)
    {
-      string_list_initialize(&ext_list);
+      /* Pooled: the extensions are only ever read */
+      string_list_initialize_pooled(&ext_list, false);
       string_split_noalloc(&ext_list, ext, "|");
       ext_list_ptr                  = &ext_list;
    }
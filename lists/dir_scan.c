@@ -0,0 +1,334 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dir_scan.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <lists/dir_scan.h>
+#include <file/file_path.h>
+#include <retro_dirent.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
+struct dir_scan_state
+{
+   dir_scan_cb_t cb;
+   void *userdata;
+   char *ext_buf;
+   const char **exts;
+   size_t num_exts;
+#ifdef HAVE_THREADS
+   tpool_t *pool;
+   slock_t *lock;
+#endif
+   unsigned flags;
+   bool stop;
+};
+
+#ifdef HAVE_THREADS
+struct dir_scan_job
+{
+   struct dir_scan_state *state;
+   char path[1];
+};
+#endif
+
+static bool dir_scan_parse_exts(struct dir_scan_state *st, const char *ext)
+{
+   size_t i, n = 1;
+   char *tok;
+
+   for (i = 0; ext[i]; i++)
+      if (ext[i] == '|')
+         n++;
+
+   if (!(st->ext_buf = strdup(ext)))
+      return false;
+   if (!(st->exts = (const char**)malloc(n * sizeof(*st->exts))))
+      return false;
+
+   /* Split in place; a leading '.' is accepted and ignored
+    * so both "zip" and ".zip" match the same files */
+   tok = st->ext_buf;
+   for (;;)
+   {
+      char *sep = strchr(tok, '|');
+      if (sep)
+         *sep   = '\0';
+      if (*tok == '.')
+         tok++;
+      if (*tok)
+         st->exts[st->num_exts++] = tok;
+      if (!sep)
+         break;
+      tok       = sep + 1;
+   }
+
+   return true;
+}
+
+static bool dir_scan_ext_match(const struct dir_scan_state *st,
+      const char *file_ext)
+{
+   size_t i;
+   for (i = 0; i < st->num_exts; i++)
+   {
+      const char *a = st->exts[i];
+      const char *b = file_ext;
+      while (tolower((unsigned char)*a) == tolower((unsigned char)*b))
+      {
+         if (*a == '\0')
+            return true;
+         a++;
+         b++;
+      }
+   }
+   return false;
+}
+
+static bool dir_scan_stopped(struct dir_scan_state *st)
+{
+   bool stop;
+#ifdef HAVE_THREADS
+   slock_lock(st->lock);
+#endif
+   stop = st->stop;
+#ifdef HAVE_THREADS
+   slock_unlock(st->lock);
+#endif
+   return stop;
+}
+
+/* Serialises the callback, so consumers never need their
+ * own locking even when several workers are producing. */
+static bool dir_scan_emit(struct dir_scan_state *st,
+      const char *path, unsigned type)
+{
+   bool ok;
+#ifdef HAVE_THREADS
+   slock_lock(st->lock);
+#endif
+   ok = !st->stop && st->cb(path, type, st->userdata);
+   if (!ok)
+      st->stop = true;
+#ifdef HAVE_THREADS
+   slock_unlock(st->lock);
+#endif
+   return ok;
+}
+
+static bool dir_scan_dir(struct dir_scan_state *st, const char *dir);
+
+#ifdef HAVE_THREADS
+static void dir_scan_job_cb(void *arg)
+{
+   struct dir_scan_job *job = (struct dir_scan_job*)arg;
+   if (!dir_scan_stopped(job->state))
+      dir_scan_dir(job->state, job->path);
+   free(job);
+}
+#endif
+
+static void dir_scan_subdir(struct dir_scan_state *st, const char *path)
+{
+#ifdef HAVE_THREADS
+   if (st->pool)
+   {
+      size_t _len              = strlen(path);
+      struct dir_scan_job *job = (struct dir_scan_job*)
+         malloc(sizeof(*job) + _len);
+      if (job)
+      {
+         job->state = st;
+         memcpy(job->path, path, _len + 1);
+         if (tpool_add_work(st->pool, dir_scan_job_cb, job))
+            return;
+         free(job);
+      }
+      /* Could not queue it, walk it on this thread instead */
+   }
+#endif
+   dir_scan_dir(st, path);
+}
+
+/**
+ * dir_scan_dir:
+ * @st                 : scan state.
+ * @dir                : directory path.
+ *
+ * Walks a single directory, emitting its entries and handing
+ * every subdirectory to dir_scan_subdir. Mirrors the filtering
+ * rules of dir_list_read.
+ *
+ * @return false if @dir could not be opened or the scan was
+ * stopped, otherwise true.
+ **/
+static bool dir_scan_dir(struct dir_scan_state *st, const char *dir)
+{
+   bool ret                = true;
+   bool include_hidden     = (st->flags & DIR_SCAN_FLAG_INCLUDE_HIDDEN)     != 0;
+   bool include_dirs       = (st->flags & DIR_SCAN_FLAG_INCLUDE_DIRS)       != 0;
+   bool include_compressed = (st->flags & DIR_SCAN_FLAG_INCLUDE_COMPRESSED) != 0;
+   bool recursive          = (st->flags & DIR_SCAN_FLAG_RECURSIVE)          != 0;
+   struct RDIR *entry      = retro_opendir_include_hidden(dir, include_hidden);
+
+   if (!entry)
+      return false;
+   if (retro_dirent_error(entry))
+   {
+      retro_closedir(entry);
+      return false;
+   }
+
+   while (retro_readdir(entry))
+   {
+      unsigned type;
+      char file_path[PATH_MAX_LENGTH];
+      const char *name = retro_dirent_get_name(entry);
+
+      if (name[0] == '.' || name[0] == '$')
+      {
+         if (!include_hidden)
+            continue;
+         if (name[1] == '\0')
+            continue;
+         if (name[1] == '.' && name[2] == '\0')
+            continue;
+      }
+
+      /* Uses d_type where the platform has it; only falls
+       * back to stat for DT_UNKNOWN and symlinks */
+      if (retro_dirent_is_dir(entry, NULL))
+      {
+         if (!include_hidden && strcmp(name, "System Volume Information") == 0)
+            continue;
+
+         fill_pathname_join_special(file_path, dir, name, sizeof(file_path));
+
+#if defined(IOS) || defined(OSX)
+         {
+            size_t name_len = strlen(name);
+            if (name_len >= 10
+                  && !memcmp(name + name_len - 10, ".framework", 10))
+            {
+               if (!(ret = dir_scan_emit(st, file_path, RARCH_PLAIN_FILE)))
+                  break;
+               continue;
+            }
+         }
+#endif
+         if (recursive)
+            dir_scan_subdir(st, file_path);
+
+         if (!include_dirs)
+            continue;
+         type = RARCH_DIRECTORY;
+      }
+      else
+      {
+         /* Decide from the bare name first, so rejected
+          * entries never cost a path join */
+         const char *file_ext = path_get_extension(name);
+
+         type                 = RARCH_FILETYPE_UNSET;
+
+         if (st->exts && dir_scan_ext_match(st, file_ext))
+            type              = RARCH_PLAIN_FILE;
+         else
+         {
+            bool is_compressed_file;
+            if ((is_compressed_file = path_is_compressed_file(name)))
+               type           = RARCH_COMPRESSED_ARCHIVE;
+
+            if (st->exts &&
+                  (!is_compressed_file || !include_compressed))
+               continue;
+         }
+
+         fill_pathname_join_special(file_path, dir, name, sizeof(file_path));
+      }
+
+      if (!(ret = dir_scan_emit(st, file_path, type)))
+         break;
+   }
+
+   retro_closedir(entry);
+
+   return ret;
+}
+
+bool dir_scan(const char *dir, const char *ext, unsigned flags,
+      unsigned num_threads, dir_scan_cb_t cb, void *userdata)
+{
+   bool ret;
+   struct dir_scan_state st;
+
+   if (!dir || !cb)
+      return false;
+
+   memset(&st, 0, sizeof(st));
+   st.cb       = cb;
+   st.userdata = userdata;
+   st.flags    = flags;
+
+   if (ext && !dir_scan_parse_exts(&st, ext))
+   {
+      free(st.ext_buf);
+      return false;
+   }
+
+#ifdef HAVE_THREADS
+   if (!(st.lock = slock_new()))
+   {
+      free(st.exts);
+      free(st.ext_buf);
+      return false;
+   }
+   /* Without a pool everything runs inline, which is also
+    * the fallback if the threads cannot be started */
+   if (num_threads > 1 && (flags & DIR_SCAN_FLAG_RECURSIVE))
+      st.pool  = tpool_create(num_threads);
+#endif
+
+   ret = dir_scan_dir(&st, dir);
+
+#ifdef HAVE_THREADS
+   if (st.pool)
+   {
+      /* Workers queue further work while running, so this
+       * only returns once the whole tree has been drained */
+      tpool_wait(st.pool);
+      tpool_destroy(st.pool);
+   }
+   slock_free(st.lock);
+#endif
+
+   free(st.exts);
+   free(st.ext_buf);
+
+   return ret && !st.stop;
+}
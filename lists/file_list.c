@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
 
 #include <retro_common.h>
 #include <retro_inline.h>
@@ -246,13 +248,73 @@ void file_list_set_alt_at_offset(file_list_t *list, size_t idx,
    list->list[idx].alt   = strdup(alt);
 }
 
+/* Sort key for file_list_sort_on_alt: the first eight
+ * case-folded bytes of the string packed big-endian, so
+ * that comparing two prefixes as integers orders them
+ * exactly like strcasecmp would. Only when the prefixes
+ * tie does the comparison fall back to the strings. */
+struct file_list_sort_key
+{
+   uint64_t prefix;
+   const char *str;
+   size_t idx;
+};
+
+static INLINE uint64_t file_list_sort_prefix(const char *s)
+{
+   uint64_t prefix = 0;
+   unsigned i;
+   for (i = 0; i < 8; i++)
+   {
+      prefix <<= 8;
+      if (*s)
+         prefix |= (uint8_t)tolower((unsigned char)*s++);
+   }
+   return prefix;
+}
+
+static INLINE int file_list_sort_key_cmp(
+      const struct file_list_sort_key *a,
+      const struct file_list_sort_key *b)
+{
+   if (a->prefix != b->prefix)
+      return (a->prefix < b->prefix) ? -1 : 1;
+   /* Equal prefixes ending early means equal strings */
+   if (!(a->prefix & 0xFF))
+      return 0;
+   return strcasecmp(a->str + 8, b->str + 8);
+}
+
+/**
+ * file_list_permute:
+ *
+ * Reorders @list so that entry i becomes the former
+ * entry @order[i].
+ **/
+static bool file_list_permute(file_list_t *list, const size_t *order)
+{
+   size_t i;
+   struct item_file *sorted = (struct item_file*)
+      malloc(list->capacity * sizeof(*sorted));
+   if (!sorted)
+      return false;
+   for (i = 0; i < list->size; i++)
+      sorted[i] = list->list[order[i]];
+   if (list->capacity > list->size)
+      memset(&sorted[list->size], 0,
+            (list->capacity - list->size) * sizeof(*sorted));
+   free(list->list);
+   list->list = sorted;
+   return true;
+}
+
 static int file_list_alt_cmp(const void *a_, const void *b_)
 {
    const struct item_file *a = (const struct item_file*)a_;
    const struct item_file *b = (const struct item_file*)b_;
    const char *cmp_a         = a->alt ? a->alt : a->path;
    const char *cmp_b         = b->alt ? b->alt : b->path;
-   return strcasecmp(cmp_a, cmp_b);
+   return strcasecmp(cmp_a ? cmp_a : "", cmp_b ? cmp_b : "");
 }
 
 static int file_list_type_cmp(const void *a_, const void *b_)
@@ -267,14 +329,153 @@ static int file_list_type_cmp(const void *a_, const void *b_)
    return 1;
 }
 
+/**
+ * file_list_sort_on_alt:
+ *
+ * Sorts by alt (or path), case-insensitively. Keys
+ * are computed once per entry up front, then merge
+ * sorted bottom-up; the sort is stable. Falls back
+ * to qsort if the scratch memory cannot be had.
+ **/
 void file_list_sort_on_alt(file_list_t *list)
 {
+   size_t i, width;
+   struct file_list_sort_key *keys = NULL;
+   struct file_list_sort_key *tmp  = NULL;
+   size_t *order                   = NULL;
+   size_t n                        = list->size;
+
+   if (n < 2)
+      return;
+
+   keys  = (struct file_list_sort_key*)malloc(n * sizeof(*keys));
+   tmp   = (struct file_list_sort_key*)malloc(n * sizeof(*tmp));
+   order = (size_t*)malloc(n * sizeof(*order));
+   if (!keys || !tmp || !order)
+      goto fallback;
+
+   for (i = 0; i < n; i++)
+   {
+      const struct item_file *item = &list->list[i];
+      const char *str              = item->alt ? item->alt : item->path;
+      if (!str)
+         str                       = "";
+      keys[i].prefix               = file_list_sort_prefix(str);
+      keys[i].str                  = str;
+      keys[i].idx                  = i;
+   }
+
+   for (width = 1; width < n; width <<= 1)
+   {
+      struct file_list_sort_key *swap = NULL;
+      for (i = 0; i < n; i += width << 1)
+      {
+         size_t lo  = i;
+         size_t mid = (i + width < n)       ? i + width        : n;
+         size_t hi  = (i + (width << 1) < n) ? i + (width << 1) : n;
+         size_t l   = lo;
+         size_t r   = mid;
+         size_t o   = lo;
+         while (l < mid && r < hi)
+         {
+            if (file_list_sort_key_cmp(&keys[r], &keys[l]) < 0)
+               tmp[o++] = keys[r++];
+            else
+               tmp[o++] = keys[l++];
+         }
+         while (l < mid)
+            tmp[o++] = keys[l++];
+         while (r < hi)
+            tmp[o++] = keys[r++];
+      }
+      swap = keys;
+      keys = tmp;
+      tmp  = swap;
+   }
+
+   for (i = 0; i < n; i++)
+      order[i] = keys[i].idx;
+   if (!file_list_permute(list, order))
+      goto fallback;
+
+   free(keys);
+   free(tmp);
+   free(order);
+   return;
+
+fallback:
+   free(keys);
+   free(tmp);
+   free(order);
    qsort(list->list, list->size, sizeof(list->list[0]), file_list_alt_cmp);
 }
 
+/**
+ * file_list_sort_on_type:
+ *
+ * Sorts by type with a stable LSD radix sort, one
+ * byte of the type per pass; passes over bytes that
+ * are the same for every entry are skipped.
+ **/
 void file_list_sort_on_type(file_list_t *list)
 {
-   qsort(list->list, list->size, sizeof(list->list[0]), file_list_type_cmp);
+   size_t i;
+   unsigned shift;
+   unsigned all_or  = 0;
+   unsigned all_and = ~0u;
+   size_t *order    = NULL;
+   size_t *tmp      = NULL;
+   size_t n         = list->size;
+
+   if (n < 2)
+      return;
+
+   order = (size_t*)malloc(n * sizeof(*order));
+   tmp   = (size_t*)malloc(n * sizeof(*tmp));
+   if (!order || !tmp)
+   {
+      free(order);
+      free(tmp);
+      qsort(list->list, list->size, sizeof(list->list[0]),
+            file_list_type_cmp);
+      return;
+   }
+
+   for (i = 0; i < n; i++)
+   {
+      order[i] = i;
+      all_or  |= list->list[i].type;
+      all_and &= list->list[i].type;
+   }
+
+   for (shift = 0; shift < sizeof(unsigned) * 8; shift += 8)
+   {
+      size_t count[257];
+      size_t *swap = NULL;
+
+      /* Every entry agrees on this byte */
+      if (!(((all_or ^ all_and) >> shift) & 0xFF))
+         continue;
+
+      memset(count, 0, sizeof(count));
+      for (i = 0; i < n; i++)
+         count[((list->list[order[i]].type >> shift) & 0xFF) + 1]++;
+      for (i = 1; i < 257; i++)
+         count[i] += count[i - 1];
+      for (i = 0; i < n; i++)
+         tmp[count[(list->list[order[i]].type >> shift) & 0xFF]++] = order[i];
+
+      swap  = order;
+      order = tmp;
+      tmp   = swap;
+   }
+
+   if (!file_list_permute(list, order))
+      qsort(list->list, list->size, sizeof(list->list[0]),
+            file_list_type_cmp);
+
+   free(order);
+   free(tmp);
 }
 
 void *file_list_get_userdata_at_offset(const file_list_t *list, size_t idx)
@@ -349,3 +550,123 @@ bool file_list_search(const file_list_t *list, const char *needle, size_t *idx)
 
    return ret;
 }
+
+bool file_list_index_build(file_list_index_t *index,
+      const file_list_t *list)
+{
+   size_t i;
+   size_t _len = 0;
+   char *out   = NULL;
+
+   if (!index)
+      return false;
+
+   index->labels  = NULL;
+   index->offsets = NULL;
+   index->size    = 0;
+
+   if (!list)
+      return false;
+
+   /* Same precedence as file_list_search */
+#define FILE_LIST_INDEX_STR(item) \
+   ((item)->alt ? (item)->alt : ((item)->path ? (item)->path : (item)->label))
+
+   for (i = 0; i < list->size; i++)
+   {
+      const char *str = FILE_LIST_INDEX_STR(&list->list[i]);
+      if (str)
+         _len += strlen(str) + 1;
+   }
+
+   if (!(index->offsets = (size_t*)malloc((list->size + 1)
+               * sizeof(*index->offsets))))
+      return false;
+   if (!(index->labels = (char*)malloc(_len + 1)))
+   {
+      free(index->offsets);
+      index->offsets = NULL;
+      return false;
+   }
+
+   out = index->labels;
+   for (i = 0; i < list->size; i++)
+   {
+      const char *str = FILE_LIST_INDEX_STR(&list->list[i]);
+      if (!str)
+      {
+         index->offsets[i] = (size_t)-1;
+         continue;
+      }
+      index->offsets[i] = (size_t)(out - index->labels);
+      while (*str)
+         *out++ = (char)tolower((unsigned char)*str++);
+      *out++ = '\0';
+   }
+   *out        = '\0';
+   index->size = list->size;
+
+#undef FILE_LIST_INDEX_STR
+
+   return true;
+}
+
+bool file_list_index_search(const file_list_index_t *index,
+      const char *needle, size_t *idx)
+{
+   size_t i;
+   char buf[256];
+   char *folded = buf;
+   size_t _len  = 0;
+   bool ret     = false;
+
+   if (!index || !index->labels || !needle)
+      return false;
+
+   if ((_len = strlen(needle)) >= sizeof(buf))
+      if (!(folded = (char*)malloc(_len + 1)))
+         return false;
+   for (i = 0; i < _len; i++)
+      folded[i] = (char)tolower((unsigned char)needle[i]);
+   folded[_len] = '\0';
+
+   for (i = 0; i < index->size; i++)
+   {
+      const char *str = NULL;
+      const char *hay = NULL;
+
+      if (index->offsets[i] == (size_t)-1)
+         continue;
+      hay = index->labels + index->offsets[i];
+
+      if ((str = strstr(hay, folded)) == hay)
+      {
+         /* Found match with first chars, best possible match. */
+         *idx = i;
+         ret  = true;
+         break;
+      }
+      else if (str && !ret)
+      {
+         /* Found mid-string match, but try to find a match with
+          * first characters before we settle. */
+         *idx = i;
+         ret  = true;
+      }
+   }
+
+   if (folded != buf)
+      free(folded);
+   return ret;
+}
+
+void file_list_index_free(file_list_index_t *index)
+{
+   if (!index)
+      return;
+   free(index->labels);
+   free(index->offsets);
+   index->labels  = NULL;
+   index->offsets = NULL;
+   index->size    = 0;
+}
@@ -28,6 +28,183 @@
 #include <compat/strl.h>
 #include <compat/posix_string.h>
 
+#define STRING_LIST_POOL_BLOCK_MIN 4096
+#define STRING_LIST_POOL_BLOCK_MAX (64 * 1024)
+
+struct string_list_block
+{
+   struct string_list_block *next;
+   size_t used;
+   size_t size;
+   char data[1];
+};
+
+struct string_list_slot
+{
+   char *str;
+   size_t len;
+};
+
+/* Bump allocator for element strings, plus an optional
+ * open-addressing table (linear probing, power-of-two
+ * capacity) of the strings stored so far for interning */
+struct string_list_pool
+{
+   struct string_list_block *blocks;
+   struct string_list_slot *slots;
+   size_t slot_count;
+   size_t slot_cap;
+   size_t block_size;
+   bool intern;
+};
+
+static struct string_list_pool *string_list_pool_new(bool intern)
+{
+   struct string_list_pool *pool = (struct string_list_pool*)
+      malloc(sizeof(*pool));
+   if (!pool)
+      return NULL;
+   pool->blocks     = NULL;
+   pool->slots      = NULL;
+   pool->slot_count = 0;
+   pool->slot_cap   = 0;
+   pool->block_size = STRING_LIST_POOL_BLOCK_MIN;
+   pool->intern     = intern;
+   return pool;
+}
+
+static void string_list_pool_free(struct string_list_pool *pool)
+{
+   struct string_list_block *block = pool->blocks;
+   while (block)
+   {
+      struct string_list_block *hold = block;
+      block                          = block->next;
+      free(hold);
+   }
+   free(pool->slots);
+   free(pool);
+}
+
+static char *string_list_pool_alloc(struct string_list_pool *pool,
+      size_t len)
+{
+   struct string_list_block *block = pool->blocks;
+
+   if (!block || block->size - block->used < len)
+   {
+      size_t size = pool->block_size;
+      /* Oversized strings get a block of their own */
+      if (size < len)
+         size     = len;
+      if (!(block = (struct string_list_block*)malloc(
+               sizeof(*block) + size - 1)))
+         return NULL;
+      block->used = 0;
+      block->size = size;
+      block->next = pool->blocks;
+      pool->blocks = block;
+      if (pool->block_size < STRING_LIST_POOL_BLOCK_MAX)
+         pool->block_size <<= 1;
+   }
+
+   block->used += len;
+   return block->data + block->used - len;
+}
+
+static uint32_t string_list_pool_hash(const char *s, size_t len)
+{
+   /* FNV-1a */
+   uint32_t hash = 2166136261u;
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      hash ^= (unsigned char)s[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+static bool string_list_pool_grow_slots(struct string_list_pool *pool)
+{
+   size_t i;
+   size_t cap                     = pool->slot_cap
+      ? pool->slot_cap * 2 : 64;
+   struct string_list_slot *slots = (struct string_list_slot*)
+      calloc(cap, sizeof(*slots));
+   if (!slots)
+      return false;
+   for (i = 0; i < pool->slot_cap; i++)
+   {
+      struct string_list_slot *old = &pool->slots[i];
+      if (old->str)
+      {
+         size_t j = string_list_pool_hash(old->str, old->len) & (cap - 1);
+         while (slots[j].str)
+            j = (j + 1) & (cap - 1);
+         slots[j] = *old;
+      }
+   }
+   free(pool->slots);
+   pool->slots    = slots;
+   pool->slot_cap = cap;
+   return true;
+}
+
+/**
+ * string_list_store:
+ *
+ * Copies @len bytes of @elem (plus a NUL terminator) into
+ * storage suitable for an element of @list.
+ **/
+static char *string_list_store(struct string_list *list,
+      const char *elem, size_t len)
+{
+   struct string_list_pool *pool = list->pool;
+   char *data                    = NULL;
+   size_t slot                   = 0;
+
+   if (!pool)
+   {
+      if (!(data = (char*)malloc(len + 1)))
+         return NULL;
+      memcpy(data, elem, len);
+      data[len] = '\0';
+      return data;
+   }
+
+   if (pool->intern)
+   {
+      /* Keep the table at most half full */
+      if (     (pool->slot_count + 1) * 2 > pool->slot_cap
+            && !string_list_pool_grow_slots(pool))
+         return NULL;
+      slot = string_list_pool_hash(elem, len) & (pool->slot_cap - 1);
+      while (pool->slots[slot].str)
+      {
+         struct string_list_slot *cur = &pool->slots[slot];
+         /* Length first, so memcmp never reads past a shorter string */
+         if (cur->len == len && !memcmp(cur->str, elem, len))
+            return cur->str;
+         slot = (slot + 1) & (pool->slot_cap - 1);
+      }
+   }
+
+   if (!(data = string_list_pool_alloc(pool, len + 1)))
+      return NULL;
+   memcpy(data, elem, len);
+   data[len] = '\0';
+
+   if (pool->intern)
+   {
+      pool->slots[slot].str = data;
+      pool->slots[slot].len = len;
+      pool->slot_count++;
+   }
+
+   return data;
+}
+
 static bool string_list_deinitialize_internal(struct string_list *list)
 {
    if (!list)
@@ -38,7 +215,7 @@ static bool string_list_deinitialize_internal(struct string_list *list)
       unsigned i;
       for (i = 0; i < (unsigned)list->size; i++)
       {
-         if (list->elems[i].data)
+         if (list->elems[i].data && !list->pool)
             free(list->elems[i].data);
          if (list->elems[i].userdata)
             free(list->elems[i].userdata);
@@ -47,7 +224,11 @@ static bool string_list_deinitialize_internal(struct string_list *list)
       free(list->elems);
    }
 
+   if (list->pool)
+      string_list_pool_free(list->pool);
+
    list->elems = NULL;
+   list->pool  = NULL;
 
    return true;
 }
@@ -102,6 +283,7 @@ struct string_list *string_list_new(void)
    list->cap  = 0;
    list->size = 0;
    list->elems = NULL;
+   list->pool  = NULL;
 
    elems = (struct string_list_elem*)
       calloc(32, sizeof(*elems));
@@ -117,6 +299,19 @@ struct string_list *string_list_new(void)
    return list;
 }
 
+struct string_list *string_list_new_pooled(bool intern)
+{
+   struct string_list *list = string_list_new();
+   if (!list)
+      return NULL;
+   if (!(list->pool = string_list_pool_new(intern)))
+   {
+      string_list_free(list);
+      return NULL;
+   }
+   return list;
+}
+
 bool string_list_initialize(struct string_list *list)
 {
    struct string_list_elem *elems = NULL;
@@ -132,11 +327,24 @@ bool string_list_initialize(struct string_list *list)
    }
 
    list->elems = elems;
+   list->pool  = NULL;
    list->size  = 0;
    list->cap   = 32;
    return true;
 }
 
+bool string_list_initialize_pooled(struct string_list *list, bool intern)
+{
+   if (!string_list_initialize(list))
+      return false;
+   if (!(list->pool = string_list_pool_new(intern)))
+   {
+      string_list_deinitialize(list);
+      return false;
+   }
+   return true;
+}
+
 bool string_list_append(struct string_list *list, const char *elem,
       union string_list_elem_attr attr)
 {
@@ -147,7 +355,10 @@ bool string_list_append(struct string_list *list, const char *elem,
                (list->cap > 0) ? (list->cap * 2) : 32))
       return false;
 
-   data_dup = strdup(elem);
+   if (list->pool)
+      data_dup = string_list_store(list, elem, strlen(elem));
+   else
+      data_dup = strdup(elem);
    if (!data_dup)
       return false;
 
@@ -168,11 +379,8 @@ bool string_list_append_n(struct string_list *list, const char *elem,
                (list->cap > 0) ? (list->cap * 2) : 32))
       return false;
 
-   data_dup = (char*)malloc(len + 1);
-   if (!data_dup)
+   if (!(data_dup = string_list_store(list, elem, len)))
       return false;
-   memcpy(data_dup, elem, len);
-   data_dup[len] = '\0';
 
    list->elems[list->size].data = data_dup;
    list->elems[list->size].attr = attr;
@@ -407,6 +615,7 @@ struct string_list *string_list_clone(const struct string_list *src)
       return NULL;
 
    dest->elems = NULL;
+   dest->pool  = NULL;
    dest->size  = src->size;
    dest->cap   = (src->cap < dest->size) ? dest->size : src->cap;
 
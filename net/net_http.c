@@ -38,6 +38,7 @@
 #include <lists/string_list.h>
 #include <retro_common_api.h>
 #include <retro_miscellaneous.h>
+#include <retro_trace.h>
 #include <string/stdstring.h>
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -1664,13 +1665,8 @@ static bool net_http_redirect(struct http_t *state, const char *location)
    return false;
 }
 
-/**
- * net_http_update:
- *
- * @return true if it's done, or if something broke.
- * @total will be 0 if it's not known.
- **/
-bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+static bool net_http_update_internal(struct http_t *state,
+      size_t* progress, size_t* total)
 {
    struct response *response;
    ssize_t _len = 0;
@@ -1781,6 +1777,21 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
    return true;
 }
 
+/**
+ * net_http_update:
+ *
+ * @return true if it's done, or if something broke.
+ * @total will be 0 if it's not known.
+ **/
+bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
+{
+   bool ret;
+   RETRO_TRACE_BEGIN("net_http.update");
+   ret = net_http_update_internal(state, progress, total);
+   RETRO_TRACE_END("net_http.update");
+   return ret;
+}
+
 /**
  * net_http_status:
  *
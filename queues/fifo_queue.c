@@ -20,33 +20,58 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <retro_common_api.h>
 #include <retro_inline.h>
+#include <retro_atomic.h>
 #include <boolean.h>
 
 #include <queues/fifo_queue.h>
 
-static bool fifo_initialize_internal(fifo_buffer_t *buf, size_t len)
+#define FIFO_IS_SPSC(buffer) ((buffer)->flags & FIFO_FLAG_SPSC)
+
+static bool fifo_initialize_internal(fifo_buffer_t *buf, size_t len,
+      uint8_t flags)
 {
-   uint8_t *buffer    = (uint8_t*)calloc(1, len + 1);
+   uint8_t *buffer;
+   /* One byte is kept free to tell a full ring from an empty one */
+   size_t size        = len + 1;
 
-   if (!buffer)
+   if (flags & FIFO_FLAG_SPSC)
+   {
+      /* Free-running cursors tell full from empty, so the whole
+       * buffer is usable; it must be a power of 2 for masking */
+      if (len == 0 || len > (SIZE_MAX / 2))
+         return false;
+      for (size = 1; size < len; )
+         size <<= 1;
+   }
+
+   if (!(buffer = (uint8_t*)calloc(1, size)))
       return false;
 
    buf->buffer        = buffer;
-   buf->size          = len + 1;
+   buf->size          = size;
    buf->first         = 0;
    buf->end           = 0;
+   buf->flags         = flags;
+   retro_atomic_size_init(&buf->head, 0);
+   retro_atomic_size_init(&buf->tail, 0);
 
    return true;
 }
 
 bool fifo_initialize(fifo_buffer_t *buf, size_t len)
 {
-   return (buf && fifo_initialize_internal(buf, len));
+   return (buf && fifo_initialize_internal(buf, len, 0));
+}
+
+bool fifo_initialize_spsc(fifo_buffer_t *buf, size_t len)
+{
+   return (buf && fifo_initialize_internal(buf, len, FIFO_FLAG_SPSC));
 }
 
 void fifo_free(fifo_buffer_t *buffer)
@@ -67,20 +92,20 @@ bool fifo_deinitialize(fifo_buffer_t *buffer)
       free(buffer->buffer);
    buffer->buffer = NULL;
    buffer->size   = 0;
-   buffer->first  = 0;
-   buffer->end    = 0;
+   buffer->flags  = 0;
+   fifo_clear(buffer);
 
    return true;
 }
 
-fifo_buffer_t *fifo_new(size_t len)
+static fifo_buffer_t *fifo_new_internal(size_t len, uint8_t flags)
 {
    fifo_buffer_t *buf = (fifo_buffer_t*)malloc(sizeof(*buf));
 
    if (!buf)
       return NULL;
 
-   if (!fifo_initialize_internal(buf, len))
+   if (!fifo_initialize_internal(buf, len, flags))
    {
       free(buf);
       return NULL;
@@ -89,38 +114,154 @@ fifo_buffer_t *fifo_new(size_t len)
    return buf;
 }
 
-void fifo_write(fifo_buffer_t *buffer, const void *in_buf, size_t len)
+fifo_buffer_t *fifo_new(size_t len)
+{
+   return fifo_new_internal(len, 0);
+}
+
+fifo_buffer_t *fifo_new_spsc(size_t len)
 {
-   size_t first_write = len;
-   size_t rest_write  = 0;
+   return fifo_new_internal(len, FIFO_FLAG_SPSC);
+}
 
-   if (buffer->end + len > buffer->size)
+size_t fifo_read_avail(const fifo_buffer_t *buffer)
+{
+   if (FIFO_IS_SPSC(buffer))
    {
-      first_write = buffer->size - buffer->end;
-      rest_write  = len - first_write;
+      /* acquire on head pairs with the producer's release, so the
+       * bytes counted here are visible */
+      size_t head = retro_atomic_load_acquire_size(
+            (retro_atomic_size_t*)&buffer->head);
+      size_t tail = retro_atomic_load_acquire_size(
+            (retro_atomic_size_t*)&buffer->tail);
+      return head - tail;
    }
+   return FIFO_READ_AVAIL(buffer);
+}
 
-   memcpy(buffer->buffer + buffer->end, in_buf, first_write);
-   if (rest_write > 0)
-      memcpy(buffer->buffer, (const uint8_t*)in_buf + first_write, rest_write);
+size_t fifo_write_avail(const fifo_buffer_t *buffer)
+{
+   if (FIFO_IS_SPSC(buffer))
+   {
+      /* acquire on tail pairs with the consumer's release, so it is
+       * done reading the space counted here */
+      size_t head = retro_atomic_load_acquire_size(
+            (retro_atomic_size_t*)&buffer->head);
+      size_t tail = retro_atomic_load_acquire_size(
+            (retro_atomic_size_t*)&buffer->tail);
+      return buffer->size - (head - tail);
+   }
+   return FIFO_WRITE_AVAIL(buffer);
+}
 
-   buffer->end = (buffer->end + len) % buffer->size;
+/* Describe @len bytes of the ring starting at index @idx, split in
+ * two where it wraps past the end of the buffer */
+static void fifo_spans(const fifo_buffer_t *buffer, size_t idx,
+      size_t len, fifo_spans_t *spans)
+{
+   size_t first  = buffer->size - idx;
+   if (first > len)
+      first      = len;
+   spans->ptr[0] = buffer->buffer + idx;
+   spans->len[0] = first;
+   spans->ptr[1] = buffer->buffer;
+   spans->len[1] = len - first;
 }
 
-void fifo_read(fifo_buffer_t *buffer, void *in_buf, size_t len)
+size_t fifo_write_reserve(fifo_buffer_t *buffer, size_t want,
+      fifo_spans_t *spans)
 {
-   size_t first_read = len;
-   size_t rest_read  = 0;
+   size_t avail = fifo_write_avail(buffer);
+   size_t idx   = buffer->end;
 
-   if (buffer->first + len > buffer->size)
+   if (want > avail)
+      want      = avail;
+   if (FIFO_IS_SPSC(buffer))
+      idx       = retro_atomic_load_acquire_size(&buffer->head)
+         & (buffer->size - 1);
+   fifo_spans(buffer, idx, want, spans);
+   return want;
+}
+
+void fifo_write_commit(fifo_buffer_t *buffer, size_t len)
+{
+   size_t avail = fifo_write_avail(buffer);
+
+   /* Free space only grows behind the producer's back, so this only
+    * catches committing more than was reserved */
+   if (len > avail)
+      len       = avail;
+
+   if (FIFO_IS_SPSC(buffer))
    {
-      first_read = buffer->size - buffer->first;
-      rest_read  = len - first_read;
+      /* release: the bytes written into the spans become visible
+       * before the new head does */
+      size_t head = retro_atomic_load_acquire_size(&buffer->head);
+      retro_atomic_store_release_size(&buffer->head, head + len);
+      return;
    }
 
-   memcpy(in_buf, (const uint8_t*)buffer->buffer + buffer->first, first_read);
-   if (rest_read > 0)
-      memcpy((uint8_t*)in_buf + first_read, buffer->buffer, rest_read);
+   buffer->end += len;
+   if (buffer->end >= buffer->size)
+      buffer->end -= buffer->size;
+}
+
+size_t fifo_read_peek(fifo_buffer_t *buffer, size_t want,
+      fifo_spans_t *spans)
+{
+   size_t avail = fifo_read_avail(buffer);
+   size_t idx   = buffer->first;
+
+   if (want > avail)
+      want      = avail;
+   if (FIFO_IS_SPSC(buffer))
+      idx       = retro_atomic_load_acquire_size(&buffer->tail)
+         & (buffer->size - 1);
+   fifo_spans(buffer, idx, want, spans);
+   return want;
+}
+
+void fifo_read_release(fifo_buffer_t *buffer, size_t len)
+{
+   size_t avail = fifo_read_avail(buffer);
+
+   if (len > avail)
+      len       = avail;
+
+   if (FIFO_IS_SPSC(buffer))
+   {
+      /* release: the bytes read from the spans are done with before
+       * the producer sees the space as free */
+      size_t tail = retro_atomic_load_acquire_size(&buffer->tail);
+      retro_atomic_store_release_size(&buffer->tail, tail + len);
+      return;
+   }
+
+   buffer->first += len;
+   if (buffer->first >= buffer->size)
+      buffer->first -= buffer->size;
+}
+
+void fifo_write(fifo_buffer_t *buffer, const void *in_buf, size_t len)
+{
+   fifo_spans_t spans;
+
+   len = fifo_write_reserve(buffer, len, &spans);
+   memcpy(spans.ptr[0], in_buf, spans.len[0]);
+   if (spans.len[1] > 0)
+      memcpy(spans.ptr[1], (const uint8_t*)in_buf + spans.len[0],
+            spans.len[1]);
+   fifo_write_commit(buffer, len);
+}
+
+void fifo_read(fifo_buffer_t *buffer, void *in_buf, size_t len)
+{
+   fifo_spans_t spans;
 
-   buffer->first = (buffer->first + len) % buffer->size;
+   len = fifo_read_peek(buffer, len, &spans);
+   memcpy(in_buf, spans.ptr[0], spans.len[0]);
+   if (spans.len[1] > 0)
+      memcpy((uint8_t*)in_buf + spans.len[0], spans.ptr[1],
+            spans.len[1]);
+   fifo_read_release(buffer, len);
 }
@@ -0,0 +1,167 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_mpmc.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <retro_mpmc.h>
+
+/* Each slot is a sequence number followed by the element bytes,
+ * padded so the next slot's sequence stays size_t aligned. */
+#define MPMC_SLOT(q, pos) ((q)->slots + ((pos) & ((q)->capacity - 1)) * (q)->stride)
+#define MPMC_SEQ(slot)    ((retro_atomic_size_t*)(slot))
+#define MPMC_ELEM(slot)   ((slot) + sizeof(retro_atomic_size_t))
+
+static void mpmc_reset(retro_mpmc_t *q)
+{
+   size_t i;
+   /* Slot i is writable on lap 0 when its sequence equals i */
+   for (i = 0; i < q->capacity; i++)
+      retro_atomic_size_init(MPMC_SEQ(q->slots + i * q->stride), i);
+   retro_atomic_size_init(&q->head, 0);
+   retro_atomic_size_init(&q->tail, 0);
+}
+
+bool retro_mpmc_init(retro_mpmc_t *q, size_t min_capacity,
+      size_t elem_size)
+{
+   size_t cap   = 2;
+   size_t align = sizeof(retro_atomic_size_t);
+   size_t stride;
+
+   if (!q)
+      return false;
+   q->slots = NULL;
+
+   if (     elem_size == 0
+         || min_capacity > (SIZE_MAX / 2)
+         || elem_size > SIZE_MAX - 2 * align)
+      return false;
+
+   while (cap < min_capacity)
+      cap <<= 1;
+
+   stride = (align + elem_size + align - 1) & ~(align - 1);
+   if (cap > SIZE_MAX / stride)
+      return false;
+
+   if (!(q->slots = (uint8_t*)malloc(cap * stride)))
+      return false;
+
+   q->capacity  = cap;
+   q->elem_size = elem_size;
+   q->stride    = stride;
+   mpmc_reset(q);
+   return true;
+}
+
+void retro_mpmc_free(retro_mpmc_t *q)
+{
+   if (!q)
+      return;
+   if (q->slots)
+   {
+      free(q->slots);
+      q->slots = NULL;
+   }
+   q->capacity = 0;
+}
+
+void retro_mpmc_clear(retro_mpmc_t *q)
+{
+   /* Quiescence is the caller's responsibility (documented), so
+    * every sequence can be rewritten with plain init. */
+   if (q && q->slots)
+      mpmc_reset(q);
+}
+
+bool retro_mpmc_push(retro_mpmc_t *q, const void *elem)
+{
+   uint8_t *slot;
+   size_t pos = retro_atomic_load_acquire_size(&q->head);
+
+   for (;;)
+   {
+      size_t seq;
+      slot = MPMC_SLOT(q, pos);
+      /* acquire pairs with the consumer's release of this slot on
+       * the previous lap, so our element write cannot overtake its
+       * read */
+      seq  = retro_atomic_load_acquire_size(MPMC_SEQ(slot));
+
+      if (seq == pos)
+      {
+         /* Slot is free on this lap; race the other producers */
+         if (retro_atomic_cas_size(&q->head, pos, pos + 1))
+            break;
+      }
+      else if ((ptrdiff_t)(seq - pos) < 0)
+         return false; /* consumers haven't freed it yet: full */
+      /* Lost the race or fell a lap behind; start again from the
+       * current head */
+      pos = retro_atomic_load_acquire_size(&q->head);
+   }
+
+   memcpy(MPMC_ELEM(slot), elem, q->elem_size);
+   retro_atomic_store_release_size(MPMC_SEQ(slot), pos + 1);
+   return true;
+}
+
+bool retro_mpmc_pop(retro_mpmc_t *q, void *elem)
+{
+   uint8_t *slot;
+   size_t pos = retro_atomic_load_acquire_size(&q->tail);
+
+   for (;;)
+   {
+      size_t seq;
+      slot = MPMC_SLOT(q, pos);
+      /* acquire pairs with the producer's release, making the
+       * element bytes visible */
+      seq  = retro_atomic_load_acquire_size(MPMC_SEQ(slot));
+
+      if (seq == pos + 1)
+      {
+         if (retro_atomic_cas_size(&q->tail, pos, pos + 1))
+            break;
+      }
+      else if ((ptrdiff_t)(seq - (pos + 1)) < 0)
+         return false; /* not yet published: empty */
+      pos = retro_atomic_load_acquire_size(&q->tail);
+   }
+
+   memcpy(elem, MPMC_ELEM(slot), q->elem_size);
+   /* Hand the slot to the producer one lap ahead */
+   retro_atomic_store_release_size(MPMC_SEQ(slot), pos + q->capacity);
+   return true;
+}
+
+size_t retro_mpmc_count(const retro_mpmc_t *q)
+{
+   /* tail first: head only moves forward, so a later head can never
+    * be behind the tail we read */
+   size_t tail = retro_atomic_load_acquire_size(
+         (retro_atomic_size_t*)&q->tail);
+   size_t head = retro_atomic_load_acquire_size(
+         (retro_atomic_size_t*)&q->head);
+   size_t n    = head - tail;
+   return n > q->capacity ? q->capacity : n;
+}
@@ -42,6 +42,39 @@ static size_t spsc_round_up_pow2(size_t v)
    return r;
 }
 
+/* Describe @bytes of the ring starting at cursor @pos, split in two
+ * where it wraps past the end of the buffer. */
+static void spsc_spans(const retro_spsc_t *q, size_t pos, size_t bytes,
+      retro_spsc_spans_t *spans)
+{
+   size_t idx   = pos & (q->capacity - 1);
+   size_t first = q->capacity - idx;
+   if (first > bytes)
+      first = bytes;
+   spans->ptr[0] = q->buffer + idx;
+   spans->len[0] = first;
+   spans->ptr[1] = q->buffer;
+   spans->len[1] = bytes - first;
+}
+
+static void spsc_copy_in(retro_spsc_t *q, size_t pos,
+      const void *data, size_t bytes)
+{
+   retro_spsc_spans_t spans;
+   spsc_spans(q, pos, bytes, &spans);
+   memcpy(spans.ptr[0], data, spans.len[0]);
+   memcpy(spans.ptr[1], (const uint8_t*)data + spans.len[0], spans.len[1]);
+}
+
+static void spsc_copy_out(const retro_spsc_t *q, size_t pos,
+      void *data, size_t bytes)
+{
+   retro_spsc_spans_t spans;
+   spsc_spans(q, pos, bytes, &spans);
+   memcpy(data, spans.ptr[0], spans.len[0]);
+   memcpy((uint8_t*)data + spans.len[0], spans.ptr[1], spans.len[1]);
+}
+
 bool retro_spsc_init(retro_spsc_t *q, size_t min_capacity)
 {
    size_t cap;
@@ -123,8 +156,6 @@ size_t retro_spsc_read_avail(const retro_spsc_t *q)
 
 size_t retro_spsc_write(retro_spsc_t *q, const void *data, size_t bytes)
 {
-   size_t mask, head_idx, first;
-   const uint8_t *src = (const uint8_t*)data;
    /* read tail first to know how much room there is */
    size_t head  = retro_atomic_load_acquire_size(&q->head);
    size_t tail  = retro_atomic_load_acquire_size(&q->tail);
@@ -134,16 +165,7 @@ size_t retro_spsc_write(retro_spsc_t *q, const void *data, size_t bytes)
    if (bytes == 0)
       return 0;
 
-   mask     = q->capacity - 1;
-   head_idx = head & mask;
-
-   /* first = bytes from head_idx to end-of-buffer */
-   first = q->capacity - head_idx;
-   if (first > bytes)
-      first = bytes;
-
-   memcpy(q->buffer + head_idx, src, first);
-   memcpy(q->buffer, src + first, bytes - first);
+   spsc_copy_in(q, head, data, bytes);
 
    /* Publish: release-store ensures the memcpys above are globally
     * visible before the consumer observes the new head. */
@@ -153,8 +175,6 @@ size_t retro_spsc_write(retro_spsc_t *q, const void *data, size_t bytes)
 
 size_t retro_spsc_read(retro_spsc_t *q, void *data, size_t bytes)
 {
-   size_t mask, tail_idx, first;
-   uint8_t *dst = (uint8_t*)data;
    /* acquire on head pairs with producer's release-store; this is
     * what makes the subsequent memcpys safe to read. */
    size_t head  = retro_atomic_load_acquire_size(&q->head);
@@ -165,15 +185,7 @@ size_t retro_spsc_read(retro_spsc_t *q, void *data, size_t bytes)
    if (bytes == 0)
       return 0;
 
-   mask     = q->capacity - 1;
-   tail_idx = tail & mask;
-
-   first = q->capacity - tail_idx;
-   if (first > bytes)
-      first = bytes;
-
-   memcpy(dst, q->buffer + tail_idx, first);
-   memcpy(dst + first, q->buffer, bytes - first);
+   spsc_copy_out(q, tail, data, bytes);
 
    /* Publish: release-store so the producer can re-use this space. */
    retro_atomic_store_release_size(&q->tail, tail + bytes);
@@ -182,8 +194,6 @@ size_t retro_spsc_read(retro_spsc_t *q, void *data, size_t bytes)
 
 size_t retro_spsc_peek(const retro_spsc_t *q, void *data, size_t bytes)
 {
-   size_t mask, tail_idx, first;
-   uint8_t *dst = (uint8_t*)data;
    size_t head  = retro_atomic_load_acquire_size(
          (retro_atomic_size_t*)&q->head);
    size_t tail = retro_atomic_load_acquire_size(
@@ -194,15 +204,174 @@ size_t retro_spsc_peek(const retro_spsc_t *q, void *data, size_t bytes)
    if (bytes == 0)
       return 0;
 
-   mask     = q->capacity - 1;
-   tail_idx = tail & mask;
-
-   first    = q->capacity - tail_idx;
-   if (first > bytes)
-      first = bytes;
-
-   memcpy(dst, q->buffer + tail_idx, first);
-   memcpy(dst + first, q->buffer, bytes - first);
+   spsc_copy_out(q, tail, data, bytes);
    /* No tail update: peek does not consume. */
    return bytes;
 }
+
+/* ---- Zero-copy access ------------------------------------------------ */
+
+size_t retro_spsc_write_reserve(retro_spsc_t *q, size_t want,
+      retro_spsc_spans_t *spans)
+{
+   /* Same acquire on tail as retro_spsc_write: the consumer must be
+    * done reading the space before we hand it out for writing. */
+   size_t head  = retro_atomic_load_acquire_size(&q->head);
+   size_t tail  = retro_atomic_load_acquire_size(&q->tail);
+   size_t avail = q->capacity - (head - tail);
+   if (want > avail)
+      want = avail;
+   spsc_spans(q, head, want, spans);
+   return want;
+}
+
+void retro_spsc_write_commit(retro_spsc_t *q, size_t bytes)
+{
+   size_t head  = retro_atomic_load_acquire_size(&q->head);
+   size_t tail  = retro_atomic_load_acquire_size(&q->tail);
+   size_t avail = q->capacity - (head - tail);
+   /* Free space only grows behind our back, so clamping here can
+    * only catch a caller committing more than it reserved. */
+   if (bytes > avail)
+      bytes = avail;
+   /* release: the caller's writes into the spans become visible
+    * before the new head does */
+   retro_atomic_store_release_size(&q->head, head + bytes);
+}
+
+size_t retro_spsc_read_peek(retro_spsc_t *q, size_t want,
+      retro_spsc_spans_t *spans)
+{
+   size_t head  = retro_atomic_load_acquire_size(&q->head);
+   size_t tail  = retro_atomic_load_acquire_size(&q->tail);
+   size_t avail = head - tail;
+   if (want > avail)
+      want = avail;
+   spsc_spans(q, tail, want, spans);
+   return want;
+}
+
+void retro_spsc_read_release(retro_spsc_t *q, size_t bytes)
+{
+   size_t head  = retro_atomic_load_acquire_size(&q->head);
+   size_t tail  = retro_atomic_load_acquire_size(&q->tail);
+   size_t avail = head - tail;
+   if (bytes > avail)
+      bytes = avail;
+   /* release: our reads of the spans complete before the producer
+    * can see the space as free */
+   retro_atomic_store_release_size(&q->tail, tail + bytes);
+}
+
+/* ---- Framed records --------------------------------------------------- */
+
+bool retro_spsc_record_reserve(retro_spsc_t *q, size_t len,
+      retro_spsc_spans_t *spans)
+{
+   uint32_t hdr;
+   size_t head, tail;
+
+   if (     q->capacity < RETRO_SPSC_RECORD_HEADER
+         || len > q->capacity - RETRO_SPSC_RECORD_HEADER
+         || len > UINT32_MAX)
+      return false;
+
+   head = retro_atomic_load_acquire_size(&q->head);
+   tail = retro_atomic_load_acquire_size(&q->tail);
+   if (q->capacity - (head - tail) < RETRO_SPSC_RECORD_HEADER + len)
+      return false;
+
+   /* The header slot is the producer's until commit; park the
+    * reserved size there so commit can clamp to it */
+   hdr = (uint32_t)len;
+   spsc_copy_in(q, head, &hdr, sizeof(hdr));
+   spsc_spans(q, head + RETRO_SPSC_RECORD_HEADER, len, spans);
+   return true;
+}
+
+void retro_spsc_record_commit(retro_spsc_t *q, size_t len)
+{
+   uint32_t hdr;
+   size_t head  = retro_atomic_load_acquire_size(&q->head);
+   size_t tail  = retro_atomic_load_acquire_size(&q->tail);
+   size_t avail = q->capacity - (head - tail);
+
+   /* Nothing can have been reserved */
+   if (avail < RETRO_SPSC_RECORD_HEADER)
+      return;
+   /* Never publish bytes the producer was not given: clamp to the
+    * reservation, and to the free space in case commit comes
+    * without one */
+   spsc_copy_out(q, head, &hdr, sizeof(hdr));
+   if (len > hdr)
+      len = hdr;
+   if (len > avail - RETRO_SPSC_RECORD_HEADER)
+      len = avail - RETRO_SPSC_RECORD_HEADER;
+
+   /* The header goes in last, then header and payload are published
+    * together, so the consumer sees the whole record or nothing. */
+   hdr = (uint32_t)len;
+   spsc_copy_in(q, head, &hdr, sizeof(hdr));
+   retro_atomic_store_release_size(&q->head,
+         head + RETRO_SPSC_RECORD_HEADER + len);
+}
+
+bool retro_spsc_record_write(retro_spsc_t *q, const void *data, size_t len)
+{
+   retro_spsc_spans_t spans;
+   if (!retro_spsc_record_reserve(q, len, &spans))
+      return false;
+   memcpy(spans.ptr[0], data, spans.len[0]);
+   memcpy(spans.ptr[1], (const uint8_t*)data + spans.len[0], spans.len[1]);
+   retro_spsc_record_commit(q, len);
+   return true;
+}
+
+bool retro_spsc_record_peek(retro_spsc_t *q, retro_spsc_spans_t *spans)
+{
+   uint32_t hdr;
+   size_t head = retro_atomic_load_acquire_size(&q->head);
+   size_t tail = retro_atomic_load_acquire_size(&q->tail);
+
+   /* Records are published whole, so anything queued starts with a
+    * complete header followed by its complete payload. */
+   if (head - tail < RETRO_SPSC_RECORD_HEADER)
+      return false;
+   spsc_copy_out(q, tail, &hdr, sizeof(hdr));
+   spsc_spans(q, tail + RETRO_SPSC_RECORD_HEADER, hdr, spans);
+   return true;
+}
+
+void retro_spsc_record_release(retro_spsc_t *q)
+{
+   uint32_t hdr;
+   size_t head = retro_atomic_load_acquire_size(&q->head);
+   size_t tail = retro_atomic_load_acquire_size(&q->tail);
+
+   if (head - tail < RETRO_SPSC_RECORD_HEADER)
+      return;
+   spsc_copy_out(q, tail, &hdr, sizeof(hdr));
+   retro_atomic_store_release_size(&q->tail,
+         tail + RETRO_SPSC_RECORD_HEADER + hdr);
+}
+
+bool retro_spsc_record_read(retro_spsc_t *q, void *data, size_t cap,
+      size_t *len)
+{
+   retro_spsc_spans_t spans;
+   size_t _len;
+
+   if (!retro_spsc_record_peek(q, &spans))
+      return false;
+
+   _len = spans.len[0] + spans.len[1];
+   if (len)
+      *len = _len;
+   if (_len > cap)
+      return false;
+
+   memcpy(data, spans.ptr[0], spans.len[0]);
+   memcpy((uint8_t*)data + spans.len[0], spans.ptr[1], spans.len[1]);
+   retro_spsc_record_release(q);
+   return true;
+}
@@ -27,6 +27,8 @@
 #include <queues/task_queue.h>
 
 #include <features/features_cpu.h>
+#include <retro_perf.h>
+#include <retro_trace.h>
 
 #if defined(HAVE_GCD) && !defined(HAVE_THREADS)
 #error "gcd uses threads, what are you doing"
@@ -41,6 +43,12 @@
 #ifdef HAVE_GCD
 #include <dispatch/dispatch.h>
 #endif
+#ifdef HAVE_LIBCO
+#include <libco.h>
+#ifdef HAVE_THREADS
+#include <retro_atomic.h>
+#endif
+#endif
 
 typedef struct
 {
@@ -48,6 +56,10 @@ typedef struct
    retro_task_t *back;
 } task_queue_t;
 
+RETRO_PERF_TIMER(perf_task_handler, "task_queue.handler");
+RETRO_PERF_TIMER(perf_task_callback, "task_queue.callback");
+RETRO_PERF_COUNTER(perf_task_pushed, "task_queue.pushed");
+
 struct retro_task_impl
 {
    retro_task_queue_msg_t msg_push;
@@ -76,13 +88,43 @@ static slock_t *running_lock                = NULL;
 static slock_t *finished_lock               = NULL;
 static slock_t *property_lock               = NULL;
 static slock_t *queue_lock                  = NULL;
-static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
 static bool worker_continue                 = true;
-/* use running_lock when touching it */
+/* use running_lock when touching it (ready_lock in the threaded impl) */
+
+/* Threaded impl: tasks waiting for a worker, one queue per
+ * task_priority, linked through ready_next.  A task is in exactly one
+ * ready queue while it is not being run, and in none while a worker
+ * runs its handler, so a handler never runs on two workers at once.
+ * tasks_running stays the list of every live task for find, retrieve,
+ * cancel and progress reporting. */
+static slock_t *ready_lock                  = NULL;
+static scond_t *ready_cond                  = NULL;
+static task_queue_t tasks_ready[2]          = {{NULL, NULL}, {NULL, NULL}};
+static sthread_t *worker_threads[TASK_QUEUE_MAX_WORKERS];
+static unsigned worker_count                = 0;
+static unsigned background_running          = 0;
+/* use ready_lock when touching these */
+
+#ifdef HAVE_LIBCO
+/* Coroutine tasks run one at a time: libco's active context is a
+ * process-wide global unless it is built with LIBCO_MP.  Cothreads
+ * are also created and deleted under it, since a task is created on
+ * whichever thread pushes it and deleted on the worker that finishes
+ * it, and libco's creation state is just as global. */
+static slock_t *coroutine_lock              = NULL;
+/* Id of the thread holding coroutine_lock, 0 if none; lets task_yield
+ * tell whether its caller is the running body without the lock */
+static retro_atomic_size_t coroutine_owner;
+#endif
+#endif
+
+#ifdef HAVE_LIBCO
+/* use coroutine_lock when touching it */
+static struct retro_task_coroutine *coroutine_current = NULL;
 #endif
 
 #ifdef HAVE_GCD
+static scond_t *worker_cond                 = NULL;
 static unsigned gcd_queue_count             = 0;
 #endif
 
@@ -196,7 +238,11 @@ static void retro_task_internal_gather(void)
       task_queue_push_progress(task);
 
       if (task->callback)
+      {
+         RETRO_PERF_BEGIN(perf_task_callback);
          task->callback(task, task->task_data, task->user_data, task->error);
+         RETRO_PERF_END(perf_task_callback);
+      }
 
       if (task->cleanup)
           task->cleanup(task);
@@ -252,7 +298,11 @@ static void retro_task_regular_gather(void)
 
       if (!task->when || task->when < cpu_features_get_time_usec())
       {
+         RETRO_TRACE_BEGIN("task_queue.handler");
+         RETRO_PERF_BEGIN(perf_task_handler);
          task->handler(task);
+         RETRO_PERF_END(perf_task_handler);
+         RETRO_TRACE_END("task_queue.handler");
 
          task_queue_push_progress(task);
       }
@@ -405,14 +455,77 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
    }
 }
 
+/* Every so many picks a worker looks at background tasks first,
+ * so that a steady stream of interactive work cannot starve them. */
+#define TASK_BACKGROUND_TURN 8
+
+#define TASK_READY_CLASS(task) \
+   (((task)->priority == TASK_PRIORITY_BACKGROUND) \
+      ? TASK_PRIORITY_BACKGROUND \
+      : TASK_PRIORITY_INTERACTIVE)
+
+/* 'ready_lock' must be held for the duration of this function */
+static void task_ready_put(retro_task_t *task)
+{
+   task_queue_t *queue = &tasks_ready[TASK_READY_CLASS(task)];
+
+   task->ready_next    = NULL;
+   if (queue->back)
+      queue->back->ready_next = task;
+   else
+      queue->front     = task;
+   queue->back         = task;
+}
+
+/* 'ready_lock' must be held for the duration of this function.
+ * Unlinks the first task in @queue whose start time has come.  If
+ * there is none, lowers *delay to the time until the earliest one
+ * will be due (*delay < 0 means no task is waiting on a timer). */
+static retro_task_t *task_ready_take(task_queue_t *queue,
+      retro_time_t now, retro_time_t *delay)
+{
+   retro_task_t *prev = NULL;
+   retro_task_t *task = queue->front;
+
+   for (; task; prev = task, task = task->ready_next)
+   {
+      /* allow half a millisecond for context switching */
+      retro_time_t wait = task->when ? task->when - now - 500 : 0;
+
+      if (wait > 0)
+      {
+         if (*delay < 0 || wait < *delay)
+            *delay = wait;
+         continue;
+      }
+
+      if (prev)
+         prev->ready_next = task->ready_next;
+      else
+         queue->front     = task->ready_next;
+      if (queue->back == task)
+         queue->back      = prev;
+      task->ready_next    = NULL;
+      return task;
+   }
+
+   return NULL;
+}
+
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
+
+   /* Only hand it to the workers once it is in tasks_running, where a
+    * worker finishing it will look for it */
+   slock_lock(ready_lock);
+   task_ready_put(task);
+   scond_signal(ready_cond);
+   slock_unlock(ready_lock);
 }
 
 static void retro_task_threaded_cancel(void *task)
@@ -510,41 +623,58 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
+   unsigned turn = 0;
+
+   RETRO_TRACE_THREAD_NAME("task_queue");
+
+   slock_lock(ready_lock);
+
    for (;;)
    {
-      retro_task_t *task  = NULL;
-      bool       finished = false;
-
-      slock_lock(running_lock);
+      retro_task_t *task       = NULL;
+      retro_time_t delay       = -1;
+      bool         finished    = false;
+      bool         background  = false;
+      /* Keep one worker free of background tasks for interactive ones */
+      bool         allow_bg    = (worker_count < 2)
+                              || (background_running + 1 < worker_count);
+      retro_time_t now;
 
       if (!worker_continue)
-      {
-         slock_unlock(running_lock);
          break; /* should we keep running until all tasks finished? */
-      }
+
+      now = cpu_features_get_time_usec();
 
       /* Get first task to run */
-      if (!(task = tasks_running.front))
+      if (allow_bg && (++turn % TASK_BACKGROUND_TURN) == 0)
+         task = task_ready_take(
+               &tasks_ready[TASK_PRIORITY_BACKGROUND], now, &delay);
+      if (!task)
+         task = task_ready_take(
+               &tasks_ready[TASK_PRIORITY_INTERACTIVE], now, &delay);
+      if (!task && allow_bg)
+         task = task_ready_take(
+               &tasks_ready[TASK_PRIORITY_BACKGROUND], now, &delay);
+
+      if (!task)
       {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
+         if (delay > 0)
+            scond_wait_timeout(ready_cond, ready_lock, delay);
+         else
+            scond_wait(ready_cond, ready_lock);
          continue;
       }
 
-      if (task->when)
-      {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
-         if (delay > 0)
-         {
-            scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
-         }
-      }
+      background = (TASK_READY_CLASS(task) == TASK_PRIORITY_BACKGROUND);
+      if (background)
+         background_running++;
+      slock_unlock(ready_lock);
 
-      slock_unlock(running_lock);
+      RETRO_TRACE_BEGIN("task_queue.handler");
+      RETRO_PERF_BEGIN(perf_task_handler);
       task->handler(task);
+      RETRO_PERF_END(perf_task_handler);
+      RETRO_TRACE_END("task_queue.handler");
 #if defined(EMSCRIPTEN) || defined(_3DS)
       /* Workaround emscripten pthread bug where not parking the
          thread will prevent other important stuff from
@@ -557,26 +687,7 @@ static void threaded_worker(void *userdata)
       finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
       slock_unlock(property_lock);
 
-      /* Update queue */
-      if (!finished)
-      {
-         /* Move the task to the back of the queue */
-         /* mimics retro_task_threaded_push_running,
-          * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
-         if (task->next)
-         {
-            task_queue_remove(&tasks_running, task);
-            task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
-         }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
-      }
-      else
+      if (finished)
       {
          /* Remove task from running queue */
          slock_lock(running_lock);
@@ -590,41 +701,113 @@ static void threaded_worker(void *userdata)
          task_queue_put(&tasks_finished, task);
          slock_unlock(finished_lock);
       }
+
+      slock_lock(ready_lock);
+      if (background)
+         background_running--;
+      /* Move an unfinished task to the back of its queue so that
+       * tasks of the same class take turns */
+      if (!finished)
+         task_ready_put(task);
+      /* Wake another worker for the requeued task, or for a
+       * background task that can now take the freed slot */
+      if (!finished || background)
+         scond_signal(ready_cond);
    }
+
+   slock_unlock(ready_lock);
+
+#ifdef HAVE_LIBCO
+   /* Coroutine stacks deleted here went to this thread's pool,
+    * which not every target empties on thread exit */
+   co_stack_pool_trim();
+#endif
 }
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+   unsigned count;
+   sthread_attr_t attr;
+   retro_task_t *task = NULL;
+
    running_lock    = slock_new();
    finished_lock   = slock_new();
    property_lock   = slock_new();
    queue_lock      = slock_new();
-   worker_cond     = scond_new();
-
-   slock_lock(running_lock);
-   worker_continue = true;
-   slock_unlock(running_lock);
-
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   ready_lock      = slock_new();
+   ready_cond      = scond_new();
+
+   slock_lock(ready_lock);
+   worker_continue    = true;
+   background_running = 0;
+   /* Tasks pushed before switching to threaded mode are still in
+    * tasks_running; queue them for the workers */
+   for (task = tasks_running.front; task; task = task->next)
+      task_ready_put(task);
+   slock_unlock(ready_lock);
+
+   count = cpu_features_get_core_amount();
+   if (count < 2)
+      count = 2;
+   if (count > TASK_QUEUE_MAX_WORKERS)
+      count = TASK_QUEUE_MAX_WORKERS;
+
+   /* worker_count is read by the workers, so publish it before the
+    * first one starts; trim it if a thread fails to start */
+   worker_count = count;
+   /* Task work is throughput work; keep it from preempting the
+    * audio, video and emulation threads */
+   sthread_attr_init(&attr);
+   attr.name        = "task_queue";
+   attr.sched_class = STHREAD_SCHED_BACKGROUND;
+   for (i = 0; i < count; i++)
+   {
+      if (!(worker_threads[i] = sthread_create_with_attr(threaded_worker,
+                  NULL, &attr)))
+         break;
+   }
+   if (i < count)
+   {
+      slock_lock(ready_lock);
+      worker_count = i;
+      slock_unlock(ready_lock);
+   }
 }
 
 static void retro_task_threaded_deinit(void)
 {
-   slock_lock(running_lock);
+   unsigned i;
+   unsigned count;
+
+   slock_lock(ready_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
-   slock_unlock(running_lock);
+   scond_broadcast(ready_cond);
+   count           = worker_count;
+   slock_unlock(ready_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < count; i++)
+   {
+      sthread_join(worker_threads[i]);
+      worker_threads[i] = NULL;
+   }
 
-   scond_free(worker_cond);
+   /* Tasks stay in tasks_running, on hold until the next init */
+   tasks_ready[TASK_PRIORITY_INTERACTIVE].front = NULL;
+   tasks_ready[TASK_PRIORITY_INTERACTIVE].back  = NULL;
+   tasks_ready[TASK_PRIORITY_BACKGROUND].front  = NULL;
+   tasks_ready[TASK_PRIORITY_BACKGROUND].back   = NULL;
+   worker_count    = 0;
+
+   scond_free(ready_cond);
+   slock_free(ready_lock);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
 
-   worker_thread   = NULL;
-   worker_cond     = NULL;
+   ready_cond      = NULL;
+   ready_lock      = NULL;
    running_lock    = NULL;
    finished_lock   = NULL;
    property_lock   = NULL;
@@ -647,6 +830,16 @@ static struct retro_task_impl impl_threaded = {
 
 #ifdef HAVE_GCD
 
+/* Background tasks run at utility QoS so that the system favours
+ * interactive ones */
+static dispatch_queue_t gcd_task_queue(retro_task_t *task)
+{
+   return dispatch_get_global_queue(
+         (task->priority == TASK_PRIORITY_BACKGROUND)
+         ? QOS_CLASS_UTILITY
+         : QOS_CLASS_USER_INITIATED, 0);
+}
+
 static void gcd_worker(retro_task_t *task)
 {
    bool       finished = false;
@@ -668,7 +861,7 @@ static void gcd_worker(retro_task_t *task)
       if (delay > 0)
       {
          dispatch_time_t after = dispatch_time(DISPATCH_TIME_NOW, delay);
-         dispatch_after(after, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+         dispatch_after(after, gcd_task_queue(task),
                         ^{ gcd_worker(task); });
          slock_unlock(running_lock);
          return;
@@ -677,14 +870,16 @@ static void gcd_worker(retro_task_t *task)
 
    slock_unlock(running_lock);
 
+   RETRO_PERF_BEGIN(perf_task_handler);
    task->handler(task);
+   RETRO_PERF_END(perf_task_handler);
 
    slock_lock(property_lock);
    finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
    slock_unlock(property_lock);
 
    if (!finished)
-      dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+      dispatch_async(gcd_task_queue(task),
                      ^{ gcd_worker(task); });
    else
    {
@@ -711,7 +906,7 @@ static void retro_task_gcd_push_running(retro_task_t *task)
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
    gcd_queue_count++;
-   dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+   dispatch_async(gcd_task_queue(task),
                   ^{ gcd_worker(task); });
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
@@ -758,7 +953,7 @@ static void retro_task_gcd_init(void)
    for (task = tasks_running.front; task; task = task->next)
    {
       gcd_queue_count++;
-      dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+      dispatch_async(gcd_task_queue(task),
                      ^{ gcd_worker(task); });
    };
    slock_unlock(running_lock);
@@ -808,6 +1003,12 @@ void task_queue_deinit(void)
    if (impl_current)
       impl_current->deinit();
    impl_current = NULL;
+#if defined(HAVE_THREADS) && defined(HAVE_LIBCO)
+   /* No handler can be running any more */
+   if (coroutine_lock)
+      slock_free(coroutine_lock);
+   coroutine_lock = NULL;
+#endif
 }
 
 void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push)
@@ -815,6 +1016,10 @@ void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push)
    impl_current   = &impl_regular;
 #ifdef HAVE_THREADS
    main_thread_id = sthread_get_current_thread_id();
+#ifdef HAVE_LIBCO
+   if (!coroutine_lock)
+      coroutine_lock = slock_new();
+#endif
    if (threaded)
    {
       task_threaded_enable = true;
@@ -906,6 +1111,7 @@ bool task_queue_push(retro_task_t *task)
 
    /* The lack of NULL checks in the following functions
     * is proposital to ensure correct control flow by the users. */
+   RETRO_PERF_ADD(perf_task_pushed, 1);
    impl_current->push_running(task);
 
    return true;
@@ -1146,7 +1352,134 @@ retro_task_t *task_init(void)
    task->ident             = task_count++;
    task->frontend_userdata = NULL;
    task->next              = NULL;
+   task->ready_next        = NULL;
    task->when              = 0;
+   task->priority          = TASK_PRIORITY_INTERACTIVE;
+
+   return task;
+}
+
+struct retro_task_coroutine
+{
+   retro_task_body_t body;
+   retro_task_t     *task;
+#ifdef HAVE_LIBCO
+   cothread_t        thread;    /* The body's own stack */
+   cothread_t        caller;    /* Context to return to on yield */
+   bool              done;      /* body has returned */
+#endif
+};
+
+#ifdef HAVE_LIBCO
+static void task_coroutine_entry(void)
+{
+   struct retro_task_coroutine *co = coroutine_current;
+
+   co->body(co->task);
+   co->done = true;
+   /* Never resumed: the handler deletes this cothread */
+   co_switch(co->caller);
+}
+#endif
+
+static void task_coroutine_handler(retro_task_t *task)
+{
+   struct retro_task_coroutine *co =
+      (struct retro_task_coroutine*)task->coroutine;
+#ifdef HAVE_LIBCO
+   bool finished;
+
+#ifdef HAVE_THREADS
+   slock_lock(coroutine_lock);
+   retro_atomic_store_release_size(&coroutine_owner,
+         (size_t)sthread_get_current_thread_id());
+#endif
+   co->caller        = co_active();
+   coroutine_current = co;
+   co_switch(co->thread);
+   coroutine_current = NULL;
+
+   finished = co->done
+      || ((task_get_flags(task) & RETRO_TASK_FLG_FINISHED) > 0);
+   /* A body that flagged itself finished and yielded is abandoned
+    * where it stopped, like any other finished task */
+   if (finished)
+      co_delete(co->thread);
+#ifdef HAVE_THREADS
+   retro_atomic_store_release_size(&coroutine_owner, 0);
+   slock_unlock(coroutine_lock);
+#endif
+
+   if (!finished)
+      return;
+#else
+   /* No cothreads: run the body straight through */
+   co->body(task);
+#endif
+
+   task->coroutine = NULL;
+   free(co);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+retro_task_t *task_init_coroutine(retro_task_body_t body,
+      unsigned stack_size)
+{
+   struct retro_task_coroutine *co;
+   retro_task_t *task;
 
+   if (!body)
+      return NULL;
+   if (!(task = task_init()))
+      return NULL;
+   if (!(co = (struct retro_task_coroutine*)calloc(1, sizeof(*co))))
+   {
+      free(task);
+      return NULL;
+   }
+
+   co->body = body;
+   co->task = task;
+#ifdef HAVE_LIBCO
+#ifdef HAVE_THREADS
+   /* NULL before task_queue_init, when no worker can be running */
+   slock_lock(coroutine_lock);
+#endif
+   co->thread = co_create(stack_size
+         ? stack_size : TASK_COROUTINE_STACK_SIZE,
+         task_coroutine_entry);
+#ifdef HAVE_THREADS
+   slock_unlock(coroutine_lock);
+#endif
+   if (!co->thread)
+   {
+      free(co);
+      free(task);
+      return NULL;
+   }
+#endif
+
+   task->handler   = task_coroutine_handler;
+   task->coroutine = co;
    return task;
 }
+
+void task_yield(void)
+{
+#ifdef HAVE_LIBCO
+   struct retro_task_coroutine *co;
+
+#ifdef HAVE_THREADS
+   /* Only the thread running a body holds coroutine_lock, and only
+    * that thread may look at coroutine_current */
+   if (retro_atomic_load_acquire_size(&coroutine_owner)
+         != (size_t)sthread_get_current_thread_id())
+      return;
+#endif
+   co = coroutine_current;
+   if (!co || co_active() != co->thread)
+      return;
+   co_switch(co->caller);
+#endif
+}
+
@@ -20,6 +20,14 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#ifdef __linux__
+/* syscall(2) for the futex backend and pthread_setname_np are GNU
+ * extensions; glibc hides them under plain _POSIX_C_SOURCE. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#endif
+
 #ifdef __unix__
 #ifndef __sun__
 #ifndef _POSIX_C_SOURCE
@@ -32,6 +40,7 @@
 #include <string.h>
 
 #include <boolean.h>
+#include <retro_atomic.h>
 #include <rthreads/rthreads.h>
 
 /* with RETRO_WIN32_USE_PTHREADS, pthreads can be used even on win32.
@@ -84,12 +93,61 @@
 #define RTHREADS_HAVE_QOS_OVERRIDE 1
 #include <pthread/qos.h>
 #endif
+/* pthread_setname_np(const char*) is macOS 10.6+ / iOS 3.2+. */
+#if (TARGET_OS_OSX && defined(MAC_OS_X_VERSION_MIN_REQUIRED) && MAC_OS_X_VERSION_MIN_REQUIRED >= 1060) || \
+    (TARGET_OS_IPHONE && defined(__IPHONE_OS_VERSION_MIN_REQUIRED) && __IPHONE_OS_VERSION_MIN_REQUIRED >= 30200)
+#define RTHREADS_HAVE_SETNAME 1
+#endif
+#endif
+
+/* Linux thread attributes: names via prctl, affinity via
+ * sched_setaffinity and per-thread nice via setpriority on the TID. */
+#if defined(__linux__) && !defined(USE_WIN32_THREADS) && !defined(EMSCRIPTEN)
+#define RTHREADS_HAVE_LINUX_ATTR 1
+#include <limits.h> /* PTHREAD_STACK_MIN */
+#include <sched.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+/* On Linux, slock_t and scond_t sit directly on futex(2) instead of
+ * pthread_mutex_t / pthread_cond_t: an uncontended lock or unlock is a
+ * single atomic with no call into libpthread, a contended lock spins
+ * briefly before it sleeps, and a signal with no waiter makes no
+ * syscall.  Define RTHREADS_NO_FUTEX to keep the pthread backend
+ * (samples/rthreads/rthreads_lock_bench builds both). */
+#if defined(__linux__) && !defined(USE_WIN32_THREADS) && !defined(EMSCRIPTEN) && !defined(RTHREADS_NO_FUTEX) && defined(RETRO_ATOMIC_LOCK_FREE)
+#define RTHREADS_USE_FUTEX 1
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* Upper bound on adaptive spin iterations before a contended
+ * slock_lock sleeps; same default as glibc's adaptive mutexes. */
+#ifndef RTHREADS_SPIN_MAX
+#define RTHREADS_SPIN_MAX 100
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define RTHREADS_CPU_RELAX() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+#define RTHREADS_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define RTHREADS_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
 #endif
 
 struct thread_data
 {
    void (*func)(void*);
    void *userdata;
+   sthread_attr_t attr;
+   bool has_attr;
+   char name[32];   /* attr.name points here */
 };
 
 struct sthread
@@ -106,6 +164,11 @@ struct slock
 {
 #ifdef USE_WIN32_THREADS
    CRITICAL_SECTION lock;
+#elif defined(RTHREADS_USE_FUTEX)
+   /* 0 = unlocked, 1 = locked, 2 = locked and a thread may be asleep */
+   retro_atomic_int_t state;
+   /* Running average of spins that ended in an acquire */
+   retro_atomic_int_t spin;
 #else
    pthread_mutex_t lock;
 #endif
@@ -147,6 +210,12 @@ struct scond
    /* used to control access to this scond, in case the user fails */
    CRITICAL_SECTION cs;
 
+#elif defined(RTHREADS_USE_FUTEX)
+   /* Bumped by every signal and broadcast; waiters sleep on it */
+   retro_atomic_int_t seq;
+   /* Threads between scond_wait entry and exit; lets signal skip the
+    * wake syscall when nobody is waiting */
+   retro_atomic_int_t waiters;
 #else
    pthread_cond_t cond;
 #endif
@@ -161,6 +230,9 @@ static void *thread_wrap(void *data_)
    struct thread_data *data = (struct thread_data*)data_;
    if (!data)
       return 0;
+   /* Best effort: the thread runs even if the OS refuses a setting */
+   if (data->has_attr)
+      sthread_set_current_attr(&data->attr);
    data->func(data->userdata);
    free(data);
    return 0;
@@ -176,7 +248,8 @@ sthread_t *sthread_create(void (*thread_func)(void*), void *userdata)
 #define HAVE_THREAD_ATTR
 #endif
 
-sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userdata, int thread_priority)
+static sthread_t *sthread_create_internal(void (*thread_func)(void*),
+      void *userdata, int thread_priority, const sthread_attr_t *attr)
 {
 #ifdef HAVE_THREAD_ATTR
    pthread_attr_t thread_attr;
@@ -197,9 +270,28 @@ sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userda
 
    data->func               = thread_func;
    data->userdata           = userdata;
+   data->has_attr           = (attr != NULL);
+   if (attr)
+   {
+      data->attr            = *attr;
+      data->name[0]         = '\0';
+      if (attr->name)
+      {
+         strncpy(data->name, attr->name, sizeof(data->name) - 1);
+         data->name[sizeof(data->name) - 1] = '\0';
+      }
+      data->attr.name       = data->name;
+   }
 
    thread->id               = 0;
 #ifdef USE_WIN32_THREADS
+#ifdef STACK_SIZE_PARAM_IS_A_RESERVATION
+   if (attr && attr->stack_size)
+      thread->thread        = CreateThread(NULL, attr->stack_size,
+            thread_wrap, data, STACK_SIZE_PARAM_IS_A_RESERVATION,
+            &thread->id);
+   else
+#endif
    thread->thread           = CreateThread(NULL, 0, thread_wrap,
          data, 0, &thread->id);
    thread_created           = !!thread->thread;
@@ -228,6 +320,17 @@ sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userda
    thread_attr_needed = true;
 #endif
 
+   if (attr && attr->stack_size)
+   {
+      size_t stack_size = attr->stack_size;
+#ifdef PTHREAD_STACK_MIN
+      if (stack_size < (size_t)PTHREAD_STACK_MIN)
+         stack_size = (size_t)PTHREAD_STACK_MIN;
+#endif
+      if (pthread_attr_setstacksize(&thread_attr, stack_size) == 0)
+         thread_attr_needed = true;
+   }
+
    if (thread_attr_needed)
       thread_created = pthread_create(&thread->id, &thread_attr, thread_wrap, data) == 0;
    else
@@ -247,6 +350,132 @@ sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userda
    return NULL;
 }
 
+sthread_t *sthread_create_with_priority(void (*thread_func)(void*), void *userdata, int thread_priority)
+{
+   return sthread_create_internal(thread_func, userdata, thread_priority,
+         NULL);
+}
+
+void sthread_attr_init(sthread_attr_t *attr)
+{
+   if (!attr)
+      return;
+   attr->name        = NULL;
+   attr->affinity    = 0;
+   attr->stack_size  = 0;
+   attr->sched_class = STHREAD_SCHED_DEFAULT;
+   attr->priority    = 0;
+}
+
+sthread_t *sthread_create_with_attr(void (*thread_func)(void*),
+      void *userdata, const sthread_attr_t *attr)
+{
+   return sthread_create_internal(thread_func, userdata, 0, attr);
+}
+
+static bool sthread_set_current_name(const char *name)
+{
+#if defined(RTHREADS_HAVE_LINUX_ATTR)
+   /* The kernel keeps 15 characters and truncates the rest */
+   return prctl(PR_SET_NAME, (unsigned long)name, 0, 0, 0) == 0;
+#elif defined(RTHREADS_HAVE_SETNAME)
+   return pthread_setname_np(name) == 0;
+#elif defined(USE_WIN32_THREADS) && !defined(_XBOX)
+   /* SetThreadDescription is Windows 10 1607+; look it up at runtime */
+   typedef HRESULT (WINAPI *set_desc_t)(HANDLE, PCWSTR);
+   WCHAR      wide[64];
+   set_desc_t set_desc = (set_desc_t)(void*)GetProcAddress(
+         GetModuleHandleA("kernel32.dll"), "SetThreadDescription");
+   if (!set_desc || !MultiByteToWideChar(CP_UTF8, 0, name, -1,
+            wide, sizeof(wide) / sizeof(wide[0])))
+      return false;
+   return SUCCEEDED(set_desc(GetCurrentThread(), wide));
+#else
+   (void)name;
+   return false;
+#endif
+}
+
+static bool sthread_set_current_affinity(uint64_t mask)
+{
+#if defined(RTHREADS_HAVE_LINUX_ATTR)
+   unsigned  i;
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   for (i = 0; i < 64; i++)
+      if (mask & ((uint64_t)1 << i))
+         CPU_SET(i, &set);
+   return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(USE_WIN32_THREADS) && !defined(_XBOX)
+   return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask) != 0;
+#else
+   (void)mask;
+   return false;
+#endif
+}
+
+static bool sthread_set_current_sched(enum sthread_sched_class sched_class,
+      int priority)
+{
+#if defined(RTHREADS_HAVE_LINUX_ATTR)
+   if (sched_class == STHREAD_SCHED_REALTIME)
+   {
+      struct sched_param sp;
+      memset(&sp, 0, sizeof(sp));
+      sp.sched_priority = priority > 0
+         ? priority : sched_get_priority_min(SCHED_FIFO);
+      return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+   }
+   if (sched_class == STHREAD_SCHED_BACKGROUND && priority == 0)
+      priority = STHREAD_BACKGROUND_NICE;
+   if (priority == 0)
+      return true;
+   /* Linux applies nice per thread when given a TID */
+   return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid),
+         priority) == 0;
+#elif defined(RTHREADS_HAVE_QOS_OVERRIDE)
+   (void)priority;
+   switch (sched_class)
+   {
+      case STHREAD_SCHED_REALTIME:
+         return pthread_set_qos_class_self_np(
+               QOS_CLASS_USER_INTERACTIVE, 0) == 0;
+      case STHREAD_SCHED_BACKGROUND:
+         return pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0) == 0;
+      default:
+         break;
+   }
+   return true;
+#elif defined(USE_WIN32_THREADS)
+   int level = THREAD_PRIORITY_NORMAL;
+   if (sched_class == STHREAD_SCHED_REALTIME)
+      level = THREAD_PRIORITY_TIME_CRITICAL;
+   else if (sched_class == STHREAD_SCHED_BACKGROUND || priority > 0)
+      level = THREAD_PRIORITY_BELOW_NORMAL;
+   else if (priority < 0)
+      level = THREAD_PRIORITY_ABOVE_NORMAL;
+   else
+      return true;
+   return SetThreadPriority(GetCurrentThread(), level) != 0;
+#else
+   return sched_class == STHREAD_SCHED_DEFAULT && priority == 0;
+#endif
+}
+
+bool sthread_set_current_attr(const sthread_attr_t *attr)
+{
+   bool ret = true;
+   if (!attr)
+      return true;
+   if (attr->name && *attr->name && !sthread_set_current_name(attr->name))
+      ret = false;
+   if (attr->affinity && !sthread_set_current_affinity(attr->affinity))
+      ret = false;
+   if (!sthread_set_current_sched(attr->sched_class, attr->priority))
+      ret = false;
+   return ret;
+}
+
 int sthread_detach(sthread_t *thread)
 {
 #ifdef USE_WIN32_THREADS
@@ -289,6 +518,108 @@ bool sthread_isself(sthread_t *thread)
 }
 #endif
 
+#ifdef RTHREADS_USE_FUTEX
+/* 0 = not probed yet, 1 = uniprocessor, 2 = SMP */
+static retro_atomic_int_t rthreads_cpu_kind = RETRO_ATOMIC_INT_INITIALIZER(0);
+
+static int rthreads_futex_wait(retro_atomic_int_t *addr, int expected,
+      const struct timespec *timeout)
+{
+   return (int)syscall(SYS_futex, (int*)(void*)addr, FUTEX_WAIT_PRIVATE,
+         expected, timeout, NULL, 0);
+}
+
+static void rthreads_futex_wake(retro_atomic_int_t *addr, int count)
+{
+   syscall(SYS_futex, (int*)(void*)addr, FUTEX_WAKE_PRIVATE,
+         count, NULL, NULL, 0);
+}
+
+static void rthreads_timeout_to_timespec(int64_t timeout_us,
+      struct timespec *ts)
+{
+   if (timeout_us < 0)
+      timeout_us = 0;
+   ts->tv_sec  = (time_t)(timeout_us / INT64_C(1000000));
+   ts->tv_nsec = (long)(timeout_us % INT64_C(1000000)) * 1000L;
+}
+
+static int rthreads_exchange_int(retro_atomic_int_t *p, int v)
+{
+   int old;
+   do
+   {
+      old = retro_atomic_load_acquire_int(p);
+   } while (!retro_atomic_cas_int(p, old, v));
+   return old;
+}
+
+/* Spinning only pays off when the lock owner can run at the same
+ * time as the spinner. */
+static bool rthreads_can_spin(void)
+{
+   int kind = retro_atomic_load_acquire_int(&rthreads_cpu_kind);
+   if (!kind)
+   {
+      kind = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? 2 : 1;
+      retro_atomic_store_release_int(&rthreads_cpu_kind, kind);
+   }
+   return kind == 2;
+}
+
+/* Drepper's three-state futex mutex ("Futexes Are Tricky", mutex 3)
+ * with a bounded adaptive spin in front of the sleep.  The spin
+ * budget tracks a running average of how long acquires took, like
+ * glibc's PTHREAD_MUTEX_ADAPTIVE_NP, so locks held for long stretches
+ * stop spinning and short critical sections rarely reach the kernel. */
+static void slock_lock_futex(slock_t *lock)
+{
+   if (rthreads_can_spin())
+   {
+      int i;
+      int spin  = retro_atomic_load_acquire_int(&lock->spin);
+      int limit = spin * 2 + 10;
+      if (limit > RTHREADS_SPIN_MAX)
+         limit = RTHREADS_SPIN_MAX;
+      for (i = 0; i < limit; i++)
+      {
+         RTHREADS_CPU_RELAX();
+         if (     retro_atomic_load_acquire_int(&lock->state) == 0
+               && retro_atomic_cas_int(&lock->state, 0, 1))
+         {
+            retro_atomic_store_release_int(&lock->spin,
+                  spin + (i - spin) / 8);
+            return;
+         }
+      }
+      retro_atomic_store_release_int(&lock->spin,
+            spin + (limit - spin) / 8);
+   }
+
+   /* Mark the lock contended so the owner's unlock wakes us */
+   while (rthreads_exchange_int(&lock->state, 2) != 0)
+      rthreads_futex_wait(&lock->state, 2, NULL);
+}
+
+static bool scond_wait_futex(scond_t *cond, slock_t *lock,
+      const struct timespec *timeout)
+{
+   int  seq;
+   bool timed_out;
+
+   retro_atomic_inc_int(&cond->waiters);
+   /* Read through an RMW so that this and the waiters check in
+    * scond_signal cannot both miss each other's update. */
+   seq       = retro_atomic_fetch_add_int(&cond->seq, 0);
+   slock_unlock(lock);
+   timed_out = rthreads_futex_wait(&cond->seq, seq, timeout) == -1
+      && errno == ETIMEDOUT;
+   retro_atomic_dec_int(&cond->waiters);
+   slock_lock(lock);
+   return !timed_out;
+}
+#endif
+
 slock_t *slock_new(void)
 {
    slock_t      *lock = (slock_t*)calloc(1, sizeof(*lock));
@@ -296,6 +627,9 @@ slock_t *slock_new(void)
       return NULL;
 #ifdef USE_WIN32_THREADS
    InitializeCriticalSection(&lock->lock);
+#elif defined(RTHREADS_USE_FUTEX)
+   retro_atomic_int_init(&lock->state, 0);
+   retro_atomic_int_init(&lock->spin, 0);
 #else
    if (pthread_mutex_init(&lock->lock, NULL) != 0)
    {
@@ -313,6 +647,7 @@ void slock_free(slock_t *lock)
 
 #ifdef USE_WIN32_THREADS
    DeleteCriticalSection(&lock->lock);
+#elif defined(RTHREADS_USE_FUTEX)
 #else
    pthread_mutex_destroy(&lock->lock);
 #endif
@@ -325,6 +660,9 @@ void slock_lock(slock_t *lock)
       return;
 #ifdef USE_WIN32_THREADS
    EnterCriticalSection(&lock->lock);
+#elif defined(RTHREADS_USE_FUTEX)
+   if (!retro_atomic_cas_int(&lock->state, 0, 1))
+      slock_lock_futex(lock);
 #else
    pthread_mutex_lock(&lock->lock);
 #endif
@@ -334,6 +672,8 @@ bool slock_try_lock(slock_t *lock)
 {
 #ifdef USE_WIN32_THREADS
    return lock && TryEnterCriticalSection(&lock->lock);
+#elif defined(RTHREADS_USE_FUTEX)
+   return lock && retro_atomic_cas_int(&lock->state, 0, 1);
 #else
    return lock && (pthread_mutex_trylock(&lock->lock) == 0);
 #endif
@@ -345,6 +685,12 @@ void slock_unlock(slock_t *lock)
       return;
 #ifdef USE_WIN32_THREADS
    LeaveCriticalSection(&lock->lock);
+#elif defined(RTHREADS_USE_FUTEX)
+   if (retro_atomic_fetch_sub_int(&lock->state, 1) != 1)
+   {
+      retro_atomic_store_release_int(&lock->state, 0);
+      rthreads_futex_wake(&lock->state, 1);
+   }
 #else
    pthread_mutex_unlock(&lock->lock);
 #endif
@@ -396,6 +742,9 @@ scond_t *scond_new(void)
    }
 
    InitializeCriticalSection(&cond->cs);
+#elif defined(RTHREADS_USE_FUTEX)
+   retro_atomic_int_init(&cond->seq, 0);
+   retro_atomic_int_init(&cond->waiters, 0);
 #else
    if (pthread_cond_init(&cond->cond, NULL) != 0)
    {
@@ -416,6 +765,7 @@ void scond_free(scond_t *cond)
    CloseHandle(cond->event);
    CloseHandle(cond->hot_potato);
    DeleteCriticalSection(&cond->cs);
+#elif defined(RTHREADS_USE_FUTEX)
 #else
    pthread_cond_destroy(&cond->cond);
 #endif
@@ -644,6 +994,8 @@ void scond_wait(scond_t *cond, slock_t *lock)
 {
 #ifdef USE_WIN32_THREADS
    scond_wait_win32(cond, lock, INFINITE);
+#elif defined(RTHREADS_USE_FUTEX)
+   scond_wait_futex(cond, lock, NULL);
 #else
    pthread_cond_wait(&cond->cond, &lock->lock);
 #endif
@@ -665,6 +1017,11 @@ int scond_broadcast(scond_t *cond)
    }
    LeaveCriticalSection(&cond->cs);
    return 0;
+#elif defined(RTHREADS_USE_FUTEX)
+   retro_atomic_inc_int(&cond->seq);
+   if (retro_atomic_fetch_add_int(&cond->waiters, 0) > 0)
+      rthreads_futex_wake(&cond->seq, INT_MAX);
+   return 0;
 #else
    return pthread_cond_broadcast(&cond->cond);
 #endif
@@ -703,6 +1060,10 @@ void scond_signal(scond_t *cond)
    /* Since there is now at least one pending waken, the potato must be in play */
    SetEvent(cond->hot_potato);
 
+#elif defined(RTHREADS_USE_FUTEX)
+   retro_atomic_inc_int(&cond->seq);
+   if (retro_atomic_fetch_add_int(&cond->waiters, 0) > 0)
+      rthreads_futex_wake(&cond->seq, 1);
 #else
    pthread_cond_signal(&cond->cond);
 #endif
@@ -730,6 +1091,10 @@ bool scond_wait_timeout(scond_t *cond, slock_t *lock, int64_t timeout_us)
    /* Someone asking for 1000 or 1001 timeout shouldn't
     * accidentally get 2ms. */
    return scond_wait_win32(cond, lock, timeout_us / 1000);
+#elif defined(RTHREADS_USE_FUTEX)
+   struct timespec timeout;
+   rthreads_timeout_to_timespec(timeout_us, &timeout);
+   return scond_wait_futex(cond, lock, &timeout);
 #else
    int64_t seconds, remainder;
    struct timespec now;
@@ -789,6 +1154,118 @@ bool scond_wait_timeout(scond_t *cond, slock_t *lock, int64_t timeout_us)
 #endif
 }
 
+#ifdef RTHREADS_USE_FUTEX
+int retro_atomic_wait_int(retro_atomic_int_t *p, int expected,
+      int64_t timeout_us)
+{
+   struct timespec timeout;
+
+   if (retro_atomic_load_acquire_int(p) != expected)
+      return 1;
+   if (timeout_us < 0)
+      rthreads_futex_wait(p, expected, NULL);
+   else
+   {
+      rthreads_timeout_to_timespec(timeout_us, &timeout);
+      if (     rthreads_futex_wait(p, expected, &timeout) == -1
+            && errno == ETIMEDOUT)
+         return 0;
+   }
+   return 1;
+}
+
+void retro_atomic_notify_one_int(retro_atomic_int_t *p)
+{
+   rthreads_futex_wake(p, 1);
+}
+
+void retro_atomic_notify_all_int(retro_atomic_int_t *p)
+{
+   rthreads_futex_wake(p, INT_MAX);
+}
+#else
+/* Without a native address wait, waiters park on one of a fixed set
+ * of slock_t/scond_t pairs picked by hashing the address.  Buckets
+ * are created on first use and live for the rest of the process.
+ * Unrelated addresses can share a bucket, so notify always
+ * broadcasts and waiters must expect spurious returns. */
+#define RTHREADS_WAIT_BUCKETS 64
+
+struct rthreads_wait_bucket
+{
+   slock_t *lock;
+   scond_t *cond;
+};
+
+static retro_atomic_size_t rthreads_wait_buckets[RTHREADS_WAIT_BUCKETS];
+
+static struct rthreads_wait_bucket *rthreads_wait_bucket_get(
+      const void *addr)
+{
+   size_t                       idx = ((uintptr_t)addr >> 4)
+      % RTHREADS_WAIT_BUCKETS;
+   struct rthreads_wait_bucket *bucket = (struct rthreads_wait_bucket*)
+      retro_atomic_load_acquire_size(&rthreads_wait_buckets[idx]);
+
+   if (bucket)
+      return bucket;
+
+   if (!(bucket = (struct rthreads_wait_bucket*)calloc(1, sizeof(*bucket))))
+      return NULL;
+   bucket->lock = slock_new();
+   bucket->cond = scond_new();
+   if (     !bucket->lock
+         || !bucket->cond
+         || !retro_atomic_cas_size(&rthreads_wait_buckets[idx], 0,
+            (size_t)(uintptr_t)bucket))
+   {
+      /* Lost the race (or out of memory); use whatever is there */
+      slock_free(bucket->lock);
+      scond_free(bucket->cond);
+      free(bucket);
+      bucket = (struct rthreads_wait_bucket*)
+         retro_atomic_load_acquire_size(&rthreads_wait_buckets[idx]);
+   }
+   return bucket;
+}
+
+int retro_atomic_wait_int(retro_atomic_int_t *p, int expected,
+      int64_t timeout_us)
+{
+   int                          woken  = 1;
+   struct rthreads_wait_bucket *bucket = rthreads_wait_bucket_get(p);
+
+   if (!bucket)
+      return 1;
+   slock_lock(bucket->lock);
+   if (retro_atomic_load_acquire_int(p) == expected)
+   {
+      if (timeout_us < 0)
+         scond_wait(bucket->cond, bucket->lock);
+      else
+         woken = scond_wait_timeout(bucket->cond, bucket->lock,
+               timeout_us) ? 1 : 0;
+   }
+   slock_unlock(bucket->lock);
+   return woken;
+}
+
+void retro_atomic_notify_all_int(retro_atomic_int_t *p)
+{
+   struct rthreads_wait_bucket *bucket = rthreads_wait_bucket_get(p);
+   if (!bucket)
+      return;
+   slock_lock(bucket->lock);
+   scond_broadcast(bucket->cond);
+   slock_unlock(bucket->lock);
+}
+
+void retro_atomic_notify_one_int(retro_atomic_int_t *p)
+{
+   retro_atomic_notify_all_int(p);
+}
+#endif
+
 #ifdef HAVE_THREAD_STORAGE
 bool sthread_tls_create(sthread_tls_t *tls)
 {
@@ -25,11 +25,522 @@
  * THE SOFTWARE
  */
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <boolean.h>
 
 #include <rthreads/rthreads.h>
 #include <rthreads/tpool.h>
+#include <retro_atomic.h>
+#include <retro_trace.h>
+
+/* The work-stealing scheduler needs real atomics; on the volatile
+ * fallback, or when TPOOL_NO_WORK_STEALING is defined, the pool uses
+ * the original single locked queue instead. */
+#if defined(RETRO_ATOMIC_LOCK_FREE) && !defined(TPOOL_NO_WORK_STEALING)
+#define TPOOL_WORK_STEALING 1
+#endif
+
+#ifdef TPOOL_WORK_STEALING
+
+#include <retro_mpmc.h>
+
+/* Scheduler layout
+ *
+ * Every worker owns a fixed-size Chase-Lev deque.  Work added from
+ * inside a job goes onto the bottom of the running worker's deque and
+ * that worker takes it back LIFO, which keeps a job's children hot in
+ * its cache.  Idle workers steal from the top of other workers' deques.
+ *
+ * Work added from outside the pool goes through a shared lock-free
+ * injection queue (retro_mpmc).  Only when that is full does a
+ * submitter fall back to an overflow list under work_mutex.
+ *
+ * Work items are recycled through a lock-free free list instead of
+ * being malloc'ed and freed for every job.
+ *
+ * An idle worker spins over all the queues for TPOOL_SPIN_ROUNDS
+ * rounds before parking on work_cond.  Submitters only take
+ * work_mutex to wake a worker when one is actually parked. */
+
+#define TPOOL_DEQUE_SIZE  1024 /* per worker, power of 2 */
+#define TPOOL_INJECT_SIZE 1024 /* shared injection queue */
+#define TPOOL_FREE_SIZE   1024 /* recycled work items kept */
+#define TPOOL_SPIN_ROUNDS 64
+#define TPOOL_CACHE_LINE  64
+
+#define TPOOL_PAD_BYTES \
+   ((TPOOL_CACHE_LINE > sizeof(retro_atomic_size_t)) \
+      ? (TPOOL_CACHE_LINE - sizeof(retro_atomic_size_t)) \
+      : 1)
+
+struct tpool_work
+{
+   thread_func_t      func;    /* Function to be called. */
+   thread_func_t      discard; /* Called instead if the pool is destroyed first. */
+   void              *arg;     /* Data to be passed to func. */
+   struct tpool_work *next;    /* Next work item in the overflow list. */
+};
+typedef struct tpool_work tpool_work_t;
+
+struct tpool_worker
+{
+   retro_atomic_size_t  top;      /* Next index thieves take from. */
+   uint8_t              _pad0[TPOOL_PAD_BYTES];
+   retro_atomic_size_t  bottom;   /* Next index the owner pushes to. */
+   uint8_t              _pad1[TPOOL_PAD_BYTES];
+   retro_atomic_size_t  slots[TPOOL_DEQUE_SIZE]; /* tpool_work_t pointers. */
+   struct tpool        *tp;
+   sthread_t           *thread;
+   size_t               index;    /* Position in tp->workers. */
+   size_t               victim;   /* Where the next steal attempt starts. */
+};
+typedef struct tpool_worker tpool_worker_t;
+
+struct tpool
+{
+   tpool_worker_t     *workers;       /* One deque per worker thread. */
+   size_t              worker_cnt;    /* Number of entries in workers. */
+   size_t              thread_cnt;    /* Workers whose thread is running. */
+   retro_mpmc_t        inject;        /* Work added from outside the pool. */
+   retro_mpmc_t        free_items;    /* Recycled work items. */
+   tpool_work_t       *overflow_first; /* Work that did not fit in inject. */
+   tpool_work_t       *overflow_last;
+   slock_t            *work_mutex;    /* Protects the overflow list and parking. */
+   scond_t            *work_cond;     /* Signalled when work arrives for a parked worker. */
+   scond_t            *working_cond;  /* Signalled when outstanding drops to 0. */
+   retro_atomic_size_t outstanding;   /* Work added but not yet finished. */
+   retro_atomic_size_t pending;       /* Work queued but not yet taken by a worker. */
+   retro_atomic_size_t overflow_cnt;  /* Entries in the overflow list. */
+   retro_atomic_int_t  sleeping;      /* Workers parked on work_cond. */
+   retro_atomic_int_t  stop;          /* Marker to tell the work threads to exit. */
+};
+
+static tpool_work_t *tpool_work_create(tpool_t *tp,
+      thread_func_t func, thread_func_t discard, void *arg)
+{
+   tpool_work_t *work;
+
+   if (!func)
+      return NULL;
+
+   if (!retro_mpmc_pop(&tp->free_items, &work))
+   {
+      work = (tpool_work_t*)malloc(sizeof(*work));
+      if (!work)
+         return NULL;
+   }
+   work->func    = func;
+   work->discard = discard;
+   work->arg     = arg;
+   work->next    = NULL;
+   return work;
+}
+
+static void tpool_work_destroy(tpool_t *tp, tpool_work_t *work)
+{
+   if (!retro_mpmc_push(&tp->free_items, &work))
+      free(work);
+}
+
+/* Owner only.  Returns false when the deque is full. */
+static bool tpool_deque_push(tpool_worker_t *w, tpool_work_t *work)
+{
+   size_t b = retro_atomic_load_acquire_size(&w->bottom);
+   size_t t = retro_atomic_load_acquire_size(&w->top);
+
+   if (b - t >= TPOOL_DEQUE_SIZE)
+      return false;
+
+   retro_atomic_store_release_size(&w->slots[b & (TPOOL_DEQUE_SIZE - 1)],
+         (size_t)(uintptr_t)work);
+   retro_atomic_store_release_size(&w->bottom, b + 1);
+   return true;
+}
+
+/* Owner only.  Takes the most recently pushed item. */
+static tpool_work_t *tpool_deque_pop(tpool_worker_t *w)
+{
+   tpool_work_t *work;
+   size_t b = retro_atomic_load_acquire_size(&w->bottom);
+   size_t t = retro_atomic_load_acquire_size(&w->top);
+
+   if (b == t)
+      return NULL;
+
+   b--;
+   retro_atomic_store_release_size(&w->bottom, b);
+   /* Read top with an RMW rather than a plain load: it observes the
+    * latest top and orders the bottom store above before any later
+    * steal, which is the job the seq_cst fence does in the original
+    * algorithm. */
+   t = retro_atomic_fetch_add_size(&w->top, 0);
+
+   if ((ptrdiff_t)(b - t) < 0)
+   {
+      /* Thieves emptied it first */
+      retro_atomic_store_release_size(&w->bottom, t);
+      return NULL;
+   }
+
+   work = (tpool_work_t*)(uintptr_t)retro_atomic_load_acquire_size(
+         &w->slots[b & (TPOOL_DEQUE_SIZE - 1)]);
+   if (b != t)
+      return work;
+
+   /* Last item: race the thieves for it */
+   if (!retro_atomic_cas_size(&w->top, t, t + 1))
+      work = NULL;
+   retro_atomic_store_release_size(&w->bottom, t + 1);
+   return work;
+}
+
+/* Any thread.  Takes the oldest item, or NULL if the deque is empty
+ * or another thread won the race for it. */
+static tpool_work_t *tpool_deque_steal(tpool_worker_t *w)
+{
+   tpool_work_t *work;
+   size_t t = retro_atomic_load_acquire_size(&w->top);
+   size_t b = retro_atomic_load_acquire_size(&w->bottom);
+
+   if ((ptrdiff_t)(b - t) <= 0)
+      return NULL;
+
+   /* The slot can only be reused once top has moved past t, in which
+    * case the CAS below fails and the value read is discarded. */
+   work = (tpool_work_t*)(uintptr_t)retro_atomic_load_acquire_size(
+         &w->slots[t & (TPOOL_DEQUE_SIZE - 1)]);
+   if (!retro_atomic_cas_size(&w->top, t, t + 1))
+      return NULL;
+   return work;
+}
+
+/* The worker running on the calling thread, if it belongs to @tp. */
+static tpool_worker_t *tpool_current_worker(tpool_t *tp)
+{
+   size_t i;
+   for (i = 0; i < tp->worker_cnt; i++)
+      if (tp->workers[i].thread && sthread_isself(tp->workers[i].thread))
+         return &tp->workers[i];
+   return NULL;
+}
+
+/* Append to the overflow list.  Caller holds work_mutex. */
+static void tpool_overflow_add(tpool_t *tp, tpool_work_t *work)
+{
+   if (!tp->overflow_first)
+      tp->overflow_first      = work;
+   else
+      tp->overflow_last->next = work;
+   tp->overflow_last          = work;
+}
+
+/* Pull the first work item out of the overflow list.
+ * Caller holds work_mutex. */
+static tpool_work_t *tpool_overflow_get(tpool_t *tp)
+{
+   tpool_work_t *work = tp->overflow_first;
+
+   if (!work)
+      return NULL;
+
+   tp->overflow_first = work->next;
+   if (!tp->overflow_first)
+      tp->overflow_last = NULL;
+   work->next         = NULL;
+   return work;
+}
+
+static tpool_work_t *tpool_find_work(tpool_t *tp, tpool_worker_t *w)
+{
+   size_t        i;
+   tpool_work_t *work = tpool_deque_pop(w);
+
+   if (work)
+      return work;
+
+   if (retro_mpmc_pop(&tp->inject, &work))
+      return work;
+
+   if (retro_atomic_load_acquire_size(&tp->overflow_cnt) > 0)
+   {
+      slock_lock(tp->work_mutex);
+      work = tpool_overflow_get(tp);
+      if (work)
+         retro_atomic_dec_size(&tp->overflow_cnt);
+      slock_unlock(tp->work_mutex);
+      if (work)
+         return work;
+   }
+
+   /* Visit every other worker once, starting after the last victim
+    * so that thieves spread out instead of all hitting worker 0. */
+   for (i = 0; i < tp->worker_cnt; i++)
+   {
+      tpool_worker_t *victim;
+      w->victim = (w->victim + 1) % tp->worker_cnt;
+      if (w->victim == w->index)
+         continue;
+      victim = &tp->workers[w->victim];
+      if ((work = tpool_deque_steal(victim)))
+         return work;
+   }
+
+   return NULL;
+}
+
+/* Wake one parked worker, if any.  The RMW read of sleeping pairs
+ * with the RMW in tpool_worker so that either the submitter sees the
+ * worker parked, or the worker sees pending != 0 before it parks. */
+static void tpool_wake_one(tpool_t *tp)
+{
+   if (retro_atomic_fetch_add_int(&tp->sleeping, 0) > 0)
+   {
+      slock_lock(tp->work_mutex);
+      scond_signal(tp->work_cond);
+      slock_unlock(tp->work_mutex);
+   }
+}
+
+static void tpool_worker(void *arg)
+{
+   tpool_worker_t *w     = (tpool_worker_t*)arg;
+   tpool_t        *tp    = w->tp;
+   unsigned        spins = 0;
+
+   RETRO_TRACE_THREAD_NAME("tpool");
+
+   for (;;)
+   {
+      tpool_work_t *work;
+
+      if (retro_atomic_load_acquire_int(&tp->stop))
+         break;
+
+      if ((work = tpool_find_work(tp, w)))
+      {
+         thread_func_t func = work->func;
+         void         *data = work->arg;
+
+         retro_atomic_dec_size(&tp->pending);
+         /* Recycle before running so a job that queues more work can
+          * reuse its own item. */
+         tpool_work_destroy(tp, work);
+
+         /* Call the work function and let it process. */
+         RETRO_TRACE_BEGIN("tpool.job");
+         func(data);
+         RETRO_TRACE_END("tpool.job");
+
+         if (retro_atomic_fetch_sub_size(&tp->outstanding, 1) == 1)
+         {
+            /* Last outstanding item: wake tpool_wait.  Taking the lock
+             * closes the window between its check and its wait. */
+            slock_lock(tp->work_mutex);
+            scond_broadcast(tp->working_cond);
+            slock_unlock(tp->work_mutex);
+         }
+         spins = 0;
+         continue;
+      }
+
+      if (++spins < TPOOL_SPIN_ROUNDS)
+         continue;
+      spins = 0;
+
+      /* Nothing found for a while: park until work arrives. */
+      slock_lock(tp->work_mutex);
+      retro_atomic_inc_int(&tp->sleeping);
+      while (     !retro_atomic_load_acquire_int(&tp->stop)
+               && !retro_atomic_load_acquire_size(&tp->pending))
+         scond_wait(tp->work_cond, tp->work_mutex);
+      retro_atomic_dec_int(&tp->sleeping);
+      slock_unlock(tp->work_mutex);
+   }
+}
+
+/* Drops work that will never run */
+static void tpool_work_discard(tpool_work_t *work)
+{
+   if (work->discard)
+      work->discard(work->arg);
+   free(work);
+}
+
+static void tpool_free(tpool_t *tp)
+{
+   size_t        i;
+   tpool_work_t *work;
+
+   /* Discard whatever is still queued; the workers are gone. */
+   for (i = 0; i < tp->worker_cnt; i++)
+      while ((work = tpool_deque_pop(&tp->workers[i])))
+         tpool_work_discard(work);
+   if (tp->inject.slots)
+      while (retro_mpmc_pop(&tp->inject, &work))
+         tpool_work_discard(work);
+   while ((work = tpool_overflow_get(tp)))
+      tpool_work_discard(work);
+   if (tp->free_items.slots)
+      while (retro_mpmc_pop(&tp->free_items, &work))
+         free(work);
+
+   retro_mpmc_free(&tp->inject);
+   retro_mpmc_free(&tp->free_items);
+   if (tp->work_mutex)
+      slock_free(tp->work_mutex);
+   if (tp->work_cond)
+      scond_free(tp->work_cond);
+   if (tp->working_cond)
+      scond_free(tp->working_cond);
+   free(tp->workers);
+   free(tp);
+}
+
+tpool_t *tpool_create_with_attr(size_t num, const sthread_attr_t *attr)
+{
+   tpool_t *tp;
+   size_t   i, j;
+   size_t   started = 0;
+
+   if (num == 0)
+      num = 2;
+
+   tp               = (tpool_t*)calloc(1, sizeof(*tp));
+   if (!tp)
+      return NULL;
+
+   retro_atomic_size_init(&tp->outstanding, 0);
+   retro_atomic_size_init(&tp->pending, 0);
+   retro_atomic_size_init(&tp->overflow_cnt, 0);
+   retro_atomic_int_init(&tp->sleeping, 0);
+   retro_atomic_int_init(&tp->stop, 0);
+
+   tp->work_mutex   = slock_new();
+   tp->work_cond    = scond_new();
+   tp->working_cond = scond_new();
+   tp->workers      = (tpool_worker_t*)calloc(num, sizeof(*tp->workers));
+
+   if (     !tp->work_mutex
+         || !tp->work_cond
+         || !tp->working_cond
+         || !tp->workers
+         || !retro_mpmc_init(&tp->inject, TPOOL_INJECT_SIZE,
+               sizeof(tpool_work_t*))
+         || !retro_mpmc_init(&tp->free_items, TPOOL_FREE_SIZE,
+               sizeof(tpool_work_t*)))
+   {
+      tpool_free(tp);
+      return NULL;
+   }
+
+   tp->worker_cnt = num;
+   for (i = 0; i < num; i++)
+   {
+      tpool_worker_t *w = &tp->workers[i];
+      retro_atomic_size_init(&w->top, 0);
+      retro_atomic_size_init(&w->bottom, 0);
+      for (j = 0; j < TPOOL_DEQUE_SIZE; j++)
+         retro_atomic_size_init(&w->slots[j], 0);
+      w->tp     = tp;
+      w->index  = i;
+      w->victim = i;
+   }
+
+   /* A worker whose thread fails to start keeps an empty deque that
+    * the others simply never find anything in. */
+   for (i = 0; i < num; i++)
+   {
+      tp->workers[i].thread = sthread_create_with_attr(tpool_worker,
+            &tp->workers[i], attr);
+      if (tp->workers[i].thread)
+         started++;
+   }
+
+   /* If no threads were created, clean up and fail. */
+   if (started == 0)
+   {
+      tpool_free(tp);
+      return NULL;
+   }
+
+   tp->thread_cnt = started;
+   return tp;
+}
+
+void tpool_destroy(tpool_t *tp)
+{
+   size_t i;
+
+   if (!tp)
+      return;
+
+   /* Tell the worker threads to stop.  Queued work that has not been
+    * picked up yet is discarded by tpool_free. */
+   slock_lock(tp->work_mutex);
+   retro_atomic_store_release_int(&tp->stop, 1);
+   scond_broadcast(tp->work_cond);
+   slock_unlock(tp->work_mutex);
+
+   /* Wait for all threads to stop. */
+   for (i = 0; i < tp->worker_cnt; i++)
+      sthread_join(tp->workers[i].thread);
+
+   tpool_free(tp);
+}
+
+static bool tpool_add_work_internal(tpool_t *tp, thread_func_t func,
+      thread_func_t discard, void *arg)
+{
+   tpool_work_t   *work;
+   tpool_worker_t *w;
+
+   if (!tp)
+      return false;
+
+   work = tpool_work_create(tp, func, discard, arg);
+   if (!work)
+      return false;
+
+   /* Count before publishing so that a worker can never finish the
+    * item before it has been counted. */
+   retro_atomic_inc_size(&tp->outstanding);
+   retro_atomic_inc_size(&tp->pending);
+
+   w = tpool_current_worker(tp);
+   if (     !(w && tpool_deque_push(w, work))
+         && !retro_mpmc_push(&tp->inject, &work))
+   {
+      slock_lock(tp->work_mutex);
+      tpool_overflow_add(tp, work);
+      retro_atomic_inc_size(&tp->overflow_cnt);
+      slock_unlock(tp->work_mutex);
+   }
+
+   tpool_wake_one(tp);
+   return true;
+}
+
+void tpool_wait(tpool_t *tp)
+{
+   if (!tp)
+      return;
+
+   slock_lock(tp->work_mutex);
+   /* outstanding covers queued and running work alike, so a wait
+    * racing tpool_add_work cannot return before the new item ran. */
+   while (retro_atomic_load_acquire_size(&tp->outstanding) != 0)
+      scond_wait(tp->working_cond, tp->work_mutex);
+   slock_unlock(tp->work_mutex);
+}
+
+static size_t tpool_thread_count(tpool_t *tp)
+{
+   return tp->thread_cnt;
+}
+
+#else
 
 /* Work object which will sit in a queue
  * waiting for the pool to process it.
@@ -37,9 +548,10 @@
  * It is a singly linked list acting as a FIFO queue. */
 struct tpool_work
 {
-   thread_func_t      func;  /* Function to be called. */
-   void              *arg;   /* Data to be passed to func. */
-   struct tpool_work *next;  /* Next work item in the queue. */
+   thread_func_t      func;    /* Function to be called. */
+   thread_func_t      discard; /* Called instead if the pool is destroyed first. */
+   void              *arg;     /* Data to be passed to func. */
+   struct tpool_work *next;    /* Next work item in the queue. */
 };
 typedef struct tpool_work tpool_work_t;
 
@@ -56,19 +568,21 @@ struct tpool
    bool             stop;         /* Marker to tell the work threads to exit. */
 };
 
-static tpool_work_t *tpool_work_create(thread_func_t func, void *arg)
+static tpool_work_t *tpool_work_create(thread_func_t func,
+      thread_func_t discard, void *arg)
 {
    tpool_work_t *work;
 
    if (!func)
       return NULL;
 
-   work       = (tpool_work_t*)calloc(1, sizeof(*work));
+   work          = (tpool_work_t*)calloc(1, sizeof(*work));
    if (!work)
       return NULL;
-   work->func = func;
-   work->arg  = arg;
-   work->next = NULL;
+   work->func    = func;
+   work->discard = discard;
+   work->arg     = arg;
+   work->next    = NULL;
    return work;
 }
 
@@ -105,6 +619,8 @@ static void tpool_worker(void *arg)
    tpool_work_t *work = NULL;
    tpool_t      *tp   = (tpool_t*)arg;
 
+   RETRO_TRACE_THREAD_NAME("tpool");
+
    for (;;)
    {
       slock_lock(tp->work_mutex);
@@ -127,7 +643,9 @@ static void tpool_worker(void *arg)
       /* Call the work function and let it process. */
       if (work)
       {
+         RETRO_TRACE_BEGIN("tpool.job");
          work->func(work->arg);
+         RETRO_TRACE_END("tpool.job");
          tpool_work_destroy(work);
 
          slock_lock(tp->work_mutex);
@@ -148,7 +666,7 @@ static void tpool_worker(void *arg)
    slock_unlock(tp->work_mutex);
 }
 
-tpool_t *tpool_create(size_t num)
+tpool_t *tpool_create_with_attr(size_t num, const sthread_attr_t *attr)
 {
    tpool_t   *tp;
    sthread_t *thread;
@@ -186,7 +704,7 @@ tpool_t *tpool_create(size_t num)
    tp->thread_cnt   = 0;
    for (i = 0; i < num; i++)
    {
-      thread = sthread_create(tpool_worker, tp);
+      thread = sthread_create_with_attr(tpool_worker, tp, attr);
       if (!thread)
          continue;
       tp->thread_cnt++;
@@ -214,15 +732,9 @@ void tpool_destroy(tpool_t *tp)
    if (!tp)
       return;
 
-   /* Take all work out of the queue and destroy it. */
+   /* Take all work out of the queue. */
    slock_lock(tp->work_mutex);
    work = tp->work_first;
-   while (work)
-   {
-      work2 = work->next;
-      tpool_work_destroy(work);
-      work = work2;
-   }
    tp->work_first = NULL;
    tp->work_last  = NULL;
 
@@ -231,6 +743,17 @@ void tpool_destroy(tpool_t *tp)
    scond_broadcast(tp->work_cond);
    slock_unlock(tp->work_mutex);
 
+   /* Destroy the work outside the lock; a discard callback may
+    * take locks of its own. */
+   while (work)
+   {
+      work2 = work->next;
+      if (work->discard)
+         work->discard(work->arg);
+      tpool_work_destroy(work);
+      work = work2;
+   }
+
    /* Wait for all threads to stop. */
    tpool_wait(tp);
 
@@ -241,14 +764,15 @@ void tpool_destroy(tpool_t *tp)
    free(tp);
 }
 
-bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg)
+static bool tpool_add_work_internal(tpool_t *tp, thread_func_t func,
+      thread_func_t discard, void *arg)
 {
    tpool_work_t *work;
 
    if (!tp)
       return false;
 
-   work = tpool_work_create(func, arg);
+   work = tpool_work_create(func, discard, arg);
    if (!work)
       return false;
 
@@ -297,3 +821,363 @@ void tpool_wait(tpool_t *tp)
 
    slock_unlock(tp->work_mutex);
 }
+
+static size_t tpool_thread_count(tpool_t *tp)
+{
+   size_t cnt;
+   slock_lock(tp->work_mutex);
+   cnt = tp->thread_cnt;
+   slock_unlock(tp->work_mutex);
+   return cnt;
+}
+
+#endif
+
+bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg)
+{
+   return tpool_add_work_internal(tp, func, NULL, arg);
+}
+
+tpool_t *tpool_create(size_t num)
+{
+   sthread_attr_t attr;
+   sthread_attr_init(&attr);
+   attr.name = "tpool";
+   return tpool_create_with_attr(num, &attr);
+}
+
+/* Task groups and dependencies
+ *
+ * Built on tpool_add_work, so they work with either scheduler.  A
+ * task's deps count is its unfinished predecessors plus one hold
+ * that tpool_task_submit drops; whoever takes it to zero hands the
+ * task to the pool.  Counters are kept under the group's lock rather
+ * than in atomics so that they stay correct on every backend. */
+
+struct tpool_group
+{
+   tpool_t *tp;
+   slock_t *lock;
+   scond_t *cond;     /* Signalled when pending drops to 0. */
+   size_t   pending;  /* Tasks submitted but not yet finished. */
+};
+
+struct tpool_task
+{
+   tpool_group_t  *group;
+   thread_func_t   func;
+   void           *arg;
+   tpool_task_t  **succ;     /* Tasks waiting for this one. */
+   size_t          succ_cnt;
+   size_t          succ_cap;
+   size_t          deps;     /* Guarded by group->lock. */
+};
+
+static void tpool_task_run(void *arg);
+
+static void tpool_task_schedule(tpool_task_t *task)
+{
+   /* If the pool cannot take it, run it here rather than lose it */
+   if (!tpool_add_work(task->group->tp, tpool_task_run, task))
+      tpool_task_run(task);
+}
+
+/* Drops one dependency; schedules the task when it was the last. */
+static void tpool_task_release(tpool_task_t *task)
+{
+   bool ready;
+   slock_lock(task->group->lock);
+   ready = (--task->deps == 0);
+   slock_unlock(task->group->lock);
+   if (ready)
+      tpool_task_schedule(task);
+}
+
+static void tpool_task_run(void *arg)
+{
+   size_t         i;
+   tpool_task_t  *task  = (tpool_task_t*)arg;
+   tpool_group_t *group = task->group;
+
+   task->func(task->arg);
+
+   for (i = 0; i < task->succ_cnt; i++)
+      tpool_task_release(task->succ[i]);
+   free(task->succ);
+   free(task);
+
+   slock_lock(group->lock);
+   if (--group->pending == 0)
+      scond_broadcast(group->cond);
+   slock_unlock(group->lock);
+}
+
+tpool_group_t *tpool_group_new(tpool_t *tp)
+{
+   tpool_group_t *group;
+
+   if (!tp)
+      return NULL;
+
+   group = (tpool_group_t*)calloc(1, sizeof(*group));
+   if (!group)
+      return NULL;
+
+   group->tp   = tp;
+   group->lock = slock_new();
+   group->cond = scond_new();
+   if (!group->lock || !group->cond)
+   {
+      if (group->lock)
+         slock_free(group->lock);
+      if (group->cond)
+         scond_free(group->cond);
+      free(group);
+      return NULL;
+   }
+   return group;
+}
+
+void tpool_group_free(tpool_group_t *group)
+{
+   if (!group)
+      return;
+   tpool_group_wait(group);
+   slock_free(group->lock);
+   scond_free(group->cond);
+   free(group);
+}
+
+void tpool_group_wait(tpool_group_t *group)
+{
+   if (!group)
+      return;
+
+   slock_lock(group->lock);
+   while (group->pending != 0)
+      scond_wait(group->cond, group->lock);
+   slock_unlock(group->lock);
+}
+
+tpool_task_t *tpool_task_new(tpool_group_t *group,
+      thread_func_t func, void *arg)
+{
+   tpool_task_t *task;
+
+   if (!group || !func)
+      return NULL;
+
+   task = (tpool_task_t*)calloc(1, sizeof(*task));
+   if (!task)
+      return NULL;
+
+   task->group = group;
+   task->func  = func;
+   task->arg   = arg;
+   task->deps  = 1; /* Held until tpool_task_submit */
+   return task;
+}
+
+bool tpool_task_depend(tpool_task_t *task, tpool_task_t *before)
+{
+   if (!task || !before || task == before)
+      return false;
+
+   if (before->succ_cnt == before->succ_cap)
+   {
+      size_t         cap  = before->succ_cap ? before->succ_cap * 2 : 4;
+      tpool_task_t **succ = (tpool_task_t**)realloc(before->succ,
+            cap * sizeof(*succ));
+      if (!succ)
+         return false;
+      before->succ     = succ;
+      before->succ_cap = cap;
+   }
+   before->succ[before->succ_cnt++] = task;
+
+   /* task may already have running predecessors releasing it */
+   slock_lock(task->group->lock);
+   task->deps++;
+   slock_unlock(task->group->lock);
+   return true;
+}
+
+void tpool_task_submit(tpool_task_t *task)
+{
+   if (!task)
+      return;
+
+   slock_lock(task->group->lock);
+   task->group->pending++;
+   slock_unlock(task->group->lock);
+
+   tpool_task_release(task);
+}
+
+bool tpool_group_add_work(tpool_group_t *group,
+      thread_func_t func, void *arg)
+{
+   tpool_task_t *task = tpool_task_new(group, func, arg);
+   if (!task)
+      return false;
+   tpool_task_submit(task);
+   return true;
+}
+
+/* Parallel for
+ *
+ * Chunks are claimed one at a time from a shared cursor by the caller
+ * and by up to one helper job per pool thread, so uneven chunks
+ * balance out.  The caller works through chunks itself and only waits
+ * for chunks other threads have already claimed; it never waits for a
+ * helper that has not started.  That keeps tpool_parallel_for safe to
+ * call from inside a job on the same pool.  The shared state is
+ * reference counted because a late helper can start after the caller
+ * has returned, or never start at all when the pool is destroyed
+ * first; tpool_destroy then drops its reference instead. */
+
+struct tpool_range
+{
+   tpool_range_func_t fn;
+   void              *arg;
+   slock_t           *lock;
+   scond_t           *cond;   /* Signalled when chunks drops to 0. */
+   size_t             next;   /* Start of the next unclaimed chunk. */
+   size_t             end;
+   size_t             grain;
+   size_t             chunks; /* Chunks not yet finished. */
+   size_t             refs;   /* Caller plus helpers not yet done. */
+};
+
+static void tpool_range_free(struct tpool_range *range)
+{
+   slock_free(range->lock);
+   scond_free(range->cond);
+   free(range);
+}
+
+/* Runs chunks until none are left.  Called and returns with the lock
+ * held. */
+static void tpool_range_work(struct tpool_range *range)
+{
+   while (range->next < range->end)
+   {
+      size_t b    = range->next;
+      size_t e    = (range->end - b > range->grain)
+                  ? b + range->grain
+                  : range->end;
+      range->next = e;
+      slock_unlock(range->lock);
+
+      range->fn(b, e, range->arg);
+
+      slock_lock(range->lock);
+      if (--range->chunks == 0)
+         scond_broadcast(range->cond);
+   }
+}
+
+static void tpool_range_helper(void *arg)
+{
+   bool                last;
+   struct tpool_range *range = (struct tpool_range*)arg;
+
+   slock_lock(range->lock);
+   tpool_range_work(range);
+   last = (--range->refs == 0);
+   slock_unlock(range->lock);
+   if (last)
+      tpool_range_free(range);
+}
+
+/* A helper discarded by tpool_destroy.  The caller never waits for
+ * helpers to start, so there is nothing to do but let go. */
+static void tpool_range_discard(void *arg)
+{
+   bool                last;
+   struct tpool_range *range = (struct tpool_range*)arg;
+
+   slock_lock(range->lock);
+   last = (--range->refs == 0);
+   slock_unlock(range->lock);
+   if (last)
+      tpool_range_free(range);
+}
+
+bool tpool_parallel_for(tpool_t *tp, size_t begin, size_t end,
+      size_t grain, tpool_range_func_t fn, void *arg)
+{
+   bool                last;
+   size_t              i, chunks, helpers;
+   struct tpool_range *range;
+
+   if (!tp || !fn || end < begin)
+      return false;
+   if (begin == end)
+      return true;
+
+   helpers = tpool_thread_count(tp);
+   if (grain == 0)
+   {
+      /* A few chunks per thread leaves room to balance */
+      grain = (end - begin) / (4 * (helpers + 1));
+      if (grain == 0)
+         grain = 1;
+   }
+   chunks  = (end - begin) / grain + ((end - begin) % grain != 0);
+   if (helpers > chunks - 1)
+      helpers = chunks - 1;
+
+   range = (struct tpool_range*)calloc(1, sizeof(*range));
+   if (range)
+   {
+      range->lock = slock_new();
+      range->cond = scond_new();
+   }
+   if (!range || !range->lock || !range->cond)
+   {
+      if (range)
+      {
+         if (range->lock)
+            slock_free(range->lock);
+         if (range->cond)
+            scond_free(range->cond);
+         free(range);
+      }
+      /* Still honour the call, just without help */
+      for (i = begin; end - i > grain; i += grain)
+         fn(i, i + grain, arg);
+      fn(i, end, arg);
+      return true;
+   }
+
+   range->fn     = fn;
+   range->arg    = arg;
+   range->next   = begin;
+   range->end    = end;
+   range->grain  = grain;
+   range->chunks = chunks;
+   range->refs   = 1 + helpers;
+
+   for (i = 0; i < helpers; i++)
+   {
+      if (!tpool_add_work_internal(tp, tpool_range_helper,
+               tpool_range_discard, range))
+      {
+         slock_lock(range->lock);
+         range->refs -= helpers - i;
+         slock_unlock(range->lock);
+         break;
+      }
+   }
+
+   slock_lock(range->lock);
+   tpool_range_work(range);
+   while (range->chunks != 0)
+      scond_wait(range->cond, range->lock);
+   last = (--range->refs == 0);
+   slock_unlock(range->lock);
+   if (last)
+      tpool_range_free(range);
+   return true;
+}
@@ -199,6 +199,21 @@ static int check_fetch_add_sub_returns_previous(void)
    return 0;
 }
 
+static int check_cas(void)
+{
+   retro_atomic_int_t  ai; retro_atomic_int_init (&ai, 3);
+   retro_atomic_size_t as; retro_atomic_size_init(&as, (std::size_t)3);
+
+   if (retro_atomic_cas_int (&ai, 2, 4)) return 1;
+   if (retro_atomic_cas_size(&as, 2, 4)) return 1;
+   if (!retro_atomic_cas_int (&ai, 3, 4)) return 1;
+   if (!retro_atomic_cas_size(&as, 3, 4)) return 1;
+
+   if (retro_atomic_load_acquire_int (&ai) != 4) return 1;
+   if (retro_atomic_load_acquire_size(&as) != (std::size_t)4) return 1;
+   return 0;
+}
+
 int main(void)
 {
    int fails = 0;
@@ -213,6 +228,7 @@ int main(void)
    fails += check_init();
    fails += check_store_release_load_acquire();
    fails += check_fetch_add_sub_returns_previous();
+   fails += check_cas();
 
    if (fails)
    {
@@ -243,6 +243,41 @@ static int check_fetch_sub_returns_previous(void)
    return 0;
 }
 
+static int check_cas(void)
+{
+   retro_atomic_int_t  vi;
+   retro_atomic_size_t vs;
+
+   retro_atomic_int_init(&vi, 5);
+   retro_atomic_size_init(&vs, 500);
+
+   /* Mismatched expected value: no change, reports failure */
+   if (retro_atomic_cas_int(&vi, 4, 9) || retro_atomic_cas_size(&vs, 499, 9))
+   {
+      fprintf(stderr, "FAIL cas succeeded on a mismatched expected value\n");
+      return 1;
+   }
+   if (     retro_atomic_load_acquire_int(&vi) != 5
+         || (size_t)retro_atomic_load_acquire_size(&vs) != 500)
+   {
+      fprintf(stderr, "FAIL failed cas modified the target\n");
+      return 1;
+   }
+
+   if (!retro_atomic_cas_int(&vi, 5, 9) || !retro_atomic_cas_size(&vs, 500, 900))
+   {
+      fprintf(stderr, "FAIL cas failed on a matching expected value\n");
+      return 1;
+   }
+   if (     retro_atomic_load_acquire_int(&vi) != 9
+         || (size_t)retro_atomic_load_acquire_size(&vs) != 900)
+   {
+      fprintf(stderr, "FAIL cas post-state\n");
+      return 1;
+   }
+   return 0;
+}
+
 static int check_inc_dec_wrappers(void)
 {
    retro_atomic_int_t  vi;
@@ -400,6 +435,7 @@ int main(void)
    fails += check_store_load();
    fails += check_fetch_add_returns_previous();
    fails += check_fetch_sub_returns_previous();
+   fails += check_cas();
    fails += check_inc_dec_wrappers();
 
 #ifdef HAVE_THREADS
@@ -0,0 +1,294 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (cpu_topology_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+static void print_topology(const cpu_topology_t *topo)
+{
+   unsigned i;
+
+   printf("%u cpus, %u cores (%u performance, %u efficiency), "
+         "%u package(s), %u NUMA node(s)\n",
+         topo->cpu_count, topo->core_count,
+         topo->performance_core_count, topo->efficiency_core_count,
+         topo->package_count, topo->numa_node_count);
+   for (i = 0; i < topo->cpu_count; i++)
+   {
+      const cpu_logical_info_t *cpu = &topo->cpus[i];
+      printf("  cpu%-2u core %-2u package %u node %u type %d%s "
+            "L1 %uK L2 %uK L3 %uK\n",
+            i, cpu->core, cpu->package, cpu->numa_node, (int)cpu->type,
+            cpu->online ? "" : " (offline)",
+            (unsigned)(cpu_topology_get_cache_size(topo, i, 1) >> 10),
+            (unsigned)(cpu_topology_get_cache_size(topo, i, 2) >> 10),
+            (unsigned)(cpu_topology_get_cache_size(topo, i, 3) >> 10));
+   }
+}
+
+#ifdef CPU_TOPOLOGY_SYSFS_ROOT
+/* Everything written below CPU_TOPOLOGY_SYSFS_ROOT, deepest last, so
+ * the tree can be removed in reverse order */
+static char created[512][256];
+static unsigned created_count = 0;
+
+static void fake_file(const char *name, const char *text)
+{
+   char path[256];
+   char dir[256];
+   unsigned i;
+
+   snprintf(path, sizeof(path), "%s/%s", CPU_TOPOLOGY_SYSFS_ROOT, name);
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   path_mkdir(dir);
+   /* Remember each new directory level as well */
+   for (i = strlen(CPU_TOPOLOGY_SYSFS_ROOT); path[i]; i++)
+   {
+      unsigned j;
+      if (path[i] != '/')
+         continue;
+      path[i] = '\0';
+      for (j = 0; j < created_count; j++)
+         if (!strcmp(created[j], path))
+            break;
+      if (j == created_count && created_count < 512)
+         strcpy(created[created_count++], path);
+      path[i] = '/';
+   }
+   CHECK(filestream_write_file(path, text, (int64_t)strlen(text)));
+   if (created_count < 512)
+      strcpy(created[created_count++], path);
+}
+
+static void fake_printf(const char *text, const char *fmt, unsigned cpu,
+      unsigned index)
+{
+   char name[128];
+   snprintf(name, sizeof(name), fmt, cpu, index);
+   fake_file(name, text);
+}
+
+static void fake_cache(unsigned cpu, unsigned index, const char *level,
+      const char *type, const char *size, const char *shared)
+{
+   static const char *fmt = "system/cpu/cpu%u/cache/index%u/";
+   char name[128];
+   size_t n = (size_t)snprintf(name, sizeof(name), fmt, cpu, index);
+
+   strcpy(name + n, "level");
+   fake_file(name, level);
+   strcpy(name + n, "type");
+   fake_file(name, type);
+   strcpy(name + n, "size");
+   fake_file(name, size);
+   strcpy(name + n, "coherency_line_size");
+   fake_file(name, "64\n");
+   strcpy(name + n, "shared_cpu_list");
+   fake_file(name, shared);
+}
+
+/* One package of four hyperthreaded performance cores (cpu0-7) and
+ * four efficiency cores (cpu8-11) sharing an L2, cpu11 offline, the
+ * E-cores on a second NUMA node. */
+static void fake_hybrid_tree(void)
+{
+   unsigned i;
+   char     text[32];
+
+   fake_file("system/cpu/present", "0-11\n");
+   fake_file("system/cpu/online", "0-10\n");
+   fake_file("system/node/node0/cpulist", "0-7\n");
+   fake_file("system/node/node1/cpulist", "8-11\n");
+   fake_file("cpu_core/cpus", "0-7\n");
+   fake_file("cpu_atom/cpus", "8-11\n");
+
+   for (i = 0; i < 11; i++)
+   {
+      bool p = i < 8;
+      fake_printf("0\n", "system/cpu/cpu%u/topology/physical_package_id",
+            i, 0);
+      snprintf(text, sizeof(text), "%u\n", p ? (i / 2) * 4 : 16 + i);
+      fake_printf(text, "system/cpu/cpu%u/topology/core_id", i, 0);
+      if (p)
+         snprintf(text, sizeof(text), "%u-%u\n", i & ~1u, i | 1u);
+      else
+         snprintf(text, sizeof(text), "%u\n", i);
+      fake_printf(text, "system/cpu/cpu%u/topology/thread_siblings_list",
+            i, 0);
+
+      /* Instruction cache first, so lookups must skip it */
+      fake_cache(i, 0, "1\n", "Instruction\n", p ? "32K\n" : "64K\n",
+            text);
+      fake_cache(i, 1, "1\n", "Data\n", p ? "48K\n" : "32K\n", text);
+      fake_cache(i, 2, "2\n", "Unified\n", p ? "1280K\n" : "2048K\n",
+            p ? text : "8-11\n");
+      fake_cache(i, 3, "3\n", "Unified\n", "30M\n", "0-11\n");
+   }
+}
+
+static void fake_remove(const char *name)
+{
+   unsigned i;
+   char path[256];
+
+   snprintf(path, sizeof(path), "%s/%s", CPU_TOPOLOGY_SYSFS_ROOT, name);
+   for (i = 0; i < created_count; i++)
+      if (!strcmp(created[i], path))
+         created[i][0] = '\0';
+   filestream_delete(path);
+}
+
+static void fake_cleanup(void)
+{
+   while (created_count)
+   {
+      const char *path = created[--created_count];
+      if (*path)
+         filestream_delete(path);
+   }
+   filestream_delete(CPU_TOPOLOGY_SYSFS_ROOT);
+}
+
+static void check_hybrid(const cpu_topology_t *topo)
+{
+   CHECK(topo->cpu_count == 12);
+   CHECK(topo->core_count == 7);
+   CHECK(topo->performance_core_count == 4);
+   CHECK(topo->efficiency_core_count == 3);
+   CHECK(topo->package_count == 1);
+   CHECK(topo->numa_node_count == 2);
+
+   CHECK(topo->cpus[0].core == topo->cpus[1].core);
+   CHECK(topo->cpus[1].core != topo->cpus[2].core);
+   CHECK(topo->cpus[3].siblings == 0x0c);
+   CHECK(topo->cpus[9].siblings == 0x200);
+   CHECK(topo->cpus[3].numa_node == 0);
+   CHECK(topo->cpus[9].numa_node == 1);
+   CHECK(topo->cpus[10].online && !topo->cpus[11].online);
+   CHECK(topo->cpus[5].type  == CPU_CORE_TYPE_PERFORMANCE);
+   CHECK(topo->cpus[10].type == CPU_CORE_TYPE_EFFICIENCY);
+
+   CHECK(cpu_topology_get_mask(topo, CPU_CORE_TYPE_PERFORMANCE, true)
+         == 0x055);
+   CHECK(cpu_topology_get_mask(topo, CPU_CORE_TYPE_PERFORMANCE, false)
+         == 0x0ff);
+   CHECK(cpu_topology_get_mask(topo, CPU_CORE_TYPE_EFFICIENCY, false)
+         == 0x700);
+   CHECK(cpu_topology_get_mask(topo, CPU_CORE_TYPE_UNKNOWN, true)
+         == 0x755);
+
+   /* Per P-core L1i/L1d/L2 x4, per online E-core L1i/L1d x3, one
+    * shared E-core L2 and one L3 */
+   CHECK(topo->cache_count == 20);
+   CHECK(cpu_topology_get_cache_size(topo, 1, 1)  == 48 << 10);
+   CHECK(cpu_topology_get_cache_size(topo, 9, 1)  == 32 << 10);
+   CHECK(cpu_topology_get_cache_size(topo, 6, 2)  == 1280 << 10);
+   CHECK(cpu_topology_get_cache_size(topo, 10, 2) == 2048 << 10);
+   CHECK(cpu_topology_get_cache_size(topo, 8, 3)  == 30 << 20);
+   CHECK(cpu_topology_get_cache_size(topo, 8, 4)  == 0);
+   CHECK(cpu_topology_get_cache_size(topo, 11, 1) == 0);
+}
+
+static void test_fake_sysfs(void)
+{
+   unsigned       i;
+   cpu_topology_t topo;
+
+   fake_cleanup();
+   fake_hybrid_tree();
+
+   /* Intel hybrid: cpu_core / cpu_atom PMU lists */
+   CHECK(cpu_features_get_topology(&topo));
+   check_hybrid(&topo);
+   print_topology(&topo);
+
+   /* ARM big.LITTLE: the same tree typed by cpu_capacity */
+   fake_remove("cpu_core/cpus");
+   for (i = 0; i < 11; i++)
+      fake_printf(i < 8 ? "1024\n" : "446\n",
+            "system/cpu/cpu%u/cpu_capacity", i, 0);
+   CHECK(cpu_features_get_topology(&topo));
+   check_hybrid(&topo);
+
+   /* No sysfs at all: falls back to the CPU count, one package */
+   fake_remove("system/cpu/present");
+   CHECK(cpu_features_get_topology(&topo));
+   CHECK(topo.cpu_count >= 1);
+   CHECK(topo.package_count == 1 && topo.numa_node_count == 1);
+   CHECK(cpu_topology_get_mask(&topo, CPU_CORE_TYPE_UNKNOWN, false) != 0);
+
+   fake_cleanup();
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifndef CPU_TOPOLOGY_SYSFS_ROOT
+   cpu_topology_t topo;
+#endif
+
+   CHECK(!cpu_features_get_topology(NULL));
+   CHECK(cpu_topology_get_mask(NULL, CPU_CORE_TYPE_UNKNOWN, false) == 0);
+   CHECK(cpu_topology_get_cache_size(NULL, 0, 1) == 0);
+
+#ifdef CPU_TOPOLOGY_SYSFS_ROOT
+   test_fake_sysfs();
+#else
+   /* The host: only sanity checks, the answer depends on the machine */
+   CHECK(cpu_features_get_topology(&topo));
+   CHECK(topo.cpu_count >= 1 && topo.cpu_count <= CPU_TOPOLOGY_MAX_CPUS);
+   CHECK(topo.core_count >= 1 && topo.core_count <= topo.cpu_count);
+   CHECK(topo.package_count >= 1 && topo.numa_node_count >= 1);
+   CHECK(topo.performance_core_count + topo.efficiency_core_count
+         <= topo.core_count);
+   CHECK(cpu_topology_get_mask(&topo, CPU_CORE_TYPE_UNKNOWN, true) != 0);
+   CHECK(cpu_topology_get_mask(&topo, CPU_CORE_TYPE_UNKNOWN, true)
+         == (cpu_topology_get_mask(&topo, CPU_CORE_TYPE_UNKNOWN, true)
+            & cpu_topology_get_mask(&topo, CPU_CORE_TYPE_UNKNOWN, false)));
+   print_topology(&topo);
+#endif
+
+   if (failures)
+   {
+      fprintf(stderr, "cpu_topology: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("cpu_topology: all tests passed\n");
+   return 0;
+}
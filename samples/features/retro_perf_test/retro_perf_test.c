@@ -0,0 +1,292 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_perf_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <formats/rjson.h>
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+#include <retro_perf.h>
+
+#define THREADS      4
+#define THREAD_ADDS  1000
+#define TASKS        3
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+RETRO_PERF_TIMER(perf_outer, "test.outer");
+RETRO_PERF_TIMER(perf_inner, "test.inner");
+/* A second site with the same name shares the entry */
+RETRO_PERF_TIMER(perf_inner_again, "test.inner");
+RETRO_PERF_COUNTER(perf_bytes, "test.bytes");
+
+static int callbacks = 0;
+
+static void busy_usec(retro_time_t usec)
+{
+   retro_time_t end = cpu_features_get_time_usec() + usec;
+   while (cpu_features_get_time_usec() < end);
+}
+
+static void add_thread(void *data)
+{
+   int i;
+   for (i = 0; i < THREAD_ADDS; i++)
+      RETRO_PERF_ADD(perf_bytes, 1);
+}
+
+static void task_handler(retro_task_t *task)
+{
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void task_callback(retro_task_t *task, void *task_data,
+      void *user_data, const char *error)
+{
+   callbacks++;
+}
+
+/* Drives a few tasks through the regular queue; its handler,
+ * callback and push sites are instrumented */
+static void run_tasks(void)
+{
+   int i;
+
+   task_queue_init(false, NULL);
+   for (i = 0; i < TASKS; i++)
+   {
+      retro_task_t *task = task_init();
+      task->handler      = task_handler;
+      task->callback     = task_callback;
+      CHECK(task_queue_push(task));
+   }
+   for (i = 0; i < 100 && callbacks < TASKS; i++)
+      task_queue_check();
+   CHECK(callbacks == TASKS);
+   task_queue_deinit();
+}
+
+#ifdef HAVE_RETRO_PERF
+static bool json_valid(const char *s, int len)
+{
+   enum rjson_type type;
+   rjson_t *json = rjson_open_string(s, (size_t)len);
+
+   if (!json)
+      return false;
+   while ((type = rjson_next(json)) != RJSON_DONE && type != RJSON_ERROR);
+   rjson_free(json);
+   return type == RJSON_DONE;
+}
+
+static void test_timers(void)
+{
+   int                i;
+   retro_perf_stats_t stats;
+
+   for (i = 0; i < 20; i++)
+   {
+      RETRO_PERF_BEGIN(perf_outer);
+      busy_usec(200);
+      RETRO_PERF_BEGIN(perf_inner);
+      busy_usec(1000);
+      RETRO_PERF_END(perf_inner);
+      RETRO_PERF_END(perf_outer);
+   }
+   RETRO_PERF_BEGIN(perf_inner_again);
+   RETRO_PERF_END(perf_inner_again);
+
+   CHECK(retro_perf_get_stats("test.inner", &stats));
+   CHECK(!strcmp(stats.name, "test.inner"));
+   CHECK(stats.type == RETRO_PERF_TYPE_TIMER);
+   CHECK(stats.calls == 21);
+   CHECK(stats.threads == 1);
+   /* Only lower bounds: the host may preempt the busy loops */
+   CHECK(stats.total_ns >= 20 * 900000ull);
+   CHECK(stats.p50_ns >= 900000);
+   CHECK(stats.p50_ns <= stats.p99_ns);
+   CHECK(stats.p99_ns <= stats.max_ns);
+   CHECK(stats.max_ns >= 1000000);
+
+   CHECK(retro_perf_get_stats("test.outer", &stats));
+   CHECK(stats.calls == 20);
+   CHECK(stats.mean_ns >= 1080000);
+
+   /* An END that does not close the innermost scope is dropped */
+   RETRO_PERF_BEGIN(perf_outer);
+   RETRO_PERF_END(perf_inner);
+   RETRO_PERF_END(perf_outer);
+   CHECK(retro_perf_get_stats("test.outer", &stats) && stats.calls == 20);
+   CHECK(retro_perf_get_stats("test.inner", &stats) && stats.calls == 21);
+
+   /* Scopes nested deeper than the stack are not recorded */
+   for (i = 0; i < RETRO_PERF_MAX_DEPTH + 4; i++)
+      RETRO_PERF_BEGIN(perf_outer);
+   for (i = 0; i < RETRO_PERF_MAX_DEPTH + 4; i++)
+      RETRO_PERF_END(perf_outer);
+   CHECK(retro_perf_get_stats("test.outer", &stats));
+   CHECK(stats.calls == 20 + RETRO_PERF_MAX_DEPTH);
+
+   CHECK(!retro_perf_get_stats("test.missing", &stats));
+}
+
+static void test_counters(void)
+{
+   int                i;
+   sthread_t         *threads[THREADS];
+   retro_perf_stats_t stats;
+
+   for (i = 0; i < 10; i++)
+      RETRO_PERF_ADD(perf_bytes, 100);
+   for (i = 0; i < THREADS; i++)
+      threads[i] = sthread_create(add_thread, NULL);
+   for (i = 0; i < THREADS; i++)
+      sthread_join(threads[i]);
+
+   CHECK(retro_perf_get_stats("test.bytes", &stats));
+   CHECK(stats.type == RETRO_PERF_TYPE_COUNTER);
+   CHECK(stats.value == 1000 + THREADS * THREAD_ADDS);
+   CHECK(stats.calls == 10 + THREADS * THREAD_ADDS);
+   CHECK(stats.threads == 1 + THREADS);
+}
+
+/* Threads that exit hand their blocks on with the totals kept, so
+ * many more than RETRO_PERF_MAX_THREADS of them can come and go */
+static void test_thread_churn(void)
+{
+   int                i;
+   sthread_t         *thread;
+   retro_perf_stats_t before, after;
+
+   CHECK(retro_perf_get_stats("test.bytes", &before));
+   for (i = 0; i < 2 * RETRO_PERF_MAX_THREADS; i++)
+   {
+      CHECK((thread = sthread_create(add_thread, NULL)) != NULL);
+      if (thread)
+         sthread_join(thread);
+   }
+   CHECK(retro_perf_get_stats("test.bytes", &after));
+   CHECK(after.value == before.value
+         + 2 * RETRO_PERF_MAX_THREADS * THREAD_ADDS);
+   CHECK(after.threads == before.threads + 2 * RETRO_PERF_MAX_THREADS);
+}
+
+static void test_task_queue(void)
+{
+   retro_perf_stats_t stats;
+
+   run_tasks();
+   CHECK(retro_perf_get_stats("task_queue.pushed", &stats));
+   CHECK(stats.value == TASKS);
+   CHECK(retro_perf_get_stats("task_queue.handler", &stats));
+   CHECK(stats.calls == TASKS);
+   CHECK(retro_perf_get_stats("task_queue.callback", &stats));
+   CHECK(stats.calls == TASKS);
+}
+
+static void test_json(void)
+{
+   int                len  = 0;
+   const char        *out  = NULL;
+   rjsonwriter_t     *w    = rjsonwriter_open_memory();
+   retro_perf_stats_t stats;
+
+   CHECK(!retro_perf_write_json(NULL));
+   CHECK(w != NULL);
+   if (!w)
+      return;
+   CHECK(retro_perf_write_json(w));
+   out = rjsonwriter_get_memory_buffer(w, &len);
+   CHECK(out && len > 0);
+   if (out)
+   {
+      printf("%s", out);
+      CHECK(json_valid(out, len));
+      CHECK(strstr(out, "\"ticks_per_usec\"") != NULL);
+      CHECK(strstr(out, "\"name\": \"test.inner\", \"type\": \"timer\"")
+            != NULL);
+      CHECK(strstr(out, "\"name\": \"test.bytes\", \"type\": \"counter\"")
+            != NULL);
+      CHECK(strstr(out, "\"p99_ns\"") != NULL);
+   }
+   rjsonwriter_free(w);
+
+   /* Reset keeps registrations */
+   retro_perf_reset();
+   CHECK(retro_perf_get_stats("test.inner", &stats));
+   CHECK(stats.calls == 0 && stats.max_ns == 0);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef HAVE_RETRO_PERF
+   test_timers();
+   test_counters();
+   test_thread_churn();
+   test_task_queue();
+   test_json();
+#else
+   /* Compiled out: the sites expand to nothing and queries fail */
+   retro_perf_stats_t stats;
+   int                i;
+
+   for (i = 0; i < 4; i++)
+   {
+      RETRO_PERF_BEGIN(perf_outer);
+      RETRO_PERF_BEGIN(perf_inner);
+      RETRO_PERF_END(perf_inner);
+      RETRO_PERF_END(perf_outer);
+      RETRO_PERF_BEGIN(perf_inner_again);
+      RETRO_PERF_END(perf_inner_again);
+      RETRO_PERF_ADD(perf_bytes, i);
+   }
+   add_thread(NULL);
+   busy_usec(0);
+   run_tasks();
+   CHECK(!retro_perf_get_stats("test.inner", &stats));
+   CHECK(!retro_perf_get_stats("task_queue.handler", &stats));
+   CHECK(!retro_perf_write_json(NULL));
+   retro_perf_reset();
+#endif
+
+   if (failures)
+   {
+      fprintf(stderr, "retro_perf: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("retro_perf: all tests passed\n");
+   return 0;
+}
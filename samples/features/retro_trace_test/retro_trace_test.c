@@ -0,0 +1,323 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_trace_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <formats/rjson.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <retro_trace.h>
+
+#define THREADS  4
+#define SPANS    10
+#define JOBS     8
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+static void span_thread(void *data)
+{
+   int i;
+   RETRO_TRACE_THREAD_NAME("span worker");
+   for (i = 0; i < SPANS; i++)
+   {
+      RETRO_TRACE_BEGIN("span");
+      RETRO_TRACE_END("span");
+   }
+}
+
+static void job(void *data)
+{
+   RETRO_TRACE_INSTANT("job body");
+}
+
+#ifdef HAVE_RETRO_TRACE
+/* Output of the last dump, owned by dump_writer */
+static rjsonwriter_t *dump_writer = NULL;
+
+static const char *dump(void)
+{
+   const char *out;
+
+   if (dump_writer)
+      rjsonwriter_free(dump_writer);
+   dump_writer = rjsonwriter_open_memory();
+   CHECK(retro_trace_write_json(dump_writer));
+   out = rjsonwriter_get_memory_buffer(dump_writer, NULL);
+   CHECK(out != NULL);
+   return out ? out : "";
+}
+
+static bool json_valid(const char *s)
+{
+   enum rjson_type type;
+   rjson_t *json = rjson_open_string(s, strlen(s));
+
+   if (!json)
+      return false;
+   while ((type = rjson_next(json)) != RJSON_DONE && type != RJSON_ERROR);
+   rjson_free(json);
+   return type == RJSON_DONE;
+}
+
+static unsigned count(const char *s, const char *needle)
+{
+   unsigned n = 0;
+   while ((s = strstr(s, needle)))
+   {
+      n++;
+      s += strlen(needle);
+   }
+   return n;
+}
+
+static void test_events(void)
+{
+   int         i;
+   sthread_t  *threads[THREADS];
+   tpool_t    *tp;
+   const char *out;
+
+   /* Nothing is recorded before retro_trace_start */
+   RETRO_TRACE_INSTANT("too early");
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(!strstr(out, "too early"));
+
+   retro_trace_start();
+   RETRO_TRACE_THREAD_NAME("main");
+   RETRO_TRACE_BEGIN("outer");
+   RETRO_TRACE_BEGIN("inner");
+   RETRO_TRACE_INSTANT("marker");
+   RETRO_TRACE_COUNTER("depth", 42);
+   RETRO_TRACE_END("inner");
+   RETRO_TRACE_END("outer");
+
+   for (i = 0; i < THREADS; i++)
+      threads[i] = sthread_create(span_thread, NULL);
+   for (i = 0; i < THREADS; i++)
+      sthread_join(threads[i]);
+
+   /* Hooked worker loop */
+   CHECK((tp = tpool_create(2)) != NULL);
+   for (i = 0; i < JOBS; i++)
+      tpool_add_work(tp, job, NULL);
+   tpool_wait(tp);
+   tpool_destroy(tp);
+
+   out = dump();
+   printf("%.600s...\n", out);
+   CHECK(json_valid(out));
+   CHECK(strstr(out, "\"displayTimeUnit\": \"ns\"") != NULL);
+   CHECK(strstr(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": 1, \"args\": {\"name\": \"main\"}}") != NULL);
+   CHECK(strstr(out, "{\"name\": \"outer\", \"ph\": \"B\"") != NULL);
+   CHECK(strstr(out, "{\"name\": \"marker\", \"ph\": \"i\"") != NULL);
+   CHECK(strstr(out, "\"args\": {\"value\": 42}") != NULL);
+   CHECK(count(out, "\"name\": \"span worker\"") == THREADS);
+   CHECK(count(out, "{\"name\": \"span\", \"ph\": \"B\"")
+         == THREADS * SPANS);
+   CHECK(count(out, "{\"name\": \"span\", \"ph\": \"E\"")
+         == THREADS * SPANS);
+   /* A worker is only listed once it ran a job */
+   CHECK(count(out, "\"args\": {\"name\": \"tpool\"}") >= 1);
+   CHECK(count(out, "\"args\": {\"name\": \"tpool\"}") <= 2);
+   CHECK(count(out, "{\"name\": \"tpool.job\", \"ph\": \"B\"") == JOBS);
+   CHECK(count(out, "\"job body\"") == JOBS);
+}
+
+static void test_ring(void)
+{
+   int         i;
+   const char *out;
+
+   /* The ring keeps the newest events, less the slot that the
+    * owner could be rewriting */
+   for (i = 0; i < RETRO_TRACE_RING_EVENTS + 100; i++)
+      RETRO_TRACE_INSTANT(i < 100 ? "overwritten" : "kept");
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(!strstr(out, "\"overwritten\""));
+   CHECK(count(out, "\"kept\"") == RETRO_TRACE_RING_EVENTS - 1);
+   CHECK(!strstr(out, "\"outer\""));
+
+   /* Stop keeps the events, start discards them */
+   retro_trace_stop();
+   RETRO_TRACE_INSTANT("stopped");
+   out = dump();
+   CHECK(!strstr(out, "\"stopped\""));
+   CHECK(strstr(out, "\"kept\"") != NULL);
+
+   retro_trace_start();
+   RETRO_TRACE_INSTANT("restarted");
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(!strstr(out, "\"kept\""));
+   CHECK(!strstr(out, "\"span\""));
+   CHECK(count(out, "\"restarted\"") == 1);
+   /* Names survive a restart */
+   CHECK(strstr(out, "\"args\": {\"name\": \"main\"}") != NULL);
+}
+
+static void idle_thread(void *data)
+{
+   RETRO_TRACE_THREAD_NAME("idle");
+}
+
+static void late_thread(void *data)
+{
+   RETRO_TRACE_THREAD_NAME("late");
+   RETRO_TRACE_INSTANT("late event");
+}
+
+/* Naming threads while not recording must not use up the rings */
+static void test_idle_threads(void)
+{
+   int         i;
+   sthread_t  *thread;
+   const char *out;
+
+   retro_trace_stop();
+   for (i = 0; i < RETRO_TRACE_MAX_THREADS + 8; i++)
+   {
+      CHECK((thread = sthread_create(idle_thread, NULL)) != NULL);
+      if (thread)
+         sthread_join(thread);
+   }
+
+   retro_trace_start();
+   CHECK((thread = sthread_create(late_thread, NULL)) != NULL);
+   if (thread)
+      sthread_join(thread);
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(!strstr(out, "\"args\": {\"name\": \"idle\"}"));
+   CHECK(strstr(out, "\"args\": {\"name\": \"late\"}") != NULL);
+   CHECK(count(out, "\"late event\"") == 1);
+}
+
+static void short_thread(void *data)
+{
+   RETRO_TRACE_THREAD_NAME("short");
+   RETRO_TRACE_INSTANT("short event");
+}
+
+/* Threads that recorded and exited hand their rings on, so many
+ * more than RETRO_TRACE_MAX_THREADS of them can come and go */
+static void test_exited_threads(void)
+{
+   int         i;
+   sthread_t  *thread;
+   const char *out;
+
+   retro_trace_start();
+   for (i = 0; i < 2 * RETRO_TRACE_MAX_THREADS; i++)
+   {
+      CHECK((thread = sthread_create(short_thread, NULL)) != NULL);
+      if (thread)
+         sthread_join(thread);
+   }
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(count(out, "\"short event\"") >= 1);
+
+   CHECK((thread = sthread_create(late_thread, NULL)) != NULL);
+   if (thread)
+      sthread_join(thread);
+   out = dump();
+   CHECK(json_valid(out));
+   CHECK(count(out, "\"late event\"") == 1);
+}
+
+#if !defined(__SANITIZE_THREAD__)
+static void lapping_thread(void *data)
+{
+   int i;
+   for (i = 0; i < 200 * RETRO_TRACE_RING_EVENTS; i++)
+   {
+      RETRO_TRACE_BEGIN("lap");
+      RETRO_TRACE_END("lap");
+   }
+}
+
+/* Dumping while a thread laps its ring must still give valid JSON
+ * holding at most one ring of its events.  Skipped under TSan: the
+ * dump reads events while they are overwritten, and drops them. */
+static void test_concurrent_dump(void)
+{
+   int        i;
+   sthread_t *thread = sthread_create(lapping_thread, NULL);
+
+   for (i = 0; i < 20; i++)
+   {
+      const char *out = dump();
+      CHECK(json_valid(out));
+      CHECK(count(out, "\"lap\"") <= RETRO_TRACE_RING_EVENTS);
+   }
+   sthread_join(thread);
+}
+#endif
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef HAVE_RETRO_TRACE
+   CHECK(!retro_trace_write_json(NULL));
+   test_events();
+   test_ring();
+   test_idle_threads();
+   test_exited_threads();
+#if !defined(__SANITIZE_THREAD__)
+   test_concurrent_dump();
+#endif
+   retro_trace_stop();
+   if (dump_writer)
+      rjsonwriter_free(dump_writer);
+#else
+   /* Compiled out: the sites expand to nothing */
+   retro_trace_start();
+   span_thread(NULL);
+   job(NULL);
+   RETRO_TRACE_COUNTER("depth", 1);
+   CHECK(!retro_trace_write_json(NULL));
+   retro_trace_stop();
+#endif
+
+   if (failures)
+   {
+      fprintf(stderr, "retro_trace: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("retro_trace: all tests passed\n");
+   return 0;
+}
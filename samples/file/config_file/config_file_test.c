@@ -27,6 +27,7 @@
 #include <errno.h>
 
 #include <file/config_file.h>
+#include <streams/file_stream.h>
 
 static void test_config_file_parse_contains(
       const char *cfgtext,
@@ -373,6 +374,315 @@ static void test_config_file_high_bit_bytes_smoke(void)
    printf("[SUCCESS] high-bit byte in config parsed without crash\n");
 }
 
+static void test_config_file_expect(config_file_t *cfg,
+      const char *key, const char *val)
+{
+   char *out = NULL;
+   bool   ok = config_get_string(cfg, key, &out);
+
+   if (ok != (val != NULL) || (val && strcmp(out, val) != 0))
+   {
+      printf("[FAILED] in-place parse: [%s] expected [%s] got [%s]\n",
+            key, val ? val : "(none)", out ? out : "(none)");
+      abort();
+   }
+   free(out);
+}
+
+/* config_file_new_from_path_to_string() parses in place: keys and
+ * values point into the file buffer and entry nodes come from one
+ * block.  Mixing those with heap entries (setters, unset, append)
+ * must never free() arena memory; under ASan any such mix-up shows
+ * up as a bad-free. */
+static void test_config_file_in_place(void)
+{
+   const char *tmp_path = "rarch_cfg_in_place_test.cfg";
+   const char *tmp_path2 = "rarch_cfg_in_place_test2.cfg";
+   FILE          *fp    = fopen(tmp_path, "wb");
+   config_file_t *cfg;
+
+   if (!fp)
+      abort();
+   fputs("# leading comment\n"
+         "foo = \"bar\"\n"
+         "empty = \"\"\n"
+         "bare = word trailing\n"
+         "bad\x80= \"x\"\n"
+         "nokey\n"
+         "tabbed\t=\t\"a # b\"  # trailing comment\n"
+         "foo = \"shadowed\"\r\n"
+         "last = 1", fp);
+   fclose(fp);
+
+   if (!(fp = fopen(tmp_path2, "wb")))
+      abort();
+   fputs("appended = \"yes\"\nfoo = \"override\"\n", fp);
+   fclose(fp);
+
+   if (!(cfg = config_file_new_from_path_to_string(tmp_path)))
+      abort();
+
+   test_config_file_expect(cfg, "foo",    "bar");
+   test_config_file_expect(cfg, "empty",  "");
+   test_config_file_expect(cfg, "bare",   "word");
+   test_config_file_expect(cfg, "tabbed", "a # b");
+   test_config_file_expect(cfg, "last",   "1");
+   test_config_file_expect(cfg, "bad\x80", NULL);
+   test_config_file_expect(cfg, "nokey",  NULL);
+
+   config_set_string(cfg, "foo", "changed");
+   config_set_string(cfg, "fresh", "new");
+   config_unset(cfg, "bare");
+   test_config_file_expect(cfg, "foo",   "changed");
+   test_config_file_expect(cfg, "fresh", "new");
+   test_config_file_expect(cfg, "bare",  NULL);
+
+   if (!config_append_file(cfg, tmp_path2))
+      abort();
+   test_config_file_expect(cfg, "appended", "yes");
+   test_config_file_expect(cfg, "foo",      "override");
+
+   remove(tmp_path);
+   remove(tmp_path2);
+   config_file_free(cfg);
+   printf("[SUCCESS] in-place parse mixes arena and heap entries\n");
+}
+
+static void test_config_file_write_text(const char *path, const char *text)
+{
+   FILE *fp = fopen(path, "wb");
+   if (!fp)
+      abort();
+   fputs(text, fp);
+   fclose(fp);
+}
+
+/* config_file_new_cached() must serve the snapshot only while the
+ * config and everything it includes are unchanged, and
+ * config_file_write() must leave a snapshot matching the new file.
+ *
+ * White-box: CONF_FILE_FLG_FROM_SNAPSHOT tells the two paths
+ * apart. */
+static void test_config_file_cached(void)
+{
+   const char *cfg_path  = "rarch_cfg_cached_test.cfg";
+   const char *inc_path  = "rarch_cfg_cached_test_inc.cfg";
+   const char *snap_path = "rarch_cfg_cached_test.snap";
+   config_file_t *cfg;
+
+   remove(snap_path);
+   test_config_file_write_text(inc_path, "inc_key = \"from_include\"\n");
+   test_config_file_write_text(cfg_path,
+         "main_key = \"main\"\n"
+         "#include \"rarch_cfg_cached_test_inc.cfg\"\n");
+
+   /* Cold: parses and writes the snapshot */
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (!cfg->sources || (cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT))
+   {
+      printf("[FAILED] cold load did not record #include sources\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "main_key", "main");
+   test_config_file_expect(cfg, "inc_key",  "from_include");
+   config_file_free(cfg);
+
+   /* Warm: served from the snapshot */
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (!(cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT) || !cfg->sources)
+   {
+      printf("[FAILED] warm load reparsed instead of using snapshot\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "main_key", "main");
+   test_config_file_expect(cfg, "inc_key",  "from_include");
+
+   /* Writing refreshes the snapshot */
+   config_set_string(cfg, "main_key", "changed");
+   if (!config_file_write(cfg, cfg_path, true))
+      abort();
+   config_file_free(cfg);
+
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (!(cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT))
+   {
+      printf("[FAILED] snapshot not refreshed by config_file_write\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "main_key", "changed");
+   test_config_file_expect(cfg, "inc_key",  "from_include");
+
+   /* A snapshot rewritten from a snapshot-loaded config still
+    * tracks the include: editing it forces a reparse */
+   config_set_string(cfg, "main_key", "rewritten");
+   if (!config_file_write(cfg, cfg_path, true))
+      abort();
+   config_file_free(cfg);
+   test_config_file_write_text(inc_path,
+         "inc_key = \"edited_after_rewrite\"\n");
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT)
+   {
+      printf("[FAILED] rewritten snapshot lost its #include sources\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "main_key", "rewritten");
+   test_config_file_expect(cfg, "inc_key",  "edited_after_rewrite");
+   config_file_free(cfg);
+
+   test_config_file_write_text(inc_path, "inc_key = \"from_include\"\n");
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   test_config_file_expect(cfg, "inc_key",  "from_include");
+
+   /* Unsetting an included key cannot stick: a reparse brings
+    * it back, so the write drops the snapshot instead */
+   config_unset(cfg, "inc_key");
+   config_set_string(cfg, "main_key", "changed again");
+   if (!config_file_write(cfg, cfg_path, true))
+      abort();
+   config_file_free(cfg);
+
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT)
+   {
+      printf("[FAILED] snapshot kept after an included key was unset\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "main_key", "changed again");
+   test_config_file_expect(cfg, "inc_key",  "from_include");
+   config_file_free(cfg);
+
+   /* A changed include invalidates the snapshot */
+   test_config_file_write_text(inc_path,
+         "inc_key = \"edited_include_value\"\n");
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   if (cfg->flags & CONF_FILE_FLG_FROM_SNAPSHOT)
+   {
+      printf("[FAILED] stale snapshot served after include changed\n");
+      abort();
+   }
+   test_config_file_expect(cfg, "inc_key", "edited_include_value");
+   config_file_free(cfg);
+
+   /* A corrupt snapshot is ignored */
+   test_config_file_write_text(snap_path, "garbage");
+   if (!(cfg = config_file_new_cached(cfg_path, snap_path)))
+      abort();
+   test_config_file_expect(cfg, "main_key", "changed again");
+   config_file_free(cfg);
+
+   remove(cfg_path);
+   remove(inc_path);
+   remove(snap_path);
+   printf("[SUCCESS] config snapshot served only while fresh\n");
+}
+
+/* config_file_write_incremental() patches only what changed and
+ * keeps comments, order and untouched lines byte for byte.  New keys
+ * land ahead of the first #include so they still take precedence. */
+static void test_config_file_write_incremental(void)
+{
+   const char *cfg_path = "rarch_cfg_incremental_test.cfg";
+   const char *expected =
+      "# user comment\n"
+      "keep   =   \"as is\"   # trailing\n"
+      "change = \"new\"\n"
+      "\n"
+      "dup = \"first\"\n"
+      "dup = \"shadowed\"\n"
+      "added = \"value\"\n"
+      "#include \"rarch_cfg_incremental_missing.cfg\"\n"
+      "tail = 1";
+   const char *expected_tail =
+      "# user comment\n"
+      "keep   =   \"as is\"   # trailing\n"
+      "change = \"new\"\n"
+      "\n"
+      "dup = \"first\"\n"
+      "dup = \"shadowed\"\n"
+      "added = \"value\"\n"
+      "#include \"rarch_cfg_incremental_missing.cfg\"\n"
+      "tail = \"2\"\n";
+   config_file_t *cfg;
+   char *data = NULL;
+   int64_t len = 0;
+
+   test_config_file_write_text(cfg_path,
+      "# user comment\n"
+      "keep   =   \"as is\"   # trailing\n"
+      "change = \"old\"\n"
+      "gone = \"bye\"\n"
+      "\n"
+      "dup = \"first\"\n"
+      "dup = \"shadowed\"\n"
+      "#include \"rarch_cfg_incremental_missing.cfg\"\n"
+      "tail = 1");
+
+   if (!(cfg = config_file_new(cfg_path)))
+      abort();
+   config_set_string(cfg, "change", "new");
+   config_set_string(cfg, "added",  "value");
+   config_unset(cfg, "gone");
+   if (!config_file_write_incremental(cfg, cfg_path))
+      abort();
+   config_file_free(cfg);
+
+   if (!filestream_read_file(cfg_path, (void**)&data, &len)
+         || strcmp(data, expected) != 0)
+   {
+      printf("[FAILED] incremental write produced:\n%s\n", data ? data : "");
+      abort();
+   }
+   free(data);
+
+   /* A key whose line comes after the #include is patched in place,
+    * not taken for a new one and written twice */
+   if (!(cfg = config_file_new(cfg_path)))
+      abort();
+   config_set_string(cfg, "tail", "2");
+   if (!config_file_write_incremental(cfg, cfg_path))
+      abort();
+   config_file_free(cfg);
+
+   data = NULL;
+   if (!filestream_read_file(cfg_path, (void**)&data, &len)
+         || strcmp(data, expected_tail) != 0)
+   {
+      printf("[FAILED] key after #include duplicated:\n%s\n",
+            data ? data : "");
+      abort();
+   }
+   free(data);
+
+   /* Editing the file behind the config's back falls back to a
+    * full rewrite, which must still carry every entry */
+   if (!(cfg = config_file_new(cfg_path)))
+      abort();
+   test_config_file_write_text(cfg_path, "unrelated = \"1\"\n");
+   config_set_string(cfg, "change", "again");
+   if (!config_file_write_incremental(cfg, cfg_path))
+      abort();
+   config_file_free(cfg);
+
+   if (!(cfg = config_file_new(cfg_path)))
+      abort();
+   test_config_file_expect(cfg, "keep",      "as is");
+   test_config_file_expect(cfg, "change",    "again");
+   test_config_file_expect(cfg, "tail",      "2");
+   test_config_file_expect(cfg, "unrelated", NULL);
+   config_file_free(cfg);
+
+   remove(cfg_path);
+   printf("[SUCCESS] incremental write patches only changed lines\n");
+}
+
 int main(void)
 {
    test_config_file_parse_contains("foo = \"bar\"\n",   "foo", "bar");
@@ -416,4 +726,7 @@ int main(void)
 
    test_config_file_deinitialize_clears_fields();
    test_config_file_high_bit_bytes_smoke();
+   test_config_file_in_place();
+   test_config_file_cached();
+   test_config_file_write_incremental();
 }
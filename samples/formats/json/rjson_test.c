@@ -28,6 +28,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <stdint.h>
 
 #include <formats/rjson.h>
 #include <formats/rjson_helpers.h>
@@ -269,6 +271,479 @@ static void test_open_user_tiny_block(void)
    printf("[SUCCESS] open_user with tiny io_block_size floors cleanly\n");
 }
 
+/* ------------------------------------------------------------------ */
+/* Vectorised string / whitespace scanning                            */
+/* ------------------------------------------------------------------ */
+
+struct chunk_io { const char *p, *end; };
+
+static int chunk_io_read(void *buf, int len, void *user)
+{
+   struct chunk_io *io = (struct chunk_io*)user;
+   if (io->end - io->p < len)
+      len = (int)(io->end - io->p);
+   memcpy(buf, io->p, len);
+   io->p += len;
+   return len;
+}
+
+/* Parses a document holding a single string, either from a buffer
+ * (one block) or in 16 byte blocks so strings straddle refills */
+static enum rjson_type parse_one_string(const char *doc, size_t len,
+      bool chunked, char options, char *out, size_t out_size)
+{
+   struct chunk_io io;
+   enum rjson_type type;
+   rjson_t *json;
+
+   io.p   = doc;
+   io.end = doc + len;
+   json   = chunked ? rjson_open_user(chunk_io_read, &io, 16)
+                    : rjson_open_buffer(doc, len);
+   if (!json)
+      return RJSON_ERROR;
+   rjson_set_options(json, options);
+   if ((type = rjson_next(json)) == RJSON_STRING)
+   {
+      size_t _len;
+      const char *str = rjson_get_string(json, &_len);
+      if (_len >= out_size)
+         _len = out_size - 1;
+      memcpy(out, str, _len);
+      out[_len] = '\0';
+   }
+   rjson_free(json);
+   return type;
+}
+
+static void test_parser_scanner(void)
+{
+   /* Puts the interesting byte at every offset around the 16 and
+    * 32 byte vector boundaries, with and without refills. */
+   char doc[192], want[128], got[128];
+   int before = failures;
+   size_t k;
+   int chunked;
+
+   for (chunked = 0; chunked < 2; chunked++)
+   {
+      for (k = 0; k < 40; k++)
+      {
+         enum rjson_type type;
+
+         /* escape */
+         memset(want, 'a', k);
+         want[k] = '\n';
+         memcpy(want + k + 1, "bbbbbbbbbbbbbbbbbbbb", 21);
+         snprintf(doc, sizeof(doc), "\"%.*s\\n%s\"", (int)k, want, want + k + 1);
+         type = parse_one_string(doc, strlen(doc), chunked, 0, got, sizeof(got));
+         if (type != RJSON_STRING || strcmp(got, want))
+         {
+            printf("[ERROR] scanner: escape at %u (chunked=%d)\n", (unsigned)k, chunked);
+            failures++;
+         }
+
+         /* valid multi-byte UTF-8 */
+         memset(want, 'a', k);
+         memcpy(want + k, "\xC3\xA9\xE2\x82\xAC" "cccccccccccccccccc", 24);
+         snprintf(doc, sizeof(doc), "\"%s\"", want);
+         type = parse_one_string(doc, strlen(doc), chunked, 0, got, sizeof(got));
+         if (type != RJSON_STRING || strcmp(got, want))
+         {
+            printf("[ERROR] scanner: UTF-8 at %u (chunked=%d)\n", (unsigned)k, chunked);
+            failures++;
+         }
+
+         /* invalid UTF-8 after a long ASCII run */
+         memset(want, 'a', k);
+         memcpy(want + k, "\xFF" "dddddddddddddddddddd", 22);
+         snprintf(doc, sizeof(doc), "\"%s\"", want);
+         if (parse_one_string(doc, strlen(doc), chunked, 0,
+                  got, sizeof(got)) != RJSON_ERROR)
+         {
+            printf("[ERROR] scanner: invalid UTF-8 at %u accepted\n", (unsigned)k);
+            failures++;
+         }
+         want[k] = '?';
+         type = parse_one_string(doc, strlen(doc), chunked,
+               RJSON_OPTION_REPLACE_INVALID_ENCODING, got, sizeof(got));
+         if (type != RJSON_STRING || strcmp(got, want))
+         {
+            printf("[ERROR] scanner: replaced UTF-8 at %u (chunked=%d)\n", (unsigned)k, chunked);
+            failures++;
+         }
+
+         /* unescaped control character */
+         memset(want, 'a', k);
+         memcpy(want + k, "\x01" "eeeeeeeeeeeeeeeeeeee", 22);
+         snprintf(doc, sizeof(doc), "\"%s\"", want);
+         if (parse_one_string(doc, strlen(doc), chunked, 0,
+                  got, sizeof(got)) != RJSON_ERROR)
+         {
+            printf("[ERROR] scanner: control char at %u accepted\n", (unsigned)k);
+            failures++;
+         }
+      }
+   }
+
+   {
+      /* Indentation runs are skipped in bulk; line and column
+       * reporting must still be right afterwards */
+      static const char pretty[] =
+         "{\n"
+         "                                        \"a\": 1,\n"
+         "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\"b\": x\n"
+         "}";
+      rjson_t *json = rjson_open_buffer(pretty, sizeof(pretty) - 1);
+      enum rjson_type type;
+      while ((type = rjson_next(json)) != RJSON_ERROR && type != RJSON_DONE) { }
+      if (type != RJSON_ERROR || rjson_get_source_line(json) != 3
+            || rjson_get_source_column(json) != 25)
+      {
+         printf("[ERROR] scanner: indent error at line %u col %u\n",
+               (unsigned)rjson_get_source_line(json),
+               (unsigned)rjson_get_source_column(json));
+         failures++;
+      }
+      rjson_free(json);
+   }
+
+   if (failures == before)
+      printf("[SUCCESS] vectorised string and whitespace scanning\n");
+}
+
+/* ------------------------------------------------------------------ */
+/* Number conversion                                                  */
+/* ------------------------------------------------------------------ */
+
+static double parse_number(const char *doc)
+{
+   double res = -1.0;
+   rjson_t *json = rjson_open_string(doc, strlen(doc));
+   if (json && rjson_next(json) == RJSON_NUMBER)
+      res = rjson_get_double(json);
+   if (json)
+      rjson_free(json);
+   return res;
+}
+
+/* rjson_open_buffer reads a large document in blocks rather than
+ * copying it whole; strings that straddle a block must still come out
+ * intact, including ones longer than a block. */
+static void test_buffer_blocks(void)
+{
+   enum { STRINGS = 4000, LONG_LEN = 20000 };
+   size_t cap  = STRINGS * 16 + LONG_LEN + 16;
+   char *doc   = (char*)malloc(cap);
+   size_t len  = 0;
+   int strings = 0;
+   int bad     = 0;
+   enum rjson_type type;
+   rjson_t *json;
+   int i;
+
+   if (!doc) { printf("[ERROR] buffer blocks: OOM\n"); failures++; return; }
+
+   doc[len++] = '[';
+   for (i = 0; i < STRINGS; i++)
+      len += snprintf(doc + len, cap - len, "\"s%07d\",", i);
+   doc[len++] = '"';
+   memset(doc + len, 'y', LONG_LEN);
+   len += LONG_LEN;
+   doc[len++] = '"';
+   doc[len++] = ']';
+
+   if (!(json = rjson_open_buffer(doc, len)))
+   {
+      printf("[ERROR] buffer blocks: open failed\n");
+      failures++;
+      free(doc);
+      return;
+   }
+   while ((type = rjson_next(json)) != RJSON_DONE && type != RJSON_ERROR)
+   {
+      size_t _len;
+      const char *str;
+      char want[16];
+      if (type != RJSON_STRING)
+         continue;
+      str = rjson_get_string(json, &_len);
+      if (strings < STRINGS)
+      {
+         snprintf(want, sizeof(want), "s%07d", strings);
+         if (_len != 8 || memcmp(str, want, 8))
+            bad++;
+      }
+      else if (_len != LONG_LEN || str[0] != 'y' || str[LONG_LEN - 1] != 'y')
+         bad++;
+      strings++;
+   }
+   rjson_free(json);
+   free(doc);
+
+   if (type != RJSON_DONE || strings != STRINGS + 1 || bad)
+   {
+      printf("[ERROR] buffer blocks: type=%d strings=%d bad=%d\n",
+            (int)type, strings, bad);
+      failures++;
+      return;
+   }
+   printf("[SUCCESS] open_buffer reads large documents in blocks\n");
+}
+
+static void test_numbers(void)
+{
+   static const struct { const char *in; double want; } parse[] = {
+      { "0",                         0.0 },
+      { "-0.5",                     -0.5 },
+      { "0.1",                       0.1 },
+      { "3.141592653589793",         3.141592653589793 },
+      { "1e23",                      1e23 },
+      { "2.2250738585072014e-308",   2.2250738585072014e-308 },
+      { "4.9406564584124654e-324",   4.9406564584124654e-324 },
+      { "1.7976931348623157e308",    1.7976931348623157e308 },
+      { "9007199254740993",          9007199254740992.0 },
+      { "123456789012345678901234567890", 1.2345678901234568e29 },
+      { "1e-400",                    0.0 }
+   };
+   static const struct { double in; const char *want; } format[] = {
+      { 0.0,                       "0" },
+      { 42.0,                      "42" },
+      { -1.5,                      "-1.5" },
+      { 0.1,                       "0.1" },
+      { 3.141592653589793,         "3.141592653589793" },
+      { 1e21,                      "1e+21" },
+      { 1e20,                      "100000000000000000000" },
+      { 0.000001,                  "0.000001" },
+      { 1e-7,                      "1e-7" },
+      { 5e-324,                    "5e-324" },
+      { 7.9050503334599447e-323,   "8e-323" },
+      { 1.7976931348623157e308,    "1.7976931348623157e+308" }
+   };
+   char buf[64];
+   int before = failures;
+   size_t i;
+
+   for (i = 0; i < sizeof(parse) / sizeof(parse[0]); i++)
+   {
+      double got = parse_number(parse[i].in);
+      if (got != parse[i].want)
+      {
+         printf("[ERROR] numbers: parse \"%s\" gave %.17g\n", parse[i].in, got);
+         failures++;
+      }
+   }
+
+   for (i = 0; i < sizeof(format) / sizeof(format[0]); i++)
+   {
+      const char *out;
+      rjsonwriter_t *w = rjsonwriter_open_memory();
+      rjsonwriter_add_double(w, format[i].in);
+      out = rjsonwriter_get_memory_buffer(w, NULL);
+      if (!out || strcmp(out, format[i].want))
+      {
+         printf("[ERROR] numbers: format %.17g gave \"%s\" want \"%s\"\n",
+               format[i].in, out ? out : "(null)", format[i].want);
+         failures++;
+      }
+      rjsonwriter_free(w);
+   }
+
+   /* Every formatted double must read back bit for bit */
+   for (i = 0; i < 20000; i++)
+   {
+      double v = (double)(i * 2654435761u) / (double)(i + 1) * (i & 1 ? 1e-5 : 1e7);
+      rjsonwriter_t *w = rjsonwriter_open_memory();
+      const char *out;
+      rjsonwriter_add_double(w, v);
+      out = rjsonwriter_get_memory_buffer(w, NULL);
+      snprintf(buf, sizeof(buf), "%s", out ? out : "");
+      rjsonwriter_free(w);
+      if (parse_number(buf) != v)
+      {
+         printf("[ERROR] numbers: %.17g did not round-trip via \"%s\"\n", v, buf);
+         failures++;
+         break;
+      }
+   }
+
+   /* Subnormals with only a few significant digits */
+   for (i = 1; i < 4096; i++)
+   {
+      double v = (double)i * 4.9406564584124654e-324;
+      rjsonwriter_t *w = rjsonwriter_open_memory();
+      const char *out;
+      rjsonwriter_add_double(w, v);
+      out = rjsonwriter_get_memory_buffer(w, NULL);
+      snprintf(buf, sizeof(buf), "%s", out ? out : "");
+      rjsonwriter_free(w);
+      if (parse_number(buf) != v)
+      {
+         printf("[ERROR] numbers: %.17g did not round-trip via \"%s\"\n", v, buf);
+         failures++;
+         break;
+      }
+   }
+
+   {
+      /* Integer fast paths, saturating instead of overflowing */
+      const char *out;
+      rjson_t *json = rjson_open_string("[-9223372036854775808, 99999999999999999999, -7]", 47);
+      rjsonwriter_t *w;
+      rjson_next(json);
+      rjson_next(json);
+      if (rjson_get_int64(json) != INT64_MIN)
+      {
+         printf("[ERROR] numbers: INT64_MIN\n");
+         failures++;
+      }
+      rjson_next(json);
+      if (rjson_get_int64(json) != INT64_MAX || rjson_get_int(json) != INT_MAX)
+      {
+         printf("[ERROR] numbers: saturation\n");
+         failures++;
+      }
+      rjson_next(json);
+      if (rjson_get_int(json) != -7)
+      {
+         printf("[ERROR] numbers: small int\n");
+         failures++;
+      }
+      rjson_free(json);
+
+      w = rjsonwriter_open_memory();
+      rjsonwriter_add_int64(w, INT64_MIN);
+      rjsonwriter_add_comma(w);
+      rjsonwriter_add_uint64(w, UINT64_MAX);
+      rjsonwriter_add_comma(w);
+      rjsonwriter_add_int(w, -120);
+      out = rjsonwriter_get_memory_buffer(w, NULL);
+      if (!out || strcmp(out, "-9223372036854775808,18446744073709551615,-120"))
+      {
+         printf("[ERROR] numbers: integer writer gave \"%s\"\n", out ? out : "(null)");
+         failures++;
+      }
+      rjsonwriter_free(w);
+   }
+
+   if (failures == before)
+      printf("[SUCCESS] number parsing and formatting\n");
+}
+
+/* ------------------------------------------------------------------ */
+/* Tape                                                               */
+/* ------------------------------------------------------------------ */
+
+static void tape_expect_string(rjson_tape_t *tape, const char *path,
+      const char *want)
+{
+   size_t len;
+   const char *got = rjson_tape_get_string(tape,
+         rjson_tape_find(tape, 0, path), &len);
+   if (!got || len != strlen(want) || memcmp(got, want, len + 1))
+   {
+      printf("[ERROR] tape: %s gave \"%s\" instead of \"%s\"\n",
+            path, got ? got : "(null)", want);
+      failures++;
+   }
+}
+
+static void test_tape(void)
+{
+   static const char doc[] =
+      "{\"name\":\"list\",\"count\":3,\n"
+      " \"items\":[{\"path\":\"a\"},[1,[2]],{},\n"
+      "   {\"path\":\"c:\\\\roms\\\\x.bin\",\"tag\":\"\\u00e9\\ud83d\\ude00\"}],\n"
+      " \"a/b\":true,\"m~n\":null,\"esc\\\"key\":-12.5e1,\"last\":7}";
+   rjson_tape_t *tape = rjson_tape_new();
+   int before = failures;
+   size_t node, items, n;
+   int round;
+
+   /* Parse twice to exercise reusing the tape */
+   for (round = 0; round < 2; round++)
+   {
+      if (!rjson_tape_parse(tape, doc, sizeof(doc) - 1, 0))
+      {
+         printf("[ERROR] tape: parse failed: %s\n", rjson_tape_get_error(tape));
+         failures++;
+         break;
+      }
+
+      if (rjson_tape_get_type(tape, 0) != RJSON_OBJECT
+            || rjson_tape_get_count(tape, 0) != 7)
+      {
+         printf("[ERROR] tape: unexpected root\n");
+         failures++;
+      }
+      items = rjson_tape_get_member(tape, 0, "items");
+      if (rjson_tape_get_type(tape, items) != RJSON_ARRAY
+            || rjson_tape_get_count(tape, items) != 4)
+      {
+         printf("[ERROR] tape: unexpected items array\n");
+         failures++;
+      }
+
+      /* Sibling stepping over nested containers */
+      for (n = 0, node = rjson_tape_first(tape, items);
+            node != RJSON_TAPE_NONE; node = rjson_tape_next(tape, node))
+         n++;
+      if (n != 4 || rjson_tape_first(tape, rjson_tape_find(tape, 0, "/items/2"))
+            != RJSON_TAPE_NONE)
+      {
+         printf("[ERROR] tape: iterating items gave %u elements\n", (unsigned)n);
+         failures++;
+      }
+
+      tape_expect_string(tape, "/name", "list");
+      tape_expect_string(tape, "/items/0/path", "a");
+      tape_expect_string(tape, "/items/3/path", "c:\\roms\\x.bin");
+      tape_expect_string(tape, "/items/3/tag", "\xC3\xA9\xF0\x9F\x98\x80");
+      tape_expect_string(tape, "/esc\"key", "-12.5e1");
+      tape_expect_string(tape, "/last", "7");
+
+      if (     rjson_tape_get_int64(tape, rjson_tape_find(tape, 0, "/count")) != 3
+            || rjson_tape_get_int64(tape, rjson_tape_find(tape, 0, "/items/1/1/0")) != 2
+            || rjson_tape_get_double(tape, rjson_tape_find(tape, 0, "/esc\"key")) != -125.0
+            || rjson_tape_get_type(tape, rjson_tape_find(tape, 0, "/a~1b")) != RJSON_TRUE
+            || rjson_tape_get_type(tape, rjson_tape_find(tape, 0, "/m~0n")) != RJSON_NULL
+            || rjson_tape_find(tape, 0, "") != 0
+            || rjson_tape_find(tape, 0, "/items/4") != RJSON_TAPE_NONE
+            || rjson_tape_find(tape, 0, "/items/01") != RJSON_TAPE_NONE
+            || rjson_tape_find(tape, 0, "/nope") != RJSON_TAPE_NONE
+            || rjson_tape_find(tape, 0, "/count/x") != RJSON_TAPE_NONE
+            || rjson_tape_find(tape, 0, "items") != RJSON_TAPE_NONE)
+      {
+         printf("[ERROR] tape: lookups gave unexpected results\n");
+         failures++;
+      }
+   }
+
+   /* A number running up to the end of the document */
+   if (     !rjson_tape_parse(tape, "12345", 5, 0)
+         || rjson_tape_get_int64(tape, 0) != 12345
+         || rjson_tape_next(tape, 0) != RJSON_TAPE_NONE)
+   {
+      printf("[ERROR] tape: top level number failed\n");
+      failures++;
+   }
+
+   /* Errors leave an empty tape behind */
+   if (     rjson_tape_parse(tape, "[1,2,\n{\"a\" 1}]", 15, 0)
+         || !strstr(rjson_tape_get_error(tape), "line 2")
+         || rjson_tape_get_type(tape, 0) != RJSON_ERROR)
+   {
+      printf("[ERROR] tape: malformed input gave \"%s\"\n",
+            rjson_tape_get_error(tape));
+      failures++;
+   }
+
+   rjson_tape_free(tape);
+
+   if (failures == before)
+      printf("[SUCCESS] tape parsing and lookups\n");
+}
+
 int main(void)
 {
    test_parser_happy_path();
@@ -277,6 +752,10 @@ int main(void)
    test_writer_happy_path();
    test_writer_negative_len();
    test_open_user_tiny_block();
+   test_parser_scanner();
+   test_buffer_blocks();
+   test_numbers();
+   test_tape();
 
    if (failures)
    {
@@ -0,0 +1,214 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (logiqx_dat_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <formats/logiqx_dat.h>
+
+#define TEST_DAT   "logiqx_dat_test.dat"
+#define TEST_CACHE "logiqx_dat_test.idx"
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+static const char *test_dat =
+   "<?xml version=\"1.0\"?>\n"
+   "<!DOCTYPE datafile PUBLIC \"-//Logiqx//DTD ROM Management Datafile//EN\" "
+   "\"http://www.logiqx.com/Dats/datafile.dtd\">\n"
+   "<datafile>\n"
+   "  <header><name>Test</name></header>\n"
+   "  <game name=\"alpha\">\n"
+   "    <description>\n      Alpha &amp;amp; Omega\n    </description>\n"
+   "    <year>1984</year>\n"
+   "    <manufacturer>Acme</manufacturer>\n"
+   "    <rom name=\"a.bin\" size=\"1024\" crc=\"DEADBEEF\" "
+   "md5=\"0123456789abcdef0123456789abcdef\" "
+   "sha1=\"0123456789abcdef0123456789abcdef01234567\"/>\n"
+   "  </game>\n"
+   "  <machine name=\"neogeo\" isbios=\"yes\">\n"
+   /* Later duplicates win until all three entries are found */
+   "    <description>Neo<!-- c -->Geo</description>\n"
+   "    <description>Neo-Geo BIOS</description>\n"
+   "    <rom name=\"nodump.bin\" size=\"16\" status=\"nodump\"/>\n"
+   "  </machine>\n"
+   "  <game name=\"beta\" runnable=\"no\">\n"
+   "    <description><b>nested</b></description>\n"
+   "    <year>1990</year><manufacturer>M</manufacturer>\n"
+   "    <description>too late</description>\n"
+   "    <rom name=\"b.bin\" size=\"2048\" crc=\"deadbeef\"/>\n"
+   "  </game>\n"
+   "  <game name=\"alpha\"><description>Second alpha</description>\n"
+   "    <rom name=\"c.bin\" size=\"1024\" crc=\"deadbeef\"/>\n"
+   "  </game>\n"
+   "  <software name=\"gamma\"><part><dataarea>\n"
+   "    <rom name=\"g.bin\" size=\"4\" crc=\"00000001\" "
+   "sha1=\"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF\"/>\n"
+   "  </dataarea></part></software>\n"
+   "</datafile>\n";
+
+static bool write_text(const char *path, const char *text)
+{
+   return filestream_write_file(path, text, (int64_t)strlen(text));
+}
+
+static void check_contents(logiqx_dat_t *dat)
+{
+   logiqx_dat_game_info_t info;
+   unsigned count = 0;
+
+   logiqx_dat_set_first(dat);
+   while (logiqx_dat_get_next(dat, &info))
+   {
+      switch (count++)
+      {
+         case 0:
+            CHECK(string_is_equal(info.name, "alpha"));
+            CHECK(string_is_equal(info.description, "Alpha & Omega"));
+            CHECK(string_is_equal(info.year, "1984"));
+            CHECK(string_is_equal(info.manufacturer, "Acme"));
+            CHECK(!info.is_bios && info.is_runnable);
+            break;
+         case 1:
+            CHECK(string_is_equal(info.name, "neogeo"));
+            CHECK(string_is_equal(info.description, "Neo-Geo BIOS"));
+            CHECK(info.is_bios && !info.is_runnable);
+            break;
+         case 2:
+            CHECK(string_is_equal(info.name, "beta"));
+            CHECK(string_is_equal(info.description, ""));
+            CHECK(string_is_equal(info.year, "1990"));
+            CHECK(!info.is_bios && !info.is_runnable);
+            break;
+         case 3:
+            CHECK(string_is_equal(info.description, "Second alpha"));
+            break;
+         case 4:
+            CHECK(string_is_equal(info.name, "gamma"));
+            break;
+      }
+   }
+   CHECK(count == 5);
+
+   /* First game in file order wins */
+   CHECK(logiqx_dat_search(dat, "alpha", &info));
+   CHECK(string_is_equal(info.description, "Alpha & Omega"));
+   CHECK(logiqx_dat_search(dat, "gamma", &info));
+   CHECK(!logiqx_dat_search(dat, "delta", &info));
+   CHECK(!logiqx_dat_search(dat, "", &info));
+
+   CHECK(logiqx_dat_search_crc(dat, 0xdeadbeef, 1024, &info));
+   CHECK(string_is_equal(info.description, "Alpha & Omega"));
+   CHECK(logiqx_dat_search_crc(dat, 0xdeadbeef, 2048, &info));
+   CHECK(string_is_equal(info.name, "beta"));
+   CHECK(!logiqx_dat_search_crc(dat, 0xdeadbeef, 16, &info));
+   CHECK(logiqx_dat_search_crc(dat, 1, 4, &info));
+   CHECK(string_is_equal(info.name, "gamma"));
+
+   CHECK(logiqx_dat_search_hash(dat,
+         "0123456789ABCDEF0123456789ABCDEF", &info));
+   CHECK(string_is_equal(info.name, "alpha"));
+   CHECK(logiqx_dat_search_hash(dat,
+         "ffffffffffffffffffffffffffffffffffffffff", &info));
+   CHECK(string_is_equal(info.name, "gamma"));
+   CHECK(!logiqx_dat_search_hash(dat,
+         "0123456789abcdef0123456789abcdef0123456x", &info));
+   CHECK(!logiqx_dat_search_hash(dat, "deadbeef", &info));
+}
+
+int main(int argc, char *argv[])
+{
+   logiqx_dat_game_info_t info;
+   logiqx_dat_t *dat = NULL;
+
+   filestream_delete(TEST_CACHE);
+   CHECK(write_text(TEST_DAT, test_dat));
+
+   /* Plain load */
+   CHECK((dat = logiqx_dat_init(TEST_DAT)) != NULL);
+   if (dat)
+      check_contents(dat);
+   logiqx_dat_free(dat);
+
+   /* Cache miss writes the cache, cache hit must agree */
+   CHECK((dat = logiqx_dat_init_cached(TEST_DAT, TEST_CACHE)) != NULL);
+   if (dat)
+      check_contents(dat);
+   logiqx_dat_free(dat);
+   CHECK(path_is_valid(TEST_CACHE));
+
+   CHECK((dat = logiqx_dat_init_cached(TEST_DAT, TEST_CACHE)) != NULL);
+   if (dat)
+      check_contents(dat);
+   logiqx_dat_free(dat);
+
+   /* A changed DAT invalidates the cache */
+   CHECK(write_text(TEST_DAT,
+         "<mame><machine name=\"new\"><description>New</description>"
+         "</machine></mame>"));
+   CHECK((dat = logiqx_dat_init_cached(TEST_DAT, TEST_CACHE)) != NULL);
+   if (dat)
+   {
+      CHECK(logiqx_dat_search(dat, "new", &info));
+      CHECK(!logiqx_dat_search(dat, "alpha", &info));
+   }
+   logiqx_dat_free(dat);
+
+   /* A corrupt cache is ignored */
+   CHECK(write_text(TEST_CACHE, "RLDX garbage"));
+   CHECK((dat = logiqx_dat_init_cached(TEST_DAT, TEST_CACHE)) != NULL);
+   if (dat)
+      CHECK(logiqx_dat_search(dat, "new", &info));
+   logiqx_dat_free(dat);
+
+   /* Invalid documents */
+   CHECK(write_text(TEST_DAT, "<notadat><game name=\"x\"/></notadat>"));
+   CHECK(!logiqx_dat_init(TEST_DAT));
+   CHECK(write_text(TEST_DAT, "<datafile></datafile>"));
+   CHECK(!logiqx_dat_init(TEST_DAT));
+   CHECK(write_text(TEST_DAT, "<datafile><game name=\"x\">"));
+   CHECK(!logiqx_dat_init(TEST_DAT));
+
+   filestream_delete(TEST_DAT);
+   filestream_delete(TEST_CACHE);
+
+   if (failures)
+   {
+      fprintf(stderr, "logiqx_dat: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("logiqx_dat: all tests passed\n");
+   return 0;
+}
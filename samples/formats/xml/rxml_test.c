@@ -21,7 +21,11 @@
  */
 
 #include <formats/rxml.h>
+#include <streams/file_stream.h>
+#include <streams/interface_stream.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void print_siblings(struct rxml_node *node, unsigned level)
 {
@@ -54,13 +58,266 @@ static void rxml_log_document(const char *path)
    rxml_free_document(doc);
 }
 
+static void rxml_log_stream(const char *path)
+{
+   enum rxml_reader_event ev;
+   rxml_reader_t *reader;
+   intfstream_t *stream = intfstream_open_file(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!stream || !(reader = rxml_reader_new(stream)))
+   {
+      fprintf(stderr, "rxml: Failed to open: %s\n", path);
+      if (stream)
+         intfstream_close(stream);
+      free(stream);
+      return;
+   }
+
+   while ((ev = rxml_reader_next(reader)) > RXML_READER_DONE)
+   {
+      unsigned level = rxml_reader_depth(reader) - 1;
+      if (ev == RXML_READER_START)
+      {
+         unsigned i;
+         fprintf(stderr, "\n%*sName: %s\n", level * 4, "",
+               rxml_reader_name(reader, NULL));
+         for (i = 0; i < rxml_reader_attrib_count(reader); i++)
+            fprintf(stderr, "%*s  Attrib: %s = %s\n", level * 4, "",
+                  rxml_reader_attrib_name(reader, i, NULL),
+                  rxml_reader_attrib_value(reader, i, NULL));
+      }
+      else if (ev == RXML_READER_TEXT)
+         fprintf(stderr, "%*sText: %s\n", (level + 1) * 4, "",
+               rxml_reader_text(reader, NULL));
+   }
+   if (ev == RXML_READER_ERROR)
+      fprintf(stderr, "rxml: Invalid document: %s\n", path);
+
+   rxml_reader_free(reader);
+   intfstream_close(stream);
+   free(stream);
+}
+
+/* Self test: the streaming reader has to see the same document as
+ * the tree builder.  Both are flattened into the same text form. */
+
+struct sig
+{
+   char *buf;
+   size_t len, cap;
+};
+
+static void sig_add(struct sig *sig, const char *str, size_t len)
+{
+   if (sig->len + len + 1 > sig->cap)
+   {
+      while (sig->len + len + 1 > sig->cap)
+         sig->cap = sig->cap ? sig->cap * 2 : 4096;
+      sig->buf = (char*)realloc(sig->buf, sig->cap);
+   }
+   memcpy(sig->buf + sig->len, str, len);
+   sig->len += len;
+   sig->buf[sig->len] = '\0';
+}
+
+#define SIG_ADD(sig, str) sig_add(sig, str, strlen(str))
+
+static void sig_node(struct sig *sig, struct rxml_node *node)
+{
+   for (; node; node = node->next)
+   {
+      const struct rxml_attrib_node *attrib;
+      SIG_ADD(sig, "<");
+      SIG_ADD(sig, node->name);
+      for (attrib = node->attrib; attrib; attrib = attrib->next)
+      {
+         SIG_ADD(sig, " ");
+         SIG_ADD(sig, attrib->attrib);
+         SIG_ADD(sig, "=");
+         if (attrib->value)
+            SIG_ADD(sig, attrib->value);
+      }
+      SIG_ADD(sig, ">");
+      if (node->data)
+         SIG_ADD(sig, node->data);
+      sig_node(sig, node->children);
+      SIG_ADD(sig, "</>");
+   }
+}
+
+static bool sig_stream(struct sig *sig, const char *doc, size_t len)
+{
+   enum rxml_reader_event ev;
+   struct sig text = { NULL, 0, 0 };
+   bool leaf = false;
+   intfstream_t *stream = intfstream_open_memory((void*)doc,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE, len);
+   rxml_reader_t *reader = rxml_reader_new(stream);
+
+   while ((ev = rxml_reader_next(reader)) > RXML_READER_DONE)
+   {
+      const char *str;
+      size_t slen;
+      unsigned i;
+      switch (ev)
+      {
+         case RXML_READER_START:
+            str = rxml_reader_name(reader, &slen);
+            if (strlen(str) != slen)
+               return false;
+            if (leaf)
+               SIG_ADD(sig, ">");
+            SIG_ADD(sig, "<");
+            SIG_ADD(sig, str);
+            for (i = 0; i < rxml_reader_attrib_count(reader); i++)
+            {
+               SIG_ADD(sig, " ");
+               SIG_ADD(sig, rxml_reader_attrib_name(reader, i, NULL));
+               SIG_ADD(sig, "=");
+               SIG_ADD(sig, rxml_reader_attrib_value(reader, i, NULL));
+            }
+            text.len = 0;
+            leaf     = true;
+            break;
+         case RXML_READER_TEXT:
+            str = rxml_reader_text(reader, &slen);
+            sig_add(&text, str, slen);
+            break;
+         default:
+            if (leaf)
+            {
+               SIG_ADD(sig, ">");
+               if (text.len)
+                  sig_add(sig, text.buf, text.len);
+            }
+            SIG_ADD(sig, "</>");
+            leaf = false;
+            break;
+      }
+   }
+
+   free(text.buf);
+   rxml_reader_free(reader);
+   intfstream_close(stream);
+   free(stream);
+   return ev == RXML_READER_DONE;
+}
+
+static int check_document(const char *name, const char *doc, bool valid)
+{
+   struct sig tree   = { NULL, 0, 0 };
+   struct sig stream = { NULL, 0, 0 };
+   rxml_document_t *dom = rxml_load_document_string(doc);
+   bool streamed = sig_stream(&stream, doc, strlen(doc));
+   int ret = 0;
+
+   if (valid)
+   {
+      if (dom)
+         sig_node(&tree, rxml_root_node(dom));
+      if (!dom || !streamed || tree.len != stream.len
+            || memcmp(tree.buf, stream.buf, tree.len))
+      {
+         fprintf(stderr, "[ERROR] %s: reader and tree differ\n", name);
+         ret = 1;
+      }
+   }
+   else if (streamed)
+   {
+      fprintf(stderr, "[ERROR] %s: reader accepted invalid document\n", name);
+      ret = 1;
+   }
+   if (!ret)
+      fprintf(stderr, "[SUCCESS] %s\n", name);
+
+   rxml_free_document(dom);
+   free(tree.buf);
+   free(stream.buf);
+   return ret;
+}
+
+static int rxml_self_test(void)
+{
+   static const char small[] =
+      "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\r\n"
+      "<!DOCTYPE datafile PUBLIC \"-//Logiqx//DTD ROM Management Datafile//EN\" "
+      "\"http://www.logiqx.com/Dats/datafile.dtd\" [ <!ENTITY x \"y\"> ]>\n"
+      "<!-- comment --><datafile>\n"
+      "\t<header><name>Test &amp; &#x263A; &#233;</name></header>\n"
+      "\t<game name=\"A &lt;1&gt;\" empty='' q='\"'>\r\n"
+      "\t\t<description>line1\r\nline2<!-- x -->tail<![CDATA[<raw>\r]]></description>\n"
+      "\t\t<rom name=\"a.bin\" size=\"16\" crc=\"deadbeef\"/>\n"
+      "\t</game >\n"
+      "</datafile>\n<?pi body?>\n";
+   static const char *invalid[] = {
+      "<a><b></a>",
+      "<a x=\"1\"y=\"2\"/>",
+      "<a>&bogus;</a>",
+      "<a>text",
+      "<a/>trailing",
+      ""
+   };
+   struct sig big = { NULL, 0, 0 };
+   char line[256];
+   int failures = 0;
+   unsigned i;
+
+   failures += check_document("small document", small, true);
+   for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+   {
+      snprintf(line, sizeof(line), "invalid document %u", i);
+      failures += check_document(line, invalid[i], false);
+   }
+
+   /* Large enough to cross many buffer refills at varying offsets,
+    * with one attribute longer than the initial read buffer. */
+   SIG_ADD(&big, "<?xml version=\"1.0\"?>\n<datafile>\n");
+   for (i = 0; i < 20000; i++)
+   {
+      snprintf(line, sizeof(line),
+            "\t<game name=\"Game %u &amp; co\" id=\"%u\">\n"
+            "\t\t<description>Description &#%u; %.*s</description>\n"
+            "\t\t<rom name=\"game%u.bin\" size=\"%u\" crc=\"%08x\"/>\n"
+            "\t</game>\n",
+            i, i, 0x41 + i % 26, (int)(i % 40),
+            "........................................",
+            i, i * 7, i * 2654435761u);
+      SIG_ADD(&big, line);
+      if (i == 12345)
+      {
+         unsigned j;
+         SIG_ADD(&big, "\t<huge value=\"");
+         for (j = 0; j < 20000; j++)
+            SIG_ADD(&big, "abc&quot;");
+         SIG_ADD(&big, "\"/>\n");
+      }
+   }
+   SIG_ADD(&big, "</datafile>\n");
+   failures += check_document("large document", big.buf, true);
+   free(big.buf);
+
+   return failures;
+}
+
 int main(int argc, char *argv[])
 {
+   if (argc == 1)
+      return rxml_self_test() ? 1 : 0;
+
+   if (argc == 3 && !strcmp(argv[1], "-s"))
+   {
+      rxml_log_stream(argv[2]);
+      return 0;
+   }
+
    if (argc != 2)
    {
-      fprintf(stderr, "Usage: %s <path>\n", argv[0]);
+      fprintf(stderr, "Usage: %s [[-s] <path>]\n", argv[0]);
+      fprintf(stderr, "   -s  use the streaming reader\n");
+      fprintf(stderr, "Without arguments a self test is run.\n");
       return 1;
    }
 
    rxml_log_document(argv[1]);
+   return 0;
 }
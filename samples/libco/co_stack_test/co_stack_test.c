@@ -0,0 +1,433 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (co_stack_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for libco's pooled, guard-paged stacks: stack reuse through
+ * the pool, co_stack_high_water() before and after reuse, that
+ * running off the bottom of a stack faults, and that threads creating
+ * and deleting cothreads at once never share a stack, nor leave pooled
+ * stacks behind when they exit.  The Makefile builds this
+ * file against the port libco.c picks for the host and against the
+ * ucontext and sjlj ports. */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <libco.h>
+
+#define STACK_SIZE (64 * 1024)
+#define LARGE_STACK_SIZE (1024 * 1024)
+#define GUARD_EXIT 42
+#define CHURN_THREADS 4
+#define CHURN_ROUNDS  2000
+#define CHURN_BATCH   4
+#define EXIT_THREADS  16
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+static cothread_t main_thread;
+static unsigned   use_bytes;
+static unsigned   entered;
+static uintptr_t  entry_frame;
+
+/* Dirties about `bytes` of stack below the caller */
+static unsigned dirty_stack(unsigned bytes)
+{
+   volatile unsigned char buf[1024];
+   unsigned i;
+   unsigned sum = 0;
+
+   for (i = 0; i < sizeof(buf); i++)
+      buf[i] = (unsigned char)(i | 1);
+   if (bytes > sizeof(buf))
+      sum = dirty_stack(bytes - (unsigned)sizeof(buf));
+   for (i = 0; i < sizeof(buf); i++)
+      sum += buf[i];
+   return sum;
+}
+
+static void use_stack_entry(void)
+{
+   volatile int frame = 0;
+
+   entry_frame = (uintptr_t)&frame;
+   for (;;)
+   {
+      entered++;
+      if (use_bytes)
+         dirty_stack(use_bytes);
+      co_switch(main_thread);
+   }
+}
+
+/* Far deeper than any stack here; volatile so the compiler can't
+ * tell that the recursion never ends */
+static volatile unsigned overflow_depth = 1u << 30;
+
+/* Overflows the stack: every level keeps 1 KiB live */
+static unsigned recurse(unsigned depth)
+{
+   volatile unsigned char buf[1024];
+   buf[0] = (unsigned char)depth;
+   if (depth >= overflow_depth)
+      return buf[0];
+   return recurse(depth + 1) + buf[0];
+}
+
+static void overflow_entry(void)
+{
+   recurse(0);
+   co_switch(main_thread);
+}
+
+static void on_guard_fault(int sig)
+{
+   (void)sig;
+   _exit(GUARD_EXIT);
+}
+
+/* Where the entry function of a new cothread of `size` puts its
+ * locals, which tells its stacks apart */
+static uintptr_t stack_of(cothread_t *co, unsigned size)
+{
+   entry_frame = 0;
+   use_bytes   = 0;
+   if ((*co = co_create(size, use_stack_entry)))
+      co_switch(*co);
+   return entry_frame;
+}
+
+static void test_reuse(void)
+{
+   cothread_t a, b, c;
+   uintptr_t  frame_a, frame_b, frame_c;
+
+   CHECK((frame_a = stack_of(&a, STACK_SIZE)) != 0);
+   co_delete(a);
+   /* Same size class comes back from the pool */
+   CHECK((frame_b = stack_of(&b, STACK_SIZE)) == frame_a);
+   /* A different class does not, nor does a stack in use */
+   CHECK((frame_c = stack_of(&c, STACK_SIZE * 4)) != 0);
+   CHECK(frame_c != frame_b);
+   co_delete(c);
+   CHECK((frame_a = stack_of(&a, STACK_SIZE)) != 0);
+   CHECK(frame_a != frame_b);
+   co_delete(a);
+   co_delete(b);
+
+   co_stack_pool_trim();
+   CHECK(stack_of(&a, STACK_SIZE) != 0);
+   co_delete(a);
+   co_stack_pool_trim();
+}
+
+static void test_high_water(void)
+{
+   cothread_t   co;
+   unsigned int shallow, deep, reused;
+
+   CHECK(co_stack_high_water(co_active()) == 0);
+
+   CHECK((co = co_create(STACK_SIZE, use_stack_entry)) != NULL);
+   if (!co)
+      return;
+   CHECK(co_stack_high_water(co) < 4096);
+
+   entered   = 0;
+   use_bytes = 0;
+   co_switch(co);
+   CHECK(entered == 1);
+   shallow   = co_stack_high_water(co);
+   CHECK(shallow > 0 && shallow < 8192);
+
+   use_bytes = 32 * 1024;
+   co_switch(co);
+   deep      = co_stack_high_water(co);
+   CHECK(deep >= 32 * 1024 && deep < STACK_SIZE);
+
+   /* A shallower pass does not lower the mark */
+   use_bytes = 0;
+   co_switch(co);
+   CHECK(co_stack_high_water(co) == deep);
+   co_delete(co);
+
+   /* The pooled stack comes back clean */
+   CHECK((co = co_create(STACK_SIZE, use_stack_entry)) != NULL);
+   if (!co)
+      return;
+   CHECK(co_stack_high_water(co) < 4096);
+   co_switch(co);
+   reused    = co_stack_high_water(co);
+   CHECK(reused < 8192);
+   co_delete(co);
+
+   printf("co_stack: high water shallow %u, deep %u, reused %u bytes\n",
+         shallow, deep, reused);
+}
+
+/* Big stacks are cleared differently when they go back to the pool */
+static void test_large_stack(void)
+{
+   cothread_t   co;
+   unsigned int deep;
+
+   CHECK((co = co_create(LARGE_STACK_SIZE, use_stack_entry)) != NULL);
+   if (!co)
+      return;
+   use_bytes = LARGE_STACK_SIZE / 2;
+   co_switch(co);
+   deep      = co_stack_high_water(co);
+   CHECK(deep >= LARGE_STACK_SIZE / 2 && deep < LARGE_STACK_SIZE);
+   co_delete(co);
+
+   CHECK((co = co_create(LARGE_STACK_SIZE, use_stack_entry)) != NULL);
+   if (!co)
+      return;
+   CHECK(co_stack_high_water(co) < 4096);
+   use_bytes = 0;
+   co_switch(co);
+   CHECK(co_stack_high_water(co) < 8192);
+   co_delete(co);
+}
+
+/* Cothreads alive on any of the churn threads */
+static pthread_mutex_t live_lock   = PTHREAD_MUTEX_INITIALIZER;
+/* Without LIBCO_MP the ports keep their own creation state (sjlj's
+ * signal-stack trick, amd64's active handle) in globals, so co_create
+ * itself is serialized.  The stack pool is not covered by this lock:
+ * pops race with the other threads' deletes. */
+static pthread_mutex_t create_lock = PTHREAD_MUTEX_INITIALIZER;
+static cothread_t      live[CHURN_THREADS * CHURN_BATCH];
+static unsigned        live_clashes;
+
+static void live_add(cothread_t co)
+{
+   unsigned i;
+   unsigned slot = sizeof(live) / sizeof(live[0]);
+
+   pthread_mutex_lock(&live_lock);
+   for (i = 0; i < sizeof(live) / sizeof(live[0]); i++)
+   {
+      if (live[i] == co)
+         live_clashes++;
+      else if (!live[i] && slot == sizeof(live) / sizeof(live[0]))
+         slot = i;
+   }
+   if (slot < sizeof(live) / sizeof(live[0]))
+      live[slot] = co;
+   pthread_mutex_unlock(&live_lock);
+}
+
+static void live_remove(cothread_t co)
+{
+   unsigned i;
+
+   pthread_mutex_lock(&live_lock);
+   for (i = 0; i < sizeof(live) / sizeof(live[0]); i++)
+      if (live[i] == co)
+      {
+         live[i] = NULL;
+         break;
+      }
+   pthread_mutex_unlock(&live_lock);
+}
+
+/* Creates and deletes cothreads without ever switching to them:
+ * switching across threads needs LIBCO_MP, the pool must not */
+static void *churn_thread(void *data)
+{
+   unsigned round, i;
+   unsigned failed = 0;
+
+   (void)data;
+   for (round = 0; round < CHURN_ROUNDS; round++)
+   {
+      cothread_t batch[CHURN_BATCH];
+      for (i = 0; i < CHURN_BATCH; i++)
+      {
+         pthread_mutex_lock(&create_lock);
+         batch[i] = co_create(STACK_SIZE, use_stack_entry);
+         pthread_mutex_unlock(&create_lock);
+         if (!batch[i])
+            failed++;
+         else
+            live_add(batch[i]);
+      }
+      for (i = 0; i < CHURN_BATCH; i++)
+      {
+         if (!batch[i])
+            continue;
+         live_remove(batch[i]);
+         co_delete(batch[i]);
+      }
+   }
+   co_stack_pool_trim();
+   return (void*)(uintptr_t)failed;
+}
+
+static void test_threads(void)
+{
+   pthread_t threads[CHURN_THREADS];
+   unsigned  i;
+
+   for (i = 0; i < CHURN_THREADS; i++)
+      CHECK(pthread_create(&threads[i], NULL, churn_thread, NULL) == 0);
+   for (i = 0; i < CHURN_THREADS; i++)
+   {
+      void *failed = NULL;
+      CHECK(pthread_join(threads[i], &failed) == 0);
+      CHECK(failed == NULL);
+   }
+   CHECK(live_clashes == 0);
+}
+
+#ifdef __linux__
+/* Pages of address space mapped by the process */
+static long mapped_pages(void)
+{
+   long  pages = -1;
+   FILE *fp    = fopen("/proc/self/statm", "r");
+   if (fp)
+   {
+      if (fscanf(fp, "%ld", &pages) != 1)
+         pages = -1;
+      fclose(fp);
+   }
+   return pages;
+}
+
+/* Pools a stack and exits without co_stack_pool_trim() */
+static void *exit_thread(void *data)
+{
+   cothread_t co;
+
+   pthread_mutex_lock(&create_lock);
+   co = co_create((unsigned)(uintptr_t)data, use_stack_entry);
+   pthread_mutex_unlock(&create_lock);
+   if (!co)
+      return (void*)1;
+   co_delete(co);
+   return NULL;
+}
+
+static void run_exit_thread(unsigned size)
+{
+   pthread_t thread;
+   void     *failed = NULL;
+
+   CHECK(pthread_create(&thread, NULL, exit_thread,
+            (void*)(uintptr_t)size) == 0);
+   CHECK(pthread_join(thread, &failed) == 0);
+   CHECK(failed == NULL);
+}
+
+/* A thread's pool is emptied when it exits, so threads that come
+ * and go do not pile up stacks */
+static void test_thread_exit(void)
+{
+   unsigned i;
+   long     before;
+
+   /* Lets libc cache a thread stack and arena first */
+   run_exit_thread(STACK_SIZE);
+   before = mapped_pages();
+   for (i = 0; i < EXIT_THREADS; i++)
+      run_exit_thread(STACK_SIZE);
+   CHECK(before > 0 && mapped_pages() <= before);
+}
+#endif
+
+static void test_guard_page(void)
+{
+   int   status = 0;
+   pid_t pid    = fork();
+
+   if (pid == 0)
+   {
+      /* The overflowing stack can't run the handler, so give it one */
+      static char      alt[64 * 1024];
+      stack_t          ss;
+      struct sigaction sa;
+      cothread_t       co;
+
+      ss.ss_sp    = alt;
+      ss.ss_size  = sizeof(alt);
+      ss.ss_flags = 0;
+      sigaltstack(&ss, NULL);
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = on_guard_fault;
+      sa.sa_flags   = SA_ONSTACK;
+      sigemptyset(&sa.sa_mask);
+      sigaction(SIGSEGV, &sa, NULL);
+      sigaction(SIGBUS, &sa, NULL);
+
+      main_thread = co_active();
+      if (!(co = co_create(STACK_SIZE, overflow_entry)))
+         _exit(1);
+      co_switch(co);
+      _exit(0);
+   }
+
+   CHECK(pid > 0);
+   if (pid <= 0)
+      return;
+   CHECK(waitpid(pid, &status, 0) == pid);
+   CHECK(WIFEXITED(status) && WEXITSTATUS(status) == GUARD_EXIT);
+}
+
+int main(void)
+{
+   main_thread = co_active();
+
+   test_reuse();
+   test_high_water();
+   test_large_stack();
+   test_threads();
+#ifdef __linux__
+   test_thread_exit();
+#endif
+   test_guard_page();
+   co_stack_pool_trim();
+
+   if (failures)
+   {
+      fprintf(stderr, "co_stack: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("co_stack: all tests passed\n");
+   return 0;
+}
@@ -0,0 +1,199 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (co_switch_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Latency benchmark for libco.
+ *
+ * Three things are timed:
+ *   - switch: the main thread and one cothread hand control back and
+ *             forth; the figure is the cost of one co_switch,
+ *   - churn:  a cothread is created, entered once and deleted, the
+ *             pattern of short-lived coroutine tasks, for a few stack
+ *             sizes,
+ *   - spread: many cothreads are alive at once and are switched to in
+ *             turn, so every switch lands on a stack that is cold in
+ *             the cache.
+ * After the run, the stack high-water mark of the ping-pong cothread
+ * is printed as a sanity check of co_stack_high_water().
+ *
+ * The Makefile builds this file twice, with the stack pool and with
+ * LIBCO_STACK_POOL_DEPTH=0 (co_switch_bench_nopool), which maps and
+ * unmaps a stack on every create and delete, so the churn figures can
+ * be compared side by side.
+ *
+ * Usage: co_switch_bench [switches]
+ *
+ * Numbers are only meaningful for an -O2 build without a sanitizer. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libco.h>
+
+#define DEFAULT_SWITCHES 10000000
+#define SPREAD_THREADS   256
+#define SPREAD_STACK     (64 * 1024)
+
+static cothread_t main_thread;
+static cothread_t spread[SPREAD_THREADS];
+static volatile unsigned long entries;
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void pingpong_entry(void)
+{
+   for (;;)
+   {
+      entries++;
+      co_switch(main_thread);
+   }
+}
+
+static void bench_switch(unsigned long switches)
+{
+   unsigned long i;
+   uint64_t      t0, t1;
+   cothread_t    co = co_create(SPREAD_STACK, pingpong_entry);
+
+   if (!co)
+   {
+      fprintf(stderr, "co_create failed\n");
+      exit(1);
+   }
+
+   /* Warm up: the first entry faults in the stack */
+   co_switch(co);
+
+   entries = 0;
+   t0      = now_ns();
+   for (i = 0; i < switches / 2; i++)
+      co_switch(co);
+   t1      = now_ns();
+
+   if (entries != switches / 2)
+   {
+      fprintf(stderr, "switch: lost %lu entries\n",
+            switches / 2 - entries);
+      exit(1);
+   }
+   printf("switch          %8.2f ns/co_switch\n",
+         (double)(t1 - t0) / (double)((switches / 2) * 2));
+   printf("high water      %8u bytes of %u\n",
+         co_stack_high_water(co), SPREAD_STACK);
+   co_delete(co);
+}
+
+static void bench_churn(unsigned long rounds, unsigned stack_size)
+{
+   unsigned long i;
+   uint64_t      t0, t1;
+
+   entries = 0;
+   t0      = now_ns();
+   for (i = 0; i < rounds; i++)
+   {
+      cothread_t co = co_create(stack_size, pingpong_entry);
+      if (!co)
+      {
+         fprintf(stderr, "co_create failed\n");
+         exit(1);
+      }
+      co_switch(co);
+      co_delete(co);
+   }
+   t1      = now_ns();
+
+   if (entries != rounds)
+   {
+      fprintf(stderr, "churn: lost %lu entries\n", rounds - entries);
+      exit(1);
+   }
+   printf("churn %5u KiB %8.2f ns/create+switch+delete\n",
+         stack_size / 1024, (double)(t1 - t0) / (double)rounds);
+}
+
+static void bench_spread(unsigned long switches)
+{
+   unsigned      i;
+   unsigned long n;
+   unsigned long laps = switches / (2 * SPREAD_THREADS);
+   uint64_t      t0, t1;
+
+   if (!laps)
+      laps = 1;
+
+   for (i = 0; i < SPREAD_THREADS; i++)
+   {
+      if (!(spread[i] = co_create(SPREAD_STACK, pingpong_entry)))
+      {
+         fprintf(stderr, "co_create failed\n");
+         exit(1);
+      }
+      co_switch(spread[i]);
+   }
+
+   entries = 0;
+   t0      = now_ns();
+   for (n = 0; n < laps; n++)
+      for (i = 0; i < SPREAD_THREADS; i++)
+         co_switch(spread[i]);
+   t1      = now_ns();
+
+   if (entries != laps * SPREAD_THREADS)
+   {
+      fprintf(stderr, "spread: lost %lu entries\n",
+            laps * SPREAD_THREADS - entries);
+      exit(1);
+   }
+   printf("spread %4u     %8.2f ns/co_switch\n", SPREAD_THREADS,
+         (double)(t1 - t0) / (double)(laps * SPREAD_THREADS * 2));
+
+   for (i = 0; i < SPREAD_THREADS; i++)
+      co_delete(spread[i]);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned long switches = DEFAULT_SWITCHES;
+
+   if (argc > 1)
+      switches = strtoul(argv[1], NULL, 0);
+   if (switches < 2)
+      switches = 2;
+
+   main_thread = co_active();
+
+   bench_switch(switches);
+   bench_churn(switches / 100 + 1, 16 * 1024);
+   bench_churn(switches / 100 + 1, 64 * 1024);
+   bench_churn(switches / 100 + 1, 1024 * 1024);
+   bench_spread(switches);
+
+   co_stack_pool_trim();
+   return 0;
+}
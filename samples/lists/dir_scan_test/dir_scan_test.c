@@ -0,0 +1,221 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dir_scan_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for the streaming directory scanner in
+ * libretro-common/lists/dir_scan.c.
+ *
+ * Builds a small tree under /tmp and checks that the serial
+ * and threaded scans report exactly the entries dir_list_new
+ * would, and that a callback returning false stops the scan.
+ * Run with SANITIZER=thread to check the worker fan-out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <lists/dir_scan.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+#include <file/file_path.h>
+
+static int failures = 0;
+
+#define EXPECT_TRUE(cond, msg) do { \
+   if (!(cond)) { \
+      printf("[ERROR] %s:%d  %s\n", __func__, __LINE__, (msg)); \
+      failures++; \
+   } \
+} while (0)
+
+static char root[64];
+
+static void touch(const char *rel)
+{
+   char path[256];
+   FILE *fp;
+   snprintf(path, sizeof(path), "%s/%s", root, rel);
+   if (!(fp = fopen(path, "wb")))
+      abort();
+   fclose(fp);
+}
+
+static void make_dir(const char *rel)
+{
+   char path[256];
+   snprintf(path, sizeof(path), "%s/%s", root, rel);
+   if (mkdir(path, 0755) != 0)
+      abort();
+}
+
+static void build_tree(void)
+{
+   unsigned i, j;
+   char rel[64];
+
+   snprintf(root, sizeof(root), "/tmp/dir_scan_test_%d", (int)getpid());
+   if (mkdir(root, 0755) != 0)
+      abort();
+
+   touch("top.sfc");
+   touch("top.txt");
+   touch("top.zip");
+   touch(".hidden.sfc");
+   for (i = 0; i < 8; i++)
+   {
+      snprintf(rel, sizeof(rel), "d%u", i);
+      make_dir(rel);
+      for (j = 0; j < 16; j++)
+      {
+         snprintf(rel, sizeof(rel), "d%u/rom%u.%s", i, j,
+               (j & 1) ? "SFC" : "nes");
+         touch(rel);
+      }
+      snprintf(rel, sizeof(rel), "d%u/sub", i);
+      make_dir(rel);
+      snprintf(rel, sizeof(rel), "d%u/sub/deep.sfc", i);
+      touch(rel);
+      snprintf(rel, sizeof(rel), "d%u/sub/readme.md", i);
+      touch(rel);
+   }
+}
+
+static void remove_tree(void)
+{
+   char cmd[128];
+   snprintf(cmd, sizeof(cmd), "rm -rf %s", root);
+   if (system(cmd) != 0)
+      printf("[WARN] could not remove %s\n", root);
+}
+
+static bool collect_cb(const char *path, unsigned type, void *userdata)
+{
+   union string_list_elem_attr attr;
+   attr.i = (int)type;
+   return string_list_append((struct string_list*)userdata, path, attr);
+}
+
+static bool stop_cb(const char *path, unsigned type, void *userdata)
+{
+   unsigned *count = (unsigned*)userdata;
+   return ++(*count) < 5;
+}
+
+static int cmp_elem(const void *a_, const void *b_)
+{
+   const struct string_list_elem *a = (const struct string_list_elem*)a_;
+   const struct string_list_elem *b = (const struct string_list_elem*)b_;
+   return strcmp(a->data, b->data);
+}
+
+static bool same_entries(struct string_list *a, struct string_list *b)
+{
+   size_t i;
+   if (a->size != b->size)
+      return false;
+   qsort(a->elems, a->size, sizeof(*a->elems), cmp_elem);
+   qsort(b->elems, b->size, sizeof(*b->elems), cmp_elem);
+   for (i = 0; i < a->size; i++)
+      if (     strcmp(a->elems[i].data, b->elems[i].data)
+            || a->elems[i].attr.i != b->elems[i].attr.i)
+         return false;
+   return true;
+}
+
+static void check_against_dir_list(const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed, unsigned num_threads)
+{
+   struct string_list *want = dir_list_new(root, ext, include_dirs,
+         include_hidden, include_compressed, true);
+   struct string_list *got  = string_list_new();
+   unsigned flags           = DIR_SCAN_FLAG_RECURSIVE;
+
+   if (include_dirs)
+      flags |= DIR_SCAN_FLAG_INCLUDE_DIRS;
+   if (include_hidden)
+      flags |= DIR_SCAN_FLAG_INCLUDE_HIDDEN;
+   if (include_compressed)
+      flags |= DIR_SCAN_FLAG_INCLUDE_COMPRESSED;
+
+   if (!want || !got)
+      abort();
+
+   EXPECT_TRUE(dir_scan(root, ext, flags, num_threads, collect_cb, got),
+         "dir_scan");
+   EXPECT_TRUE(want->size > 0, "dir_list_new found nothing");
+   EXPECT_TRUE(same_entries(want, got), "dir_scan differs from dir_list_new");
+
+   string_list_free(want);
+   string_list_free(got);
+}
+
+static void test_matches_dir_list(void)
+{
+   unsigned threads[3] = { 0, 2, 8 };
+   unsigned i;
+
+   for (i = 0; i < 3; i++)
+   {
+      check_against_dir_list("sfc", false, false, false, threads[i]);
+      check_against_dir_list(".sfc|nes", true, false, true, threads[i]);
+      check_against_dir_list(NULL, true, true, false, threads[i]);
+   }
+}
+
+static void test_stop(void)
+{
+   unsigned count = 0;
+   EXPECT_TRUE(!dir_scan(root, NULL, DIR_SCAN_FLAG_RECURSIVE, 4,
+            stop_cb, &count), "stopped scan reports false");
+   EXPECT_TRUE(count == 5, "callback not invoked after returning false");
+}
+
+static void test_missing_dir(void)
+{
+   struct string_list *got = string_list_new();
+   EXPECT_TRUE(!dir_scan("/nonexistent/dir_scan_test", NULL,
+            DIR_SCAN_FLAG_RECURSIVE, 4, collect_cb, got),
+         "missing directory reports false");
+   EXPECT_TRUE(got->size == 0, "missing directory emits nothing");
+   string_list_free(got);
+}
+
+int main(void)
+{
+   build_tree();
+
+   test_matches_dir_list();
+   test_stop();
+   test_missing_dir();
+
+   remove_tree();
+
+   if (failures)
+   {
+      printf("\n%d dir_scan test(s) failed\n", failures);
+      return 1;
+   }
+   printf("All dir_scan tests passed.\n");
+   return 0;
+}
@@ -0,0 +1,182 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (file_list_sort_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for the keyed sorts and the search index in
+ * libretro-common/lists/file_list.c.
+ *
+ * file_list_sort_on_alt compares precomputed 8-byte case-folded
+ * prefixes and only falls back to strcasecmp on ties; the test
+ * feeds it names that share long prefixes, differ only in case,
+ * or end inside the prefix, and checks the result against plain
+ * strcasecmp ordering plus stability.  file_list_index_search
+ * must agree with file_list_search for every needle.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <lists/file_list.h>
+
+static int failures = 0;
+
+#define EXPECT_TRUE(cond, msg) do { \
+   if (!(cond)) { \
+      printf("[ERROR] %s:%d  %s\n", __func__, __LINE__, (msg)); \
+      failures++; \
+   } \
+} while (0)
+
+static const char *sort_str(const struct item_file *item)
+{
+   return item->alt ? item->alt : (item->path ? item->path : "");
+}
+
+static void fill_list(file_list_t *list, unsigned n)
+{
+   static const char *stems[] = {
+      "Super Mario", "super mario", "Super Mario World",
+      "Super Mario World 2", "Zelda", "zelda", "A", "a", "",
+      "Metroid Prime Trilogy", "Metroid Prime", "METROID PRIME",
+      "Sonic", "Sonic the Hedgehog"
+   };
+   unsigned i;
+   srand(1234);
+   for (i = 0; i < n; i++)
+   {
+      char name[64];
+      const char *stem = stems[rand() % (sizeof(stems) / sizeof(stems[0]))];
+      if (rand() % 3)
+         snprintf(name, sizeof(name), "%s (%u)", stem, (unsigned)(rand() % 50));
+      else
+         snprintf(name, sizeof(name), "%s", stem);
+      /* entry_idx remembers insertion order for the stability check */
+      file_list_append(list, name, NULL, (unsigned)(rand() % 4) << 9, 0, i);
+      if (rand() % 4 == 0)
+         file_list_set_alt_at_offset(list, i, stem);
+   }
+}
+
+static void test_sort_on_alt(void)
+{
+   size_t i;
+   file_list_t list = {0};
+
+   fill_list(&list, 5000);
+   file_list_sort_on_alt(&list);
+
+   EXPECT_TRUE(list.size == 5000, "size kept");
+   for (i = 1; i < list.size; i++)
+   {
+      int cmp = strcasecmp(sort_str(&list.list[i - 1]),
+            sort_str(&list.list[i]));
+      if (cmp > 0)
+      {
+         printf("[ERROR] order: \"%s\" before \"%s\"\n",
+               sort_str(&list.list[i - 1]), sort_str(&list.list[i]));
+         failures++;
+         break;
+      }
+      if (cmp == 0 && list.list[i - 1].entry_idx > list.list[i].entry_idx)
+      {
+         printf("[ERROR] unstable at %u\n", (unsigned)i);
+         failures++;
+         break;
+      }
+   }
+
+   file_list_deinitialize(&list);
+}
+
+static void test_sort_on_type(void)
+{
+   size_t i;
+   file_list_t list = {0};
+
+   fill_list(&list, 5000);
+   file_list_sort_on_type(&list);
+
+   for (i = 1; i < list.size; i++)
+   {
+      if (     list.list[i - 1].type >  list.list[i].type
+            || (list.list[i - 1].type == list.list[i].type
+               && list.list[i - 1].entry_idx > list.list[i].entry_idx))
+      {
+         printf("[ERROR] type order broken at %u\n", (unsigned)i);
+         failures++;
+         break;
+      }
+   }
+
+   file_list_deinitialize(&list);
+}
+
+static void test_index_search(void)
+{
+   static const char *needles[] = {
+      "super", "MARIO WORLD", "(4", "trilogy", "zel", "nothing here", "",
+      "a (1"
+   };
+   size_t i;
+   file_list_t list        = {0};
+   file_list_index_t index = {0};
+
+   fill_list(&list, 2000);
+   /* An entry with nothing to search must be skipped by both */
+   file_list_append(&list, NULL, NULL, 0, 0, 0);
+   EXPECT_TRUE(file_list_index_build(&index, &list), "index build");
+
+   for (i = 0; i < sizeof(needles) / sizeof(needles[0]); i++)
+   {
+      size_t idx_list  = (size_t)-1;
+      size_t idx_index = (size_t)-1;
+      bool found_list  = file_list_search(&list, needles[i], &idx_list);
+      bool found_index = file_list_index_search(&index, needles[i],
+            &idx_index);
+      if (found_list != found_index || idx_list != idx_index)
+      {
+         printf("[ERROR] search \"%s\": list %d/%u index %d/%u\n",
+               needles[i], found_list, (unsigned)idx_list,
+               found_index, (unsigned)idx_index);
+         failures++;
+      }
+   }
+
+   file_list_index_free(&index);
+   file_list_deinitialize(&list);
+}
+
+int main(void)
+{
+   test_sort_on_alt();
+   test_sort_on_type();
+   test_index_search();
+
+   if (failures)
+   {
+      printf("\n%d file_list sort test(s) failed\n", failures);
+      return 1;
+   }
+   printf("\nAll file_list sort tests passed.\n");
+   return 0;
+}
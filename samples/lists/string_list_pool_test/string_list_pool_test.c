@@ -0,0 +1,183 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (string_list_pool_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for pooled string lists in
+ * libretro-common/lists/string_list.c.
+ *
+ * Pooled lists store element strings in blocks owned by the
+ * list; string_list_free must release the blocks and never
+ * free() an element on its own.  Run under SANITIZER=address
+ * to catch any stray per-element free or overrun of a block
+ * boundary (the oversized-element case below straddles one).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lists/string_list.h>
+
+static int failures = 0;
+
+#define EXPECT_TRUE(cond, msg) do { \
+   if (!(cond)) { \
+      printf("[ERROR] %s:%d  %s\n", __func__, __LINE__, (msg)); \
+      failures++; \
+   } \
+} while (0)
+
+#define EXPECT_EQ_STR(got, want, msg) do { \
+   if (strcmp((got), (want)) != 0) { \
+      printf("[ERROR] %s:%d  %s  got=\"%s\" want=\"%s\"\n", \
+            __func__, __LINE__, (msg), (got), (want)); \
+      failures++; \
+   } \
+} while (0)
+
+static void test_pooled_append(void)
+{
+   char name[32];
+   char *big = (char*)malloc(20000);
+   union string_list_elem_attr attr;
+   struct string_list *list = string_list_new_pooled(false);
+   unsigned i;
+
+   attr.i = 0;
+   EXPECT_TRUE(list != NULL, "string_list_new_pooled");
+   if (!list || !big)
+      abort();
+
+   for (i = 0; i < 10000; i++)
+   {
+      snprintf(name, sizeof(name), "file_%05u.bin", i);
+      if (!string_list_append(list, name, attr))
+         abort();
+   }
+
+   /* Larger than any block - must get its own */
+   memset(big, 'x', 19999);
+   big[19999] = '\0';
+   EXPECT_TRUE(string_list_append(list, big, attr), "oversized append");
+   EXPECT_TRUE(string_list_append_n(list, "tail_and_more", 4, attr),
+         "append_n");
+
+   EXPECT_TRUE(list->size == 10002, "size");
+   EXPECT_EQ_STR(list->elems[0].data,    "file_00000.bin", "first");
+   EXPECT_EQ_STR(list->elems[9999].data, "file_09999.bin", "last");
+   EXPECT_TRUE(strlen(list->elems[10000].data) == 19999, "oversized");
+   EXPECT_EQ_STR(list->elems[10001].data, "tail", "append_n");
+   EXPECT_TRUE(string_list_find_elem(list, "FILE_01234.BIN") == 1235,
+         "find_elem");
+
+   free(big);
+   string_list_free(list);
+}
+
+static void test_interned(void)
+{
+   struct string_list list = {0};
+   unsigned i;
+
+   EXPECT_TRUE(string_list_initialize_pooled(&list, true),
+         "string_list_initialize_pooled");
+   EXPECT_TRUE(string_split_noalloc(&list,
+            "zip|7z|cue|zip|bin|cue|zip", "|"), "split");
+   EXPECT_TRUE(list.size == 7, "split size");
+
+   /* Equal elements share storage */
+   EXPECT_TRUE(list.elems[0].data == list.elems[3].data, "zip interned");
+   EXPECT_TRUE(list.elems[0].data == list.elems[6].data, "zip interned");
+   EXPECT_TRUE(list.elems[2].data == list.elems[5].data, "cue interned");
+   EXPECT_TRUE(list.elems[1].data != list.elems[4].data, "distinct");
+   EXPECT_EQ_STR(list.elems[1].data, "7z",  "7z");
+   EXPECT_EQ_STR(list.elems[4].data, "bin", "bin");
+
+   /* Force the intern table to grow a few times */
+   for (i = 0; i < 1000; i++)
+   {
+      char name[16];
+      union string_list_elem_attr attr;
+      attr.i = 0;
+      snprintf(name, sizeof(name), "ext%u", i % 300);
+      if (!string_list_append(&list, name, attr))
+         abort();
+   }
+   EXPECT_TRUE(list.elems[7].data == list.elems[307].data,
+         "interned across table growth");
+   EXPECT_TRUE(list.elems[7].data != list.elems[8].data, "distinct");
+
+   string_list_deinitialize(&list);
+   EXPECT_TRUE(!list.pool && !list.elems && !list.size,
+         "deinitialize clears list");
+
+   /* Prefixes of an interned string stay distinct */
+   EXPECT_TRUE(string_list_initialize_pooled(&list, true),
+         "string_list_initialize_pooled");
+   EXPECT_TRUE(string_split_noalloc(&list, "binary|bi|binary|b", "|"),
+         "split prefixes");
+   EXPECT_TRUE(list.size == 4, "split prefixes size");
+   EXPECT_EQ_STR(list.elems[0].data, "binary", "binary");
+   EXPECT_EQ_STR(list.elems[1].data, "bi",     "bi");
+   EXPECT_EQ_STR(list.elems[3].data, "b",      "b");
+   EXPECT_TRUE(list.elems[0].data == list.elems[2].data, "binary interned");
+   string_list_deinitialize(&list);
+}
+
+static void test_clone_is_unpooled(void)
+{
+   struct string_list *list  = string_list_new_pooled(true);
+   struct string_list *clone = NULL;
+   union string_list_elem_attr attr;
+
+   attr.i = 7;
+   if (!list)
+      abort();
+   string_list_append(list, "a", attr);
+   string_list_append(list, "a", attr);
+
+   /* The clone owns its strings individually */
+   clone = string_list_clone(list);
+   string_list_free(list);
+   EXPECT_TRUE(clone && clone->size == 2 && !clone->pool, "clone");
+   if (clone)
+   {
+      EXPECT_EQ_STR(clone->elems[1].data, "a", "clone data");
+      EXPECT_TRUE(clone->elems[0].data != clone->elems[1].data,
+            "clone does not share storage");
+      string_list_free(clone);
+   }
+}
+
+int main(void)
+{
+   test_pooled_append();
+   test_interned();
+   test_clone_is_unpooled();
+
+   if (failures)
+   {
+      printf("\n%d string_list pool test(s) failed\n", failures);
+      return 1;
+   }
+   printf("\nAll string_list pool tests passed.\n");
+   return 0;
+}
@@ -0,0 +1,300 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (fifo_queue_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for queues/fifo_queue.c in both modes: the locked ring the
+ * audio drivers have always used, and the lock-free single-producer,
+ * single-consumer mode (FIFO_FLAG_SPSC).
+ *
+ * The single-threaded checks cover sizes, wrap-around, the avail
+ * functions and the zero-copy span accessors.  The stress test runs
+ * one producer and one consumer thread through a small SPSC queue
+ * with no lock, the way an audio driver and its callback would; build
+ * with SANITIZER=thread to check the cursor protocol. */
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/fifo_queue.h>
+#include <rthreads/rthreads.h>
+
+#define STRESS_BYTES  (1024 * 1024)
+#define STRESS_BUFFER 256
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+static uint8_t pattern(size_t i)
+{
+   return (uint8_t)((i * 7u) ^ (i >> 8));
+}
+
+/* Pushes a few laps of a known byte sequence through @fifo in
+ * uneven chunks, half with fifo_write/fifo_read and half through
+ * the span accessors. */
+static void check_round_trip(fifo_buffer_t *fifo, size_t capacity)
+{
+   uint8_t chunk[64];
+   size_t  written = 0;
+   size_t  read    = 0;
+   size_t  total   = capacity * 5 + 3;
+   size_t  step    = 0;
+
+   while (read < total)
+   {
+      size_t want = 1 + (step * 13) % sizeof(chunk);
+      size_t i, n;
+
+      if (want > total - written)
+         want = total - written;
+
+      if (step & 1)
+      {
+         fifo_spans_t spans;
+         n = fifo_write_reserve(fifo, want, &spans);
+         CHECK(spans.len[0] + spans.len[1] == n);
+         for (i = 0; i < spans.len[0]; i++)
+            spans.ptr[0][i] = pattern(written + i);
+         for (i = 0; i < spans.len[1]; i++)
+            spans.ptr[1][i] = pattern(written + spans.len[0] + i);
+         fifo_write_commit(fifo, n);
+      }
+      else
+      {
+         n = fifo_write_avail(fifo);
+         if (n > want)
+            n = want;
+         for (i = 0; i < n; i++)
+            chunk[i] = pattern(written + i);
+         fifo_write(fifo, chunk, n);
+      }
+      written += n;
+      CHECK(fifo_read_avail(fifo) == written - read);
+      CHECK(fifo_write_avail(fifo) == capacity - (written - read));
+
+      want = 1 + (step * 29) % sizeof(chunk);
+      if (step & 2)
+      {
+         fifo_spans_t spans;
+         n = fifo_read_peek(fifo, want, &spans);
+         CHECK(spans.len[0] + spans.len[1] == n);
+         CHECK(spans.len[1] == 0 || spans.ptr[1] == fifo->buffer);
+         for (i = 0; i < spans.len[0]; i++)
+            CHECK(spans.ptr[0][i] == pattern(read + i));
+         for (i = 0; i < spans.len[1]; i++)
+            CHECK(spans.ptr[1][i] == pattern(read + spans.len[0] + i));
+         fifo_read_release(fifo, n);
+      }
+      else
+      {
+         n = fifo_read_avail(fifo);
+         if (n > want)
+            n = want;
+         fifo_read(fifo, chunk, n);
+         for (i = 0; i < n; i++)
+            CHECK(chunk[i] == pattern(read + i));
+      }
+      read += n;
+      step++;
+   }
+   CHECK(fifo_read_avail(fifo) == 0);
+}
+
+static void test_locked(void)
+{
+   fifo_buffer_t  fifo;
+   fifo_buffer_t *heap;
+   fifo_spans_t   spans;
+   uint8_t        buf[100];
+
+   CHECK(fifo_initialize(&fifo, 100));
+   CHECK(!(fifo.flags & FIFO_FLAG_SPSC));
+   CHECK(fifo_write_avail(&fifo) == 100);
+   CHECK(FIFO_WRITE_AVAIL(&fifo) == 100);
+   check_round_trip(&fifo, 100);
+   /* The old macros still agree with the cursors */
+   CHECK(FIFO_READ_AVAIL_NONPTR(fifo) == 0);
+
+   /* A full ring, and writes that don't fit are dropped */
+   memset(buf, 0xab, sizeof(buf));
+   fifo_write(&fifo, buf, sizeof(buf));
+   CHECK(FIFO_READ_AVAIL(&fifo) == 100);
+   fifo_write(&fifo, buf, 1);
+   CHECK(FIFO_READ_AVAIL(&fifo) == 100);
+   CHECK(fifo_write_reserve(&fifo, 10, &spans) == 0);
+
+   fifo_clear(&fifo);
+   CHECK(fifo_read_avail(&fifo) == 0);
+   CHECK(fifo_read_peek(&fifo, 10, &spans) == 0);
+   CHECK(fifo_deinitialize(&fifo));
+
+   CHECK((heap = fifo_new(1)) != NULL);
+   if (heap)
+      check_round_trip(heap, 1);
+   fifo_free(heap);
+}
+
+static void test_spsc(void)
+{
+   fifo_buffer_t  fifo;
+   fifo_buffer_t *heap;
+   fifo_spans_t   spans;
+   uint8_t        buf[128];
+
+   CHECK(!fifo_initialize_spsc(&fifo, 0));
+   CHECK(!fifo_initialize_spsc(NULL, 16));
+
+   /* Rounded up to a power of 2, all of it usable */
+   CHECK(fifo_initialize_spsc(&fifo, 100));
+   CHECK(fifo.flags & FIFO_FLAG_SPSC);
+   CHECK(fifo.size == 128);
+   CHECK(fifo_write_avail(&fifo) == 128);
+   check_round_trip(&fifo, 128);
+
+   memset(buf, 0xcd, sizeof(buf));
+   fifo_write(&fifo, buf, sizeof(buf));
+   CHECK(fifo_read_avail(&fifo) == 128);
+   CHECK(fifo_write_avail(&fifo) == 0);
+   fifo_write(&fifo, buf, 1);
+   CHECK(fifo_read_avail(&fifo) == 128);
+
+   /* A reservation can straddle the end of the buffer */
+   fifo_clear(&fifo);
+   fifo_write(&fifo, buf, 100);
+   fifo_read(&fifo, buf, 100);
+   CHECK(fifo_write_reserve(&fifo, 60, &spans) == 60);
+   CHECK(spans.len[0] == 28 && spans.len[1] == 32);
+   CHECK(spans.ptr[1] == fifo.buffer);
+   fifo_write_commit(&fifo, 40);
+   CHECK(fifo_read_avail(&fifo) == 40);
+
+   fifo_clear(&fifo);
+   CHECK(fifo_read_avail(&fifo) == 0);
+   CHECK(fifo_write_avail(&fifo) == 128);
+   CHECK(fifo_deinitialize(&fifo));
+   CHECK(!(fifo.flags & FIFO_FLAG_SPSC));
+
+   CHECK((heap = fifo_new_spsc(64)) != NULL);
+   if (heap)
+   {
+      CHECK(heap->size == 64);
+      check_round_trip(heap, 64);
+   }
+   fifo_free(heap);
+}
+
+static void stress_producer(void *data)
+{
+   fifo_buffer_t *fifo = (fifo_buffer_t*)data;
+   size_t         sent = 0;
+
+   while (sent < STRESS_BYTES)
+   {
+      uint8_t chunk[48];
+      size_t  i;
+      size_t  n = fifo_write_avail(fifo);
+
+      if (n > sizeof(chunk))
+         n = sizeof(chunk);
+      if (n > STRESS_BYTES - sent)
+         n = STRESS_BYTES - sent;
+      /* Let the consumer run on a single core */
+      if (!n)
+         sched_yield();
+      for (i = 0; i < n; i++)
+         chunk[i] = pattern(sent + i);
+      fifo_write(fifo, chunk, n);
+      sent += n;
+   }
+}
+
+static void stress_consumer(void *data)
+{
+   fifo_buffer_t *fifo = (fifo_buffer_t*)data;
+   size_t         got  = 0;
+
+   while (got < STRESS_BYTES)
+   {
+      fifo_spans_t spans;
+      size_t       i;
+      size_t       n = fifo_read_peek(fifo, 40, &spans);
+
+      if (!n)
+         sched_yield();
+
+      for (i = 0; i < spans.len[0]; i++)
+         if (spans.ptr[0][i] != pattern(got + i))
+            failures++;
+      for (i = 0; i < spans.len[1]; i++)
+         if (spans.ptr[1][i] != pattern(got + spans.len[0] + i))
+            failures++;
+      fifo_read_release(fifo, n);
+      got += n;
+   }
+}
+
+static void test_spsc_threads(void)
+{
+   sthread_t     *producer;
+   sthread_t     *consumer;
+   fifo_buffer_t *fifo = fifo_new_spsc(STRESS_BUFFER);
+
+   CHECK(fifo != NULL);
+   if (!fifo)
+      return;
+
+   producer = sthread_create(stress_producer, fifo);
+   consumer = sthread_create(stress_consumer, fifo);
+   CHECK(producer && consumer);
+   if (producer)
+      sthread_join(producer);
+   if (consumer)
+      sthread_join(consumer);
+
+   CHECK(fifo_read_avail(fifo) == 0);
+   fifo_free(fifo);
+}
+
+int main(void)
+{
+   test_locked();
+   test_spsc();
+   test_spsc_threads();
+
+   if (failures)
+   {
+      fprintf(stderr, "fifo_queue: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("fifo_queue: all tests passed\n");
+   return 0;
+}
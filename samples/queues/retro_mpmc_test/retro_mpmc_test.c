@@ -0,0 +1,473 @@
+/* MPMC correctness test and contention benchmark.
+ *
+ * Property checks exercise the single-threaded API contract (rounding,
+ * full/empty answers, FIFO order, wrap-around, clear).
+ *
+ * The benchmark then runs P producers and C consumers over one queue
+ * for a handful of P/C mixes.  Every item carries its producer, a
+ * per-producer sequence number and the time it was pushed:
+ *   - throughput is items moved per second of wall time,
+ *   - latency is pop time minus push time, collected into a log2
+ *     histogram per consumer (so it includes time spent queued),
+ *   - correctness: a consumer must see each producer's sequence
+ *     numbers strictly increasing, and the sum over all popped items
+ *     must match what was pushed (no drops, no duplicates).
+ * The same workload is run through a ring guarded by slock_t as the
+ * baseline the lock-free queue is meant to replace.
+ *
+ * Usage: retro_mpmc_test [items-per-run]
+ *
+ * Numbers are only meaningful on a multi-core machine with an -O2
+ * build; under a sanitizer or on one core the run is a stress test. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include <retro_mpmc.h>
+#include <rthreads/rthreads.h>
+
+#define MAX_THREADS    8
+#define QUEUE_CAPACITY 1024
+#define HIST_BUCKETS   64
+
+typedef struct
+{
+   uint32_t producer;
+   uint32_t seq;
+   uint64_t stamp;
+} item_t;
+
+/* ---- Queues under test ------------------------------------------------ */
+
+typedef struct
+{
+   slock_t *lock;
+   item_t  *items;
+   size_t   capacity;
+   size_t   head;
+   size_t   tail;
+} locked_ring_t;
+
+typedef struct
+{
+   const char *name;
+   bool (*push)(void *q, const item_t *item);
+   bool (*pop)(void *q, item_t *item);
+   void *q;
+} bench_queue_t;
+
+static bool mpmc_push(void *q, const item_t *item)
+{
+   return retro_mpmc_push((retro_mpmc_t*)q, item);
+}
+
+static bool mpmc_pop(void *q, item_t *item)
+{
+   return retro_mpmc_pop((retro_mpmc_t*)q, item);
+}
+
+static bool locked_push(void *q, const item_t *item)
+{
+   locked_ring_t *r = (locked_ring_t*)q;
+   bool ret         = false;
+   slock_lock(r->lock);
+   if (r->head - r->tail < r->capacity)
+   {
+      r->items[r->head++ % r->capacity] = *item;
+      ret = true;
+   }
+   slock_unlock(r->lock);
+   return ret;
+}
+
+static bool locked_pop(void *q, item_t *item)
+{
+   locked_ring_t *r = (locked_ring_t*)q;
+   bool ret         = false;
+   slock_lock(r->lock);
+   if (r->head != r->tail)
+   {
+      *item = r->items[r->tail++ % r->capacity];
+      ret   = true;
+   }
+   slock_unlock(r->lock);
+   return ret;
+}
+
+/* ---- Benchmark -------------------------------------------------------- */
+
+typedef struct
+{
+   bench_queue_t      *bq;
+   unsigned            producers;
+   unsigned long       per_producer;
+   retro_atomic_int_t  go;
+   retro_atomic_int_t  producers_done;
+} bench_t;
+
+typedef struct
+{
+   bench_t      *b;
+   unsigned      id;
+   unsigned long count;
+   unsigned long errors;
+   uint64_t      checksum;
+   uint64_t      max_ns;
+   uint64_t      hist[HIST_BUCKETS];
+   uint32_t      last_seq[MAX_THREADS];
+} worker_t;
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned log2_bucket(uint64_t v)
+{
+   unsigned b = 0;
+   while (v > 1 && b < HIST_BUCKETS - 1)
+   {
+      v >>= 1;
+      b++;
+   }
+   return b;
+}
+
+static void wait_for_go(bench_t *b)
+{
+   while (!retro_atomic_load_acquire_int(&b->go))
+      sched_yield();
+}
+
+static void producer_thread(void *arg)
+{
+   worker_t *w = (worker_t*)arg;
+   bench_t  *b = w->b;
+   item_t    item;
+   uint32_t  seq;
+
+   wait_for_go(b);
+   item.producer = w->id;
+   for (seq = 1; seq <= b->per_producer; seq++)
+   {
+      item.seq   = seq;
+      item.stamp = now_ns();
+      while (!b->bq->push(b->bq->q, &item))
+         sched_yield();
+      w->count++;
+   }
+   retro_atomic_inc_int(&b->producers_done);
+}
+
+static void consumer_thread(void *arg)
+{
+   worker_t *w = (worker_t*)arg;
+   bench_t  *b = w->b;
+   item_t    item;
+
+   wait_for_go(b);
+   for (;;)
+   {
+      uint64_t lat;
+
+      if (!b->bq->pop(b->bq->q, &item))
+      {
+         /* Once every producer has published its last item, a
+          * failed pop means the queue really is drained */
+         if (retro_atomic_load_acquire_int(&b->producers_done)
+               == (int)b->producers)
+         {
+            if (!b->bq->pop(b->bq->q, &item))
+               break;
+         }
+         else
+         {
+            sched_yield();
+            continue;
+         }
+      }
+
+      lat = now_ns() - item.stamp;
+      w->hist[log2_bucket(lat)]++;
+      if (lat > w->max_ns)
+         w->max_ns = lat;
+
+      if (     item.producer >= b->producers
+            || item.seq <= w->last_seq[item.producer])
+         w->errors++;
+      else
+         w->last_seq[item.producer] = item.seq;
+      w->checksum += (uint64_t)item.producer * b->per_producer + item.seq;
+      w->count++;
+   }
+}
+
+static uint64_t percentile_bound(const uint64_t *hist, uint64_t total,
+      double pct)
+{
+   unsigned i;
+   uint64_t seen = 0;
+   uint64_t want = (uint64_t)(total * pct);
+   for (i = 0; i < HIST_BUCKETS; i++)
+   {
+      seen += hist[i];
+      if (seen > want)
+         return (uint64_t)2 << i;
+   }
+   return 0;
+}
+
+static int run_bench(bench_queue_t *bq, unsigned producers,
+      unsigned consumers, unsigned long total)
+{
+   bench_t   b;
+   worker_t  prod[MAX_THREADS];
+   worker_t  cons[MAX_THREADS];
+   sthread_t *threads[2 * MAX_THREADS];
+   uint64_t  hist[HIST_BUCKETS];
+   uint64_t  expected = 0;
+   uint64_t  checksum = 0;
+   uint64_t  max_ns   = 0;
+   unsigned long popped = 0;
+   unsigned long errors = 0;
+   unsigned  i, j, n  = 0;
+   uint64_t  t0, t1;
+   double    secs;
+
+   memset(&b, 0, sizeof(b));
+   memset(prod, 0, sizeof(prod));
+   memset(cons, 0, sizeof(cons));
+   memset(hist, 0, sizeof(hist));
+   b.bq           = bq;
+   b.producers    = producers;
+   b.per_producer = total / producers;
+   retro_atomic_int_init(&b.go, 0);
+   retro_atomic_int_init(&b.producers_done, 0);
+
+   for (i = 0; i < consumers; i++)
+   {
+      cons[i].b  = &b;
+      cons[i].id = i;
+      if (!(threads[n++] = sthread_create(consumer_thread, &cons[i])))
+         return 1;
+   }
+   for (i = 0; i < producers; i++)
+   {
+      prod[i].b  = &b;
+      prod[i].id = i;
+      if (!(threads[n++] = sthread_create(producer_thread, &prod[i])))
+         return 1;
+   }
+
+   t0 = now_ns();
+   retro_atomic_store_release_int(&b.go, 1);
+   for (i = 0; i < n; i++)
+      sthread_join(threads[i]);
+   t1 = now_ns();
+
+   for (i = 0; i < producers; i++)
+   {
+      uint64_t k;
+      for (k = 1; k <= b.per_producer; k++)
+         expected += (uint64_t)i * b.per_producer + k;
+   }
+   for (i = 0; i < consumers; i++)
+   {
+      popped   += cons[i].count;
+      errors   += cons[i].errors;
+      checksum += cons[i].checksum;
+      if (cons[i].max_ns > max_ns)
+         max_ns = cons[i].max_ns;
+      for (j = 0; j < HIST_BUCKETS; j++)
+         hist[j] += cons[i].hist[j];
+   }
+
+   secs = (double)(t1 - t0) / 1e9;
+   printf("  %-6s %up/%uc: %8.2f Mitems/s   latency p50 < %llu ns, "
+          "p99 < %llu ns, max %llu ns\n",
+         bq->name, producers, consumers,
+         secs > 0 ? (double)popped / secs / 1e6 : 0.0,
+         (unsigned long long)percentile_bound(hist, popped, 0.50),
+         (unsigned long long)percentile_bound(hist, popped, 0.99),
+         (unsigned long long)max_ns);
+
+   if (     errors
+         || popped != b.per_producer * producers
+         || checksum != expected)
+   {
+      fprintf(stderr, "FAIL %s %up/%uc: popped %lu of %lu, "
+            "%lu ordering errors, checksum %s\n",
+            bq->name, producers, consumers, popped,
+            b.per_producer * producers, errors,
+            checksum == expected ? "ok" : "MISMATCH");
+      return 1;
+   }
+   return 0;
+}
+
+/* ---- Single-threaded property checks --------------------------------- */
+
+static int run_property_checks(void)
+{
+   retro_mpmc_t q;
+   unsigned     i, v;
+   uint8_t      odd[5];
+
+   if (retro_mpmc_init(&q, 16, 0))
+   {
+      fprintf(stderr, "FAIL: init accepted elem_size 0\n");
+      return 1;
+   }
+
+   if (!retro_mpmc_init(&q, 100, sizeof(unsigned)))
+   {
+      fprintf(stderr, "FAIL: init(100)\n");
+      return 1;
+   }
+   if (q.capacity != 128)
+   {
+      fprintf(stderr, "FAIL: capacity %u != 128 (round up)\n",
+            (unsigned)q.capacity);
+      retro_mpmc_free(&q);
+      return 1;
+   }
+
+   if (retro_mpmc_pop(&q, &v))
+   {
+      fprintf(stderr, "FAIL: pop on an empty queue\n");
+      retro_mpmc_free(&q);
+      return 1;
+   }
+
+   for (i = 0; i < 128; i++)
+      if (!retro_mpmc_push(&q, &i))
+      {
+         fprintf(stderr, "FAIL: push %u of 128\n", i);
+         retro_mpmc_free(&q);
+         return 1;
+      }
+   if (retro_mpmc_push(&q, &i) || retro_mpmc_count(&q) != 128)
+   {
+      fprintf(stderr, "FAIL: push on a full queue\n");
+      retro_mpmc_free(&q);
+      return 1;
+   }
+
+   /* FIFO order, kept full across many laps of the ring */
+   for (i = 0; i < 128 * 40; i++)
+   {
+      if (!retro_mpmc_pop(&q, &v) || v != i)
+      {
+         fprintf(stderr, "FAIL: pop %u returned %u\n", i, v);
+         retro_mpmc_free(&q);
+         return 1;
+      }
+      v = i + 128;
+      if (!retro_mpmc_push(&q, &v))
+      {
+         fprintf(stderr, "FAIL: refill push %u\n", v);
+         retro_mpmc_free(&q);
+         return 1;
+      }
+   }
+
+   retro_mpmc_clear(&q);
+   if (retro_mpmc_count(&q) != 0 || retro_mpmc_pop(&q, &v))
+   {
+      fprintf(stderr, "FAIL: clear left elements behind\n");
+      retro_mpmc_free(&q);
+      return 1;
+   }
+   retro_mpmc_free(&q);
+
+   /* Odd element sizes keep the sequence words aligned */
+   if (!retro_mpmc_init(&q, 2, sizeof(odd)))
+   {
+      fprintf(stderr, "FAIL: init(2, 5)\n");
+      return 1;
+   }
+   for (i = 0; i < 10; i++)
+   {
+      memset(odd, (int)i, sizeof(odd));
+      retro_mpmc_push(&q, odd);
+      memset(odd, 0xff, sizeof(odd));
+      if (!retro_mpmc_pop(&q, odd) || odd[0] != i || odd[4] != i)
+      {
+         fprintf(stderr, "FAIL: odd-sized element %u\n", i);
+         retro_mpmc_free(&q);
+         return 1;
+      }
+   }
+   retro_mpmc_free(&q);
+
+   printf("[pass] property checks\n");
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   static const unsigned mixes[][2] = {
+      { 1, 1 }, { 2, 2 }, { 4, 4 }, { 4, 1 }, { 1, 4 }
+   };
+   retro_mpmc_t   mpmc;
+   locked_ring_t  ring;
+   bench_queue_t  queues[2];
+   unsigned long  total = 2000000;
+   unsigned       i, k;
+   int            fails = 0;
+
+   if (argc > 1)
+      total = strtoul(argv[1], NULL, 10);
+   if (total < 4)
+      total = 4;
+
+   fails += run_property_checks();
+
+   if (!retro_mpmc_init(&mpmc, QUEUE_CAPACITY, sizeof(item_t)))
+   {
+      fprintf(stderr, "FAIL: retro_mpmc_init\n");
+      return 1;
+   }
+   memset(&ring, 0, sizeof(ring));
+   ring.capacity = QUEUE_CAPACITY;
+   ring.lock     = slock_new();
+   ring.items    = (item_t*)malloc(QUEUE_CAPACITY * sizeof(item_t));
+   if (!ring.lock || !ring.items)
+   {
+      fprintf(stderr, "FAIL: locked ring allocation\n");
+      return 1;
+   }
+
+   queues[0].name = "mpmc";
+   queues[0].push = mpmc_push;
+   queues[0].pop  = mpmc_pop;
+   queues[0].q    = &mpmc;
+   queues[1].name = "locked";
+   queues[1].push = locked_push;
+   queues[1].pop  = locked_pop;
+   queues[1].q    = &ring;
+
+   printf("%lu items per run, capacity %d, backend %s\n",
+         total, QUEUE_CAPACITY, RETRO_ATOMIC_BACKEND_NAME);
+   for (i = 0; i < sizeof(mixes) / sizeof(mixes[0]); i++)
+      for (k = 0; k < 2; k++)
+         fails += run_bench(&queues[k], mixes[i][0], mixes[i][1], total);
+
+   retro_mpmc_free(&mpmc);
+   slock_free(ring.lock);
+   free(ring.items);
+
+   if (fails == 0)
+   {
+      printf("ALL OK\n");
+      return 0;
+   }
+   printf("%d FAILURE(S)\n", fails);
+   return 1;
+}
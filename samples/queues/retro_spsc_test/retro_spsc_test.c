@@ -254,12 +254,282 @@ static int run_property_checks(void)
    return 0;
 }
 
+/* Zero-copy and record checks, single-threaded. */
+static int run_span_checks(void)
+{
+   retro_spsc_t       q;
+   retro_spsc_spans_t spans;
+   uint8_t            buf[64];
+   size_t             i, n, len;
+
+   if (!retro_spsc_init(&q, 64))
+   {
+      fprintf(stderr, "FAIL: init(64)\n");
+      return 1;
+   }
+
+   /* Move the cursors to 48 so the next region wraps */
+   n = retro_spsc_write_reserve(&q, 48, &spans);
+   if (n != 48 || spans.len[0] != 48 || spans.len[1] != 0)
+   {
+      fprintf(stderr, "FAIL: reserve(48) on empty queue\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   memset(spans.ptr[0], 0xaa, 48);
+   if (retro_spsc_read_avail(&q) != 0)
+   {
+      fprintf(stderr, "FAIL: reserve published data\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   retro_spsc_write_commit(&q, 48);
+   n = retro_spsc_read_peek(&q, 100, &spans);
+   if (n != 48 || spans.ptr[0][47] != 0xaa)
+   {
+      fprintf(stderr, "FAIL: read_peek after commit\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   retro_spsc_read_release(&q, 48);
+
+   /* 32 bytes from offset 48: 16 at the end, 16 at the start */
+   n = retro_spsc_write_reserve(&q, 32, &spans);
+   if (     n != 32 || spans.len[0] != 16 || spans.len[1] != 16
+         || spans.ptr[1] != q.buffer)
+   {
+      fprintf(stderr, "FAIL: wrapped reserve spans %u+%u\n",
+            (unsigned)spans.len[0], (unsigned)spans.len[1]);
+      retro_spsc_free(&q);
+      return 1;
+   }
+   for (i = 0; i < 16; i++)
+   {
+      spans.ptr[0][i] = (uint8_t)i;
+      spans.ptr[1][i] = (uint8_t)(16 + i);
+   }
+   /* Partial commit: only the first 20 bytes become visible */
+   retro_spsc_write_commit(&q, 20);
+   if (retro_spsc_read(&q, buf, sizeof(buf)) != 20)
+   {
+      fprintf(stderr, "FAIL: partial commit\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   for (i = 0; i < 20; i++)
+      if (buf[i] != i)
+      {
+         fprintf(stderr, "FAIL: wrapped content at %u\n", (unsigned)i);
+         retro_spsc_free(&q);
+         return 1;
+      }
+
+   /* Records: all or nothing, wrapped header and payload */
+   retro_spsc_clear(&q);
+   for (i = 0; i < 200; i++)
+   {
+      size_t rec = i % 29;
+      memset(buf, (int)i, rec);
+      if (!retro_spsc_record_write(&q, buf, rec))
+      {
+         fprintf(stderr, "FAIL: record_write %u\n", (unsigned)i);
+         retro_spsc_free(&q);
+         return 1;
+      }
+      memset(buf, 0, sizeof(buf));
+      if (     !retro_spsc_record_read(&q, buf, sizeof(buf), &len)
+            || len != rec
+            || (rec && (buf[0] != (uint8_t)i || buf[rec - 1] != (uint8_t)i)))
+      {
+         fprintf(stderr, "FAIL: record_read %u\n", (unsigned)i);
+         retro_spsc_free(&q);
+         return 1;
+      }
+   }
+   if (retro_spsc_record_read(&q, buf, sizeof(buf), &len))
+   {
+      fprintf(stderr, "FAIL: record_read on an empty queue\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+
+   if (retro_spsc_record_write(&q, buf, 61))
+   {
+      fprintf(stderr, "FAIL: record larger than the queue accepted\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   retro_spsc_record_write(&q, buf, 40);
+   if (     retro_spsc_record_write(&q, buf, 30)
+         || retro_spsc_read_avail(&q) != 44)
+   {
+      fprintf(stderr, "FAIL: record_write wrote a partial record\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   if (     retro_spsc_record_read(&q, buf, 10, &len)
+         || len != 40
+         || retro_spsc_read_avail(&q) != 44)
+   {
+      fprintf(stderr, "FAIL: short record_read consumed the record\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   if (!retro_spsc_record_peek(&q, &spans)
+         || spans.len[0] + spans.len[1] != 40)
+   {
+      fprintf(stderr, "FAIL: record_peek\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   retro_spsc_record_release(&q);
+
+   /* Reserve for the worst case, commit what was produced */
+   if (!retro_spsc_record_reserve(&q, 50, &spans))
+   {
+      fprintf(stderr, "FAIL: record_reserve\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   spans.ptr[0][0] = 0x5a;
+   retro_spsc_record_commit(&q, 1);
+   if (     !retro_spsc_record_read(&q, buf, sizeof(buf), &len)
+         || len != 1 || buf[0] != 0x5a)
+   {
+      fprintf(stderr, "FAIL: record_commit of a shorter payload\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+
+   /* Committing more than was reserved publishes only the
+    * reservation */
+   if (!retro_spsc_record_reserve(&q, 8, &spans))
+   {
+      fprintf(stderr, "FAIL: record_reserve\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+   retro_spsc_record_commit(&q, 1000);
+   if (     retro_spsc_read_avail(&q) != RETRO_SPSC_RECORD_HEADER + 8
+         || !retro_spsc_record_read(&q, buf, sizeof(buf), &len)
+         || len != 8)
+   {
+      fprintf(stderr, "FAIL: record_commit past the reservation\n");
+      retro_spsc_free(&q);
+      return 1;
+   }
+
+   retro_spsc_free(&q);
+   printf("[pass] span and record checks\n");
+   return 0;
+}
+
+/* Record stress: variable-length records, written in place by the
+ * producer and checked in place by the consumer. */
+#define RECORD_COUNT 200000
+#define RECORD_MAX   100
+
+static uint8_t record_byte(uint32_t rec, size_t i)
+{
+   return (uint8_t)(rec * 31 + i);
+}
+
+static void record_producer(void *arg)
+{
+   retro_spsc_t *q = (retro_spsc_t*)arg;
+   uint32_t      rec;
+
+   for (rec = 0; rec < RECORD_COUNT; rec++)
+   {
+      retro_spsc_spans_t spans;
+      size_t len = rec % RECORD_MAX;
+      size_t i;
+      while (!retro_spsc_record_reserve(q, len, &spans))
+         ; /* spin */
+      for (i = 0; i < len; i++)
+      {
+         if (i < spans.len[0])
+            spans.ptr[0][i] = record_byte(rec, i);
+         else
+            spans.ptr[1][i - spans.len[0]] = record_byte(rec, i);
+      }
+      retro_spsc_record_commit(q, len);
+   }
+}
+
+static unsigned long record_mismatches;
+
+static void record_consumer(void *arg)
+{
+   retro_spsc_t *q = (retro_spsc_t*)arg;
+   uint32_t      rec;
+
+   for (rec = 0; rec < RECORD_COUNT; rec++)
+   {
+      retro_spsc_spans_t spans;
+      size_t i;
+      while (!retro_spsc_record_peek(q, &spans))
+         ; /* spin */
+      if (spans.len[0] + spans.len[1] != rec % RECORD_MAX)
+         record_mismatches++;
+      else
+         for (i = 0; i < spans.len[0] + spans.len[1]; i++)
+         {
+            uint8_t b = i < spans.len[0]
+               ? spans.ptr[0][i] : spans.ptr[1][i - spans.len[0]];
+            if (b != record_byte(rec, i))
+            {
+               record_mismatches++;
+               break;
+            }
+         }
+      retro_spsc_record_release(q);
+   }
+}
+
+static int run_record_stress(void)
+{
+   retro_spsc_t q;
+   sthread_t   *prod;
+   sthread_t   *cons;
+
+   if (!retro_spsc_init(&q, 1024))
+   {
+      fprintf(stderr, "FAIL: retro_spsc_init\n");
+      return 1;
+   }
+   prod = sthread_create(record_producer, &q);
+   cons = sthread_create(record_consumer, &q);
+   if (!prod || !cons)
+   {
+      fprintf(stderr, "FAIL: sthread_create\n");
+      return 1;
+   }
+   sthread_join(prod);
+   sthread_join(cons);
+   retro_spsc_free(&q);
+
+   if (record_mismatches != 0)
+   {
+      fprintf(stderr, "FAIL: %lu mismatched records out of %d\n",
+            record_mismatches, RECORD_COUNT);
+      return 1;
+   }
+   printf("[pass] record stress: %d records, 0 mismatches\n",
+         RECORD_COUNT);
+   return 0;
+}
+
 int main(void)
 {
    if (run_property_checks() != 0)
       return 1;
+   if (run_span_checks() != 0)
+      return 1;
    if (run_stress() != 0)
       return 1;
+   if (run_record_stress() != 0)
+      return 1;
    puts("ALL OK");
    return 0;
 }
@@ -0,0 +1,331 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (task_queue_coroutine_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for coroutine tasks (task_init_coroutine / task_yield).
+ *
+ *  - Plain queue: each task_queue_check resumes every body once, so
+ *    two bodies that yield after every step interleave pairwise.
+ *  - A body that flags itself finished and yields is not resumed.
+ *  - task_yield outside a body is a no-op.
+ *  - Threaded queue: bodies keep their stack locals across yields even
+ *    when a different worker resumes them, and ordinary tasks that
+ *    call task_yield are unaffected.
+ *  - Cross-thread: tasks created and pushed from other threads while
+ *    workers finish and delete earlier ones. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <boolean.h>
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+
+#define WAIT_MS      10000
+#define CO_TASKS     8
+#define CO_STEPS     200
+#define PLAIN_TASKS  4
+#define PUSH_THREADS 2
+#define PUSH_TASKS   64
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+/* ---- stubs for features_cpu.c ------------------------------------- */
+
+retro_time_t cpu_features_get_time_usec(void);
+retro_time_t cpu_features_get_time_usec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (retro_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned cpu_features_get_core_amount(void);
+unsigned cpu_features_get_core_amount(void)
+{
+   return 4;
+}
+
+/* ---- helpers ------------------------------------------------------- */
+
+static int callbacks; /* main thread only */
+
+static void count_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *error)
+{
+   callbacks++;
+}
+
+static bool pump_until(int target)
+{
+   retro_time_t deadline = cpu_features_get_time_usec()
+      + (retro_time_t)WAIT_MS * 1000;
+   for (;;)
+   {
+      struct timespec ts;
+      task_queue_check();
+      if (callbacks >= target)
+         return true;
+      if (cpu_features_get_time_usec() > deadline)
+         return false;
+      ts.tv_sec  = 0;
+      ts.tv_nsec = 1000000L;
+      nanosleep(&ts, NULL);
+   }
+}
+
+static retro_task_t *new_co_task(retro_task_body_t body, void *user_data)
+{
+   retro_task_t *task = task_init_coroutine(body, 0);
+   if (task)
+   {
+      task->callback  = count_cb;
+      task->user_data = user_data;
+   }
+   return task;
+}
+
+/* ---- plain queue --------------------------------------------------- */
+
+static char   trace[32];
+static size_t trace_len;
+
+static void letter_body(retro_task_t *task)
+{
+   int  i;
+   char c = *(const char*)task->user_data;
+   for (i = 0; i < 5; i++)
+   {
+      trace[trace_len++] = c;
+      task_yield();
+   }
+}
+
+static bool reached_after_finish;
+
+static void finish_early_body(retro_task_t *task)
+{
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+   task_yield();
+   reached_after_finish = true;
+}
+
+static void test_plain(void)
+{
+   static const char a = 'A';
+   static const char b = 'B';
+   size_t            i;
+   retro_task_t     *ta, *tb, *tc;
+
+   task_queue_init(false, NULL);
+   callbacks = 0;
+   trace_len = 0;
+
+   /* Outside any body */
+   task_yield();
+
+   ta = new_co_task(letter_body, (void*)&a);
+   tb = new_co_task(letter_body, (void*)&b);
+   tc = new_co_task(finish_early_body, NULL);
+   CHECK(ta && tb && tc);
+   if (!ta || !tb || !tc)
+      return;
+   CHECK(task_queue_push(ta));
+   CHECK(task_queue_push(tb));
+   CHECK(task_queue_push(tc));
+
+   CHECK(pump_until(3));
+   trace[trace_len] = '\0';
+   /* Each pass resumes both bodies once; the pass order may vary */
+   CHECK(trace_len == 10);
+   for (i = 0; i + 1 < trace_len; i += 2)
+      CHECK(trace[i] != trace[i + 1]);
+   CHECK(!reached_after_finish);
+   CHECK(!task_init_coroutine(NULL, 0));
+
+   task_queue_deinit();
+}
+
+/* ---- threaded queue ------------------------------------------------ */
+
+struct co_state
+{
+   slock_t *lock;
+   int      steps;
+   bool     locals_ok;
+};
+
+static void stepping_body(retro_task_t *task)
+{
+   int              i;
+   unsigned         local[16];
+   unsigned         sum = 0;
+   struct co_state *st  = (struct co_state*)task->user_data;
+
+   for (i = 0; i < 16; i++)
+      local[i] = (unsigned)i * 2654435761u;
+
+   for (i = 0; i < CO_STEPS; i++)
+   {
+      local[i & 15] += (unsigned)i;
+      sum           += (unsigned)i;
+      slock_lock(st->lock);
+      st->steps++;
+      slock_unlock(st->lock);
+      task_yield();
+   }
+
+   for (i = 0; i < 16; i++)
+      sum -= local[i] - (unsigned)i * 2654435761u;
+   slock_lock(st->lock);
+   st->locals_ok = (sum == 0);
+   slock_unlock(st->lock);
+}
+
+static void plain_yield_handler(retro_task_t *task)
+{
+   /* Not a coroutine: must return here normally */
+   task_yield();
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void test_threaded(void)
+{
+   int             i;
+   struct co_state st[CO_TASKS];
+
+   task_queue_init(true, NULL);
+   callbacks = 0;
+
+   for (i = 0; i < CO_TASKS; i++)
+   {
+      retro_task_t *task;
+      st[i].lock      = slock_new();
+      st[i].steps     = 0;
+      st[i].locals_ok = false;
+      task            = new_co_task(stepping_body, &st[i]);
+      CHECK(task != NULL);
+      if (!task)
+         continue;
+      task->priority  = (i & 1)
+         ? TASK_PRIORITY_BACKGROUND
+         : TASK_PRIORITY_INTERACTIVE;
+      CHECK(task_queue_push(task));
+   }
+   for (i = 0; i < PLAIN_TASKS; i++)
+   {
+      retro_task_t *task = task_init();
+      task->handler      = plain_yield_handler;
+      task->callback     = count_cb;
+      CHECK(task_queue_push(task));
+   }
+
+   CHECK(pump_until(CO_TASKS + PLAIN_TASKS));
+
+   for (i = 0; i < CO_TASKS; i++)
+   {
+      slock_lock(st[i].lock);
+      CHECK(st[i].steps == CO_STEPS);
+      CHECK(st[i].locals_ok);
+      slock_unlock(st[i].lock);
+      slock_free(st[i].lock);
+   }
+
+   task_queue_deinit();
+}
+
+/* ---- cross-thread create / delete -------------------------------- */
+
+static void short_body(retro_task_t *task)
+{
+   int *runs = (int*)task->user_data;
+   task_yield();
+   (*runs)++;
+}
+
+static void pusher_thread(void *data)
+{
+   int *runs = (int*)data;
+   int  i;
+
+   for (i = 0; i < PUSH_TASKS; i++)
+   {
+      retro_task_t *task = new_co_task(short_body, &runs[i]);
+      CHECK(task != NULL);
+      if (task)
+         CHECK(task_queue_push(task));
+   }
+}
+
+static void test_cross_thread(void)
+{
+   static int runs[PUSH_THREADS][PUSH_TASKS];
+   sthread_t *threads[PUSH_THREADS];
+   int        i, j;
+
+   task_queue_init(true, NULL);
+   callbacks = 0;
+   memset(runs, 0, sizeof(runs));
+
+   for (i = 0; i < PUSH_THREADS; i++)
+   {
+      threads[i] = sthread_create(pusher_thread, runs[i]);
+      CHECK(threads[i] != NULL);
+   }
+   for (i = 0; i < PUSH_THREADS; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+
+   CHECK(pump_until(PUSH_THREADS * PUSH_TASKS));
+   /* Each body ran once on a stack of its own */
+   for (i = 0; i < PUSH_THREADS; i++)
+      for (j = 0; j < PUSH_TASKS; j++)
+         CHECK(runs[i][j] == 1);
+
+   task_queue_deinit();
+}
+
+int main(void)
+{
+   test_plain();
+   test_threaded();
+   test_cross_thread();
+
+   if (failures)
+   {
+      fprintf(stderr, "task_queue_coroutine: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("task_queue_coroutine: all tests passed\n");
+   return 0;
+}
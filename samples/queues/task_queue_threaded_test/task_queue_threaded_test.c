@@ -0,0 +1,366 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (task_queue_threaded_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for the multi-worker threaded task queue.
+ *
+ *  - A background task stuck in its handler does not hold up
+ *    interactive tasks pushed after it.
+ *  - Background tasks never occupy every worker: with all workers'
+ *    worth of background tasks blocked, one stays free and an
+ *    interactive task still completes.
+ *  - A task's handler is never run on two workers at once, and every
+ *    task gets all of its steps, across a mix of priorities.
+ *  - Tasks with a future 'when' do not start early.
+ *  - Only one TASK_TYPE_BLOCKING task is accepted at a time.
+ *  - Switching to non-threaded mode and back mid-task keeps the task
+ *    running to completion.
+ * Callbacks run on the main thread from task_queue_check, as before. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <boolean.h>
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+
+#define STUB_CORES   4
+#define WAIT_MS      10000
+#define STEP_TASKS   16
+#define STEPS        50
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+/* ---- stubs for features_cpu.c ------------------------------------- */
+
+retro_time_t cpu_features_get_time_usec(void);
+retro_time_t cpu_features_get_time_usec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (retro_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned cpu_features_get_core_amount(void);
+unsigned cpu_features_get_core_amount(void)
+{
+   return STUB_CORES;
+}
+
+/* ---- shared state -------------------------------------------------- */
+
+static slock_t *lock;
+static scond_t *cond;
+static bool     gate_open;
+static int      bg_inside;
+static int      bg_inside_max;
+static int      callbacks;     /* main thread only */
+
+static void sleep_ms(unsigned ms)
+{
+   struct timespec ts;
+   ts.tv_sec  = ms / 1000;
+   ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+   nanosleep(&ts, NULL);
+}
+
+/* Runs the queue until *counter reaches target or time runs out */
+static bool pump_until(int *counter, int target)
+{
+   retro_time_t deadline = cpu_features_get_time_usec()
+      + (retro_time_t)WAIT_MS * 1000;
+   for (;;)
+   {
+      task_queue_check();
+      if (*counter >= target)
+         return true;
+      if (cpu_features_get_time_usec() > deadline)
+         return false;
+      sleep_ms(1);
+   }
+}
+
+static bool wait_bg_inside(int n)
+{
+   bool          ok;
+   retro_time_t  deadline = cpu_features_get_time_usec()
+      + (retro_time_t)WAIT_MS * 1000;
+   slock_lock(lock);
+   while (bg_inside < n && cpu_features_get_time_usec() < deadline)
+      scond_wait_timeout(cond, lock, 1000);
+   ok = (bg_inside >= n);
+   slock_unlock(lock);
+   return ok;
+}
+
+static void set_gate(bool open)
+{
+   slock_lock(lock);
+   gate_open = open;
+   scond_broadcast(cond);
+   slock_unlock(lock);
+}
+
+static void count_cb(retro_task_t *task, void *task_data,
+      void *user_data, const char *error)
+{
+   callbacks++;
+}
+
+/* Blocks in its handler until the gate opens, then finishes */
+static void gate_handler(retro_task_t *task)
+{
+   slock_lock(lock);
+   if (++bg_inside > bg_inside_max)
+      bg_inside_max = bg_inside;
+   scond_broadcast(cond);
+   while (!gate_open)
+      scond_wait(cond, lock);
+   bg_inside--;
+   slock_unlock(lock);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void quick_handler(retro_task_t *task)
+{
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static retro_task_t *new_task(retro_task_handler_t handler,
+      enum task_priority priority)
+{
+   retro_task_t *task = task_init();
+   task->handler      = handler;
+   task->callback     = count_cb;
+   task->priority     = priority;
+   return task;
+}
+
+static void reset_state(void)
+{
+   set_gate(false);
+   slock_lock(lock);
+   bg_inside     = 0;
+   bg_inside_max = 0;
+   slock_unlock(lock);
+   callbacks     = 0;
+}
+
+/* ---- tests --------------------------------------------------------- */
+
+static void test_no_head_of_line_blocking(void)
+{
+   int i;
+
+   reset_state();
+   CHECK(task_queue_push(new_task(gate_handler, TASK_PRIORITY_BACKGROUND)));
+   CHECK(wait_bg_inside(1));
+   for (i = 0; i < 20; i++)
+      CHECK(task_queue_push(new_task(quick_handler,
+                  TASK_PRIORITY_INTERACTIVE)));
+
+   /* All 20 must finish while the background task is still stuck */
+   CHECK(pump_until(&callbacks, 20));
+   CHECK(callbacks == 20);
+
+   set_gate(true);
+   CHECK(pump_until(&callbacks, 21));
+}
+
+static void test_background_leaves_a_worker(void)
+{
+   int i;
+
+   reset_state();
+   for (i = 0; i < STUB_CORES; i++)
+      CHECK(task_queue_push(new_task(gate_handler,
+                  TASK_PRIORITY_BACKGROUND)));
+   CHECK(wait_bg_inside(STUB_CORES - 1));
+
+   CHECK(task_queue_push(new_task(quick_handler,
+               TASK_PRIORITY_INTERACTIVE)));
+   CHECK(pump_until(&callbacks, 1));
+
+   slock_lock(lock);
+   CHECK(bg_inside_max == STUB_CORES - 1);
+   slock_unlock(lock);
+
+   set_gate(true);
+   CHECK(pump_until(&callbacks, 1 + STUB_CORES));
+}
+
+struct stepper
+{
+   int inside;
+   int steps;
+   int overlaps;
+};
+
+static void step_handler(retro_task_t *task)
+{
+   struct stepper *st = (struct stepper*)task->user_data;
+   bool            done;
+
+   slock_lock(lock);
+   if (st->inside)
+      st->overlaps++;
+   st->inside = 1;
+   slock_unlock(lock);
+
+   sleep_ms(0);
+
+   slock_lock(lock);
+   st->inside = 0;
+   done       = (++st->steps == STEPS);
+   slock_unlock(lock);
+
+   if (done)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void test_steps(void)
+{
+   int            i;
+   struct stepper st[STEP_TASKS];
+
+   reset_state();
+   memset(st, 0, sizeof(st));
+   for (i = 0; i < STEP_TASKS; i++)
+   {
+      retro_task_t *task = new_task(step_handler, (i & 1)
+            ? TASK_PRIORITY_BACKGROUND
+            : TASK_PRIORITY_INTERACTIVE);
+      task->user_data    = &st[i];
+      CHECK(task_queue_push(task));
+   }
+   CHECK(pump_until(&callbacks, STEP_TASKS));
+
+   slock_lock(lock);
+   for (i = 0; i < STEP_TASKS; i++)
+   {
+      CHECK(st[i].steps == STEPS);
+      CHECK(st[i].overlaps == 0);
+   }
+   slock_unlock(lock);
+}
+
+static retro_time_t delayed_ran_at;
+
+static void delayed_handler(retro_task_t *task)
+{
+   slock_lock(lock);
+   delayed_ran_at = cpu_features_get_time_usec();
+   slock_unlock(lock);
+   task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void test_delayed(void)
+{
+   retro_task_t *task = new_task(delayed_handler, TASK_PRIORITY_INTERACTIVE);
+   retro_time_t  when = cpu_features_get_time_usec() + 50000;
+
+   reset_state();
+   task->when = when;
+   CHECK(task_queue_push(task));
+   CHECK(pump_until(&callbacks, 1));
+
+   slock_lock(lock);
+   /* The queue allows half a millisecond of slack */
+   CHECK(delayed_ran_at >= when - 1000);
+   slock_unlock(lock);
+}
+
+static void test_blocking(void)
+{
+   retro_task_t *first  = new_task(gate_handler, TASK_PRIORITY_BACKGROUND);
+   retro_task_t *second = new_task(quick_handler, TASK_PRIORITY_INTERACTIVE);
+
+   reset_state();
+   first->type  = TASK_TYPE_BLOCKING;
+   second->type = TASK_TYPE_BLOCKING;
+   CHECK(task_queue_push(first));
+   CHECK(!task_queue_push(second));
+   set_gate(true);
+   CHECK(pump_until(&callbacks, 1));
+
+   /* Accepted again once the first one is gone */
+   CHECK(task_queue_push(second));
+   CHECK(pump_until(&callbacks, 2));
+}
+
+static void test_mode_switch(void)
+{
+   struct stepper st;
+   retro_task_t  *task = new_task(step_handler, TASK_PRIORITY_BACKGROUND);
+
+   reset_state();
+   memset(&st, 0, sizeof(st));
+   task->user_data = &st;
+   CHECK(task_queue_push(task));
+
+   task_queue_unset_threaded();
+   task_queue_check();
+   CHECK(!task_queue_is_threaded());
+   task_queue_set_threaded();
+   CHECK(pump_until(&callbacks, 1));
+   CHECK(task_queue_is_threaded());
+   CHECK(st.steps == STEPS);
+}
+
+int main(void)
+{
+   lock = slock_new();
+   cond = scond_new();
+
+   task_queue_init(true, NULL);
+   CHECK(task_queue_is_threaded());
+
+   test_no_head_of_line_blocking();
+   test_background_leaves_a_worker();
+   test_steps();
+   test_delayed();
+   test_blocking();
+   test_mode_switch();
+
+   task_queue_deinit();
+   slock_free(lock);
+   scond_free(cond);
+
+   if (failures)
+   {
+      fprintf(stderr, "task_queue_threaded: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("task_queue_threaded: all tests passed\n");
+   return 0;
+}
@@ -0,0 +1,319 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rthreads_lock_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Lock contention benchmark for slock_t / scond_t.
+ *
+ * Three shapes, each checked for lost updates:
+ *   - counter:  N threads increment one shared counter under an
+ *               slock_t (short critical sections, heavy contention),
+ *   - handoff:  two threads pass a token back and forth with
+ *               slock_t + scond_t, like an audio or video thread
+ *               waiting on its producer,
+ *   - wait:     the same ping-pong on retro_atomic_wait_int /
+ *               retro_atomic_notify_one_int with no mutex at all.
+ * A short scond_wait_timeout with no signal is also checked.
+ *
+ * The Makefile builds this file twice: rthreads_lock_bench uses the
+ * default backend (futex on Linux) and rthreads_lock_bench_pthread is
+ * built with RTHREADS_NO_FUTEX, so the two can be compared.
+ *
+ * Usage: rthreads_lock_bench [iterations-per-thread]
+ *
+ * Numbers are only meaningful on a multi-core machine with an -O2
+ * build; under a sanitizer or on one core the run is a stress test. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rthreads/rthreads.h>
+#include <retro_atomic.h>
+
+#define DEFAULT_ITERATIONS 200000
+
+#ifdef RTHREADS_NO_FUTEX
+#define BACKEND_NAME "pthread"
+#elif defined(__linux__)
+#define BACKEND_NAME "futex"
+#else
+#define BACKEND_NAME "native"
+#endif
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ---- counter ------------------------------------------------------- */
+
+typedef struct
+{
+   slock_t *lock;
+   size_t   iterations;
+   size_t   counter;
+} counter_t;
+
+static void counter_thread(void *arg)
+{
+   size_t     i;
+   counter_t *c = (counter_t*)arg;
+   for (i = 0; i < c->iterations; i++)
+   {
+      slock_lock(c->lock);
+      c->counter++;
+      slock_unlock(c->lock);
+   }
+}
+
+static int run_counter(size_t threads, size_t iterations)
+{
+   size_t     i;
+   uint64_t   t0, t1;
+   sthread_t *workers[16];
+   counter_t  c;
+
+   c.lock       = slock_new();
+   c.iterations = iterations;
+   c.counter    = 0;
+   if (!c.lock)
+   {
+      printf("[FAIL] counter: slock_new failed\n");
+      return 1;
+   }
+
+   t0 = now_ns();
+   for (i = 0; i < threads; i++)
+      if (!(workers[i] = sthread_create(counter_thread, &c)))
+         abort();
+   for (i = 0; i < threads; i++)
+      sthread_join(workers[i]);
+   t1 = now_ns();
+   slock_free(c.lock);
+
+   if (c.counter != threads * iterations)
+   {
+      printf("[FAIL] counter: %u threads lost updates (%lu of %lu)\n",
+            (unsigned)threads, (unsigned long)c.counter,
+            (unsigned long)(threads * iterations));
+      return 1;
+   }
+   printf("counter  %2u threads  %7.1f ns/lock\n", (unsigned)threads,
+         (double)(t1 - t0) / (double)(threads * iterations));
+   return 0;
+}
+
+/* ---- handoff ------------------------------------------------------- */
+
+typedef struct
+{
+   slock_t *lock;
+   scond_t *cond;
+   size_t   rounds;
+   int      turn;    /* 0 = main thread, 1 = partner */
+   size_t   passes;
+} handoff_t;
+
+static void handoff_thread(void *arg)
+{
+   size_t     i;
+   handoff_t *h = (handoff_t*)arg;
+   for (i = 0; i < h->rounds; i++)
+   {
+      slock_lock(h->lock);
+      while (h->turn != 1)
+         scond_wait(h->cond, h->lock);
+      h->passes++;
+      h->turn = 0;
+      scond_signal(h->cond);
+      slock_unlock(h->lock);
+   }
+}
+
+static int run_handoff(size_t rounds)
+{
+   size_t     i;
+   uint64_t   t0, t1;
+   sthread_t *partner;
+   handoff_t  h;
+
+   h.lock   = slock_new();
+   h.cond   = scond_new();
+   h.rounds = rounds;
+   h.turn   = 0;
+   h.passes = 0;
+   if (!h.lock || !h.cond || !(partner = sthread_create(handoff_thread, &h)))
+   {
+      printf("[FAIL] handoff: setup failed\n");
+      return 1;
+   }
+
+   t0 = now_ns();
+   for (i = 0; i < rounds; i++)
+   {
+      slock_lock(h.lock);
+      h.passes++;
+      h.turn = 1;
+      scond_signal(h.cond);
+      while (h.turn != 0)
+         scond_wait(h.cond, h.lock);
+      slock_unlock(h.lock);
+   }
+   t1 = now_ns();
+   sthread_join(partner);
+   scond_free(h.cond);
+   slock_free(h.lock);
+
+   if (h.passes != 2 * rounds)
+   {
+      printf("[FAIL] handoff: %lu passes, expected %lu\n",
+            (unsigned long)h.passes, (unsigned long)(2 * rounds));
+      return 1;
+   }
+   printf("handoff  slock+scond  %7.2f us/round trip\n",
+         (double)(t1 - t0) / 1000.0 / (double)rounds);
+   return 0;
+}
+
+/* ---- wait / notify ------------------------------------------------- */
+
+typedef struct
+{
+   retro_atomic_int_t turn;
+   size_t             rounds;
+} ping_t;
+
+static void pass_turn(ping_t *p, int from, int to)
+{
+   int v;
+   while ((v = retro_atomic_load_acquire_int(&p->turn)) != from)
+      retro_atomic_wait_int(&p->turn, v, -1);
+   retro_atomic_store_release_int(&p->turn, to);
+   retro_atomic_notify_one_int(&p->turn);
+}
+
+static void ping_thread(void *arg)
+{
+   size_t  i;
+   ping_t *p = (ping_t*)arg;
+   for (i = 0; i < p->rounds; i++)
+      pass_turn(p, 1, 2);
+}
+
+static int run_wait(size_t rounds)
+{
+   size_t     i;
+   uint64_t   t0, t1;
+   sthread_t *partner;
+   ping_t     p;
+
+   retro_atomic_int_init(&p.turn, 0);
+   p.rounds = rounds;
+   if (!(partner = sthread_create(ping_thread, &p)))
+   {
+      printf("[FAIL] wait: setup failed\n");
+      return 1;
+   }
+
+   t0 = now_ns();
+   for (i = 0; i < rounds; i++)
+   {
+      /* 0 -> 1 here, 1 -> 2 in the partner, 2 -> 0 here again */
+      pass_turn(&p, 0, 1);
+      pass_turn(&p, 2, 0);
+   }
+   t1 = now_ns();
+   sthread_join(partner);
+
+   if (retro_atomic_load_acquire_int(&p.turn) != 0)
+   {
+      printf("[FAIL] wait: token lost\n");
+      return 1;
+   }
+   /* Value already differs: must not block */
+   if (!retro_atomic_wait_int(&p.turn, 1, -1))
+   {
+      printf("[FAIL] wait: returned timeout for a changed value\n");
+      return 1;
+   }
+   /* Nobody notifies: must time out */
+   if (retro_atomic_wait_int(&p.turn, 0, 1000))
+      printf("note: wait returned early (spurious wakeup)\n");
+   printf("wait     atomic wait  %7.2f us/round trip\n",
+         (double)(t1 - t0) / 1000.0 / (double)rounds);
+   return 0;
+}
+
+/* ---- timeout ------------------------------------------------------- */
+
+static int run_timeout(void)
+{
+   uint64_t t0, t1;
+   bool     signalled;
+   slock_t *lock = slock_new();
+   scond_t *cond = scond_new();
+
+   if (!lock || !cond)
+   {
+      printf("[FAIL] timeout: setup failed\n");
+      return 1;
+   }
+   slock_lock(lock);
+   t0        = now_ns();
+   signalled = scond_wait_timeout(cond, lock, 2000);
+   t1        = now_ns();
+   slock_unlock(lock);
+   scond_free(cond);
+   slock_free(lock);
+
+   if (!signalled && t1 - t0 < 2000000ull)
+   {
+      printf("[FAIL] timeout: timed out after %lu ns\n",
+            (unsigned long)(t1 - t0));
+      return 1;
+   }
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t thread_counts[] = { 1, 2, 4, 8 };
+   size_t i;
+   int    rc         = 0;
+   size_t iterations = DEFAULT_ITERATIONS;
+
+   if (argc > 1)
+      iterations = (size_t)strtoul(argv[1], NULL, 10);
+   if (!iterations)
+      iterations = 1;
+
+   printf("backend: %s\n", BACKEND_NAME);
+   for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+      rc |= run_counter(thread_counts[i], iterations);
+   rc |= run_handoff(iterations / 10 + 1);
+   rc |= run_wait(iterations / 10 + 1);
+   rc |= run_timeout();
+
+   return rc;
+}
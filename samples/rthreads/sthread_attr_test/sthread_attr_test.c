@@ -0,0 +1,285 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (sthread_attr_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for sthread_attr_t.
+ *
+ *  - sthread_create_with_attr starts the thread with the requested
+ *    name, affinity, nice value and stack size (read back through the
+ *    Linux APIs),
+ *  - attributes the process may lack privileges for (SCHED_FIFO, a
+ *    negative nice) never stop the thread from running,
+ *  - tpool_create_with_attr applies the attributes to every worker,
+ *    and tpool_create names its workers "tpool". */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#define STACK_SIZE (512 * 1024)
+#define POOL_TASKS 16
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+/* What a thread observed about itself */
+struct observed
+{
+   char     name[17];
+   uint64_t affinity;
+   size_t   stack_size;
+   int      nice;
+   bool     ran;
+};
+
+static void observe(struct observed *o)
+{
+#ifdef __linux__
+   unsigned       i;
+   cpu_set_t      set;
+   pthread_attr_t pattr;
+
+   memset(o->name, 0, sizeof(o->name));
+   prctl(PR_GET_NAME, (unsigned long)o->name, 0, 0, 0);
+
+   o->affinity = 0;
+   if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (i = 0; i < 64; i++)
+         if (CPU_ISSET(i, &set))
+            o->affinity |= (uint64_t)1 << i;
+
+   o->stack_size = 0;
+   if (pthread_getattr_np(pthread_self(), &pattr) == 0)
+   {
+      pthread_attr_getstacksize(&pattr, &o->stack_size);
+      pthread_attr_destroy(&pattr);
+   }
+
+   o->nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+#endif
+   o->ran = true;
+}
+
+static void observe_thread(void *arg)
+{
+   observe((struct observed*)arg);
+}
+
+static uint64_t first_allowed_cpu(void)
+{
+#ifdef __linux__
+   unsigned  i;
+   cpu_set_t set;
+   if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (i = 0; i < 64; i++)
+         if (CPU_ISSET(i, &set))
+            return (uint64_t)1 << i;
+#endif
+   return 1;
+}
+
+static void test_create_with_attr(void)
+{
+   sthread_attr_t  attr;
+   sthread_t      *thread;
+   struct observed seen;
+   uint64_t        cpu = first_allowed_cpu();
+
+   memset(&seen, 0, sizeof(seen));
+   sthread_attr_init(&attr);
+   attr.name        = "attr-test-with-a-long-name";
+   attr.affinity    = cpu;
+   attr.stack_size  = STACK_SIZE;
+   attr.sched_class = STHREAD_SCHED_BACKGROUND;
+
+   thread = sthread_create_with_attr(observe_thread, &seen, &attr);
+   CHECK(thread != NULL);
+   sthread_join(thread);
+
+   CHECK(seen.ran);
+#ifdef __linux__
+   /* The kernel keeps 15 characters */
+   CHECK(!strcmp(seen.name, "attr-test-with-"));
+   CHECK(seen.affinity == cpu);
+   CHECK(seen.stack_size >= STACK_SIZE);
+   CHECK(seen.nice == STHREAD_BACKGROUND_NICE);
+#endif
+}
+
+static void test_defaults(void)
+{
+   sthread_attr_t  attr;
+   sthread_t      *thread;
+   struct observed parent;
+   struct observed seen;
+
+   memset(&parent, 0, sizeof(parent));
+   memset(&seen, 0, sizeof(seen));
+   observe(&parent);
+
+   /* NULL attributes behave like sthread_create */
+   thread = sthread_create_with_attr(observe_thread, &seen, NULL);
+   CHECK(thread != NULL);
+   sthread_join(thread);
+   CHECK(seen.ran);
+#ifdef __linux__
+   CHECK(seen.nice == parent.nice);
+   CHECK(seen.affinity == parent.affinity);
+#endif
+
+   sthread_attr_init(&attr);
+   CHECK(attr.name == NULL);
+   CHECK(attr.affinity == 0);
+   CHECK(attr.stack_size == 0);
+   CHECK(attr.sched_class == STHREAD_SCHED_DEFAULT);
+   CHECK(attr.priority == 0);
+   CHECK(sthread_set_current_attr(NULL));
+   CHECK(sthread_set_current_attr(&attr));
+}
+
+static void test_privileged(void)
+{
+   sthread_attr_t  attr;
+   sthread_t      *thread;
+   struct observed seen;
+
+   /* Realtime may be refused; the thread must run regardless */
+   memset(&seen, 0, sizeof(seen));
+   sthread_attr_init(&attr);
+   attr.name        = "attr-rt";
+   attr.sched_class = STHREAD_SCHED_REALTIME;
+   attr.priority    = 10;
+   thread = sthread_create_with_attr(observe_thread, &seen, &attr);
+   CHECK(thread != NULL);
+   sthread_join(thread);
+   CHECK(seen.ran);
+
+   memset(&seen, 0, sizeof(seen));
+   sthread_attr_init(&attr);
+   attr.priority = -5;
+   thread = sthread_create_with_attr(observe_thread, &seen, &attr);
+   CHECK(thread != NULL);
+   sthread_join(thread);
+   CHECK(seen.ran);
+}
+
+/* ---- tpool --------------------------------------------------------- */
+
+static slock_t        *pool_lock;
+static struct observed pool_seen[POOL_TASKS];
+static unsigned        pool_next;
+
+static void pool_task(void *arg)
+{
+   struct observed o;
+   memset(&o, 0, sizeof(o));
+   observe(&o);
+   slock_lock(pool_lock);
+   pool_seen[pool_next++] = o;
+   slock_unlock(pool_lock);
+}
+
+static void run_pool(tpool_t *tp)
+{
+   unsigned i;
+   pool_next = 0;
+   for (i = 0; i < POOL_TASKS; i++)
+      CHECK(tpool_add_work(tp, pool_task, NULL));
+   tpool_wait(tp);
+   tpool_destroy(tp);
+   CHECK(pool_next == POOL_TASKS);
+}
+
+static void test_tpool(void)
+{
+   unsigned       i;
+   sthread_attr_t attr;
+   tpool_t       *tp;
+
+   pool_lock = slock_new();
+
+   sthread_attr_init(&attr);
+   attr.name        = "decode";
+   attr.sched_class = STHREAD_SCHED_BACKGROUND;
+   attr.priority    = 5;
+   CHECK((tp = tpool_create_with_attr(3, &attr)) != NULL);
+   if (tp)
+      run_pool(tp);
+#ifdef __linux__
+   for (i = 0; i < pool_next; i++)
+   {
+      CHECK(!strcmp(pool_seen[i].name, "decode"));
+      CHECK(pool_seen[i].nice == 5);
+   }
+#endif
+
+   CHECK((tp = tpool_create(2)) != NULL);
+   if (tp)
+      run_pool(tp);
+#ifdef __linux__
+   for (i = 0; i < pool_next; i++)
+      CHECK(!strcmp(pool_seen[i].name, "tpool"));
+#endif
+
+   slock_free(pool_lock);
+}
+
+int main(void)
+{
+   test_create_with_attr();
+   test_defaults();
+   test_privileged();
+   test_tpool();
+
+   if (failures)
+   {
+      fprintf(stderr, "sthread_attr: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("sthread_attr: all tests passed\n");
+   return 0;
+}
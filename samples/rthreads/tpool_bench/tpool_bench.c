@@ -0,0 +1,230 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (tpool_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fine-grained task benchmark for rthreads/tpool.c.
+ *
+ * Each task does a small, fixed amount of arithmetic (a few hundred
+ * nanoseconds), the size of a decode slice or CRC chunk, so that the
+ * cost of queueing dominates.  Two shapes are timed for a few pool
+ * sizes:
+ *   - flat:   the main thread adds every task, then calls tpool_wait,
+ *   - nested: one root task splits its range in two and adds both
+ *             halves from inside the pool, recursively, down to single
+ *             tasks (divide and conquer, as a parallel decoder would).
+ * Every task writes its result into its own slot; after tpool_wait the
+ * slots are summed and compared with a serial run, which catches lost
+ * or duplicated tasks.
+ *
+ * The Makefile builds this file twice, against the work-stealing
+ * scheduler and against the locked queue (tpool_bench_locked).
+ *
+ * Usage: tpool_bench [tasks-per-run]
+ *
+ * Numbers are only meaningful on a multi-core machine with an -O2
+ * build; under a sanitizer or on one core the run is a stress test. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <retro_atomic.h>
+
+#define DEFAULT_TASKS 200000
+#define TASK_ROUNDS   64
+
+typedef struct
+{
+   tpool_t            *tp;
+   uint32_t           *results;
+   struct split       *nodes;
+   retro_atomic_size_t next_node;
+} bench_t;
+
+struct split
+{
+   bench_t *bench;
+   size_t   begin;
+   size_t   end;
+};
+
+static uint64_t now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t task_value(size_t i)
+{
+   unsigned r;
+   uint32_t x = (uint32_t)i * 2654435761u + 1;
+   for (r = 0; r < TASK_ROUNDS; r++)
+   {
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+   }
+   return x;
+}
+
+static uint64_t expected_sum(size_t tasks)
+{
+   size_t   i;
+   uint64_t sum = 0;
+   for (i = 0; i < tasks; i++)
+      sum += task_value(i);
+   return sum;
+}
+
+static uint64_t results_sum(const uint32_t *results, size_t tasks)
+{
+   size_t   i;
+   uint64_t sum = 0;
+   for (i = 0; i < tasks; i++)
+      sum += results[i];
+   return sum;
+}
+
+/* ---- flat ---------------------------------------------------------- */
+
+static uint32_t *flat_results;
+
+static void flat_task(void *arg)
+{
+   size_t i        = (size_t)(uintptr_t)arg;
+   flat_results[i] = task_value(i);
+}
+
+/* ---- nested -------------------------------------------------------- */
+
+static void split_task(void *arg);
+
+static void split_add(bench_t *b, size_t begin, size_t end)
+{
+   size_t        n = retro_atomic_fetch_add_size(&b->next_node, 1);
+   struct split *s = &b->nodes[n];
+   s->bench        = b;
+   s->begin        = begin;
+   s->end          = end;
+   if (!tpool_add_work(b->tp, split_task, s))
+      abort();
+}
+
+static void split_task(void *arg)
+{
+   struct split *s = (struct split*)arg;
+   bench_t      *b = s->bench;
+
+   if (s->end - s->begin == 1)
+   {
+      b->results[s->begin] = task_value(s->begin);
+      return;
+   }
+   split_add(b, s->begin, s->begin + (s->end - s->begin) / 2);
+   split_add(b, s->begin + (s->end - s->begin) / 2, s->end);
+}
+
+/* ---- driver -------------------------------------------------------- */
+
+static int run(size_t threads, size_t tasks, uint64_t expect)
+{
+   bench_t  b;
+   size_t   i;
+   uint64_t t0, t1, t2;
+   int      rc = 0;
+
+   b.tp      = tpool_create(threads);
+   b.results = (uint32_t*)calloc(tasks, sizeof(*b.results));
+   /* A binary split of n leaves has 2n - 1 nodes */
+   b.nodes   = (struct split*)malloc(2 * tasks * sizeof(*b.nodes));
+   retro_atomic_size_init(&b.next_node, 0);
+   if (!b.tp || !b.results || !b.nodes)
+   {
+      printf("[FAIL] %u threads: setup failed\n", (unsigned)threads);
+      rc = 1;
+      goto end;
+   }
+
+   flat_results = b.results;
+   t0 = now_ns();
+   for (i = 0; i < tasks; i++)
+      if (!tpool_add_work(b.tp, flat_task, (void*)(uintptr_t)i))
+         abort();
+   tpool_wait(b.tp);
+   t1 = now_ns();
+   if (results_sum(b.results, tasks) != expect)
+   {
+      printf("[FAIL] %u threads: flat checksum mismatch\n",
+            (unsigned)threads);
+      rc = 1;
+   }
+
+   for (i = 0; i < tasks; i++)
+      b.results[i] = 0;
+   t1 = now_ns();
+   split_add(&b, 0, tasks);
+   tpool_wait(b.tp);
+   t2 = now_ns();
+   if (results_sum(b.results, tasks) != expect)
+   {
+      printf("[FAIL] %u threads: nested checksum mismatch\n",
+            (unsigned)threads);
+      rc = 1;
+   }
+
+   printf("%2u threads  flat %9.0f tasks/s  nested %9.0f tasks/s\n",
+         (unsigned)threads,
+         tasks / ((t1 - t0) / 1e9),
+         (2 * tasks - 1) / ((t2 - t1) / 1e9));
+
+end:
+   tpool_destroy(b.tp);
+   free(b.results);
+   free(b.nodes);
+   return rc;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t threads[] = { 1, 2, 4, 8 };
+   size_t   tasks = DEFAULT_TASKS;
+   size_t   i;
+   uint64_t expect;
+   int      rc    = 0;
+
+   if (argc > 1)
+      tasks = (size_t)strtoul(argv[1], NULL, 10);
+   if (tasks == 0)
+      tasks = 1;
+
+   expect = expected_sum(tasks);
+   printf("%u tasks of %u rounds each\n", (unsigned)tasks, TASK_ROUNDS);
+   for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+      rc |= run(threads[i], tasks, expect);
+
+   if (rc)
+      printf("tpool_bench: FAILED\n");
+   return rc;
+}
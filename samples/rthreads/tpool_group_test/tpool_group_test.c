@@ -0,0 +1,456 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (tpool_group_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Tests for tpool task groups, dependency edges and
+ * tpool_parallel_for.
+ *
+ *  - A group wait returns once the group's own tasks are done, even
+ *    while another group's task is still blocked.
+ *  - Pipelines of dependent tasks run each stage after its inputs,
+ *    checked on many independent decode -> convert -> scale chains
+ *    and on a diamond (one task joining two predecessors).
+ *  - tpool_parallel_for visits every index exactly once for a range
+ *    of grain sizes, and also works when called from inside a job on
+ *    the same pool.
+ *  - Destroying a pool while parallel_for helpers are still queued
+ *    releases them (the leak shows under SANITIZER=address). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <retro_timers.h>
+
+#define POOL_THREADS 4
+#define CHAINS       200
+#define RANGE_SIZE   10007
+
+static int failures = 0;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) \
+      { \
+         fprintf(stderr, "%s:%d: check failed: %s\n", \
+               __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while (0)
+
+/* ---- group isolation ----------------------------------------------- */
+
+struct gate
+{
+   slock_t *lock;
+   scond_t *cond;
+   bool     open;
+   int      count;
+};
+
+static void gate_job(void *arg)
+{
+   struct gate *g = (struct gate*)arg;
+   slock_lock(g->lock);
+   while (!g->open)
+      scond_wait(g->cond, g->lock);
+   slock_unlock(g->lock);
+}
+
+static void count_job(void *arg)
+{
+   struct gate *g = (struct gate*)arg;
+   slock_lock(g->lock);
+   g->count++;
+   slock_unlock(g->lock);
+}
+
+static void test_group_isolation(tpool_t *tp)
+{
+   int            i;
+   struct gate    g;
+   tpool_group_t *blocked = tpool_group_new(tp);
+   tpool_group_t *mine    = tpool_group_new(tp);
+
+   CHECK(blocked && mine);
+   if (!blocked || !mine)
+      return;
+
+   g.lock  = slock_new();
+   g.cond  = scond_new();
+   g.open  = false;
+   g.count = 0;
+
+   CHECK(tpool_group_add_work(blocked, gate_job, &g));
+   for (i = 0; i < 100; i++)
+      CHECK(tpool_group_add_work(mine, count_job, &g));
+
+   /* Must return although the other group is stuck */
+   tpool_group_wait(mine);
+   slock_lock(g.lock);
+   CHECK(g.count == 100);
+   g.open = true;
+   scond_broadcast(g.cond);
+   slock_unlock(g.lock);
+
+   tpool_group_free(blocked);
+   tpool_group_free(mine);
+   slock_free(g.lock);
+   scond_free(g.cond);
+
+   CHECK(!tpool_group_new(NULL));
+   CHECK(!tpool_task_new(NULL, count_job, NULL));
+}
+
+/* ---- dependencies -------------------------------------------------- */
+
+struct frame
+{
+   int decoded;
+   int converted;
+   int scaled;
+   int ok;
+};
+
+static void decode(void *arg)
+{
+   struct frame *f = (struct frame*)arg;
+   f->decoded      = 1;
+}
+
+static void convert(void *arg)
+{
+   struct frame *f = (struct frame*)arg;
+   f->converted    = f->decoded + 1;
+}
+
+static void scale(void *arg)
+{
+   struct frame *f = (struct frame*)arg;
+   f->scaled       = f->converted + 1;
+   f->ok           = (f->decoded == 1 && f->converted == 2);
+}
+
+static void test_pipeline(tpool_t *tp)
+{
+   int            i;
+   struct frame  *frames = (struct frame*)calloc(CHAINS, sizeof(*frames));
+   tpool_group_t *g      = tpool_group_new(tp);
+
+   CHECK(frames && g);
+   if (!frames || !g)
+      return;
+
+   for (i = 0; i < CHAINS; i++)
+   {
+      tpool_task_t *dec = tpool_task_new(g, decode,  &frames[i]);
+      tpool_task_t *cvt = tpool_task_new(g, convert, &frames[i]);
+      tpool_task_t *scl = tpool_task_new(g, scale,   &frames[i]);
+      CHECK(dec && cvt && scl);
+      CHECK(tpool_task_depend(cvt, dec));
+      CHECK(tpool_task_depend(scl, cvt));
+      CHECK(!tpool_task_depend(scl, scl));
+      /* Submit in reverse: the edges alone must order the stages */
+      tpool_task_submit(scl);
+      tpool_task_submit(cvt);
+      tpool_task_submit(dec);
+   }
+   tpool_group_wait(g);
+
+   for (i = 0; i < CHAINS; i++)
+   {
+      CHECK(frames[i].scaled == 3);
+      CHECK(frames[i].ok);
+   }
+
+   tpool_group_free(g);
+   free(frames);
+}
+
+struct diamond
+{
+   slock_t *lock;
+   int      left;
+   int      right;
+   int      joined;
+};
+
+/* Clears both halves, so a half that ran early is lost */
+static void diamond_root(void *arg)
+{
+   struct diamond *d = (struct diamond*)arg;
+   slock_lock(d->lock);
+   d->left  = 0;
+   d->right = 0;
+   slock_unlock(d->lock);
+}
+
+static void diamond_left(void *arg)
+{
+   struct diamond *d = (struct diamond*)arg;
+   slock_lock(d->lock);
+   d->left = 1;
+   slock_unlock(d->lock);
+}
+
+static void diamond_right(void *arg)
+{
+   struct diamond *d = (struct diamond*)arg;
+   slock_lock(d->lock);
+   d->right = 1;
+   slock_unlock(d->lock);
+}
+
+static void diamond_join(void *arg)
+{
+   struct diamond *d = (struct diamond*)arg;
+   slock_lock(d->lock);
+   d->joined = d->left + d->right;
+   slock_unlock(d->lock);
+}
+
+static void test_diamond(tpool_t *tp)
+{
+   int            i;
+   tpool_group_t *g = tpool_group_new(tp);
+   tpool_group_t *h = tpool_group_new(tp);
+
+   CHECK(g && h);
+   if (!g || !h)
+      return;
+
+   for (i = 0; i < CHAINS; i++)
+   {
+      struct diamond d;
+      tpool_task_t  *root, *l, *r, *join;
+
+      memset(&d, 0, sizeof(d));
+      d.lock = slock_new();
+      root   = tpool_task_new(g, diamond_root,  &d);
+      l      = tpool_task_new(g, diamond_left,  &d);
+      r      = tpool_task_new(g, diamond_right, &d);
+      /* The join lives in another group, so waiting for it alone must
+       * cover its predecessors too */
+      join   = tpool_task_new(h, diamond_join,  &d);
+      CHECK(tpool_task_depend(l, root));
+      CHECK(tpool_task_depend(r, root));
+      CHECK(tpool_task_depend(join, l));
+      CHECK(tpool_task_depend(join, r));
+      tpool_task_submit(join);
+      tpool_task_submit(r);
+      tpool_task_submit(l);
+      tpool_task_submit(root);
+
+      tpool_group_wait(h);
+      CHECK(d.joined == 2);
+      tpool_group_wait(g);
+      slock_free(d.lock);
+   }
+
+   tpool_group_free(g);
+   tpool_group_free(h);
+}
+
+/* ---- parallel_for -------------------------------------------------- */
+
+struct visits
+{
+   unsigned char *seen;
+   size_t         bad;
+   slock_t       *lock;
+};
+
+static void visit(size_t begin, size_t end, void *arg)
+{
+   size_t          i;
+   struct visits  *v = (struct visits*)arg;
+   for (i = begin; i < end; i++)
+      v->seen[i]++;
+   if (begin >= end)
+   {
+      slock_lock(v->lock);
+      v->bad++;
+      slock_unlock(v->lock);
+   }
+}
+
+static void check_range(tpool_t *tp, size_t begin, size_t end,
+      size_t grain)
+{
+   size_t        i;
+   struct visits v;
+
+   v.seen = (unsigned char*)calloc(end + 1, 1);
+   v.bad  = 0;
+   v.lock = slock_new();
+
+   CHECK(tpool_parallel_for(tp, begin, end, grain, visit, &v));
+   for (i = 0; i < begin; i++)
+      CHECK(v.seen[i] == 0);
+   for (i = begin; i < end; i++)
+      if (v.seen[i] != 1)
+      {
+         fprintf(stderr, "index %u visited %u times (grain %u)\n",
+               (unsigned)i, (unsigned)v.seen[i], (unsigned)grain);
+         failures++;
+         break;
+      }
+   CHECK(v.bad == 0);
+
+   slock_free(v.lock);
+   free(v.seen);
+}
+
+struct nested
+{
+   tpool_t *tp;
+   int      ok;
+};
+
+static void nested_job(void *arg)
+{
+   struct nested *n = (struct nested*)arg;
+   struct visits  v;
+   size_t         i;
+
+   v.seen = (unsigned char*)calloc(RANGE_SIZE, 1);
+   v.bad  = 0;
+   v.lock = slock_new();
+   n->ok  = tpool_parallel_for(n->tp, 0, RANGE_SIZE, 0, visit, &v);
+   for (i = 0; i < RANGE_SIZE; i++)
+      if (v.seen[i] != 1)
+         n->ok = 0;
+   slock_free(v.lock);
+   free(v.seen);
+}
+
+static void test_parallel_for(tpool_t *tp)
+{
+   int            i;
+   struct nested  n[POOL_THREADS * 2];
+   tpool_group_t *g;
+
+   check_range(tp, 0, RANGE_SIZE, 0);
+   check_range(tp, 0, RANGE_SIZE, 1);
+   check_range(tp, 0, RANGE_SIZE, 7);
+   check_range(tp, 3, RANGE_SIZE, 1000);
+   check_range(tp, 0, RANGE_SIZE, RANGE_SIZE * 2);
+   check_range(tp, 5, 6, 0);
+   check_range(tp, 9, 9, 4);
+
+   CHECK(!tpool_parallel_for(NULL, 0, 1, 1, visit, NULL));
+   CHECK(!tpool_parallel_for(tp, 0, 1, 1, NULL, NULL));
+   CHECK(!tpool_parallel_for(tp, 2, 1, 1, visit, NULL));
+
+   /* More nested loops than threads: every worker ends up inside a
+    * parallel_for and must still make progress on its own */
+   g = tpool_group_new(tp);
+   CHECK(g != NULL);
+   if (!g)
+      return;
+   for (i = 0; i < POOL_THREADS * 2; i++)
+   {
+      n[i].tp = tp;
+      n[i].ok = 0;
+      CHECK(tpool_group_add_work(g, nested_job, &n[i]));
+   }
+   tpool_group_wait(g);
+   for (i = 0; i < POOL_THREADS * 2; i++)
+      CHECK(n[i].ok);
+   tpool_group_free(g);
+}
+
+static void open_gate_later(void *arg)
+{
+   struct gate *g = (struct gate*)arg;
+   retro_sleep(50);
+   slock_lock(g->lock);
+   g->open = true;
+   scond_broadcast(g->cond);
+   slock_unlock(g->lock);
+}
+
+/* The only worker is stuck, so the caller runs every chunk and its
+ * helper is still queued when the pool goes away */
+static void test_destroy_queued_helpers(void)
+{
+   size_t        i;
+   struct gate   g;
+   struct visits v;
+   sthread_t    *opener;
+   tpool_t      *tp = tpool_create(1);
+
+   CHECK(tp != NULL);
+   if (!tp)
+      return;
+
+   g.lock  = slock_new();
+   g.cond  = scond_new();
+   g.open  = false;
+   v.seen  = (unsigned char*)calloc(RANGE_SIZE, 1);
+   v.bad   = 0;
+   v.lock  = slock_new();
+
+   CHECK(tpool_add_work(tp, gate_job, &g));
+   CHECK(tpool_parallel_for(tp, 0, RANGE_SIZE, 1, visit, &v));
+   for (i = 0; i < RANGE_SIZE; i++)
+      CHECK(v.seen[i] == 1);
+   CHECK(v.bad == 0);
+
+   /* Opens the gate once tpool_destroy has told the worker to stop */
+   opener = sthread_create(open_gate_later, &g);
+   CHECK(opener != NULL);
+   tpool_destroy(tp);
+   if (opener)
+      sthread_join(opener);
+
+   slock_free(v.lock);
+   free(v.seen);
+   slock_free(g.lock);
+   scond_free(g.cond);
+}
+
+int main(int argc, char *argv[])
+{
+   tpool_t *tp = tpool_create(POOL_THREADS);
+
+   CHECK(tp != NULL);
+   if (!tp)
+      return 1;
+
+   test_group_isolation(tp);
+   test_pipeline(tp);
+   test_diamond(tp);
+   test_parallel_for(tp);
+
+   tpool_destroy(tp);
+   test_destroy_queued_helpers();
+
+   if (failures)
+   {
+      fprintf(stderr, "tpool_group: %d check(s) failed\n", failures);
+      return 1;
+   }
+   printf("tpool_group: all tests passed\n");
+   return 0;
+}